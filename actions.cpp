@@ -0,0 +1,207 @@
+#include "actions.h"
+#include "log.h"
+
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+struct PendingAction
+{
+    uint64_t id;
+    WindowAction action;
+    std::chrono::steady_clock::time_point submitted;
+};
+
+static std::mutex queueMutex;
+static std::condition_variable queueChanged;
+static std::deque<PendingAction> queue;
+static bool busy = false; // worker is inside an action
+static bool stopping = false;
+static bool running = false;
+static uint64_t nextId = 1;
+static std::thread worker;
+
+static ActionBackendFactory backendFactory = nullptr;
+static ActionDone actionDone = nullptr;
+
+static uint64_t micros_between(const std::chrono::steady_clock::time_point from,
+                               const std::chrono::steady_clock::time_point to)
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(to - from).count());
+}
+
+const char* action_name(const WindowActionType type)
+{
+    switch (type)
+    {
+    case WindowActionType::Close: return "close";
+    case WindowActionType::Minimize: return "minimize";
+    case WindowActionType::MoveToDesktop: return "move to desktop";
+    case WindowActionType::Tile: return "tile";
+    }
+    return "?";
+}
+
+std::vector<WindowRect> tile_layout(const WindowRect& area, const size_t count)
+{
+    std::vector<WindowRect> cells;
+    if (count == 0) return cells;
+    cells.reserve(count);
+
+    const auto columns = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+    const size_t rows = (count + columns - 1) / columns;
+
+    // edges from exact integer division, so neighbours share an edge and the
+    // cells add up to the whole area whatever the rounding
+    const auto edge = [](const int start, const int length, const size_t index, const size_t parts)
+    {
+        return start + static_cast<int>(static_cast<long long>(length) * static_cast<long long>(index) /
+            static_cast<long long>(parts));
+    };
+
+    for (size_t row = 0; row < rows; ++row)
+    {
+        const size_t inRow = row + 1 < rows ? columns : count - columns * (rows - 1);
+        const int top = edge(area.y, area.height, row, rows);
+        const int bottom = edge(area.y, area.height, row + 1, rows);
+        for (size_t column = 0; column < inRow; ++column)
+        {
+            const int left = edge(area.x, area.width, column, inRow);
+            const int right = edge(area.x, area.width, column + 1, inRow);
+            cells.push_back({left, top, right - left, bottom - top});
+        }
+    }
+    return cells;
+}
+
+static size_t run_action(WindowBackend& backend, const WindowAction& action)
+{
+    size_t succeeded = 0;
+    switch (action.type)
+    {
+    case WindowActionType::Close:
+        for (const HWND hwnd : action.windows)
+        {
+            succeeded += backend.close_window(hwnd);
+        }
+        break;
+    case WindowActionType::Minimize:
+        for (const HWND hwnd : action.windows)
+        {
+            succeeded += backend.minimize(hwnd);
+        }
+        break;
+    case WindowActionType::MoveToDesktop:
+        for (const HWND hwnd : action.windows)
+        {
+            succeeded += backend.move_to_desktop_of(hwnd, action.anchor);
+        }
+        break;
+    case WindowActionType::Tile:
+        {
+            const auto cells = tile_layout(backend.work_area(), action.windows.size());
+            std::vector<WindowPlacement> placements;
+            placements.reserve(cells.size());
+            for (size_t i = 0; i < cells.size(); ++i)
+            {
+                placements.push_back({action.windows[i], cells[i]});
+            }
+            succeeded = backend.set_positions(placements);
+        }
+        break;
+    }
+    return succeeded;
+}
+
+static void worker_main()
+{
+    // the Win32 backend sets up COM for the thread that creates it
+    const std::unique_ptr<WindowBackend> owned = backendFactory ? backendFactory() : nullptr;
+    WindowBackend& backend = owned ? *owned : window_backend();
+
+    std::unique_lock lock(queueMutex);
+    while (true)
+    {
+        queueChanged.wait(lock, [] { return stopping || !queue.empty(); });
+        if (queue.empty()) break;
+
+        PendingAction pending = std::move(queue.front());
+        queue.pop_front();
+        busy = true;
+        lock.unlock();
+
+        const auto start = std::chrono::steady_clock::now();
+        const size_t succeeded = run_action(backend, pending.action);
+        const auto end = std::chrono::steady_clock::now();
+
+        const ActionResult result{
+            pending.id, pending.action.type, pending.action.windows.size(), succeeded,
+            micros_between(pending.submitted, start), micros_between(start, end),
+        };
+        if (result.succeeded == result.requested)
+        {
+            LOG_INFO("Action {} {}: {} windows in {} us (queued {} us)", result.id, action_name(result.type),
+                     result.requested, result.runUs, result.queuedUs);
+        }
+        else
+        {
+            LOG_WARN("Action {} {}: {} of {} windows in {} us (queued {} us)", result.id,
+                     action_name(result.type), result.succeeded, result.requested, result.runUs, result.queuedUs);
+        }
+        if (actionDone) actionDone(result);
+
+        lock.lock();
+        busy = false;
+        queueChanged.notify_all();
+    }
+}
+
+bool actions_start(const ActionBackendFactory make_backend, const ActionDone done)
+{
+    std::lock_guard lock(queueMutex);
+    if (running) return false;
+
+    backendFactory = make_backend;
+    actionDone = done;
+    stopping = false;
+    running = true;
+    worker = std::thread(worker_main);
+    return true;
+}
+
+void actions_stop()
+{
+    {
+        std::lock_guard lock(queueMutex);
+        if (!running) return;
+        stopping = true;
+        running = false;
+    }
+    queueChanged.notify_all();
+    worker.join();
+}
+
+uint64_t submit_action(WindowAction action)
+{
+    if (action.windows.empty()) return 0;
+
+    uint64_t id;
+    {
+        std::lock_guard lock(queueMutex);
+        if (!running) return 0;
+
+        id = nextId++;
+        queue.push_back({id, std::move(action), std::chrono::steady_clock::now()});
+    }
+    queueChanged.notify_all();
+    return id;
+}
+
+void actions_wait_idle()
+{
+    std::unique_lock lock(queueMutex);
+    queueChanged.wait(lock, [] { return queue.empty() && !busy; });
+}
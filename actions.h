@@ -0,0 +1,65 @@
+#ifndef FINDMYWINDOWS_ACTIONS_H
+#define FINDMYWINDOWS_ACTIONS_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "backend.h"
+
+// Multi-window actions from the switcher, run in order on a worker thread so a
+// hung app stalls the queue rather than the GUI. Each action is one batch: a
+// tile of N windows is a single deferred positioning call, not N moves.
+
+enum class WindowActionType
+{
+    Close,
+    Minimize,
+    MoveToDesktop,
+    Tile,
+};
+
+struct WindowAction
+{
+    WindowActionType type;
+    std::vector<HWND> windows;
+    // MoveToDesktop: a window on the target desktop, null for the foreground window's
+    HWND anchor = nullptr;
+};
+
+struct ActionResult
+{
+    uint64_t id;
+    WindowActionType type;
+    size_t requested;
+    size_t succeeded;
+    // submit to start, and time spent in the backend
+    uint64_t queuedUs;
+    uint64_t runUs;
+};
+
+// Called on the worker thread after every action
+using ActionDone = void (*)(const ActionResult& result);
+
+// Called once on the worker thread. Returning null (or passing no factory at all)
+// shares window_backend(), which then has to be thread safe like FakeBackend.
+using ActionBackendFactory = std::unique_ptr<WindowBackend> (*)();
+
+bool actions_start(ActionBackendFactory make_backend, ActionDone done);
+
+// Runs what is already queued, then joins the worker
+void actions_stop();
+
+// Returns the action id, 0 when the worker isn't running or there is nothing to do
+uint64_t submit_action(WindowAction action);
+
+// Blocks until the queue is empty and the last action finished
+void actions_wait_idle();
+
+const char* action_name(WindowActionType type);
+
+// Grid of count cells covering area without gaps or overlap, row by row.
+// Rows get ceil(sqrt(count)) cells, the last row splits its width among fewer.
+std::vector<WindowRect> tile_layout(const WindowRect& area, size_t count);
+
+#endif //FINDMYWINDOWS_ACTIONS_H
@@ -0,0 +1,115 @@
+#include "app_identity.h"
+#include "backend.h"
+
+#include <algorithm>
+
+static char fold(const char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+bool is_frame_host(const std::string_view processName)
+{
+    static constexpr std::string_view hosts[] = {"applicationframehost.exe"};
+    return std::ranges::any_of(hosts, [&](const std::string_view host)
+    {
+        return std::ranges::equal(processName, host, [](const char a, const char b) { return fold(a) == b; });
+    });
+}
+
+bool HostedAppResolver::walk(WindowBackend& backend, const HWND hwnd, const DWORD hostId, AppIdentity& out)
+{
+    ++walkCount;
+    children.clear();
+    backend.child_windows(hwnd, children);
+    for (const HWND child : children)
+    {
+        const DWORD processId = backend.process_id(child);
+        if (processId == 0 || processId == hostId) continue;
+
+        out.processId = processId;
+        out.processName = backend.process_name(processId);
+        out.package = backend.package_name(processId);
+        return true;
+    }
+    return false;
+}
+
+const AppIdentity* HostedAppResolver::resolve(WindowBackend& backend, const HWND hwnd, const DWORD hostId,
+                                              const uint64_t generation)
+{
+    auto [it, inserted] = entries.try_emplace(hwnd);
+    Entry& entry = it->second;
+    // a handle reused by another host process without us seeing the destroy
+    if (!inserted && entry.hostId != hostId)
+    {
+        entry = Entry{};
+    }
+    entry.hostId = hostId;
+    entry.generation = generation;
+
+    if (entry.resolved) return &entry.app;
+    if (generation < entry.retryAt) return nullptr;
+
+    if (walk(backend, hwnd, hostId, entry.app))
+    {
+        entry.resolved = true;
+        return &entry.app;
+    }
+
+    const uint32_t interval = std::min<uint32_t>(1u << std::min<uint32_t>(entry.failures, 31), max_retry_interval);
+    entry.retryAt = generation + interval;
+    ++entry.failures;
+    return nullptr;
+}
+
+void HostedAppResolver::keep(const HWND hwnd, const uint64_t generation)
+{
+    if (const auto it = entries.find(hwnd); it != entries.end())
+    {
+        it->second.generation = generation;
+    }
+}
+
+void HostedAppResolver::forget(const HWND hwnd)
+{
+    entries.erase(hwnd);
+}
+
+void HostedAppResolver::sweep(const uint64_t generation)
+{
+    std::erase_if(entries, [&](const auto& entry) { return entry.second.generation != generation; });
+}
+
+void HostedAppResolver::clear()
+{
+    entries.clear();
+}
+
+size_t HostedAppResolver::size() const
+{
+    return entries.size();
+}
+
+// heap bytes of a string beyond its inline buffer
+static size_t heap_bytes(const std::string& text)
+{
+    return text.capacity() > std::string().capacity() ? text.capacity() + 1 : 0;
+}
+
+size_t HostedAppResolver::bytes() const
+{
+    // a node per entry, the key and value plus the next pointer and cached hash
+    size_t total = entries.bucket_count() * sizeof(void*) + children.capacity() * sizeof(HWND);
+    for (const auto& [hwnd, entry] : entries)
+    {
+        total += sizeof(std::pair<const HWND, Entry>) + 2 * sizeof(void*);
+        total += heap_bytes(entry.app.processName) + heap_bytes(entry.app.package);
+    }
+    return total;
+}
+
+uint64_t HostedAppResolver::walks() const
+{
+    return walkCount;
+}
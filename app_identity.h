@@ -0,0 +1,78 @@
+#ifndef FINDMYWINDOWS_APP_IDENTITY_H
+#define FINDMYWINDOWS_APP_IDENTITY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "platform.h"
+
+class WindowBackend;
+
+// The process that actually owns a window's content
+struct AppIdentity
+{
+    DWORD processId = 0;
+    std::string processName;
+    // package family name, empty for unpackaged apps
+    std::string package;
+};
+
+// Processes whose top-level windows are frames around another process's window,
+// ApplicationFrameHost.exe for UWP apps
+bool is_frame_host(std::string_view processName);
+
+// Finds the app behind a frame host window by walking its children for the first
+// one owned by another process, the app's CoreWindow. The walk costs a call per
+// child, so the result is kept per frame until the frame is destroyed or no longer
+// listed. Not thread safe, tabs.cpp calls it under its metadata lock.
+class HostedAppResolver
+{
+public:
+    // A frame without the app's window in it, as while the app starts up or while
+    // it is minimized and suspended, is walked again after 1, 2, 4 ... enumerations
+    static constexpr uint32_t max_retry_interval = 64;
+
+    // The app behind hwnd, a window of the frame host process hostId. Null when the
+    // walk found no other process, or found none recently and isn't due again.
+    const AppIdentity* resolve(WindowBackend& backend, HWND hwnd, DWORD hostId, uint64_t generation);
+
+    // Keeps hwnd's entry through the sweep without resolving anything
+    void keep(HWND hwnd, uint64_t generation);
+    // The frame was destroyed, its handle may be reused by an unrelated window
+    void forget(HWND hwnd);
+    // Drops the frames neither resolved nor kept since generation
+    void sweep(uint64_t generation);
+    void clear();
+
+    size_t size() const;
+    // Table, entries and their strings, an estimate
+    size_t bytes() const;
+    // Child walks so far
+    uint64_t walks() const;
+
+private:
+    struct Entry
+    {
+        AppIdentity app;
+        DWORD hostId = 0;
+        bool resolved = false;
+        uint32_t failures = 0;
+        // generation of the next walk while unresolved
+        uint64_t retryAt = 0;
+        uint64_t generation = 0;
+    };
+
+    // false when no child belongs to another process
+    bool walk(WindowBackend& backend, HWND hwnd, DWORD hostId, AppIdentity& out);
+
+    std::unordered_map<HWND, Entry> entries;
+    // reused across walks
+    std::vector<HWND> children;
+    uint64_t walkCount = 0;
+};
+
+#endif //FINDMYWINDOWS_APP_IDENTITY_H
@@ -0,0 +1,1077 @@
+#include "app_index.h"
+#include "log.h"
+#include "platform.h"
+#include "query.h"
+#include "utf.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#ifdef __linux__
+#include <cerrno>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+const std::string FIND_MY_WIN_APPS = "findmywindows.apps";
+
+static constexpr char index_magic[4] = {'F', 'M', 'W', 'A'};
+static constexpr uint32_t index_version = 1;
+static constexpr char separator = static_cast<char>(std::filesystem::path::preferred_separator);
+
+static char fold(const char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+static int compare_folded(const std::string_view a, const std::string_view b)
+{
+    const size_t common = std::min(a.size(), b.size());
+    for (size_t i = 0; i < common; ++i)
+    {
+        const char x = fold(a[i]);
+        const char y = fold(b[i]);
+        if (x != y) return static_cast<unsigned char>(x) < static_cast<unsigned char>(y) ? -1 : 1;
+    }
+    return a.size() < b.size() ? -1 : a.size() > b.size() ? 1 : 0;
+}
+
+static bool ends_with_folded(const std::string_view text, const std::string_view suffix)
+{
+    return text.size() >= suffix.size() &&
+        std::ranges::equal(text.substr(text.size() - suffix.size()), suffix,
+                           [](const char a, const char b) { return fold(a) == b; });
+}
+
+// Paths are UTF-8 everywhere, std::filesystem would read a narrow string in the ANSI code page on Windows
+static std::filesystem::path to_path(const std::string_view utf8)
+{
+    return std::u8string_view(reinterpret_cast<const char8_t*>(utf8.data()), utf8.size());
+}
+
+static std::string from_path(const std::filesystem::path& path)
+{
+    const std::u8string text = path.u8string();
+    return {text.begin(), text.end()};
+}
+
+static std::string normalize_root(const std::string& root)
+{
+    std::string path = from_path(to_path(root).lexically_normal().make_preferred());
+    while (path.size() > 1 && path.back() == separator) path.pop_back();
+    return path;
+}
+
+static bool is_app_file(const std::string_view path)
+{
+    return ends_with_folded(path, ".desktop") || ends_with_folded(path, ".lnk");
+}
+
+static int64_t modified_time(const std::string& path, std::error_code& error)
+{
+    return std::filesystem::last_write_time(to_path(path), error).time_since_epoch().count();
+}
+
+static std::string_view trim(std::string_view text)
+{
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) text.remove_suffix(1);
+    return text;
+}
+
+// Name and Exec of the [Desktop Entry] group, false for anything but a shown application.
+// Exec field codes (%f, %U, ...) are dropped, nothing is there to fill them in.
+static bool parse_desktop_entry(std::string_view text, std::string_view& name, std::string& command)
+{
+    bool inEntry = false;
+    bool application = false;
+    bool hidden = false;
+    std::string_view exec;
+    while (!text.empty())
+    {
+        const size_t end = text.find('\n');
+        const std::string_view line = trim(text.substr(0, end));
+        text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+        if (line.empty() || line.front() == '#') continue;
+
+        if (line.front() == '[')
+        {
+            inEntry = line == "[Desktop Entry]";
+            continue;
+        }
+        const size_t equals = line.find('=');
+        if (!inEntry || equals == std::string_view::npos) continue;
+
+        // localized keys like Name[de] are left alone
+        const std::string_view key = trim(line.substr(0, equals));
+        const std::string_view value = trim(line.substr(equals + 1));
+        if (key == "Name") name = value;
+        else if (key == "Exec") exec = value;
+        else if (key == "Type") application = value == "Application";
+        else if (key == "NoDisplay" || key == "Hidden") hidden = hidden || value == "true";
+    }
+    if (!application || hidden || name.empty() || exec.empty()) return false;
+
+    command.clear();
+    for (size_t i = 0; i < exec.size(); ++i)
+    {
+        if (exec[i] != '%' || i + 1 == exec.size())
+        {
+            command += exec[i];
+            continue;
+        }
+        if (exec[++i] == '%') command += '%';
+    }
+    command.erase(trim(command).size());
+    return !command.empty();
+}
+
+static bool read_file(const std::string& path, std::string& out)
+{
+    // .desktop files are a few KB, anything longer than this isn't one
+    out.resize(64 * 1024);
+    std::ifstream file(to_path(path), std::ios::binary);
+    if (!file) return false;
+
+    file.read(out.data(), static_cast<std::streamsize>(out.size()));
+    out.resize(static_cast<size_t>(file.gcount()));
+    return true;
+}
+
+void coalesce_changes(std::vector<AppChange>& changes)
+{
+    std::vector<bool> keep(changes.size());
+    std::unordered_set<std::string_view> seen;
+    for (size_t i = changes.size(); i-- > 0;)
+    {
+        keep[i] = seen.insert(changes[i].path).second;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < changes.size(); ++i)
+    {
+        if (!keep[i]) continue;
+        if (kept != i) changes[kept] = std::move(changes[i]);
+        ++kept;
+    }
+    changes.resize(kept);
+}
+
+std::string_view AppIndex::text(const uint32_t offset, const uint16_t length) const
+{
+    return {pool.data() + offset, length};
+}
+
+uint32_t AppIndex::add_text(const std::string_view text, uint16_t& length)
+{
+    const auto offset = static_cast<uint32_t>(pool.size());
+    length = static_cast<uint16_t>(std::min<size_t>(text.size(), UINT16_MAX));
+    pool.append(text.substr(0, length));
+    return offset;
+}
+
+std::vector<AppIndex::Entry>::iterator AppIndex::find_entry(const std::string_view path)
+{
+    return std::ranges::lower_bound(entries, path, {}, [&](const Entry& entry)
+    {
+        return text(entry.path, entry.pathLength);
+    });
+}
+
+std::vector<AppIndex::Directory>::iterator AppIndex::find_directory(const std::string_view path)
+{
+    return std::ranges::lower_bound(dirs, path, {}, [&](const Directory& dir)
+    {
+        return text(dir.path, dir.pathLength);
+    });
+}
+
+bool AppIndex::index_file(const std::string& path)
+{
+    ++counters.parsed;
+    std::string_view name;
+    std::string_view command;
+    bool app = false;
+    if (ends_with_folded(path, ".lnk"))
+    {
+        // the shortcut's file name is what the Start Menu shows
+        const size_t start = path.rfind(separator) + 1;
+        name = std::string_view(path).substr(start, path.size() - start - 4);
+        command = path;
+        app = !name.empty();
+    }
+    else if (read_file(path, scratch))
+    {
+        app = parse_desktop_entry(scratch, name, commandScratch);
+        command = commandScratch;
+    }
+
+    const auto it = find_entry(path);
+    const bool known = it != entries.end() && text(it->path, it->pathLength) == path;
+    if (!app)
+    {
+        if (!known) return false;
+
+        garbage += it->pathLength + it->nameLength + it->commandLength;
+        entries.erase(it);
+        return true;
+    }
+
+    Entry entry{};
+    if (known)
+    {
+        garbage += it->nameLength + it->commandLength;
+        entry.path = it->path;
+        entry.pathLength = it->pathLength;
+    }
+    else
+    {
+        entry.path = add_text(path, entry.pathLength);
+    }
+    entry.name = add_text(name, entry.nameLength);
+    entry.command = add_text(command, entry.commandLength);
+    if (known)
+    {
+        *it = entry;
+    }
+    else
+    {
+        entries.insert(it, entry);
+    }
+    return true;
+}
+
+void AppIndex::list_directory(const std::string& dir, const bool recursive, std::vector<std::string>* newDirs)
+{
+    std::error_code error;
+    const int64_t modified = modified_time(dir, error);
+    if (error) return;
+
+    ++counters.listedDirs;
+    if (const auto it = find_directory(dir); it != dirs.end() && text(it->path, it->pathLength) == dir)
+    {
+        it->modified = modified;
+    }
+    else
+    {
+        Directory stamp{modified, 0, 0};
+        stamp.path = add_text(dir, stamp.pathLength);
+        dirs.insert(find_directory(dir), stamp);
+        if (newDirs) newDirs->push_back(dir);
+    }
+
+    std::filesystem::directory_iterator it(to_path(dir), std::filesystem::directory_options::skip_permission_denied,
+                                           error);
+    for (; !error && it != std::filesystem::directory_iterator(); it.increment(error))
+    {
+        std::error_code typeError;
+        const std::string child = from_path(it->path());
+        // symlinked directories could loop, symlinked files are common in applications/
+        if (it->is_directory(typeError) && !it->is_symlink(typeError))
+        {
+            const auto known = find_directory(child);
+            if (recursive || known == dirs.end() || text(known->path, known->pathLength) != child)
+            {
+                list_directory(child, true, newDirs);
+            }
+        }
+        else if (is_app_file(child) && it->is_regular_file(typeError))
+        {
+            index_file(child);
+        }
+    }
+}
+
+bool AppIndex::drop_tree(const std::string_view dir)
+{
+    std::string prefix(dir);
+    prefix += separator;
+    const auto under = [&](const uint32_t offset, const uint16_t length)
+    {
+        return text(offset, length).starts_with(prefix);
+    };
+
+    const auto first = find_entry(prefix);
+    auto last = first;
+    while (last != entries.end() && under(last->path, last->pathLength))
+    {
+        garbage += last->pathLength + last->nameLength + last->commandLength;
+        ++last;
+    }
+    const bool dropped = first != last;
+    entries.erase(first, last);
+
+    // "dir-2" sorts between "dir" and "dir/...", so the directory itself goes separately
+    const auto firstDir = find_directory(prefix);
+    auto lastDir = firstDir;
+    while (lastDir != dirs.end() && under(lastDir->path, lastDir->pathLength))
+    {
+        garbage += lastDir->pathLength;
+        ++lastDir;
+    }
+    dirs.erase(firstDir, lastDir);
+    if (const auto self = find_directory(dir); self != dirs.end() && text(self->path, self->pathLength) == dir)
+    {
+        garbage += self->pathLength;
+        dirs.erase(self);
+    }
+    return dropped;
+}
+
+void AppIndex::drop_files_in(const std::string_view dir)
+{
+    std::string prefix(dir);
+    prefix += separator;
+    const auto first = find_entry(prefix);
+    auto last = first;
+    while (last != entries.end() && text(last->path, last->pathLength).starts_with(prefix)) ++last;
+
+    const auto kept = std::remove_if(first, last, [&](const Entry& entry)
+    {
+        const bool direct = text(entry.path, entry.pathLength).find(separator, prefix.size()) == std::string_view::npos;
+        if (direct) garbage += entry.pathLength + entry.nameLength + entry.commandLength;
+        return direct;
+    });
+    entries.erase(kept, last);
+}
+
+void AppIndex::restamp_parent(const std::string_view path)
+{
+    const size_t end = path.rfind(separator);
+    if (end == std::string_view::npos) return;
+
+    const std::string parent(path.substr(0, end));
+    const auto it = find_directory(parent);
+    if (it == dirs.end() || text(it->path, it->pathLength) != parent) return;
+
+    std::error_code error;
+    const int64_t modified = modified_time(parent, error);
+    if (!error) it->modified = modified;
+}
+
+void AppIndex::compact(const bool force)
+{
+    if (!force && (garbage < 64 * 1024 || garbage * 2 < pool.size())) return;
+
+    std::string live;
+    live.reserve(pool.size() - garbage);
+    const auto move = [&](uint32_t& offset, const uint16_t length)
+    {
+        const auto moved = static_cast<uint32_t>(live.size());
+        live.append(text(offset, length));
+        offset = moved;
+    };
+    for (Entry& entry : entries)
+    {
+        move(entry.path, entry.pathLength);
+        move(entry.name, entry.nameLength);
+        move(entry.command, entry.commandLength);
+    }
+    for (Directory& dir : dirs)
+    {
+        move(dir.path, dir.pathLength);
+    }
+    pool = std::move(live);
+    garbage = 0;
+}
+
+void AppIndex::scan(const std::vector<std::string>& roots)
+{
+    const auto started = std::chrono::steady_clock::now();
+    rootPaths.clear();
+    entries.clear();
+    dirs.clear();
+    pool.clear();
+    garbage = 0;
+    for (const std::string& root : roots)
+    {
+        rootPaths.push_back(normalize_root(root));
+        list_directory(rootPaths.back(), true, nullptr);
+    }
+    counters.scanMicroseconds = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - started).count());
+}
+
+template <typename T>
+static void put(std::string& out, const T value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+bool AppIndex::save(const std::string& path)
+{
+    compact(true);
+
+    std::string out(index_magic, sizeof(index_magic));
+    put(out, index_version);
+    put(out, static_cast<uint32_t>(rootPaths.size()));
+    put(out, static_cast<uint32_t>(entries.size()));
+    put(out, static_cast<uint32_t>(dirs.size()));
+    put(out, static_cast<uint32_t>(pool.size()));
+    for (const std::string& root : rootPaths)
+    {
+        put(out, static_cast<uint16_t>(root.size()));
+        out += root;
+    }
+    for (const Entry& entry : entries)
+    {
+        put(out, entry.path);
+        put(out, entry.name);
+        put(out, entry.command);
+        put(out, entry.pathLength);
+        put(out, entry.nameLength);
+        put(out, entry.commandLength);
+    }
+    for (const Directory& dir : dirs)
+    {
+        put(out, dir.modified);
+        put(out, dir.path);
+        put(out, dir.pathLength);
+    }
+    out += pool;
+
+    const std::string temp = path + ".tmp";
+    {
+        std::ofstream file(to_path(temp), std::ios::binary | std::ios::trunc);
+        file.write(out.data(), static_cast<std::streamsize>(out.size()));
+        if (!file)
+        {
+            LOG_ERROR("Unable to write app index: {}", temp);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(to_path(temp), to_path(path), error);
+    if (error)
+    {
+        LOG_ERROR("Unable to replace app index: {}", path);
+        return false;
+    }
+    return true;
+}
+
+// Bounds-checked reads of a loaded index
+struct IndexReader
+{
+    std::string_view data;
+    size_t pos = 0;
+    bool ok = true;
+
+    template <typename T>
+    T get()
+    {
+        T value{};
+        if (data.size() - pos < sizeof(T))
+        {
+            ok = false;
+            return value;
+        }
+        std::memcpy(&value, data.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+
+    std::string_view text(const size_t length)
+    {
+        if (data.size() - pos < length)
+        {
+            ok = false;
+            return {};
+        }
+        const std::string_view value = data.substr(pos, length);
+        pos += length;
+        return value;
+    }
+};
+
+bool AppIndex::load(const std::string& path, const std::vector<std::string>& roots)
+{
+    std::ifstream file(to_path(path), std::ios::binary);
+    if (!file) return false;
+    const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    IndexReader reader{data};
+    if (reader.text(sizeof(index_magic)) != std::string_view(index_magic, sizeof(index_magic)) ||
+        reader.get<uint32_t>() != index_version)
+    {
+        return false;
+    }
+    const auto rootCount = reader.get<uint32_t>();
+    const auto entryCount = reader.get<uint32_t>();
+    const auto dirCount = reader.get<uint32_t>();
+    const auto poolSize = reader.get<uint32_t>();
+    if (!reader.ok || rootCount != roots.size()) return false;
+
+    // an index of other roots is no use, a changed setting means a fresh scan
+    for (const std::string& root : roots)
+    {
+        const auto length = reader.get<uint16_t>();
+        if (reader.text(length) != normalize_root(root)) return false;
+    }
+
+    const auto fits = [&](const uint32_t offset, const uint16_t length)
+    {
+        return static_cast<uint64_t>(offset) + length <= poolSize;
+    };
+    std::vector<Entry> loadedEntries(std::min<size_t>(entryCount, data.size() / 18));
+    for (Entry& entry : loadedEntries)
+    {
+        entry.path = reader.get<uint32_t>();
+        entry.name = reader.get<uint32_t>();
+        entry.command = reader.get<uint32_t>();
+        entry.pathLength = reader.get<uint16_t>();
+        entry.nameLength = reader.get<uint16_t>();
+        entry.commandLength = reader.get<uint16_t>();
+        if (!fits(entry.path, entry.pathLength) || !fits(entry.name, entry.nameLength) ||
+            !fits(entry.command, entry.commandLength))
+        {
+            return false;
+        }
+    }
+    std::vector<Directory> loadedDirs(std::min<size_t>(dirCount, data.size() / 14));
+    for (Directory& dir : loadedDirs)
+    {
+        dir.modified = reader.get<int64_t>();
+        dir.path = reader.get<uint32_t>();
+        dir.pathLength = reader.get<uint16_t>();
+        if (!fits(dir.path, dir.pathLength)) return false;
+    }
+    const std::string_view loadedPool = reader.text(poolSize);
+    if (!reader.ok || loadedEntries.size() != entryCount || loadedDirs.size() != dirCount) return false;
+
+    rootPaths.clear();
+    for (const std::string& root : roots)
+    {
+        rootPaths.push_back(normalize_root(root));
+    }
+    entries = std::move(loadedEntries);
+    dirs = std::move(loadedDirs);
+    pool = loadedPool;
+    garbage = 0;
+    return true;
+}
+
+size_t AppIndex::refresh_stale(std::vector<std::string>& newDirs)
+{
+    size_t relisted = 0;
+    for (const std::string& root : rootPaths)
+    {
+        const auto it = find_directory(root);
+        if (it == dirs.end() || text(it->path, it->pathLength) != root)
+        {
+            list_directory(root, true, &newDirs);
+            ++relisted;
+        }
+    }
+
+    // a file edited in place leaves its directory's time alone, only notifications see that
+    for (const std::string& dir : directories())
+    {
+        const auto it = find_directory(dir);
+        if (it == dirs.end() || text(it->path, it->pathLength) != dir) continue;
+
+        std::error_code error;
+        const int64_t modified = modified_time(dir, error);
+        if (error)
+        {
+            drop_tree(dir);
+            ++relisted;
+        }
+        else if (modified != it->modified)
+        {
+            drop_files_in(dir);
+            list_directory(dir, false, &newDirs);
+            ++relisted;
+        }
+    }
+    compact(false);
+    return relisted;
+}
+
+bool AppIndex::apply(const AppChange& change, std::vector<std::string>& newDirs)
+{
+    ++counters.changes;
+    switch (change.kind)
+    {
+    case AppChange::Kind::Overflow:
+        for (const std::string& root : rootPaths)
+        {
+            if (!change.path.empty() && change.path != root) continue;
+
+            drop_tree(root);
+            list_directory(root, true, &newDirs);
+        }
+        compact(false);
+        return true;
+    case AppChange::Kind::Removed:
+        break;
+    case AppChange::Kind::Changed:
+        {
+            std::error_code error;
+            const auto status = std::filesystem::status(to_path(change.path), error);
+            if (error || !std::filesystem::exists(status)) break;
+
+            if (std::filesystem::is_directory(status))
+            {
+                // a known directory reports its own writes on Windows, its files report the rest
+                const auto known = find_directory(change.path);
+                if (known != dirs.end() && text(known->path, known->pathLength) == change.path)
+                {
+                    known->modified = modified_time(change.path, error);
+                    return false;
+                }
+                list_directory(change.path, true, &newDirs);
+                restamp_parent(change.path);
+                return true;
+            }
+            if (!is_app_file(change.path) || !std::filesystem::is_regular_file(status)) return false;
+
+            const bool changed = index_file(change.path);
+            restamp_parent(change.path);
+            return changed;
+        }
+    }
+
+    bool changed;
+    if (const auto it = find_entry(change.path); it != entries.end() && text(it->path, it->pathLength) == change.path)
+    {
+        garbage += it->pathLength + it->nameLength + it->commandLength;
+        entries.erase(it);
+        changed = true;
+    }
+    else
+    {
+        changed = drop_tree(change.path);
+    }
+    restamp_parent(change.path);
+    compact(false);
+    return changed;
+}
+
+size_t AppIndex::size() const
+{
+    return entries.size();
+}
+
+std::string_view AppIndex::name(const uint32_t entry) const
+{
+    return text(entries[entry].name, entries[entry].nameLength);
+}
+
+std::string_view AppIndex::command(const uint32_t entry) const
+{
+    return text(entries[entry].command, entries[entry].commandLength);
+}
+
+std::string_view AppIndex::path(const uint32_t entry) const
+{
+    return text(entries[entry].path, entries[entry].pathLength);
+}
+
+const std::vector<std::string>& AppIndex::roots() const
+{
+    return rootPaths;
+}
+
+std::vector<std::string> AppIndex::directories() const
+{
+    std::vector<std::string> out;
+    out.reserve(dirs.size());
+    for (const Directory& dir : dirs)
+    {
+        out.emplace_back(text(dir.path, dir.pathLength));
+    }
+    return out;
+}
+
+void AppIndex::search(const WindowQuery& query, std::vector<uint32_t>& out, const size_t limit) const
+{
+    out.clear();
+    for (uint32_t entry = 0; entry < entries.size(); ++entry)
+    {
+        if (query.matches_app(name(entry), command(entry))) out.push_back(entry);
+    }
+
+    const auto byName = [&](const uint32_t a, const uint32_t b)
+    {
+        const int order = compare_folded(name(a), name(b));
+        return order != 0 ? order < 0 : a < b;
+    };
+    const size_t kept = std::min(limit, out.size());
+    std::partial_sort(out.begin(), out.begin() + static_cast<ptrdiff_t>(kept), out.end(), byName);
+    out.resize(kept);
+}
+
+size_t AppIndex::bytes() const
+{
+    return pool.size() + entries.size() * sizeof(Entry) + dirs.size() * sizeof(Directory);
+}
+
+const AppIndexStats& AppIndex::stats() const
+{
+    return counters;
+}
+
+// ---- platform watchers -------------------------------------------------------
+
+#ifdef __linux__
+class InotifyWatcher final : public DirectoryWatcher
+{
+public:
+    InotifyWatcher() : descriptor(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+    {
+    }
+
+    ~InotifyWatcher() override
+    {
+        if (descriptor >= 0) close(descriptor);
+    }
+
+    bool ok() const
+    {
+        return descriptor >= 0;
+    }
+
+    bool watch(const std::string& dir) override
+    {
+        // the same directory again gives back its existing watch
+        const int watched = inotify_add_watch(descriptor, dir.c_str(), IN_CREATE | IN_CLOSE_WRITE | IN_DELETE |
+                                              IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR);
+        if (watched < 0) return false;
+
+        dirs[watched] = dir;
+        return true;
+    }
+
+    bool wait(std::vector<AppChange>& out, const std::chrono::milliseconds timeout) override
+    {
+        pollfd ready{descriptor, POLLIN, 0};
+        const int polled = poll(&ready, 1, static_cast<int>(timeout.count()));
+        if (polled <= 0) return polled == 0 || errno == EINTR;
+
+        while (true)
+        {
+            const ssize_t length = read(descriptor, buffer, sizeof(buffer));
+            if (length <= 0) return length == 0 || errno == EAGAIN || errno == EINTR;
+
+            for (ssize_t pos = 0; pos < length;)
+            {
+                const auto* event = reinterpret_cast<const inotify_event*>(buffer + pos);
+                pos += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+                if (event->mask & IN_Q_OVERFLOW)
+                {
+                    out.push_back({AppChange::Kind::Overflow, {}});
+                    continue;
+                }
+
+                const auto it = dirs.find(event->wd);
+                if (it == dirs.end()) continue;
+                if (event->mask & IN_IGNORED)
+                {
+                    dirs.erase(it);
+                    continue;
+                }
+                if (event->len == 0) continue;
+
+                std::string path = it->second;
+                path += '/';
+                path += event->name;
+                const bool gone = event->mask & (IN_DELETE | IN_MOVED_FROM);
+                out.push_back({gone ? AppChange::Kind::Removed : AppChange::Kind::Changed, std::move(path)});
+            }
+        }
+    }
+
+private:
+    int descriptor;
+    std::unordered_map<int, std::string> dirs;
+    alignas(inotify_event) char buffer[64 * 1024];
+};
+#endif
+
+#ifdef _WIN32
+class Win32DirectoryWatcher final : public DirectoryWatcher
+{
+public:
+    ~Win32DirectoryWatcher() override
+    {
+        for (const auto& root : roots)
+        {
+            CancelIoEx(root->directory, &root->overlapped);
+            // the cancelled read still completes into the buffer
+            DWORD unused;
+            GetOverlappedResult(root->directory, &root->overlapped, &unused, TRUE);
+            CloseHandle(root->overlapped.hEvent);
+            CloseHandle(root->directory);
+        }
+    }
+
+    bool watch(const std::string& dir) override
+    {
+        for (const auto& root : roots)
+        {
+            if (dir == root->path || (dir.starts_with(root->path) && dir[root->path.size()] == '\\')) return true;
+        }
+
+        const std::u16string wide = utf8_to_utf16(dir);
+        const HANDLE directory = CreateFileW(reinterpret_cast<LPCWSTR>(wide.c_str()), FILE_LIST_DIRECTORY,
+                                             FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                                             OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+                                             nullptr);
+        if (directory == INVALID_HANDLE_VALUE) return false;
+
+        auto root = std::make_unique<Root>();
+        root->path = dir;
+        root->directory = directory;
+        root->overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        if (!root->overlapped.hEvent || !arm(*root))
+        {
+            if (root->overlapped.hEvent) CloseHandle(root->overlapped.hEvent);
+            CloseHandle(directory);
+            return false;
+        }
+        roots.push_back(std::move(root));
+        return true;
+    }
+
+    bool wait(std::vector<AppChange>& out, const std::chrono::milliseconds timeout) override
+    {
+        if (roots.empty())
+        {
+            std::this_thread::sleep_for(timeout);
+            return true;
+        }
+
+        HANDLE events[MAXIMUM_WAIT_OBJECTS];
+        const DWORD count = static_cast<DWORD>(std::min<size_t>(roots.size(), MAXIMUM_WAIT_OBJECTS));
+        for (DWORD i = 0; i < count; ++i)
+        {
+            events[i] = roots[i]->overlapped.hEvent;
+        }
+        const DWORD result = WaitForMultipleObjects(count, events, FALSE, static_cast<DWORD>(timeout.count()));
+        if (result == WAIT_TIMEOUT) return true;
+        if (result >= WAIT_OBJECT_0 + count) return false;
+
+        Root& root = *roots[result - WAIT_OBJECT_0];
+        DWORD bytes = 0;
+        if (!GetOverlappedResult(root.directory, &root.overlapped, &bytes, FALSE)) return false;
+
+        if (bytes == 0)
+        {
+            // more changed than the buffer held
+            out.push_back({AppChange::Kind::Overflow, root.path});
+        }
+        else
+        {
+            for (size_t offset = 0;;)
+            {
+                const auto* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(root.buffer + offset);
+                std::string path = root.path;
+                path += '\\';
+                utf16_to_utf8(std::u16string_view(reinterpret_cast<const char16_t*>(info->FileName),
+                                                  info->FileNameLength / sizeof(WCHAR)), path);
+                const bool gone = info->Action == FILE_ACTION_REMOVED || info->Action == FILE_ACTION_RENAMED_OLD_NAME;
+                out.push_back({gone ? AppChange::Kind::Removed : AppChange::Kind::Changed, std::move(path)});
+                if (info->NextEntryOffset == 0) break;
+                offset += info->NextEntryOffset;
+            }
+        }
+        ResetEvent(root.overlapped.hEvent);
+        return arm(root);
+    }
+
+private:
+    struct Root
+    {
+        std::string path;
+        HANDLE directory = INVALID_HANDLE_VALUE;
+        OVERLAPPED overlapped{};
+        alignas(DWORD) BYTE buffer[64 * 1024];
+    };
+
+    static bool arm(Root& root)
+    {
+        return ReadDirectoryChangesW(root.directory, root.buffer, sizeof(root.buffer), TRUE,
+                                     FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME |
+                                     FILE_NOTIFY_CHANGE_LAST_WRITE, nullptr, &root.overlapped, nullptr) != FALSE;
+    }
+
+    std::vector<std::unique_ptr<Root>> roots;
+};
+#endif
+
+std::unique_ptr<DirectoryWatcher> make_directory_watcher()
+{
+#if defined(__linux__)
+    auto watcher = std::make_unique<InotifyWatcher>();
+    if (!watcher->ok()) return nullptr;
+    return watcher;
+#elif defined(_WIN32)
+    return std::make_unique<Win32DirectoryWatcher>();
+#else
+    return nullptr;
+#endif
+}
+
+std::vector<std::string> default_app_roots()
+{
+    std::vector<std::string> roots;
+#ifdef _WIN32
+    // all users' shortcuts, then the user's own
+    for (const wchar_t* variable : {L"ProgramData", L"APPDATA"})
+    {
+        const wchar_t* value = _wgetenv(variable);
+        if (!value || !*value) continue;
+
+        std::string root = utf16_to_utf8(reinterpret_cast<const char16_t*>(value));
+        root += "\\Microsoft\\Windows\\Start Menu\\Programs";
+        roots.push_back(std::move(root));
+    }
+#else
+    // the XDG base directories, the user's data home first
+    const char* dataHome = std::getenv("XDG_DATA_HOME");
+    const char* home = std::getenv("HOME");
+    if (dataHome && *dataHome)
+    {
+        roots.push_back(std::string(dataHome) + "/applications");
+    }
+    else if (home && *home)
+    {
+        roots.push_back(std::string(home) + "/.local/share/applications");
+    }
+
+    const char* dataDirs = std::getenv("XDG_DATA_DIRS");
+    std::string_view dirs = dataDirs && *dataDirs ? dataDirs : "/usr/local/share:/usr/share";
+    while (!dirs.empty())
+    {
+        const size_t end = dirs.find(':');
+        const std::string_view dir = dirs.substr(0, end);
+        dirs.remove_prefix(end == std::string_view::npos ? dirs.size() : end + 1);
+        if (!dir.empty()) roots.push_back(std::string(dir) + "/applications");
+    }
+#endif
+    return roots;
+}
+
+// ---- worker ------------------------------------------------------------------
+
+static std::mutex appsMutex;
+static std::thread appsThread;
+static std::atomic<bool> appsStopping{false};
+static std::atomic<std::shared_ptr<const AppIndex>> publishedApps{std::make_shared<const AppIndex>()};
+
+static void publish(const AppIndex& index)
+{
+    publishedApps.store(std::make_shared<const AppIndex>(index));
+}
+
+static void apps_main(const std::vector<std::string> roots, const std::string indexPath,
+                      const WatcherFactory make_watcher)
+{
+    const auto started = std::chrono::steady_clock::now();
+    AppIndex index;
+    const bool loaded = index.load(indexPath, roots);
+    if (!loaded)
+    {
+        index.scan(roots);
+    }
+
+    // watching before the stale check, a change in between is seen twice at worst
+    const std::unique_ptr<DirectoryWatcher> watcher = make_watcher ? make_watcher() : nullptr;
+    if (watcher)
+    {
+        for (const std::string& dir : index.directories())
+        {
+            watcher->watch(dir);
+        }
+    }
+    std::vector<std::string> newDirs;
+    const size_t relisted = loaded ? index.refresh_stale(newDirs) : 0;
+    for (const std::string& dir : newDirs)
+    {
+        if (watcher) watcher->watch(dir);
+    }
+    if (!loaded || relisted != 0)
+    {
+        index.save(indexPath);
+    }
+    publish(index);
+    LOG_INFO("Indexed {} apps in {} us ({}, {} directories relisted)", index.size(),
+             std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count(),
+             loaded ? "saved index" : "full scan", relisted);
+
+    if (!watcher)
+    {
+        LOG_WARN("No directory watcher, installed apps only update on the next start");
+        return;
+    }
+
+    bool dirty = false;
+    std::vector<AppChange> changes;
+    while (!appsStopping.load())
+    {
+        changes.clear();
+        if (!watcher->wait(changes, std::chrono::milliseconds(250)))
+        {
+            LOG_WARN("Directory watcher failed, installed apps only update on the next start");
+            break;
+        }
+        if (changes.empty()) continue;
+
+        coalesce_changes(changes);
+        newDirs.clear();
+        bool changed = false;
+        for (const AppChange& change : changes)
+        {
+            changed = index.apply(change, newDirs) || changed;
+        }
+        for (const std::string& dir : newDirs)
+        {
+            watcher->watch(dir);
+        }
+        if (changed)
+        {
+            publish(index);
+            dirty = true;
+        }
+    }
+
+    if (dirty)
+    {
+        index.save(indexPath);
+    }
+}
+
+void app_index_start(std::vector<std::string> roots, std::string indexPath, const WatcherFactory make_watcher)
+{
+    std::lock_guard lock(appsMutex);
+    if (appsThread.joinable()) return;
+
+    appsStopping = false;
+    appsThread = std::thread(apps_main, std::move(roots), std::move(indexPath), make_watcher);
+}
+
+void app_index_stop()
+{
+    std::lock_guard lock(appsMutex);
+    if (!appsThread.joinable()) return;
+
+    appsStopping = true;
+    appsThread.join();
+    publishedApps.store(std::make_shared<const AppIndex>());
+}
+
+std::shared_ptr<const AppIndex> current_apps()
+{
+    return publishedApps.load();
+}
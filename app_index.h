@@ -0,0 +1,167 @@
+#ifndef FINDMYWINDOWS_APP_INDEX_H
+#define FINDMYWINDOWS_APP_INDEX_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class WindowQuery;
+
+// Where the index is kept between runs
+extern const std::string FIND_MY_WIN_APPS;
+
+// A change seen in a watched directory
+struct AppChange
+{
+    enum class Kind : uint8_t
+    {
+        // a file or directory appeared, was written or was renamed into place
+        Changed,
+        // a file or directory went away or was renamed elsewhere
+        Removed,
+        // the watcher dropped events under path, everything when it is empty
+        Overflow,
+    };
+
+    Kind kind;
+    std::string path;
+};
+
+// Keeps the last change of each path, in the order they came. A file written
+// right after it was created is parsed once.
+void coalesce_changes(std::vector<AppChange>& changes);
+
+// Directory change notifications: ReadDirectoryChangesW on Windows, which watches
+// a root's whole tree, inotify on Linux, which watches one directory at a time
+class DirectoryWatcher
+{
+public:
+    virtual ~DirectoryWatcher() = default;
+
+    // Watching a directory twice, or one a root's watch covers, is fine
+    virtual bool watch(const std::string& dir) = 0;
+
+    // Waits up to timeout and appends what changed, false once watching is broken for good
+    virtual bool wait(std::vector<AppChange>& out, std::chrono::milliseconds timeout) = 0;
+};
+
+using WatcherFactory = std::unique_ptr<DirectoryWatcher> (*)();
+
+// The platform's watcher, null where there is none
+std::unique_ptr<DirectoryWatcher> make_directory_watcher();
+
+struct AppIndexStats
+{
+    // shortcut and .desktop files read
+    uint64_t parsed = 0;
+    // directories listed, by a scan or because they changed
+    uint64_t listedDirs = 0;
+    // notifications applied
+    uint64_t changes = 0;
+    uint64_t scanMicroseconds = 0;
+};
+
+// Installed apps: Start Menu shortcuts (.lnk) and freedesktop .desktop files under
+// a few roots. Names, commands and paths live in one string pool, entries are
+// offsets into it sorted by file path, so a notification finds its entry by
+// binary search and a directory's entries are one range. Directory modification
+// times are kept too: a saved index only relists the directories that changed
+// while nothing was watching.
+class AppIndex
+{
+public:
+    // Lists every root from scratch, the one full scan
+    void scan(const std::vector<std::string>& roots);
+
+    // Native endian: "FMWA", u32 version, u32 root, entry and directory counts, u32
+    // pool size, the roots (u16 length, text), the entries, the directories, the pool.
+    // Written to a temp file and renamed into place.
+    bool save(const std::string& path);
+    // False when there is no index for these roots
+    bool load(const std::string& path, const std::vector<std::string>& roots);
+
+    // After load(): relists the directories whose modification time changed and
+    // drops the ones that are gone. Directories found on the way go to newDirs.
+    size_t refresh_stale(std::vector<std::string>& newDirs);
+
+    // One notification, false when the index didn't change. Directories that
+    // appeared go to newDirs so the watcher can follow them.
+    bool apply(const AppChange& change, std::vector<std::string>& newDirs);
+
+    size_t size() const;
+    std::string_view name(uint32_t entry) const;
+    // What launching runs: the shortcut itself, or the Exec line without field codes
+    std::string_view command(uint32_t entry) const;
+    std::string_view path(uint32_t entry) const;
+
+    const std::vector<std::string>& roots() const;
+    // Every directory listed, sorted so a directory comes before what is in it
+    std::vector<std::string> directories() const;
+
+    // Up to limit entries query matches, by name
+    void search(const WindowQuery& query, std::vector<uint32_t>& out, size_t limit) const;
+
+    // Pool, entries and directories, what the index costs in memory and on disk
+    size_t bytes() const;
+    const AppIndexStats& stats() const;
+
+private:
+    struct Entry
+    {
+        uint32_t path;
+        uint32_t name;
+        uint32_t command;
+        uint16_t pathLength;
+        uint16_t nameLength;
+        uint16_t commandLength;
+    };
+
+    struct Directory
+    {
+        int64_t modified;
+        uint32_t path;
+        uint16_t pathLength;
+    };
+
+    std::string_view text(uint32_t offset, uint16_t length) const;
+    uint32_t add_text(std::string_view text, uint16_t& length);
+    std::vector<Entry>::iterator find_entry(std::string_view path);
+    std::vector<Directory>::iterator find_directory(std::string_view path);
+    // Reads one file into an entry, or drops its entry when it isn't an app anymore
+    bool index_file(const std::string& path);
+    // Lists dir, subdirectories recursively when recursive or when they are new
+    void list_directory(const std::string& dir, bool recursive, std::vector<std::string>* newDirs);
+    bool drop_tree(std::string_view dir);
+    // Entries directly in dir, not in its subdirectories
+    void drop_files_in(std::string_view dir);
+    void restamp_parent(std::string_view path);
+    // Rebuilds the pool once most of it is dead text
+    void compact(bool force);
+
+    std::vector<std::string> rootPaths;
+    std::vector<Entry> entries;
+    std::vector<Directory> dirs;
+    std::string pool;
+    // pool bytes no entry points at anymore
+    size_t garbage = 0;
+    AppIndexStats counters;
+    // file reads and the command parsed out of them
+    std::string scratch;
+    std::string commandScratch;
+};
+
+// Start Menu folders on Windows, the XDG applications directories elsewhere
+std::vector<std::string> default_app_roots();
+
+// Loads or scans the index on a worker thread, then keeps it current from the
+// watcher's notifications and saves it to indexPath when it stops
+void app_index_start(std::vector<std::string> roots, std::string indexPath, WatcherFactory make_watcher);
+void app_index_stop();
+
+// The index as of the last notification, never null
+std::shared_ptr<const AppIndex> current_apps();
+
+#endif //FINDMYWINDOWS_APP_INDEX_H
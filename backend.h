@@ -0,0 +1,82 @@
+#ifndef FINDMYWINDOWS_BACKEND_H
+#define FINDMYWINDOWS_BACKEND_H
+
+#include <string>
+#include <vector>
+
+#include "platform.h"
+
+struct WindowRect
+{
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
+
+struct WindowPlacement
+{
+    HWND hwnd = nullptr;
+    WindowRect rect;
+};
+
+// Everything the window list needs from the desktop, one call per query so the
+// enumeration logic in tabs.cpp stays platform independent.
+// win32_backend.cpp talks to the real desktop, FakeBackend stands in elsewhere.
+class WindowBackend
+{
+public:
+    virtual ~WindowBackend() = default;
+
+    // Top-level windows in z-order, like EnumWindows
+    virtual void enum_windows(std::vector<HWND>& out) = 0;
+
+    virtual bool is_visible(HWND hwnd) = 0;
+    virtual DWORD ex_style(HWND hwnd) = 0;
+    virtual HWND owner(HWND hwnd) = 0;
+    // DWM_CLOAKED_* flags saying why DWM keeps the window off screen, 0 when it doesn't
+    virtual DWORD cloaked(HWND hwnd) = 0;
+    virtual std::string title(HWND hwnd) = 0;
+    virtual std::string class_name(HWND hwnd) = 0;
+    virtual DWORD process_id(HWND hwnd) = 0;
+    virtual std::string process_name(DWORD processId) = 0;
+
+    // Descendants of parent, like EnumChildWindows
+    virtual void child_windows(HWND parent, std::vector<HWND>& out) = 0;
+    // Package family name of a packaged (Store) app's process, empty for other processes
+    virtual std::string package_name(DWORD processId) = 0;
+
+    // false when the desktop has no virtual desktop support
+    virtual bool has_virtual_desktops() = 0;
+    virtual bool is_on_current_desktop(HWND hwnd) = 0;
+
+    virtual bool activate(HWND hwnd) = 0;
+
+    // The window with keyboard focus, null when there is none
+    virtual HWND foreground() = 0;
+
+    // Asks the window to close like its close button would, without waiting for the app
+    virtual bool close_window(HWND hwnd) = 0;
+    virtual bool minimize(HWND hwnd) = 0;
+
+    // Moves hwnd to the virtual desktop anchor is on, the foreground window's when anchor is null
+    virtual bool move_to_desktop_of(HWND hwnd, HWND anchor) = 0;
+
+    // Usable area of the primary monitor, without the taskbar
+    virtual WindowRect work_area() = 0;
+
+    // Moves and resizes all windows as one batch so the desktop repaints once,
+    // restoring minimized and maximized ones first. Returns how many were placed.
+    virtual size_t set_positions(const std::vector<WindowPlacement>& placements) = 0;
+
+    // Starts an installed app from its launcher entry: a Start Menu shortcut opened
+    // the way Explorer would, or a .desktop Exec line
+    virtual bool launch(const std::string& command) = 0;
+};
+
+// The backend used by ListWindowsByDesktop() and BringWindowToFront()
+WindowBackend& window_backend();
+
+void set_window_backend(WindowBackend* backend);
+
+#endif //FINDMYWINDOWS_BACKEND_H
@@ -0,0 +1,596 @@
+#include "browser_tabs.h"
+#include "log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+static char fold(const char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+bool is_browser_process(const std::string_view processName)
+{
+    static constexpr std::string_view browsers[] = {
+        "chrome.exe", "msedge.exe", "firefox.exe", "brave.exe", "opera.exe", "vivaldi.exe",
+    };
+    return std::ranges::any_of(browsers, [&](const std::string_view browser)
+    {
+        return std::ranges::equal(processName, browser, [](const char a, const char b) { return fold(a) == b; });
+    });
+}
+
+// ---- mock tree ------------------------------------------------------------------
+
+uint32_t MockAccessibilityTree::add_node(const AccessibleRole role, std::string name, const HWND window)
+{
+    nodes.push_back({role, std::move(name), window, {}});
+    return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+void MockAccessibilityTree::add_browser(const HWND window, const std::vector<std::string>& titles,
+                                        const size_t documentNodes)
+{
+    const uint32_t root = add_node(AccessibleRole::Other, "browser", window);
+    const uint32_t toolbar = add_node(AccessibleRole::Other, "toolbar", window);
+    const uint32_t tabList = add_node(AccessibleRole::TabList, "tabs", window);
+    const uint32_t newTab = add_node(AccessibleRole::Other, "New Tab", window);
+    const uint32_t document = add_node(AccessibleRole::Document, "page", window);
+    nodes[root].children = {toolbar, document};
+    nodes[toolbar].children = {tabList, newTab};
+    for (size_t i = 0; i < documentNodes; ++i)
+    {
+        const uint32_t content = add_node(AccessibleRole::Other, "content", window);
+        nodes[document].children.push_back(content);
+    }
+
+    roots[window] = root;
+    tabLists[window] = tabList;
+    set_tabs(window, titles);
+}
+
+void MockAccessibilityTree::set_tabs(const HWND window, const std::vector<std::string>& titles)
+{
+    const uint32_t tabList = tabLists.at(window);
+    nodes[tabList].children.clear();
+    for (const auto& title : titles)
+    {
+        const uint32_t tab = add_node(AccessibleRole::Tab, title, window);
+        nodes[tabList].children.push_back(tab);
+    }
+}
+
+void MockAccessibilityTree::remove_browser(const HWND window)
+{
+    roots.erase(window);
+    tabLists.erase(window);
+    selected.erase(window);
+}
+
+void MockAccessibilityTree::set_call_cost(const std::chrono::microseconds cost,
+                                          void (*advance)(std::chrono::microseconds))
+{
+    callCost = cost;
+    advanceClock = advance;
+}
+
+size_t MockAccessibilityTree::calls() const
+{
+    return callCount;
+}
+
+size_t MockAccessibilityTree::live_handles() const
+{
+    return liveHandles;
+}
+
+std::string MockAccessibilityTree::selected_tab(const HWND window) const
+{
+    const auto it = selected.find(window);
+    return it == selected.end() ? std::string() : it->second;
+}
+
+void MockAccessibilityTree::charge()
+{
+    ++callCount;
+    if (callCost.count() == 0) return;
+
+    if (advanceClock)
+    {
+        advanceClock(callCost);
+    }
+    else
+    {
+        std::this_thread::sleep_for(callCost);
+    }
+}
+
+AccessibleNode MockAccessibilityTree::root(const HWND window)
+{
+    charge();
+    const auto it = roots.find(window);
+    if (it == roots.end()) return 0;
+
+    ++liveHandles;
+    return it->second + 1;
+}
+
+void MockAccessibilityTree::children(const AccessibleNode node, std::vector<AccessibleNode>& out)
+{
+    charge();
+    for (const uint32_t child : nodes[node - 1].children)
+    {
+        ++liveHandles;
+        out.push_back(child + 1);
+    }
+}
+
+AccessibleRole MockAccessibilityTree::role(const AccessibleNode node)
+{
+    charge();
+    return nodes[node - 1].role;
+}
+
+std::string MockAccessibilityTree::name(const AccessibleNode node)
+{
+    charge();
+    return nodes[node - 1].name;
+}
+
+bool MockAccessibilityTree::select(const AccessibleNode node)
+{
+    charge();
+    const Node& tab = nodes[node - 1];
+    const auto tabList = tabLists.find(tab.window);
+    if (tab.role != AccessibleRole::Tab || tabList == tabLists.end() ||
+        std::ranges::find(nodes[tabList->second].children, static_cast<uint32_t>(node - 1)) ==
+        nodes[tabList->second].children.end())
+    {
+        return false;
+    }
+
+    selected[tab.window] = tab.name;
+    return true;
+}
+
+void MockAccessibilityTree::release(AccessibleNode)
+{
+    --liveHandles;
+}
+
+// ---- index ----------------------------------------------------------------------
+
+std::vector<size_t> TabSnapshot::find(const std::string_view text) const
+{
+    std::string folded(text);
+    std::ranges::transform(folded, folded.begin(), fold);
+
+    std::vector<size_t> found;
+    for (size_t i = 0; i < foldedTitles.size(); ++i)
+    {
+        if (foldedTitles[i].find(folded) != std::string::npos)
+        {
+            found.push_back(i);
+        }
+    }
+    return found;
+}
+
+// ---- crawler --------------------------------------------------------------------
+
+TabCrawler::TabCrawler(AccessibilityTree& tree, const TabCrawlerOptions options, const Clock now) :
+    tree(tree), options(options), now(now), published(std::make_shared<const TabSnapshot>())
+{
+}
+
+TabCrawler::~TabCrawler()
+{
+    for (const AccessibleNode node : crawl.pending)
+    {
+        tree.release(node);
+    }
+    release_tabs(crawl.found);
+    for (auto& [hwnd, known] : windows)
+    {
+        release_tabs(known.tabs);
+    }
+}
+
+void TabCrawler::set_windows(const std::vector<BrowserWindow>& current)
+{
+    bool dropped = false;
+    for (auto it = windows.begin(); it != windows.end();)
+    {
+        if (std::ranges::find(current, it->first, &BrowserWindow::hwnd) != current.end())
+        {
+            ++it;
+            continue;
+        }
+
+        if (crawl.window == it->first)
+        {
+            for (const AccessibleNode node : crawl.pending)
+            {
+                tree.release(node);
+            }
+            release_tabs(crawl.found);
+            crawl = {};
+        }
+        std::erase(queue, it->first);
+        release_tabs(it->second.tabs);
+        it = windows.erase(it);
+        dropped = true;
+    }
+
+    for (const auto& window : current)
+    {
+        const auto [it, added] = windows.try_emplace(window.hwnd);
+        if (added || it->second.title != window.title)
+        {
+            it->second.title = window.title;
+            enqueue(window.hwnd);
+        }
+    }
+
+    if (dropped) publish();
+}
+
+void TabCrawler::enqueue(const HWND window)
+{
+    if (std::ranges::find(queue, window) == queue.end())
+    {
+        queue.push_back(window);
+    }
+}
+
+void TabCrawler::queue_due_recrawls()
+{
+    const auto time = now();
+    for (const auto& [hwnd, known] : windows)
+    {
+        if (known.crawled && hwnd != crawl.window && time - known.crawledAt >= options.recrawlAfter)
+        {
+            enqueue(hwnd);
+        }
+    }
+}
+
+bool TabCrawler::idle() const
+{
+    return queue.empty() && !crawl.window;
+}
+
+std::chrono::nanoseconds TabCrawler::run_slice()
+{
+    const auto start = now();
+    queue_due_recrawls();
+    if (idle()) return std::chrono::nanoseconds::zero();
+
+    ++counters.slices;
+    // checked after every node, so a slice overruns by at most one node's calls
+    while (!idle())
+    {
+        step();
+        if (now() - start >= options.slice) break;
+    }
+    return now() - start;
+}
+
+std::chrono::nanoseconds TabCrawler::rest_after(const std::chrono::nanoseconds used) const
+{
+    const double share = std::clamp(options.cpuShare, 0.01, 1.0);
+    return std::chrono::nanoseconds(static_cast<long long>(static_cast<double>(used.count()) * (1.0 / share - 1.0)));
+}
+
+void TabCrawler::step()
+{
+    if (!crawl.window)
+    {
+        crawl.window = queue.front();
+        queue.pop_front();
+        if (const AccessibleNode root = tree.root(crawl.window))
+        {
+            crawl.pending.push_back(root);
+        }
+        else
+        {
+            // nothing exposed (yet), counts as a window without tabs
+            finish_crawl();
+        }
+        return;
+    }
+
+    const AccessibleNode node = crawl.pending.back();
+    crawl.pending.pop_back();
+    ++counters.nodes;
+    if (++crawl.visited > options.maxNodesPerWindow)
+    {
+        tree.release(node);
+        abandon_crawl();
+        return;
+    }
+
+    switch (tree.role(node))
+    {
+    case AccessibleRole::Tab:
+        // kept for select(), released when the window's tabs are replaced
+        crawl.found.push_back({crawl.window, tree.name(node), node});
+        break;
+    case AccessibleRole::Document:
+        tree.release(node);
+        break;
+    case AccessibleRole::TabList:
+    case AccessibleRole::Other:
+        childScratch.clear();
+        tree.children(node, childScratch);
+        crawl.pending.insert(crawl.pending.end(), childScratch.rbegin(), childScratch.rend());
+        tree.release(node);
+        break;
+    }
+
+    if (crawl.pending.empty()) finish_crawl();
+}
+
+void TabCrawler::finish_crawl()
+{
+    KnownWindow& known = windows.at(crawl.window);
+    release_tabs(known.tabs);
+    known.tabs = std::move(crawl.found);
+    known.crawledAt = now();
+    known.crawled = true;
+    ++counters.windowsCrawled;
+    crawl = {};
+    publish();
+}
+
+void TabCrawler::abandon_crawl()
+{
+    LOG_WARN("Gave up on the tabs of window {} after {} nodes", crawl.window, crawl.visited - 1);
+    for (const AccessibleNode node : crawl.pending)
+    {
+        tree.release(node);
+    }
+    release_tabs(crawl.found);
+
+    // the last complete crawl stays, the next try waits for the recrawl interval
+    KnownWindow& known = windows.at(crawl.window);
+    known.crawledAt = now();
+    known.crawled = true;
+    ++counters.windowsAbandoned;
+    crawl = {};
+}
+
+void TabCrawler::release_tabs(std::vector<BrowserTab>& tabs)
+{
+    for (const auto& tab : tabs)
+    {
+        tree.release(tab.node);
+    }
+    tabs.clear();
+}
+
+void TabCrawler::publish()
+{
+    auto snapshot = std::make_shared<TabSnapshot>();
+    snapshot->version = published->version + 1;
+    for (const auto& [hwnd, known] : windows)
+    {
+        for (const auto& tab : known.tabs)
+        {
+            snapshot->tabs.push_back(tab);
+            std::string folded = tab.title;
+            std::ranges::transform(folded, folded.begin(), fold);
+            snapshot->foldedTitles.push_back(std::move(folded));
+        }
+    }
+    published = std::move(snapshot);
+}
+
+bool TabCrawler::select(const HWND window, const AccessibleNode node)
+{
+    const auto it = windows.find(window);
+    if (it == windows.end() || std::ranges::find(it->second.tabs, node, &BrowserTab::node) == it->second.tabs.end())
+    {
+        return false;
+    }
+    return tree.select(node);
+}
+
+std::shared_ptr<const TabSnapshot> TabCrawler::snapshot() const
+{
+    return published;
+}
+
+TabCrawlStats TabCrawler::stats() const
+{
+    return counters;
+}
+
+// ---- crawler thread -------------------------------------------------------------
+
+struct TabSelection
+{
+    HWND window;
+    AccessibleNode node;
+};
+
+static std::mutex crawlerMutex;
+static std::condition_variable crawlerWake;
+static bool crawlerStopping = false;
+static bool crawlerRunning = false;
+static std::thread crawlerThread;
+static AccessibilityFactory treeFactory = nullptr;
+static TabCrawlerOptions crawlerOptions;
+
+static std::vector<BrowserWindow> trackedWindows;
+static bool trackedChanged = false;
+static std::vector<TabSelection> pendingSelections;
+
+static std::atomic<std::shared_ptr<const TabSnapshot>> publishedTabs{std::make_shared<const TabSnapshot>()};
+
+static void crawler_main()
+{
+    // the tree is made here so UI Automation gets its COM apartment on this thread
+    const std::unique_ptr<AccessibilityTree> tree = treeFactory();
+    if (!tree)
+    {
+        LOG_WARN("No accessibility tree, browser tabs won't be listed");
+        return;
+    }
+
+    TabCrawler crawler(*tree, crawlerOptions);
+    std::vector<BrowserWindow> windows;
+    std::vector<TabSelection> selections;
+    auto restUntil = std::chrono::steady_clock::now();
+
+    std::unique_lock lock(crawlerMutex);
+    while (true)
+    {
+        // an idle crawler still wakes up now and then for the periodic recrawl
+        const auto wakeAt = crawler.idle() ? std::chrono::steady_clock::now() + std::chrono::seconds(1) : restUntil;
+        crawlerWake.wait_until(lock, wakeAt, []
+        {
+            return crawlerStopping || trackedChanged || !pendingSelections.empty();
+        });
+        if (crawlerStopping) break;
+
+        const bool windowsChanged = trackedChanged;
+        if (windowsChanged)
+        {
+            windows = trackedWindows;
+            trackedChanged = false;
+        }
+        selections.swap(pendingSelections);
+        lock.unlock();
+
+        if (windowsChanged) crawler.set_windows(windows);
+        for (const auto& selection : selections)
+        {
+            if (!crawler.select(selection.window, selection.node))
+            {
+                LOG_DEBUG("Tab of window {} went away before it could be selected", selection.window);
+            }
+        }
+        selections.clear();
+
+        // new windows don't cut the rest short, the budget holds however often the list changes
+        if (std::chrono::steady_clock::now() >= restUntil)
+        {
+            const auto used = crawler.run_slice();
+            restUntil = std::chrono::steady_clock::now() + crawler.rest_after(used);
+        }
+
+        if (crawler.snapshot() != publishedTabs.load(std::memory_order_acquire))
+        {
+            publishedTabs.store(crawler.snapshot(), std::memory_order_release);
+        }
+
+        lock.lock();
+    }
+
+    lock.unlock();
+    const TabCrawlStats stats = crawler.stats();
+    LOG_INFO("Crawled browser tabs {} times over {} nodes in {} slices, gave up {} times", stats.windowsCrawled,
+             stats.nodes, stats.slices, stats.windowsAbandoned);
+}
+
+bool tab_crawler_start(const AccessibilityFactory make_tree, const TabCrawlerOptions options)
+{
+    std::lock_guard lock(crawlerMutex);
+    if (crawlerRunning) return false;
+
+    // every refresh hands the browser windows over, found by process name
+    set_required_window_fields(FIELD_TITLE | FIELD_PROCESS);
+    treeFactory = make_tree;
+    crawlerOptions = options;
+    crawlerStopping = false;
+    crawlerRunning = true;
+    crawlerThread = std::thread(crawler_main);
+    return true;
+}
+
+void tab_crawler_stop()
+{
+    {
+        std::lock_guard lock(crawlerMutex);
+        if (!crawlerRunning) return;
+        crawlerStopping = true;
+        crawlerRunning = false;
+    }
+    crawlerWake.notify_all();
+    crawlerThread.join();
+    set_required_window_fields(0);
+
+    std::lock_guard lock(crawlerMutex);
+    trackedWindows.clear();
+    pendingSelections.clear();
+    publishedTabs.store(std::make_shared<const TabSnapshot>(), std::memory_order_release);
+}
+
+void track_browser_windows(const std::vector<WindowInfo>& windows)
+{
+    std::vector<BrowserWindow> browsers;
+    for (const auto& window : windows)
+    {
+        if (is_browser_process(window.processName))
+        {
+            browsers.push_back({window.hwnd, window.title});
+        }
+    }
+
+    {
+        std::lock_guard lock(crawlerMutex);
+        const bool same = std::ranges::equal(browsers, trackedWindows, [](const BrowserWindow& a, const BrowserWindow& b)
+        {
+            return a.hwnd == b.hwnd && a.title == b.title;
+        });
+        if (same) return;
+
+        trackedWindows = std::move(browsers);
+        trackedChanged = true;
+    }
+    crawlerWake.notify_all();
+}
+
+std::shared_ptr<const TabSnapshot> current_tabs()
+{
+    return publishedTabs.load(std::memory_order_acquire);
+}
+
+void append_browser_tabs(std::vector<WindowInfo>& windows)
+{
+    const auto tabs = current_tabs();
+    if (tabs->tabs.empty()) return;
+
+    const size_t count = windows.size();
+    windows.reserve(count + tabs->tabs.size());
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (!is_browser_process(windows[i].processName)) continue;
+
+        // the snapshot is grouped by window in handle order
+        const auto [first, last] = std::ranges::equal_range(tabs->tabs, windows[i].hwnd, std::less{},
+                                                            &BrowserTab::window);
+        for (auto tab = first; tab != last; ++tab)
+        {
+            WindowInfo entry = windows[i];
+            entry.title = tab->title;
+            entry.pinnedSlot = 0;
+            entry.tabNode = tab->node;
+            windows.push_back(std::move(entry));
+        }
+    }
+}
+
+void activate_tab(const HWND window, const AccessibleNode node)
+{
+    {
+        std::lock_guard lock(crawlerMutex);
+        if (!crawlerRunning) return;
+        pendingSelections.push_back({window, node});
+    }
+    crawlerWake.notify_all();
+}
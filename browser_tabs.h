@@ -0,0 +1,240 @@
+#ifndef FINDMYWINDOWS_BROWSER_TABS_H
+#define FINDMYWINDOWS_BROWSER_TABS_H
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "tabs.h"
+
+// Handle to a node of a window's accessibility tree, 0 for none. A handle stays
+// valid until it is released.
+using AccessibleNode = uint64_t;
+
+enum class AccessibleRole : uint8_t
+{
+    Other,
+    TabList,
+    Tab,
+    // page content, never holds browser tabs and is by far the largest subtree
+    Document,
+};
+
+// What the tab crawler needs from an accessibility API, UI Automation on Windows.
+// Any call can be slow, a busy browser stalls them for seconds, so only the
+// crawler thread uses it.
+class AccessibilityTree
+{
+public:
+    virtual ~AccessibilityTree() = default;
+
+    virtual AccessibleNode root(HWND window) = 0;
+    // Appends the children in order
+    virtual void children(AccessibleNode node, std::vector<AccessibleNode>& out) = 0;
+    virtual AccessibleRole role(AccessibleNode node) = 0;
+    virtual std::string name(AccessibleNode node) = 0;
+    // Makes the tab the selected one of its window
+    virtual bool select(AccessibleNode node) = 0;
+    virtual void release(AccessibleNode node) = 0;
+};
+
+// In-memory tree for the self-checks and headless builds. Each browser window
+// gets a toolbar holding the tab strip and a document subtree of the given size.
+class MockAccessibilityTree final : public AccessibilityTree
+{
+public:
+    void add_browser(HWND window, const std::vector<std::string>& titles, size_t documentNodes);
+    // Replaces the tab strip, handles to the old tabs stay valid but go stale
+    void set_tabs(HWND window, const std::vector<std::string>& titles);
+    void remove_browser(HWND window);
+
+    // Every call takes cost: advance(cost) when given, so a fake clock moves,
+    // otherwise a real sleep
+    void set_call_cost(std::chrono::microseconds cost, void (*advance)(std::chrono::microseconds) = nullptr);
+
+    size_t calls() const;
+    // handles given out and not released yet
+    size_t live_handles() const;
+    std::string selected_tab(HWND window) const;
+
+    AccessibleNode root(HWND window) override;
+    void children(AccessibleNode node, std::vector<AccessibleNode>& out) override;
+    AccessibleRole role(AccessibleNode node) override;
+    std::string name(AccessibleNode node) override;
+    bool select(AccessibleNode node) override;
+    void release(AccessibleNode node) override;
+
+private:
+    struct Node
+    {
+        AccessibleRole role = AccessibleRole::Other;
+        std::string name;
+        HWND window = nullptr;
+        std::vector<uint32_t> children;
+    };
+
+    void charge();
+    uint32_t add_node(AccessibleRole role, std::string name, HWND window);
+
+    // index + 1 is the handle
+    std::vector<Node> nodes;
+    std::map<HWND, uint32_t> roots;
+    std::map<HWND, uint32_t> tabLists;
+    std::map<HWND, std::string> selected;
+    std::chrono::microseconds callCost{0};
+    void (*advanceClock)(std::chrono::microseconds) = nullptr;
+    size_t callCount = 0;
+    size_t liveHandles = 0;
+};
+
+struct BrowserTab
+{
+    HWND window = nullptr;
+    std::string title;
+    AccessibleNode node = 0;
+};
+
+// Every tab found so far, grouped by window in tab strip order. Immutable once
+// published, so the switcher reads it without waiting for the crawler.
+struct TabSnapshot
+{
+    uint64_t version = 0;
+    std::vector<BrowserTab> tabs;
+    // ASCII lowercase titles in the same order, for find()
+    std::vector<std::string> foldedTitles;
+
+    // Indexes of the tabs whose title contains text, ignoring ASCII case
+    std::vector<size_t> find(std::string_view text) const;
+};
+
+struct BrowserWindow
+{
+    HWND hwnd = nullptr;
+    // the active tab's title, a change means the tabs probably changed too
+    std::string title;
+};
+
+struct TabCrawlerOptions
+{
+    // longest stretch of accessibility calls before the crawler yields
+    std::chrono::microseconds slice{5000};
+    // share of wall time the crawler may spend calling into browsers
+    double cpuShare = 0.1;
+    // windows are crawled again after this even when their title stayed the same
+    std::chrono::milliseconds recrawlAfter{30000};
+    // a window with a larger tree is given up on, its last tabs are kept
+    size_t maxNodesPerWindow = 5000;
+};
+
+struct TabCrawlStats
+{
+    uint64_t slices = 0;
+    // nodes looked at, each one is two or three accessibility calls
+    uint64_t nodes = 0;
+    uint64_t windowsCrawled = 0;
+    uint64_t windowsAbandoned = 0;
+};
+
+// Crawls one window at a time, depth first, skipping page content. The walk
+// keeps its position between run_slice() calls, so a large tree is spread over
+// many slices and a window that goes away mid-crawl is simply dropped.
+// Single threaded, the thread in browser_tabs.cpp drives it; the clock is a
+// function pointer so the budget can be checked on a fake one.
+class TabCrawler
+{
+public:
+    using Clock = std::chrono::steady_clock::time_point (*)();
+
+    TabCrawler(AccessibilityTree& tree, TabCrawlerOptions options, Clock now = std::chrono::steady_clock::now);
+    ~TabCrawler();
+
+    TabCrawler(const TabCrawler&) = delete;
+    TabCrawler& operator=(const TabCrawler&) = delete;
+
+    // The browser windows that exist now. New windows and windows whose title
+    // changed are queued, tabs of the ones gone are dropped.
+    void set_windows(const std::vector<BrowserWindow>& windows);
+
+    // Crawls until the slice is used up or nothing is queued, returns the time spent
+    std::chrono::nanoseconds run_slice();
+
+    // Pause after a slice that took used, keeping the crawler within cpuShare
+    std::chrono::nanoseconds rest_after(std::chrono::nanoseconds used) const;
+
+    // Nothing queued or in progress
+    bool idle() const;
+
+    // Selects a tab from the current snapshot, false when it has gone stale
+    bool select(HWND window, AccessibleNode node);
+
+    std::shared_ptr<const TabSnapshot> snapshot() const;
+    TabCrawlStats stats() const;
+
+private:
+    struct KnownWindow
+    {
+        std::string title;
+        std::vector<BrowserTab> tabs;
+        std::chrono::steady_clock::time_point crawledAt;
+        bool crawled = false;
+    };
+
+    struct Crawl
+    {
+        HWND window = nullptr;
+        std::vector<AccessibleNode> pending;
+        std::vector<BrowserTab> found;
+        size_t visited = 0;
+    };
+
+    void enqueue(HWND window);
+    void queue_due_recrawls();
+    // One node of the current crawl, starting the next queued window when there is none
+    void step();
+    void finish_crawl();
+    void abandon_crawl();
+    void release_tabs(std::vector<BrowserTab>& tabs);
+    void publish();
+
+    AccessibilityTree& tree;
+    TabCrawlerOptions options;
+    Clock now;
+
+    std::map<HWND, KnownWindow> windows;
+    std::deque<HWND> queue;
+    Crawl crawl;
+    std::vector<AccessibleNode> childScratch;
+    std::shared_ptr<const TabSnapshot> published;
+    TabCrawlStats counters;
+};
+
+using AccessibilityFactory = std::unique_ptr<AccessibilityTree> (*)();
+
+// Starts the crawler thread, make_tree runs on it so COM is set up there.
+// Returns false when it is already running.
+bool tab_crawler_start(AccessibilityFactory make_tree, TabCrawlerOptions options = {});
+void tab_crawler_stop();
+
+// Hands the browser windows in the list to the crawler. Copies a few strings
+// under a lock, cheap enough for every refresh.
+void track_browser_windows(const std::vector<WindowInfo>& windows);
+
+// The latest crawl results, empty until the crawler published any
+std::shared_ptr<const TabSnapshot> current_tabs();
+
+// Appends a switcher entry for each tab of the windows in the list, after all
+// the windows so the Ctrl+N slots keep their numbers
+void append_browser_tabs(std::vector<WindowInfo>& windows);
+
+// Queues selecting the tab on the crawler thread and returns immediately.
+// The caller activates the window itself.
+void activate_tab(HWND window, AccessibleNode node);
+
+bool is_browser_process(std::string_view processName);
+
+#endif //FINDMYWINDOWS_BROWSER_TABS_H
@@ -0,0 +1,221 @@
+#ifndef FINDMYWINDOWS_ELIGIBILITY_H
+#define FINDMYWINDOWS_ELIGIBILITY_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "backend.h"
+#include "tabs.h"
+
+struct StageStats
+{
+    const char* name = "";
+    // windows that reached the stage, and how many it turned away
+    uint64_t checked = 0;
+    uint64_t rejected = 0;
+    uint64_t nanoseconds = 0;
+};
+
+// One enumerated window on its way through the pipeline. Whatever a stage
+// fetches is kept for the later stages and for the list entry, so nothing is
+// fetched twice.
+class Candidate
+{
+public:
+    Candidate(WindowBackend& backend, const HWND hwnd) : backend(backend)
+    {
+        info.hwnd = hwnd;
+        info.processId = 0;
+        info.isOnCurrentDesktop = false;
+        info.resolved = 0;
+    }
+
+    HWND hwnd() const
+    {
+        return info.hwnd;
+    }
+
+    DWORD ex_style()
+    {
+        if (!hasExStyle)
+        {
+            exStyle = backend.ex_style(info.hwnd);
+            hasExStyle = true;
+        }
+        return exStyle;
+    }
+
+    const std::string& title()
+    {
+        if (!(info.resolved & FIELD_TITLE))
+        {
+            info.title = backend.title(info.hwnd);
+            info.resolved |= FIELD_TITLE;
+            fetchedTitle = true;
+        }
+        return info.title;
+    }
+
+    WindowBackend& backend;
+    // becomes the list entry, fields are filled in as stages fetch them
+    WindowInfo info;
+    bool fetchedTitle = false;
+
+private:
+    DWORD exStyle = 0;
+    bool hasExStyle = false;
+};
+
+// The Alt+Tab rules, cheapest first. cost only orders the stages: 1 reads the
+// window structure, 2 asks DWM, 3 may go to the owning thread, 4 may open the process.
+struct VisibleStage
+{
+    static constexpr const char* name = "visible";
+    static constexpr int cost = 1;
+
+    bool accept(Candidate& window) const
+    {
+        return window.backend.is_visible(window.hwnd());
+    }
+};
+
+struct ToolWindowStage
+{
+    static constexpr const char* name = "tool window";
+    static constexpr int cost = 1;
+
+    bool accept(Candidate& window) const
+    {
+        return !(window.ex_style() & WS_EX_TOOLWINDOW);
+    }
+};
+
+// Owned windows (dialogs, palettes) are reached through their owner unless they ask to be listed
+struct OwnerStage
+{
+    static constexpr const char* name = "owned";
+    static constexpr int cost = 1;
+
+    bool accept(Candidate& window) const
+    {
+        return (window.ex_style() & WS_EX_APPWINDOW) || window.backend.owner(window.hwnd()) == nullptr;
+    }
+};
+
+// Windows their app hides through DWM, like suspended UWP frames. Shell cloaking
+// is how the windows of other virtual desktops are hidden, those stay listed.
+struct CloakedStage
+{
+    static constexpr const char* name = "cloaked";
+    static constexpr int cost = 2;
+
+    bool accept(Candidate& window) const
+    {
+        return !(window.backend.cloaked(window.hwnd()) & (DWM_CLOAKED_APP | DWM_CLOAKED_INHERITED));
+    }
+};
+
+struct TitleStage
+{
+    static constexpr const char* name = "untitled";
+    static constexpr int cost = 3;
+
+    bool accept(Candidate& window) const
+    {
+        return (window.ex_style() & WS_EX_APPWINDOW) || !window.title().empty();
+    }
+};
+
+// Runs the stages in order until one rejects the window. Stages are plain
+// members called directly, adding one is a template argument, and each keeps
+// counters and time spent. begin() is called on stages that have it once per
+// enumeration. Not thread safe, the enumeration holds its own lock.
+template <typename... Stages>
+class EligibilityPipeline
+{
+    static constexpr std::array<int, sizeof...(Stages)> costs{Stages::cost...};
+    static_assert(std::ranges::is_sorted(costs), "eligibility stages have to run cheapest first");
+
+public:
+    static constexpr size_t stage_count = sizeof...(Stages);
+
+    void begin()
+    {
+        std::apply([](auto&... stage)
+        {
+            (begin_stage(stage), ...);
+        }, stages);
+    }
+
+    bool accept(Candidate& window)
+    {
+        return accept_from<0>(window, std::chrono::steady_clock::now());
+    }
+
+    std::array<StageStats, stage_count> stats() const
+    {
+        std::array<StageStats, stage_count> out = counters;
+        constexpr std::array<const char*, stage_count> names{Stages::name...};
+        for (size_t i = 0; i < stage_count; ++i)
+        {
+            out[i].name = names[i];
+        }
+        return out;
+    }
+
+    template <typename Stage>
+    Stage& stage()
+    {
+        return std::get<Stage>(stages);
+    }
+
+private:
+    template <typename Stage>
+    static void begin_stage(Stage& stage)
+    {
+        if constexpr (requires { stage.begin(); })
+        {
+            stage.begin();
+        }
+    }
+
+    // one clock read per stage, the end of one stage is the start of the next
+    template <size_t I>
+    bool accept_from(Candidate& window, const std::chrono::steady_clock::time_point start)
+    {
+        if constexpr (I == stage_count)
+        {
+            return true;
+        }
+        else
+        {
+            const bool passed = std::get<I>(stages).accept(window);
+            const auto end = std::chrono::steady_clock::now();
+
+            StageStats& stats = counters[I];
+            ++stats.checked;
+            stats.nanoseconds += static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+            if (!passed)
+            {
+                ++stats.rejected;
+                return false;
+            }
+            return accept_from<I + 1>(window, end);
+        }
+    }
+
+    std::tuple<Stages...> stages;
+    std::array<StageStats, stage_count> counters{};
+};
+
+// Counters of the pipeline ListWindowsByDesktop() runs, in stage order
+std::vector<StageStats> eligibility_stats();
+
+#endif //FINDMYWINDOWS_ELIGIBILITY_H
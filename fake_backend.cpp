@@ -0,0 +1,667 @@
+#include "fake_backend.h"
+#include "log.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <string_view>
+#include <thread>
+
+static constexpr const char* call_names[] = {
+    "enum_windows", "is_visible", "ex_style", "owner", "cloaked", "title", "class_name", "process_id", "process_name",
+    "child_windows", "package_name", "is_on_current_desktop", "activate", "set_positions",
+};
+static_assert(std::size(call_names) == static_cast<size_t>(FakeCall::Count));
+
+const char* fake_call_name(const FakeCall call)
+{
+    return call_names[static_cast<size_t>(call)];
+}
+
+template <typename T>
+static bool parse_number(const std::string_view text, T& out)
+{
+    const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), out);
+    return ec == std::errc() && end == text.data() + text.size();
+}
+
+// Splits off the next space separated word
+static std::string_view next_word(std::string_view& text)
+{
+    const size_t start = text.find_first_not_of(' ');
+    if (start == std::string_view::npos)
+    {
+        text = {};
+        return {};
+    }
+    text.remove_prefix(start);
+    const size_t end = std::min(text.find_first_of(", "), text.size());
+    const std::string_view word = text.substr(0, end);
+    text.remove_prefix(end == text.size() ? end : end + 1);
+    return word;
+}
+
+HWND FakeBackend::next_handle()
+{
+    const HWND hwnd = reinterpret_cast<HWND>(nextHandle);
+    nextHandle += 0x10;
+    return hwnd;
+}
+
+void FakeBackend::assign_process_id(FakeWindow& window)
+{
+    if (window.processId != 0) return;
+
+    // windows of the same process share a pid, like on a real desktop
+    const auto sibling = std::ranges::find(windows, window.processName, &FakeWindow::processName);
+    if (sibling != windows.end())
+    {
+        window.processId = sibling->processId;
+        return;
+    }
+    const auto child = std::ranges::find(children, window.processName, &FakeWindow::processName);
+    window.processId = child != children.end() ? child->processId : nextProcessId++;
+}
+
+HWND FakeBackend::add_window(FakeWindow window)
+{
+    std::lock_guard lock(mutex);
+    if (window.hwnd == nullptr)
+    {
+        window.hwnd = next_handle();
+    }
+
+    assign_process_id(window);
+    window.parent = nullptr;
+    const HWND hwnd = window.hwnd;
+    windows.insert(windows.begin(), std::move(window));
+    return hwnd;
+}
+
+HWND FakeBackend::add_child(const HWND parent, FakeWindow window)
+{
+    std::lock_guard lock(mutex);
+    if (!find(parent)) return nullptr;
+
+    if (window.hwnd == nullptr)
+    {
+        window.hwnd = next_handle();
+    }
+
+    assign_process_id(window);
+    window.parent = parent;
+    const HWND hwnd = window.hwnd;
+    children.push_back(std::move(window));
+    return hwnd;
+}
+
+void FakeBackend::remove_window(const HWND hwnd)
+{
+    std::lock_guard lock(mutex);
+    std::erase_if(windows, [&](const FakeWindow& window) { return window.hwnd == hwnd; });
+    erase_orphans();
+}
+
+void FakeBackend::set_title(const HWND hwnd, const std::string& title)
+{
+    std::lock_guard lock(mutex);
+    if (FakeWindow* window = find(hwnd))
+    {
+        window->title = title;
+    }
+}
+
+void FakeBackend::set_hung(const HWND hwnd, const bool hung)
+{
+    std::lock_guard lock(mutex);
+    if (FakeWindow* window = find(hwnd))
+    {
+        window->hung = hung;
+    }
+}
+
+void FakeBackend::end_process(const DWORD processId)
+{
+    std::lock_guard lock(mutex);
+    std::erase_if(windows, [&](const FakeWindow& window) { return window.processId == processId; });
+    std::erase_if(children, [&](const FakeWindow& window) { return window.processId == processId; });
+    erase_orphans();
+    // whatever gets the pid next is a different process
+    std::erase(deniedProcesses, processId);
+}
+
+void FakeBackend::deny_process(const DWORD processId)
+{
+    std::lock_guard lock(mutex);
+    if (std::ranges::find(deniedProcesses, processId) == deniedProcesses.end())
+    {
+        deniedProcesses.push_back(processId);
+    }
+}
+
+void FakeBackend::set_virtual_desktops(const bool available)
+{
+    std::lock_guard lock(mutex);
+    virtualDesktops = available;
+}
+
+void FakeBackend::set_latency(const FakeCall call, const FakeLatency latency)
+{
+    std::lock_guard lock(mutex);
+    latencies[static_cast<size_t>(call)] = latency;
+}
+
+void FakeBackend::set_hang_cost(const std::chrono::microseconds cost)
+{
+    std::lock_guard lock(mutex);
+    hangCost = cost;
+}
+
+void FakeBackend::seed(const uint64_t seed)
+{
+    std::lock_guard lock(mutex);
+    random.seed(seed);
+}
+
+void FakeBackend::set_clock(void (*advance)(std::chrono::microseconds))
+{
+    std::lock_guard lock(mutex);
+    advanceClock = advance;
+}
+
+std::chrono::microseconds FakeBackend::charged()
+{
+    std::lock_guard lock(mutex);
+    return chargedTime;
+}
+
+size_t FakeBackend::calls(const FakeCall call)
+{
+    std::lock_guard lock(mutex);
+    return callCounts[static_cast<size_t>(call)];
+}
+
+// "@latency title 20 400" and the other simulation settings of a script
+static bool apply_directive(FakeBackend& backend, std::string_view text)
+{
+    const std::string_view name = next_word(text);
+    if (name == "seed")
+    {
+        uint64_t seed = 0;
+        if (!parse_number(next_word(text), seed)) return false;
+        backend.seed(seed);
+        return true;
+    }
+    if (name == "hang")
+    {
+        int64_t cost = 0;
+        if (!parse_number(next_word(text), cost)) return false;
+        backend.set_hang_cost(std::chrono::microseconds(cost));
+        return true;
+    }
+    if (name == "desktops")
+    {
+        backend.set_virtual_desktops(next_word(text) == "on");
+        return true;
+    }
+    if (name == "latency")
+    {
+        const std::string_view callName = next_word(text);
+        const auto call = std::ranges::find(call_names, callName);
+        int64_t median = 0;
+        int64_t p99 = 0;
+        if (call == std::end(call_names) || !parse_number(next_word(text), median) ||
+            !parse_number(next_word(text), p99))
+        {
+            return false;
+        }
+        backend.set_latency(static_cast<FakeCall>(call - std::begin(call_names)),
+                            {std::chrono::microseconds(median), std::chrono::microseconds(p99)});
+        return true;
+    }
+    return false;
+}
+
+// The "[hung pid=1200] " prefix of a window line, denied is returned separately
+// because it belongs to the process rather than the window, child because the
+// parent's handle isn't known yet
+static bool apply_flags(std::string_view flags, FakeWindow& window, bool& denied, bool& child)
+{
+    for (std::string_view flag = next_word(flags); !flag.empty(); flag = next_word(flags))
+    {
+        if (flag == "hung") window.hung = true;
+        else if (flag == "denied") denied = true;
+        else if (flag == "minimized") window.minimized = true;
+        else if (flag == "hidden") window.visible = false;
+        else if (flag == "tool") window.exStyle |= WS_EX_TOOLWINDOW;
+        else if (flag == "cloaked") window.cloaked |= DWM_CLOAKED_APP;
+        else if (flag == "current") window.onCurrentDesktop = true;
+        else if (flag == "child") child = true;
+        else if (flag.starts_with("package="))
+        {
+            window.package = flag.substr(8);
+            if (window.package.empty()) return false;
+        }
+        else if (flag.starts_with("pid="))
+        {
+            if (!parse_number(flag.substr(4), window.processId) || window.processId == 0) return false;
+        }
+        else return false;
+    }
+    return true;
+}
+
+bool FakeBackend::load(const std::string& filename)
+{
+    std::ifstream file_stream(filename);
+    if (!file_stream.is_open())
+    {
+        LOG_ERROR("Unable to open fake window list: {}", filename);
+        return false;
+    }
+
+    struct LoadedWindow
+    {
+        FakeWindow window;
+        bool denied = false;
+        // index of the parent line, npos for a top-level window
+        size_t parent = std::string::npos;
+    };
+    std::vector<LoadedWindow> loaded;
+    size_t lastTopLevel = std::string::npos;
+    std::string line;
+    while (std::getline(file_stream, line))
+    {
+        if (line.empty() || line[0] == '#') continue;
+
+        if (line[0] == '@')
+        {
+            if (!apply_directive(*this, std::string_view(line).substr(1)))
+            {
+                LOG_WARN("Skipping malformed fake desktop setting: {}", line);
+            }
+            continue;
+        }
+
+        FakeWindow window;
+        bool denied = false;
+        bool child = false;
+        size_t start = 0;
+        if (line[0] == '[')
+        {
+            const size_t close = line.find("] ");
+            if (close == std::string::npos ||
+                !apply_flags(std::string_view(line).substr(1, close - 1), window, denied, child) ||
+                (child && lastTopLevel == std::string::npos))
+            {
+                LOG_WARN("Skipping malformed fake window line: {}", line);
+                continue;
+            }
+            start = close + 2;
+        }
+
+        const size_t first = line.find('|', start);
+        const size_t second = first == std::string::npos ? std::string::npos : line.find('|', first + 1);
+        if (second == std::string::npos)
+        {
+            LOG_WARN("Skipping malformed fake window line: {}", line);
+            continue;
+        }
+
+        window.processName = line.substr(start, first - start);
+        window.className = line.substr(first + 1, second - first - 1);
+        window.title = line.substr(second + 1);
+        if (!child)
+        {
+            lastTopLevel = loaded.size();
+        }
+        loaded.push_back({std::move(window), denied, child ? lastTopLevel : std::string::npos});
+    }
+
+    // the file lists windows front first, add_window pushes to the front.
+    // Children go in afterwards, once their parents have handles.
+    std::vector<HWND> handles(loaded.size());
+    for (size_t i = loaded.size(); i-- > 0;)
+    {
+        if (loaded[i].parent == std::string::npos)
+        {
+            handles[i] = add_window(std::move(loaded[i].window));
+        }
+    }
+    for (size_t i = 0; i < loaded.size(); ++i)
+    {
+        if (loaded[i].parent != std::string::npos)
+        {
+            handles[i] = add_child(handles[loaded[i].parent], std::move(loaded[i].window));
+        }
+    }
+    for (size_t i = 0; i < loaded.size(); ++i)
+    {
+        if (loaded[i].denied)
+        {
+            FakeWindow added;
+            get_window(handles[i], added);
+            deny_process(added.processId);
+        }
+    }
+    return true;
+}
+
+void FakeBackend::load_sample()
+{
+    add_window({.title = "Windows PowerShell", .className = "ConsoleWindowClass", .processName = "powershell.exe"});
+    add_window({.title = "Inbox - Outlook", .className = "rctrl_renwnd32", .processName = "OUTLOOK.EXE"});
+    add_window({.title = "tabs.cpp - findmywindows - Visual Studio Code", .className = "Chrome_WidgetWin_1",
+        .processName = "Code.exe"});
+    add_window({.title = "GitHub - Google Chrome", .className = "Chrome_WidgetWin_1", .processName = "chrome.exe"});
+}
+
+void FakeBackend::enum_windows(std::vector<HWND>& out)
+{
+    std::unique_lock lock(mutex);
+    charge(lock, FakeCall::EnumWindows);
+    for (const auto& window : windows)
+    {
+        out.push_back(window.hwnd);
+    }
+}
+
+bool FakeBackend::is_visible(const HWND hwnd)
+{
+    std::unique_lock lock(mutex);
+    charge(lock, FakeCall::IsVisible);
+    const FakeWindow* window = find(hwnd);
+    return window && window->visible;
+}
+
+DWORD FakeBackend::ex_style(const HWND hwnd)
+{
+    std::unique_lock lock(mutex);
+    charge(lock, FakeCall::ExStyle);
+    const FakeWindow* window = find(hwnd);
+    return window ? window->exStyle : 0;
+}
+
+HWND FakeBackend::owner(const HWND hwnd)
+{
+    std::unique_lock lock(mutex);
+    charge(lock, FakeCall::Owner);
+    const FakeWindow* window = find(hwnd);
+    return window ? window->owner : nullptr;
+}
+
+DWORD FakeBackend::cloaked(const HWND hwnd)
+{
+    std::unique_lock lock(mutex);
+    charge(lock, FakeCall::Cloaked);
+    const FakeWindow* window = find(hwnd);
+    return window ? window->cloaked : 0;
+}
+
+std::string FakeBackend::title(const HWND hwnd)
+{
+    std::unique_lock lock(mutex);
+    charge(lock, FakeCall::Title);
+    const FakeWindow* window = find(hwnd);
+    return window ? window->title : std::string();
+}
+
+std::string FakeBackend::class_name(const HWND hwnd)
+{
+    std::unique_lock lock(mutex);
+    charge(lock, FakeCall::ClassName);
+    const FakeWindow* window = find(hwnd);
+    return window ? window->className : std::string();
+}
+
+DWORD FakeBackend::process_id(const HWND hwnd)
+{
+    std::unique_lock lock(mutex);
+    charge(lock, FakeCall::ProcessId);
+    const FakeWindow* window = find(hwnd);
+    return window ? window->processId : 0;
+}
+
+std::string FakeBackend::process_name(const DWORD processId)
+{
+    std::unique_lock lock(mutex);
+    charge(lock, FakeCall::ProcessName);
+    if (std::ranges::find(deniedProcesses, processId) != deniedProcesses.end()) return "Unknown";
+
+    const FakeWindow* window = find_process(processId);
+    return window ? window->processName : "Unknown";
+}
+
+void FakeBackend::child_windows(const HWND parent, std::vector<HWND>& out)
+{
+    std::unique_lock lock(mutex);
+    charge(lock, FakeCall::ChildWindows);
+    const size_t first = out.size();
+    for (const auto& child : children)
+    {
+        // a parent comes before its children, so grandchildren find theirs in out already
+        if (child.parent == parent || std::ranges::find(out.begin() + first, out.end(), child.parent) != out.end())
+        {
+            out.push_back(child.hwnd);
+        }
+    }
+}
+
+std::string FakeBackend::package_name(const DWORD processId)
+{
+    std::unique_lock lock(mutex);
+    charge(lock, FakeCall::PackageName);
+    if (std::ranges::find(deniedProcesses, processId) != deniedProcesses.end()) return {};
+
+    const FakeWindow* window = find_process(processId);
+    return window ? window->package : std::string();
+}
+
+bool FakeBackend::has_virtual_desktops()
+{
+    std::lock_guard lock(mutex);
+    return virtualDesktops;
+}
+
+bool FakeBackend::is_on_current_desktop(const HWND hwnd)
+{
+    std::unique_lock lock(mutex);
+    charge(lock, FakeCall::IsOnCurrentDesktop);
+    const FakeWindow* window = find(hwnd);
+    return window && window->onCurrentDesktop;
+}
+
+bool FakeBackend::activate(const HWND hwnd)
+{
+    std::unique_lock lock(mutex);
+    const FakeWindow* target = find(hwnd);
+    if (target && target->hung)
+    {
+        // the window never answers, the desktop gives up and leaves the focus where it was
+        charge(lock, FakeCall::Activate, true);
+        return false;
+    }
+    charge(lock, FakeCall::Activate);
+
+    const auto it = std::ranges::find(windows, hwnd, &FakeWindow::hwnd);
+    if (it == windows.end()) return false;
+
+    it->minimized = false;
+    std::rotate(windows.begin(), it, it + 1);
+    return true;
+}
+
+HWND FakeBackend::foreground()
+{
+    // activate() raises to the front of the z-order, like the real desktop
+    std::lock_guard lock(mutex);
+    return windows.empty() ? nullptr : windows.front().hwnd;
+}
+
+bool FakeBackend::close_window(const HWND hwnd)
+{
+    // the fake app never asks to save first
+    std::lock_guard lock(mutex);
+    if (std::erase_if(windows, [&](const FakeWindow& window) { return window.hwnd == hwnd; }) == 0) return false;
+
+    erase_orphans();
+    return true;
+}
+
+bool FakeBackend::minimize(const HWND hwnd)
+{
+    std::lock_guard lock(mutex);
+    FakeWindow* window = find(hwnd);
+    if (!window) return false;
+
+    window->minimized = true;
+    return true;
+}
+
+bool FakeBackend::move_to_desktop_of(const HWND hwnd, const HWND anchor)
+{
+    std::lock_guard lock(mutex);
+    FakeWindow* window = find(hwnd);
+    if (!window) return false;
+
+    // the fake desktop has the current one and "elsewhere", the front window stands in for the foreground
+    const FakeWindow* target = anchor ? find(anchor) : &windows.front();
+    if (!target) return false;
+
+    window->onCurrentDesktop = target->onCurrentDesktop;
+    return true;
+}
+
+WindowRect FakeBackend::work_area()
+{
+    return {0, 0, 1920, 1040};
+}
+
+size_t FakeBackend::set_positions(const std::vector<WindowPlacement>& placements)
+{
+    std::unique_lock lock(mutex);
+    // the batch waits for every window in it, one hung window stalls all of them
+    const bool anyHung = std::ranges::any_of(placements, [&](const WindowPlacement& placement)
+    {
+        const FakeWindow* window = find(placement.hwnd);
+        return window && window->hung;
+    });
+    charge(lock, FakeCall::SetPositions, anyHung);
+    ++positionBatches;
+
+    size_t placed = 0;
+    for (const auto& placement : placements)
+    {
+        FakeWindow* window = find(placement.hwnd);
+        if (window && !window->hung)
+        {
+            window->minimized = false;
+            window->rect = placement.rect;
+            ++placed;
+        }
+    }
+    return placed;
+}
+
+bool FakeBackend::get_window(const HWND hwnd, FakeWindow& out)
+{
+    std::lock_guard lock(mutex);
+    const FakeWindow* window = find(hwnd);
+    if (!window) return false;
+
+    out = *window;
+    return true;
+}
+
+size_t FakeBackend::position_batches()
+{
+    std::lock_guard lock(mutex);
+    return positionBatches;
+}
+
+std::vector<std::string> FakeBackend::launches()
+{
+    std::lock_guard lock(mutex);
+    return launched;
+}
+
+bool FakeBackend::launch(const std::string& command)
+{
+    std::lock_guard lock(mutex);
+    launched.push_back(command);
+    return true;
+}
+
+FakeWindow* FakeBackend::find(const HWND hwnd)
+{
+    if (const auto it = std::ranges::find(windows, hwnd, &FakeWindow::hwnd); it != windows.end()) return &*it;
+
+    const auto child = std::ranges::find(children, hwnd, &FakeWindow::hwnd);
+    return child != children.end() ? &*child : nullptr;
+}
+
+const FakeWindow* FakeBackend::find_process(const DWORD processId)
+{
+    if (const auto it = std::ranges::find(windows, processId, &FakeWindow::processId); it != windows.end()) return &*it;
+
+    const auto child = std::ranges::find(children, processId, &FakeWindow::processId);
+    return child != children.end() ? &*child : nullptr;
+}
+
+void FakeBackend::erase_orphans()
+{
+    // destroying a window destroys its children, parents come first so one pass does
+    std::vector<HWND> alive;
+    alive.reserve(windows.size() + children.size());
+    for (const auto& window : windows)
+    {
+        alive.push_back(window.hwnd);
+    }
+    std::erase_if(children, [&](const FakeWindow& child)
+    {
+        if (std::ranges::find(alive, child.parent) == alive.end()) return true;
+        alive.push_back(child.hwnd);
+        return false;
+    });
+}
+
+std::chrono::microseconds FakeBackend::draw(const FakeCall call)
+{
+    const FakeLatency& latency = latencies[static_cast<size_t>(call)];
+    if (latency.median <= std::chrono::microseconds::zero()) return std::chrono::microseconds::zero();
+
+    // Box-Muller on the raw engine output rather than std::normal_distribution,
+    // whose algorithm differs between standard libraries
+    const double u1 = (static_cast<double>(random() >> 11) + 1.0) * 0x1.0p-53;
+    const double u2 = static_cast<double>(random() >> 11) * 0x1.0p-53;
+    const double z = std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+
+    // z of the 99th percentile of a standard normal
+    constexpr double z99 = 2.326347874040841;
+    const double median = static_cast<double>(latency.median.count());
+    const double sigma = latency.p99 > latency.median
+        ? std::log(static_cast<double>(latency.p99.count()) / median) / z99
+        : 0.0;
+    return std::chrono::microseconds(std::llround(median * std::exp(sigma * z)));
+}
+
+void FakeBackend::charge(std::unique_lock<std::mutex>& lock, const FakeCall call, const bool hung)
+{
+    ++callCounts[static_cast<size_t>(call)];
+    const std::chrono::microseconds cost = hung ? hangCost : draw(call);
+    if (cost <= std::chrono::microseconds::zero()) return;
+
+    chargedTime += cost;
+    const auto advance = advanceClock;
+    lock.unlock();
+    if (advance)
+    {
+        advance(cost);
+    }
+    else
+    {
+        std::this_thread::sleep_for(cost);
+    }
+    lock.lock();
+}
@@ -0,0 +1,182 @@
+#ifndef FINDMYWINDOWS_FAKE_BACKEND_H
+#define FINDMYWINDOWS_FAKE_BACKEND_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "backend.h"
+
+struct FakeWindow
+{
+    HWND hwnd = nullptr;
+    std::string title{};
+    std::string className{};
+    std::string processName{};
+    DWORD processId = 0;
+    // package family name, all windows of a process share it
+    std::string package{};
+    // set for child windows, which enum_windows() leaves out
+    HWND parent = nullptr;
+    DWORD exStyle = 0;
+    HWND owner = nullptr;
+    // DWM_CLOAKED_* flags
+    DWORD cloaked = 0;
+    bool visible = true;
+    bool onCurrentDesktop = false;
+    bool minimized = false;
+    // stopped pumping messages, calls that have to wait for the window cost the hang time
+    bool hung = false;
+    WindowRect rect{0, 0, 800, 600};
+};
+
+// The backend calls that can be given a latency
+enum class FakeCall : uint8_t
+{
+    EnumWindows,
+    IsVisible,
+    ExStyle,
+    Owner,
+    Cloaked,
+    Title,
+    ClassName,
+    ProcessId,
+    ProcessName,
+    ChildWindows,
+    PackageName,
+    IsOnCurrentDesktop,
+    Activate,
+    SetPositions,
+    Count,
+};
+
+// Log-normal latency given by its median and 99th percentile, zero for none
+struct FakeLatency
+{
+    std::chrono::microseconds median{0};
+    std::chrono::microseconds p99{0};
+};
+
+// In-memory desktop for headless builds. Windows are kept in z-order, front first,
+// and activate() raises a window the same way the real desktop would.
+// Every call takes a lock, so the action worker can share it with the list owner.
+//
+// It can also stand in for a slow or misbehaving desktop: calls take latencies drawn
+// from a seeded generator, so one thread making the same calls is charged the same
+// time on every run, windows can hang and processes can refuse to be opened.
+class FakeBackend final : public WindowBackend
+{
+public:
+    // Inserts at the top of the z-order, assigning a handle when hwnd is null
+    HWND add_window(FakeWindow window);
+    // Adds a child of parent, e.g. the app window inside a UWP frame. Ends up
+    // after the parent's other children.
+    HWND add_child(HWND parent, FakeWindow window);
+    // Removes the window and its children
+    void remove_window(HWND hwnd);
+    void set_title(HWND hwnd, const std::string& title);
+    void set_hung(HWND hwnd, bool hung);
+
+    // Removes every window of the process. Its pid is free again, add_window() with
+    // that processId and another name is how pid reuse looks.
+    void end_process(DWORD processId);
+    // process_name() fails for the pid like OpenProcess() on an elevated process
+    void deny_process(DWORD processId);
+
+    // Off by default, like a desktop without the virtual desktop manager
+    void set_virtual_desktops(bool available);
+
+    // One window per line as "process|class|title", blank lines and # comments skipped.
+    // A line can start with "[flags] ", any of hung, denied, minimized, hidden, tool,
+    // cloaked (by its app), current (on the current desktop), pid=N, package=NAME and
+    // child (of the closest window line above without it). Lines starting with @ configure the
+    // simulation: "@seed N", "@hang US", "@desktops on" and "@latency CALL MEDIAN_US P99_US"
+    // with CALL one of the fake_call_name()s.
+    bool load(const std::string& filename);
+    void load_sample();
+
+    // Every call of that kind takes a latency drawn from the distribution
+    void set_latency(FakeCall call, FakeLatency latency);
+    // What calls that wait for a hung window cost, 5 s by default like the hung app timeout
+    void set_hang_cost(std::chrono::microseconds cost);
+    // Restarts the latency draws, the same seed gives the same sequence
+    void seed(uint64_t seed);
+    // Latencies pass as advance(latency) when given, so a fake clock moves, otherwise
+    // as a real sleep
+    void set_clock(void (*advance)(std::chrono::microseconds));
+
+    // Latency charged so far, over all calls and threads
+    std::chrono::microseconds charged();
+    size_t calls(FakeCall call);
+
+    // Copy of the window's current state, false if it is gone
+    bool get_window(HWND hwnd, FakeWindow& out);
+
+    // set_positions() calls so far, each one is a single repaint on a real desktop
+    size_t position_batches();
+    // launch() commands so far, nothing is started
+    std::vector<std::string> launches();
+
+    void enum_windows(std::vector<HWND>& out) override;
+    bool is_visible(HWND hwnd) override;
+    DWORD ex_style(HWND hwnd) override;
+    HWND owner(HWND hwnd) override;
+    DWORD cloaked(HWND hwnd) override;
+    std::string title(HWND hwnd) override;
+    std::string class_name(HWND hwnd) override;
+    DWORD process_id(HWND hwnd) override;
+    std::string process_name(DWORD processId) override;
+    void child_windows(HWND parent, std::vector<HWND>& out) override;
+    std::string package_name(DWORD processId) override;
+    bool has_virtual_desktops() override;
+    bool is_on_current_desktop(HWND hwnd) override;
+    bool activate(HWND hwnd) override;
+    HWND foreground() override;
+    bool close_window(HWND hwnd) override;
+    bool minimize(HWND hwnd) override;
+    bool move_to_desktop_of(HWND hwnd, HWND anchor) override;
+    WindowRect work_area() override;
+    size_t set_positions(const std::vector<WindowPlacement>& placements) override;
+    bool launch(const std::string& command) override;
+
+private:
+    // callers hold mutex, finds child windows too
+    FakeWindow* find(HWND hwnd);
+    // The process's first window, top-level or child, null when it has none
+    const FakeWindow* find_process(DWORD processId);
+    HWND next_handle();
+    // The pid of another window of the same process name, a new one when there is none
+    void assign_process_id(FakeWindow& window);
+    // Drops the children of windows that are gone
+    void erase_orphans();
+    std::chrono::microseconds draw(FakeCall call);
+    // Counts the call and waits out its latency with the lock released, the
+    // window may be gone by the time it returns. hung charges the hang cost instead.
+    void charge(std::unique_lock<std::mutex>& lock, FakeCall call, bool hung = false);
+
+    std::mutex mutex;
+    std::vector<FakeWindow> windows;
+    // in the order they were added, so a window's parent always comes first
+    std::vector<FakeWindow> children;
+    std::vector<DWORD> deniedProcesses;
+    size_t positionBatches = 0;
+    std::vector<std::string> launched;
+    uintptr_t nextHandle = 0x10010;
+    DWORD nextProcessId = 1000;
+    bool virtualDesktops = false;
+
+    std::array<FakeLatency, static_cast<size_t>(FakeCall::Count)> latencies{};
+    std::array<size_t, static_cast<size_t>(FakeCall::Count)> callCounts{};
+    std::chrono::microseconds hangCost{5000000};
+    std::chrono::microseconds chargedTime{0};
+    void (*advanceClock)(std::chrono::microseconds) = nullptr;
+    std::mt19937_64 random{1};
+};
+
+const char* fake_call_name(FakeCall call);
+
+#endif //FINDMYWINDOWS_FAKE_BACKEND_H
@@ -1,6 +1,6 @@
 #include "file.h"
+#include "log.h"
 
-#include <iostream>
 #include <fstream>
 #include <vector>
 #include <string>
@@ -11,13 +11,13 @@ void write_strings_to_file(const std::string& filename, const std::vector<std::s
     {
         for (const auto& str : strings)
         {
-            output_file << str << std::endl;
+            output_file << str << '\n';
         }
         output_file.close();
     }
     else
     {
-        std::cerr << "Unable to open file for writing: " << filename << std::endl;
+        LOG_ERROR("Unable to open file for writing: {}", filename);
     }
 }
 
@@ -27,11 +27,11 @@ std::vector<std::string> read_strings_from_file(const std::string& filename)
 
     if (!file_stream.is_open())
     {
-        std::cout << "File not found: " << filename << ". Creating a default file." << std::endl;
+        LOG_INFO("File not found: {}. Creating a default file.", filename);
 
         if (std::ofstream output_file(filename); !output_file)
         {
-            std::cerr << "Error: Could not create the default file: " << filename << std::endl;
+            LOG_ERROR("Could not create the default file: {}", filename);
             return {};
         }
 
@@ -39,7 +39,7 @@ std::vector<std::string> read_strings_from_file(const std::string& filename)
         file_stream.open(filename);
         if (!file_stream.is_open())
         {
-            std::cerr << "Fatal Error: Failed to open the newly created config file." << std::endl;
+            LOG_ERROR("Failed to open the newly created config file: {}", filename);
             return {}; // Return empty
         }
     }
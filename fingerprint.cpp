@@ -0,0 +1,314 @@
+#include "fingerprint.h"
+#include "backend.h"
+#include "window_list.h"
+
+#include <algorithm>
+#include <bit>
+#include <mutex>
+#include <tuple>
+
+static constexpr uint64_t fnv_offset = 14695981039346656037ull;
+static constexpr uint64_t fnv_prime = 1099511628211ull;
+
+static char fold(const char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// splitmix64's finalizer, FNV alone leaves the high bits poorly mixed for short strings
+static uint64_t mix(uint64_t h)
+{
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBull;
+    return h ^ (h >> 31);
+}
+
+static uint64_t hash_folded(const std::string_view text, uint64_t h = fnv_offset)
+{
+    for (const char c : text)
+    {
+        h = (h ^ static_cast<unsigned char>(fold(c))) * fnv_prime;
+    }
+    return h;
+}
+
+uint32_t app_hash(const std::string_view orderingKey, const std::string_view className)
+{
+    // the separator keeps "ab"+"c" and "a"+"bc" apart
+    const uint64_t h = hash_folded(className, (hash_folded(orderingKey) ^ 0x1F) * fnv_prime);
+    const auto app = static_cast<uint32_t>(mix(h) >> 32);
+    return app != 0 ? app : 1;
+}
+
+// Letters, digits and anything not ASCII, so words in other scripts count as words
+static bool word_char(const char c)
+{
+    const auto u = static_cast<unsigned char>(c);
+    return u >= 0x80 || (c >= '0' && c <= '9') || (fold(c) >= 'a' && fold(c) <= 'z');
+}
+
+// "Document - App", the app part is the same for all of the app's windows and would
+// outvote the words that tell them apart
+static std::string_view without_app_suffix(const std::string_view title)
+{
+    for (const std::string_view separator : {std::string_view(" - "), std::string_view(" \xE2\x80\x94 ")})
+    {
+        const size_t at = title.rfind(separator);
+        if (at != std::string_view::npos && at > 0) return title.substr(0, at);
+    }
+    return title;
+}
+
+uint32_t title_simhash(std::string_view title)
+{
+    title = without_app_suffix(title);
+    int votes[24] = {};
+    size_t words = 0;
+    size_t i = 0;
+    while (i < title.size())
+    {
+        if (!word_char(title[i]))
+        {
+            ++i;
+            continue;
+        }
+
+        uint64_t h = fnv_offset;
+        while (i < title.size() && word_char(title[i]))
+        {
+            if (title[i] >= '0' && title[i] <= '9')
+            {
+                // a counter or a version, the number itself doesn't identify the window
+                h = (h ^ '#') * fnv_prime;
+                while (i < title.size() && title[i] >= '0' && title[i] <= '9') ++i;
+                continue;
+            }
+            h = (h ^ static_cast<unsigned char>(fold(title[i]))) * fnv_prime;
+            ++i;
+        }
+        h = mix(h);
+        // words weigh 1 to 8 by their own hash, equal weights tie half the bits of a two word title
+        const int weight = 1 + static_cast<int>(h >> 61);
+        for (int bit = 0; bit < 24; ++bit)
+        {
+            votes[bit] += (h >> bit) & 1 ? weight : -weight;
+        }
+        ++words;
+    }
+    if (words == 0) return 0;
+
+    uint32_t bits = 0;
+    for (int bit = 0; bit < 24; ++bit)
+    {
+        if (votes[bit] > 0) bits |= 1u << bit;
+    }
+    return bits;
+}
+
+WindowFingerprint make_fingerprint(const uint32_t app, const uint32_t ordinal, const uint32_t title)
+{
+    return static_cast<uint64_t>(app) << 32 | static_cast<uint64_t>(std::min(ordinal, 255u)) << 24 |
+        (title & 0xFFFFFF);
+}
+
+int title_distance(const WindowFingerprint a, const WindowFingerprint b)
+{
+    return std::popcount(fingerprint_title(a ^ b));
+}
+
+uint32_t FingerprintRegistry::take_ordinal(const uint32_t app)
+{
+    std::array<uint64_t, 4>& used = ordinals[app];
+    for (uint32_t word = 0; word < used.size(); ++word)
+    {
+        if (used[word] == ~0ull) continue;
+
+        const auto bit = static_cast<uint32_t>(std::countr_one(used[word]));
+        used[word] |= 1ull << bit;
+        return word * 64 + bit;
+    }
+    // hundreds of windows of one app share the last ordinal
+    return max_ordinal;
+}
+
+void FingerprintRegistry::give_back(const Known& known)
+{
+    const auto it = ordinals.find(known.app);
+    if (it == ordinals.end()) return;
+
+    if (known.ordinal < max_ordinal) it->second[known.ordinal / 64] &= ~(1ull << (known.ordinal % 64));
+    if (std::ranges::all_of(it->second, [](const uint64_t word) { return word == 0; })) ordinals.erase(it);
+}
+
+void FingerprintRegistry::update(WindowBackend& backend, const std::span<WindowInfo> windows)
+{
+    ++generation;
+    for (WindowInfo& window : windows)
+    {
+        if ((window.resolved & ALL_WINDOW_FIELDS) != ALL_WINDOW_FIELDS || window.tabNode != 0)
+        {
+            window.fingerprint = 0;
+            continue;
+        }
+
+        const uint32_t app = app_hash(ordering_key(window), window.className);
+        auto [it, inserted] = this->windows.try_emplace(window.hwnd);
+        Known& known = it->second;
+        if (!inserted && known.app != app)
+        {
+            // the handle went to another app, or the window moved into a UWP app it hosts
+            give_back(known);
+            inserted = true;
+        }
+        if (inserted)
+        {
+            known.app = app;
+            known.ordinal = take_ordinal(app);
+        }
+
+        // hashing the whole title is cheaper than splitting it into words
+        const uint64_t titleKey = hash_folded(window.title);
+        if (inserted || titleKey != known.titleKey)
+        {
+            known.title = title_simhash(window.title);
+            known.titleKey = titleKey;
+        }
+        known.processId = window.processId;
+        known.generation = generation;
+        window.fingerprint = make_fingerprint(app, known.ordinal, known.title);
+    }
+
+    // on another desktop, or cloaked for a moment, is not closed
+    std::erase_if(this->windows, [&](const auto& entry)
+    {
+        const Known& known = entry.second;
+        if (known.generation == generation || backend.process_id(entry.first) == known.processId) return false;
+
+        give_back(known);
+        return true;
+    });
+}
+
+void FingerprintRegistry::seed(const HWND hwnd, const DWORD processId, const WindowFingerprint fingerprint)
+{
+    if (fingerprint == 0 || windows.contains(hwnd)) return;
+
+    Known known;
+    known.app = fingerprint_app(fingerprint);
+    known.ordinal = fingerprint_ordinal(fingerprint);
+    known.processId = processId;
+    known.title = fingerprint_title(fingerprint);
+    std::array<uint64_t, 4>& used = ordinals[known.app];
+    const uint64_t bit = 1ull << (known.ordinal % 64);
+    if (known.ordinal >= max_ordinal || used[known.ordinal / 64] & bit)
+    {
+        // two restored windows claim it, the second one starts over
+        known.ordinal = take_ordinal(known.app);
+    }
+    else
+    {
+        used[known.ordinal / 64] |= bit;
+    }
+    known.generation = generation;
+    windows.emplace(hwnd, known);
+}
+
+size_t FingerprintRegistry::size() const
+{
+    return windows.size();
+}
+
+FingerprintMatcher::FingerprintMatcher(const std::span<const WindowInfo> windows) : used(windows.size())
+{
+    sorted.reserve(windows.size());
+    for (uint32_t i = 0; i < windows.size(); ++i)
+    {
+        if (windows[i].fingerprint != 0) sorted.emplace_back(windows[i].fingerprint, i);
+    }
+    std::ranges::sort(sorted);
+}
+
+// Unrelated titles are about 11 bits apart, a title with one of three words changed
+// about 5 from what it was. A different ordinal counts a little less than that word,
+// enough to keep a window whose title changed, not enough to outvote the title of
+// one whose older sibling closed.
+static constexpr int ordinal_weight = 3;
+
+std::vector<size_t> FingerprintMatcher::match(const std::span<const WindowFingerprint> saved)
+{
+    std::vector<size_t> matched(saved.size(), SIZE_MAX);
+
+    std::vector<uint32_t> order;
+    order.reserve(saved.size());
+    for (uint32_t i = 0; i < saved.size(); ++i)
+    {
+        if (saved[i] != 0) order.push_back(i);
+    }
+    std::ranges::sort(order, {}, [&](const uint32_t i) { return std::pair(fingerprint_app(saved[i]), i); });
+
+    // score, saved index, window index
+    std::vector<std::tuple<int, uint32_t, uint32_t>> pairs;
+    for (size_t first = 0; first < order.size();)
+    {
+        const uint32_t app = fingerprint_app(saved[order[first]]);
+        size_t last = first;
+        while (last < order.size() && fingerprint_app(saved[order[last]]) == app) ++last;
+
+        const auto begin = std::ranges::lower_bound(sorted, app, {}, [](const auto& entry)
+        {
+            return fingerprint_app(entry.first);
+        });
+        pairs.clear();
+        for (auto it = begin; it != sorted.end() && fingerprint_app(it->first) == app; ++it)
+        {
+            if (used[it->second]) continue;
+
+            for (size_t i = first; i < last; ++i)
+            {
+                const WindowFingerprint fingerprint = saved[order[i]];
+                const int score = title_distance(it->first, fingerprint) +
+                    (fingerprint_ordinal(it->first) != fingerprint_ordinal(fingerprint) ? ordinal_weight : 0);
+                pairs.emplace_back(score, order[i], it->second);
+            }
+        }
+
+        // nearest first, ties go to the earlier slot
+        std::ranges::sort(pairs);
+        for (const auto& [score, slot, window] : pairs)
+        {
+            if (matched[slot] != SIZE_MAX || used[window]) continue;
+
+            matched[slot] = window;
+            used[window] = true;
+        }
+        first = last;
+    }
+    return matched;
+}
+
+void FingerprintMatcher::take(const size_t index)
+{
+    used[index] = true;
+}
+
+bool FingerprintMatcher::taken(const size_t index) const
+{
+    return used[index];
+}
+
+static std::mutex registryMutex;
+static FingerprintRegistry registry;
+
+void fingerprint_windows(WindowBackend& backend, const std::span<WindowInfo> windows)
+{
+    std::lock_guard lock(registryMutex);
+    registry.update(backend, windows);
+}
+
+void seed_fingerprint(const HWND hwnd, const DWORD processId, const WindowFingerprint fingerprint)
+{
+    std::lock_guard lock(registryMutex);
+    registry.seed(hwnd, processId, fingerprint);
+}
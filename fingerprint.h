@@ -0,0 +1,123 @@
+#ifndef FINDMYWINDOWS_FINGERPRINT_H
+#define FINDMYWINDOWS_FINGERPRINT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tabs.h"
+
+class WindowBackend;
+
+// Identity of a window that survives restarts of its app and of this process,
+// unlike its handle:
+//
+//   bits 63..32  the app, its ordering key (process name, or package for UWP apps)
+//                and window class hashed together
+//   bits 31..24  launch ordinal, 0 for the app's first window still open, 1 for the next...
+//   bits 23..0   simhash of the title's words, digits folded, so titles sharing most
+//                words are a few bits apart
+//
+// 0 means no fingerprint. Computed from fields the list has anyway, a hash of
+// two short strings and of the title's words per window.
+using WindowFingerprint = uint64_t;
+
+constexpr uint32_t fingerprint_app(const WindowFingerprint fingerprint)
+{
+    return static_cast<uint32_t>(fingerprint >> 32);
+}
+
+constexpr uint32_t fingerprint_ordinal(const WindowFingerprint fingerprint)
+{
+    return static_cast<uint32_t>(fingerprint >> 24) & 0xFF;
+}
+
+constexpr uint32_t fingerprint_title(const WindowFingerprint fingerprint)
+{
+    return static_cast<uint32_t>(fingerprint) & 0xFFFFFF;
+}
+
+uint32_t app_hash(std::string_view orderingKey, std::string_view className);
+
+// 24 bits, lowercase words with runs of digits counted as one "#" each and the
+// app's " - Name" at the end left out: "Inbox (12) - Outlook" and "Inbox (3)" hash the same
+uint32_t title_simhash(std::string_view title);
+
+WindowFingerprint make_fingerprint(uint32_t app, uint32_t ordinal, uint32_t title);
+
+// Bits two titles differ in, how far apart they are
+int title_distance(WindowFingerprint a, WindowFingerprint b);
+
+// Hands out launch ordinals and caches the title hashes. A window gets the lowest
+// ordinal no other open window of its app has and keeps it until it closes, also
+// while it is on another desktop and not listed. Not thread safe.
+class FingerprintRegistry
+{
+public:
+    static constexpr uint32_t max_ordinal = 255;
+
+    // Sets the fingerprint of every window, which need their process, class and title.
+    // Windows no longer listed give their ordinal back once the backend no longer
+    // sees their process own them.
+    void update(WindowBackend& backend, std::span<WindowInfo> windows);
+
+    // A window restored from the last session keeps its ordinal, before the first update
+    void seed(HWND hwnd, DWORD processId, WindowFingerprint fingerprint);
+
+    // Windows holding an ordinal
+    size_t size() const;
+
+private:
+    struct Known
+    {
+        uint32_t app = 0;
+        uint32_t ordinal = 0;
+        DWORD processId = 0;
+        // the title last hashed, by its plain hash
+        uint64_t titleKey = 0;
+        uint32_t title = 0;
+        uint64_t generation = 0;
+    };
+
+    uint32_t take_ordinal(uint32_t app);
+    void give_back(const Known& known);
+
+    std::unordered_map<HWND, Known> windows;
+    // bit n of an app's words set while one of its windows has ordinal n
+    std::unordered_map<uint32_t, std::array<uint64_t, 4>> ordinals;
+    uint64_t generation = 0;
+};
+
+// Matches saved fingerprints to the windows open now, each window to one at most.
+// Within an app the nearest pairs go first, the title distance plus a penalty for a
+// different ordinal, so a window whose title changed stays with its ordinal and one
+// whose older sibling closed follows its title. Sorting the windows by fingerprint
+// makes every app one range, a match only looks at the app's few windows.
+class FingerprintMatcher
+{
+public:
+    explicit FingerprintMatcher(std::span<const WindowInfo> windows);
+
+    // Index of the window each fingerprint matched, SIZE_MAX for 0 and when the app
+    // has no window left. The windows matched are taken.
+    std::vector<size_t> match(std::span<const WindowFingerprint> saved);
+    // Takes a window matched some other way
+    void take(size_t index);
+    bool taken(size_t index) const;
+
+private:
+    // fingerprint and window index, sorted
+    std::vector<std::pair<WindowFingerprint, uint32_t>> sorted;
+    std::vector<bool> used;
+};
+
+// Fingerprints windows with the process-wide registry, any thread
+void fingerprint_windows(WindowBackend& backend, std::span<WindowInfo> windows);
+void seed_fingerprint(HWND hwnd, DWORD processId, WindowFingerprint fingerprint);
+
+#endif //FINDMYWINDOWS_FINGERPRINT_H
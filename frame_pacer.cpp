@@ -0,0 +1,66 @@
+#include "frame_pacer.h"
+
+#include <algorithm>
+
+FramePacer::FramePacer(const std::chrono::nanoseconds period) : period(std::max(period, std::chrono::nanoseconds(1)))
+{
+}
+
+void FramePacer::set_vblank(const time_point vblank, const std::chrono::nanoseconds period)
+{
+    this->vblank = vblank;
+    if (period.count() > 0) this->period = period;
+    anchored = true;
+}
+
+FramePacer::time_point FramePacer::next_vblank(const time_point t) const
+{
+    if (!anchored) return t + period;
+
+    const auto since = t - vblank;
+    // floor division, t may be before the known vblank
+    auto periods = since / period;
+    if (since < std::chrono::nanoseconds::zero() && since % period != std::chrono::nanoseconds::zero()) --periods;
+    return vblank + (periods + 1) * period;
+}
+
+FramePacer::time_point FramePacer::next_frame_start(const time_point now) const
+{
+    const auto lead = estimate + margin;
+    time_point start = next_vblank(now) - lead;
+    // too late for the coming vblank, aim for the one after
+    while (start < now)
+    {
+        start += period;
+    }
+    return start;
+}
+
+void FramePacer::frame_rendered(const std::chrono::nanoseconds renderTime)
+{
+    // a missed vblank costs a whole period, so slow frames count at once
+    estimate = renderTime > estimate ? renderTime : estimate - (estimate - renderTime) / 16;
+}
+
+FramePacer::time_point FramePacer::frame_finished(const time_point frameStart, const time_point finished)
+{
+    frame_rendered(finished - frameStart);
+    return anchored ? next_vblank(finished) : finished;
+}
+
+std::chrono::nanoseconds FramePacer::render_estimate() const
+{
+    return estimate;
+}
+
+static LatencyStats presentLatency;
+
+void record_present_latency(const std::chrono::steady_clock::duration latency)
+{
+    presentLatency.add(latency);
+}
+
+LatencyStats present_latency_stats()
+{
+    return presentLatency;
+}
@@ -0,0 +1,51 @@
+#ifndef FINDMYWINDOWS_FRAME_PACER_H
+#define FINDMYWINDOWS_FRAME_PACER_H
+
+#include <chrono>
+
+#include "quick_switch.h"
+
+// Paces the switcher's frames in low-latency mode. Rather than blocking in a
+// vsync'd swap, the loop sleeps until input arrives or until the latest moment
+// a frame can start and still make the coming vblank, going by how long recent
+// frames took to render. Takes the time as arguments, no clock of its own.
+class FramePacer
+{
+public:
+    using time_point = std::chrono::steady_clock::time_point;
+
+    // slack left before the vblank for a late wakeup and the compositor
+    static constexpr std::chrono::microseconds margin{1500};
+
+    explicit FramePacer(std::chrono::nanoseconds period);
+
+    // A vblank the display had, from the compositor when it tells. Without one
+    // the first present anchors the phase.
+    void set_vblank(time_point vblank, std::chrono::nanoseconds period);
+
+    // The first vblank strictly after t
+    time_point next_vblank(time_point t) const;
+
+    // When to start rendering so the frame is done just before a vblank, the
+    // next one unless that is already too close
+    time_point next_frame_start(time_point now) const;
+
+    // Follows a slower frame right away and faster ones gradually
+    void frame_rendered(std::chrono::nanoseconds renderTime);
+    // A frame started at frameStart and finished at finished, returns when it
+    // shows: at the next vblank when the pacer knows one, otherwise right away
+    time_point frame_finished(time_point frameStart, time_point finished);
+    std::chrono::nanoseconds render_estimate() const;
+
+private:
+    std::chrono::nanoseconds period;
+    time_point vblank;
+    bool anchored = false;
+    std::chrono::nanoseconds estimate{std::chrono::milliseconds(2)};
+};
+
+// Key press to the frame showing it, in either present mode. Main thread only.
+void record_present_latency(std::chrono::steady_clock::duration latency);
+LatencyStats present_latency_stats();
+
+#endif //FINDMYWINDOWS_FRAME_PACER_H
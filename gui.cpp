@@ -1,18 +1,55 @@
 #include <algorithm>
-#include <format>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
 #include <iostream>
+#include <mutex>
+#include <random>
 #include <ranges>
 #include <string>
+#include <thread>
+#include <vector>
 #include <glad/glad.h>
-#include <glfw/glfw3.h>
+#include <GLFW/glfw3.h>
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
+#include "actions.h"
+#include "app_index.h"
+#include "backend.h"
+#include "browser_tabs.h"
+#include "frame_pacer.h"
+#include "gui.h"
+#include "latency_probe.h"
+#include "log.h"
+#include "mru.h"
+#include "switcher.h"
 #include "tabs.h"
+#include "usage.h"
 #include "icon.h"
-
+#ifndef _WIN32
+// the probe sends its keys through the X server, see InputProbe. Last, Xlib
+// defines macros like None and Status.
+#define GLFW_EXPOSE_NATIVE_X11
+#include <GLFW/glfw3native.h>
+#include <X11/Xlib.h>
+#include <X11/keysym.h>
+#include <X11/extensions/XTest.h>
+#endif
+
+// hidden from the list by the built-in rule in rules.cpp
 const auto windowTitle = "Find My Windows";
 
+static bool lowLatencyPresent = false;
+
+// the switcher's window between openings, hidden, null while released
+static GLFWwindow* residentWindow = nullptr;
+
+void set_low_latency_present(const bool enabled)
+{
+    lowLatencyPresent = enabled;
+}
+
 static void glfw_error_callback(const int error, const char* description)
 {
     fprintf(stderr, "GLFW Error %d: %s\n", error, description);
@@ -31,6 +68,8 @@ bool setup_window(GLFWwindow*& window)
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    // built ahead of the hotkey too, launch_gui() shows it
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
     window = glfwCreateWindow(720, 480, windowTitle, nullptr, nullptr);
     if (window == nullptr)
@@ -38,7 +77,8 @@ bool setup_window(GLFWwindow*& window)
         return true;
     }
     glfwMakeContextCurrent(window);
-    glfwSwapInterval(1); // Enable vsync
+    // paced by hand in low-latency mode, a vsync'd swap would block until the vblank
+    glfwSwapInterval(lowLatencyPresent ? 0 : 1);
 
     GLFWimage icon;
     icon.width = 32; // Match your export size
@@ -59,7 +99,13 @@ bool setup_window(GLFWwindow*& window)
     const ImGuiIO& io = ImGui::GetIO();
     (void)io;
 
-    io.Fonts->AddFontFromFileTTF("C:/Windows/Fonts/verdana.ttf", 20.0f, nullptr, io.Fonts->GetGlyphRangesDefault());
+    // ImGui asserts on a font file that isn't there, elsewhere than Windows it keeps its built-in font
+    const char* verdana = "C:/Windows/Fonts/verdana.ttf";
+    std::error_code error;
+    if (std::filesystem::exists(verdana, error))
+    {
+        io.Fonts->AddFontFromFileTTF(verdana, 20.0f, nullptr, io.Fonts->GetGlyphRangesDefault());
+    }
     // Setup Dear ImGui style
     ImGui::StyleColorsDark();
 
@@ -81,7 +127,50 @@ void cleanup(GLFWwindow* window)
     glfwTerminate();
 }
 
-void render(GLFWwindow* window, const ImVec4 clear_color)
+void gui_warm()
+{
+    if (residentWindow) return;
+
+    GLFWwindow* window = nullptr;
+    if (setup_window(window))
+    {
+        LOG_WARN("Unable to create the switcher window");
+        return;
+    }
+    residentWindow = window;
+}
+
+void gui_release()
+{
+    if (!residentWindow) return;
+
+    cleanup(residentWindow);
+    residentWindow = nullptr;
+}
+
+size_t gui_resident_bytes()
+{
+    if (!residentWindow) return 0;
+
+    // front, back and depth-stencil buffers, and the font atlas twice, ImGui's
+    // RGBA copy and the texture made from it
+    int width = 0;
+    int height = 0;
+    glfwGetFramebufferSize(residentWindow, &width, &height);
+    const ImFontAtlas& fonts = *ImGui::GetIO().Fonts;
+#if IMGUI_VERSION_NUM >= 19200
+    // the atlas moved into a texture object of its own in 1.92
+    const size_t atlasPixels = fonts.TexData
+        ? static_cast<size_t>(fonts.TexData->Width) * static_cast<size_t>(fonts.TexData->Height)
+        : 0;
+#else
+    const size_t atlasPixels = static_cast<size_t>(fonts.TexWidth) * static_cast<size_t>(fonts.TexHeight);
+#endif
+    return static_cast<size_t>(width) * static_cast<size_t>(height) * 4 * 3 + atlasPixels * 4 * 2;
+}
+
+// readback, when given, gets the frame's pixels as they go to the swap
+void render(GLFWwindow* window, const ImVec4 clear_color, std::vector<unsigned char>* readback = nullptr)
 {
     // Rendering
     ImGui::Render();
@@ -97,16 +186,229 @@ void render(GLFWwindow* window, const ImVec4 clear_color)
     glClear(GL_COLOR_BUFFER_BIT);
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
+    if (readback)
+    {
+        readback->resize(static_cast<size_t>(display_w) * display_h * 4);
+        glReadBuffer(GL_BACK);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, display_w, display_h, GL_RGBA, GL_UNSIGNED_BYTE, readback->data());
+    }
     glfwSwapBuffers(window);
 }
 
-std::vector<WindowInfo> launch_gui(std::vector<WindowInfo> desktops)
+// Key presses from another thread at random moments: arrows down and up in turn,
+// then Enter. They go in through the OS, SendInput() on Windows and XTest on X11,
+// and reach the switcher the way a keyboard's do, so the switcher can be timed
+// without one (under Xvfb say). Each is stamped just before it is sent.
+class InputProbe
 {
-    GLFWwindow* window;
-    if (setup_window(window))
+public:
+    InputProbe(GLFWwindow* window, LatencyProbe* latency, const int presses)
+        : latency(latency), remaining(latency && presses > 0 ? presses + 1 : 0)
+    {
+        if (!active()) return;
+
+#ifndef _WIN32
+        target = glfwGetX11Window(window);
+#else
+        (void)window;
+#endif
+        thread = std::thread([this, presses] { run(presses); });
+    }
+
+    ~InputProbe()
+    {
+        stop();
+    }
+
+    void stop()
+    {
+        stopping = true;
+        if (thread.joinable()) thread.join();
+    }
+
+    bool active() const
+    {
+        return remaining > 0;
+    }
+
+    // A key reached the key callback, main thread. The oldest one sent that
+    // matches is timed from when it was sent, keys the probe didn't send are ignored.
+    void arrived(const int key)
+    {
+        std::lock_guard lock(mutex);
+        const auto it = std::ranges::find(sent, key, &SentKey::key);
+        if (it == sent.end()) return;
+
+        latency->received(key == GLFW_KEY_ENTER ? ProbePhase::Close : ProbePhase::Navigate, it->sentAt);
+        sent.erase(it);
+        --remaining;
+    }
+
+    // A key sent a second ago and still not in, the switcher lost the focus and
+    // the rest won't arrive either. Counted as missed.
+    bool lost(const std::chrono::steady_clock::time_point now)
+    {
+        std::lock_guard lock(mutex);
+        if (sent.empty() || now - sent.front().sentAt < std::chrono::seconds(1)) return false;
+
+        for (const SentKey& key : sent)
+        {
+            latency->lost(phase_of(key.key));
+        }
+        sent.clear();
+        remaining = 0;
+        return true;
+    }
+
+private:
+    static ProbePhase phase_of(const int key)
+    {
+        return key == GLFW_KEY_ENTER ? ProbePhase::Close : ProbePhase::Navigate;
+    }
+
+    struct SentKey
+    {
+        int key;
+        std::chrono::steady_clock::time_point sentAt;
+    };
+
+    void run(const int presses)
+    {
+#ifndef _WIN32
+        // a connection of its own, Xlib calls on glfw's would race the main thread
+        Display* display = XOpenDisplay(nullptr);
+        int event;
+        int error;
+        int major;
+        int minor;
+        if (!display || !XTestQueryExtension(display, &event, &error, &major, &minor))
+        {
+            LOG_ERROR("The latency probe needs an X server with the XTEST extension");
+            if (display) XCloseDisplay(display);
+            return;
+        }
+        XSetInputFocus(display, target, RevertToParent, CurrentTime);
+#endif
+        std::mt19937 random(3);
+        std::uniform_int_distribution<int> gap(5, 40);
+        for (int i = 0; i <= presses && !stopping; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(gap(random)));
+            const int key = i == presses ? GLFW_KEY_ENTER : i % 2 == 0 ? GLFW_KEY_DOWN : GLFW_KEY_UP;
+            {
+                std::lock_guard lock(mutex);
+                sent.push_back({key, std::chrono::steady_clock::now()});
+            }
+#ifdef _WIN32
+            const WORD vk = key == GLFW_KEY_ENTER ? VK_RETURN : key == GLFW_KEY_DOWN ? VK_DOWN : VK_UP;
+            INPUT inputs[2] = {};
+            inputs[0].type = INPUT_KEYBOARD;
+            inputs[0].ki.wVk = vk;
+            inputs[1] = inputs[0];
+            inputs[1].ki.dwFlags = KEYEVENTF_KEYUP;
+            SendInput(2, inputs, sizeof(INPUT));
+#else
+            const KeySym symbol = key == GLFW_KEY_ENTER ? XK_Return : key == GLFW_KEY_DOWN ? XK_Down : XK_Up;
+            const KeyCode code = XKeysymToKeycode(display, symbol);
+            XTestFakeKeyEvent(display, code, True, CurrentTime);
+            XTestFakeKeyEvent(display, code, False, CurrentTime);
+            XFlush(display);
+#endif
+        }
+#ifndef _WIN32
+        XCloseDisplay(display);
+#endif
+    }
+
+    LatencyProbe* latency;
+#ifndef _WIN32
+    Window target = 0;
+#endif
+    std::mutex mutex;
+    std::vector<SentKey> sent;
+    std::atomic<bool> stopping{false};
+    std::atomic<int> remaining;
+    std::thread thread;
+};
+
+// Inputs no frame has shown yet, stamped as they arrive
+struct SwitcherInput
+{
+    SwitcherList* rows = nullptr;
+    std::vector<std::chrono::steady_clock::time_point> unpresented;
+    InputProbe* probe = nullptr;
+};
+
+// Runs as glfw delivers the key, ahead of the next frame. In low-latency mode
+// the arrows move the selection right here and the frame code leaves them alone.
+static void switcher_key_callback(GLFWwindow* window, const int key, const int scancode, const int action,
+                                  const int mods)
+{
+    ImGui_ImplGlfw_KeyCallback(window, key, scancode, action, mods);
+    // hidden between openings
+    auto* open = static_cast<SwitcherInput*>(glfwGetWindowUserPointer(window));
+    if (action == GLFW_RELEASE || !open) return;
+
+    SwitcherInput& input = *open;
+    input.unpresented.push_back(std::chrono::steady_clock::now());
+    if (input.probe) input.probe->arrived(key);
+    if (lowLatencyPresent && !(mods & GLFW_MOD_ALT))
+    {
+        if (key == GLFW_KEY_DOWN) input.rows->move_selection(1);
+        if (key == GLFW_KEY_UP) input.rows->move_selection(-1);
+    }
+}
+
+static std::chrono::nanoseconds refresh_period()
+{
+    const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+    const int hz = mode && mode->refreshRate > 0 ? mode->refreshRate : 60;
+    return std::chrono::nanoseconds(1000000000 / hz);
+}
+
+// The compositor's vblank on Windows. Elsewhere the pacer goes by the refresh
+// rate and a frame counts as presented once it is finished.
+static void update_vblank(FramePacer& pacer)
+{
+#ifdef _WIN32
+    DWM_TIMING_INFO timing{};
+    timing.cbSize = sizeof(timing);
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (FAILED(DwmGetCompositionTimingInfo(nullptr, &timing)) || !QueryPerformanceFrequency(&frequency) ||
+        !QueryPerformanceCounter(&counter))
+    {
+        return;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    const auto to_ns = [&](const int64_t ticks)
+    {
+        return std::chrono::nanoseconds(ticks * 1000000 / frequency.QuadPart * 1000);
+    };
+    pacer.set_vblank(now - to_ns(counter.QuadPart - static_cast<int64_t>(timing.qpcVBlank)),
+                     to_ns(static_cast<int64_t>(timing.qpcRefreshPeriod)));
+#else
+    (void)pacer;
+#endif
+}
+
+std::vector<WindowInfo> launch_gui(std::vector<WindowInfo> desktops, const SwitcherOpen& open)
+{
+    // taken before the switcher window steals the focus
+    const HWND switchedFrom = window_backend().foreground();
+    HWND switchTo = nullptr;
+    uint64_t switchToTab = 0;
+    std::string launchCommand;
+
+    gui_warm();
+    GLFWwindow* window = residentWindow;
+    if (!window)
     {
         return {};
     }
+    glfwSetWindowShouldClose(window, GLFW_FALSE);
+    glfwShowWindow(window);
 
     // Enhanced color scheme - Grey primary, Red secondary
     constexpr auto clear_color = ImVec4(0.15f, 0.15f, 0.18f, 1.00f); // Dark grey background
@@ -165,22 +467,67 @@ std::vector<WindowInfo> launch_gui(std::vector<WindowInfo> desktops)
     style.ItemSpacing = ImVec2(8.0f, 6.0f); // Item spacing
     style.ItemInnerSpacing = ImVec2(6.0f, 4.0f); // Inner spacing
 
-    // Remove windows with matching title
-    for (auto const& [index, value] : std::views::enumerate(desktops))
+    // the hotkey picked the row, the predicted next window or where its taps cycled to
+    SwitcherList rows(std::move(desktops), open.selected, mru_stack().order());
+    rows.set_apps(current_apps());
+    unsigned chordPresses = open.presses;
+    bool firstFrame = true;
+
+    InputProbe probe(window, open.probe, open.latencyProbe);
+    SwitcherInput input;
+    input.rows = &rows;
+    input.unpresented.reserve(64);
+    input.probe = probe.active() ? &probe : nullptr;
+    glfwSetWindowUserPointer(window, &input);
+    glfwSetKeyCallback(window, switcher_key_callback);
+    FramePacer pacer(refresh_period());
+    std::vector<unsigned char> readback;
+    if (open.probe)
     {
-        if (value.title == windowTitle)
-        {
-            desktops.erase(desktops.begin() + index);
-        }
+        open.probe->opening(open.openedAt);
     }
-
-    static int selectedIndex = 0;
     static bool focusListBox = true;
     static bool set_initial_focus = true;
+    // kept between openings, sampled only while the switcher shows the columns
+    static bool showUsage = false;
+    // "/" starts typing a query, Escape clears it, see query.h
+    char queryText[256] = "";
+    bool editingQuery = false;
+    bool focusQuery = false;
+    if (showUsage)
+    {
+        usage_sampling_start();
+    }
 
     while (!glfwWindowShouldClose(window))
     {
-        glfwPollEvents();
+        if (lowLatencyPresent)
+        {
+            // asleep until input or the last moment a frame still makes the vblank,
+            // input wakes the loop and its frame starts right away
+            update_vblank(pacer);
+            const auto now = std::chrono::steady_clock::now();
+            const std::chrono::duration<double> untilStart = pacer.next_frame_start(now) - now;
+            // the first frame isn't held back, the switcher should show as soon as it can
+            if (input.unpresented.empty() && !firstFrame)
+            {
+                glfwWaitEventsTimeout(untilStart.count());
+            }
+            else
+            {
+                glfwPollEvents();
+            }
+        }
+        else
+        {
+            glfwPollEvents();
+        }
+        if (open.probe && probe.lost(std::chrono::steady_clock::now()))
+        {
+            LOG_ERROR("Latency probe keys didn't reach the switcher, closing it");
+            glfwSetWindowShouldClose(window, GL_TRUE);
+        }
+        const auto frameStart = std::chrono::steady_clock::now();
 
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -213,7 +560,7 @@ std::vector<WindowInfo> launch_gui(std::vector<WindowInfo> desktops)
 
         // Enhanced instruction panel with better formatting
         ImGui::PushStyleColor(ImGuiCol_ChildBg, ImVec4(0.08f, 0.08f, 0.10f, 0.85f));
-        ImGui::BeginChild("Instructions", ImVec2(0, 80), true, ImGuiWindowFlags_NoScrollbar);
+        ImGui::BeginChild("Instructions", ImVec2(0, 110), true, ImGuiWindowFlags_NoScrollbar);
 
         const auto appname = "Find My Windows";
         ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.85f, 0.30f, 0.30f, 1.00f)); // Red title
@@ -222,7 +569,7 @@ std::vector<WindowInfo> launch_gui(std::vector<WindowInfo> desktops)
         ImGui::PopStyleColor();
 
         ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.75f, 0.75f, 0.77f, 1.00f));
-        const auto instructions = {"TAB to Close", "^/v Navigate", "ALT+^/v Reorder"};
+        const auto instructions = {"TAB to Close", "ENTER Switch", "^/v Navigate", "ALT+^/v Reorder", "CTRL+O Order"};
 
         auto offset = 0;
         for (const auto ins : instructions)
@@ -231,6 +578,17 @@ std::vector<WindowInfo> launch_gui(std::vector<WindowInfo> desktops)
             offset += 150;
             ImGui::SameLine(offset);
         }
+        ImGui::Text("by %s", sort_view_name(rows.view()));
+
+        const auto action_instructions = {"SPACE Mark", "CTRL+T Tile", "CTRL+M Minimize", "CTRL+W Close",
+                                          "CTRL+U Usage", "/ Filter"};
+        offset = 0;
+        for (const auto ins : action_instructions)
+        {
+            ImGui::Text(ins);
+            offset += 150;
+            ImGui::SameLine(offset);
+        }
         ImGui::PopStyleColor();
 
         ImGui::EndChild();
@@ -238,15 +596,42 @@ std::vector<WindowInfo> launch_gui(std::vector<WindowInfo> desktops)
 
         ImGui::Spacing();
 
-        constexpr auto max_shortcuts = 9;
-
-        if (!desktops.empty())
+        if (!editingQuery && ImGui::IsKeyPressed(ImGuiKey_Slash))
+        {
+            editingQuery = true;
+            focusQuery = true;
+        }
+        if (editingQuery)
         {
-            // Clamp selected index to valid range
-            if (selectedIndex < 0) selectedIndex = 0;
-            if (selectedIndex >= static_cast<int>(desktops.size()))
-                selectedIndex = static_cast<int>(desktops.size()) - 1;
+            if (ImGui::IsKeyPressed(ImGuiKey_Escape))
+            {
+                editingQuery = false;
+                queryText[0] = '\0';
+                rows.set_query("");
+            }
+            else
+            {
+                if (focusQuery)
+                {
+                    ImGui::SetKeyboardFocusHere();
+                    focusQuery = false;
+                }
+                ImGui::SetNextItemWidth(-1);
+                // compiled once per edit, the rows only run it
+                if (ImGui::InputTextWithHint("##query", "proc:code title:\"*.cpp\" -class:ConsoleWindowClass",
+                                             queryText, sizeof(queryText)))
+                {
+                    rows.set_query(queryText);
+                }
+                if (rows.query().error()[0] != '\0')
+                {
+                    ImGui::TextColored(ImVec4(0.85f, 0.30f, 0.30f, 1.00f), "%s", rows.query().error());
+                }
+            }
+        }
 
+        if (!rows.empty())
+        {
             const ImGuiIO& io = ImGui::GetIO();
 
             if (ImGui::IsKeyPressed(ImGuiKey_Tab))
@@ -254,30 +639,114 @@ std::vector<WindowInfo> launch_gui(std::vector<WindowInfo> desktops)
                 glfwSetWindowShouldClose(window, GL_TRUE);
             }
 
+            // activated or launched once the switcher is gone, it would take the focus back otherwise
+            const auto choose = [&]
+            {
+                if (rows.is_app(rows.selected()))
+                {
+                    launchCommand = rows.apps()->command(rows.app_entry(rows.selected()));
+                }
+                else
+                {
+                    switchTo = rows.window(rows.selected()).hwnd;
+                    switchToTab = rows.window(rows.selected()).tabNode;
+                }
+                glfwSetWindowShouldClose(window, GL_TRUE);
+            };
+            if (ImGui::IsKeyPressed(ImGuiKey_Enter))
+            {
+                choose();
+            }
+
+            // held open from the hotkey: its presses cycle and letting go switches, like Alt+Tab
+            if (open.poll_chord)
+            {
+                const ChordState chord = open.poll_chord();
+                if (chord.presses > chordPresses)
+                {
+                    rows.move_selection(static_cast<int>(chord.presses - chordPresses));
+                    chordPresses = chord.presses;
+                }
+                if (!chord.held)
+                {
+                    choose();
+                }
+            }
+
             // Reordering with Alt + up/down
-            if (io.KeyAlt && ImGui::IsKeyPressed(ImGuiKey_UpArrow) && selectedIndex > 0)
+            if (io.KeyAlt && ImGui::IsKeyPressed(ImGuiKey_UpArrow))
+            {
+                rows.move_selected(-1);
+            }
+
+            if (io.KeyAlt && ImGui::IsKeyPressed(ImGuiKey_DownArrow))
+            {
+                rows.move_selected(1);
+            }
+
+            // Navigation with up/down arrows, already done by the key callback in low-latency mode
+            if (!lowLatencyPresent && !io.KeyAlt && ImGui::IsKeyPressed(ImGuiKey_DownArrow))
+            {
+                rows.move_selection(1);
+            }
+
+            if (!lowLatencyPresent && !io.KeyAlt && ImGui::IsKeyPressed(ImGuiKey_UpArrow))
+            {
+                rows.move_selection(-1);
+            }
+
+            // saved, process, title, recent and desktop order in turn, each one kept sorted
+            if (io.KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_O))
             {
-                std::swap(desktops[selectedIndex], desktops[selectedIndex - 1]);
-                selectedIndex--;
+                rows.set_view(static_cast<SortView>((static_cast<size_t>(rows.view()) + 1) % sort_view_count));
             }
 
-            if (io.KeyAlt && ImGui::IsKeyPressed(ImGuiKey_DownArrow) && selectedIndex < static_cast<int>(desktops.
-                size()) - 1)
+            if (io.KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_U))
             {
-                std::swap(desktops[selectedIndex], desktops[selectedIndex + 1]);
-                selectedIndex++;
+                showUsage = !showUsage;
+                if (showUsage)
+                {
+                    usage_sampling_start();
+                }
+                else
+                {
+                    usage_sampling_stop();
+                }
             }
+        }
 
-            // Navigation with up/down arrows
-            if (!io.KeyAlt && ImGui::IsKeyPressed(ImGuiKey_DownArrow))
+        // Actions on the marked windows, or the selected one when none are marked
+        if (!rows.empty())
+        {
+            const ImGuiIO& io = ImGui::GetIO();
+            // typed into the query while editing it
+            if (!editingQuery && ImGui::IsKeyPressed(ImGuiKey_Space))
             {
-                selectedIndex = (selectedIndex + 1) % static_cast<int>(desktops.size());
+                rows.toggle_mark();
             }
 
-            if (!io.KeyAlt && ImGui::IsKeyPressed(ImGuiKey_UpArrow))
+            // queued for the action worker, a slow app doesn't hold up the switcher
+            const auto submit = [&](const WindowActionType type)
+            {
+                WindowAction action{type, rows.take_targets()};
+                if (type == WindowActionType::Close)
+                {
+                    rows.remove(action.windows);
+                }
+                submit_action(std::move(action));
+            };
+
+            if (io.KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_T))
+            {
+                submit(WindowActionType::Tile);
+            }
+            if (io.KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_M))
+            {
+                submit(WindowActionType::Minimize);
+            }
+            if (io.KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_W))
             {
-                selectedIndex = (selectedIndex - 1 + static_cast<int>(desktops.size())) % static_cast<int>(desktops.
-                    size());
+                submit(WindowActionType::Close);
             }
         }
 
@@ -287,43 +756,33 @@ std::vector<WindowInfo> launch_gui(std::vector<WindowInfo> desktops)
             focusListBox = false;
         }
 
-        // Enhanced list box with custom styling
+        // Enhanced list box with custom styling, the labels come pre-formatted
         ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(8.0f, 8.0f));
         if (ImGui::BeginListBox("##desktops", ImVec2(-1, -1)))
         {
-            for (int i = 0; i < static_cast<int>(desktops.size()); i++)
-            {
-                const bool isSelected = selectedIndex == i;
-
-                std::string label;
-                std::string shortcut;
-                if (i < max_shortcuts)
-                {
-                    shortcut = std::format("CTRL {}", i + 1);
-                    label = desktops[i].title;
-                }
-                else
-                {
-                    label = desktops[i].title;
-                }
+            // one snapshot per frame, right-aligned over the rows
+            const std::shared_ptr<const UsageSnapshot> usage = showUsage ? current_usage() : nullptr;
+            const float usageX = ImGui::GetContentRegionAvail().x - ImGui::CalcTextSize("100.0%  99999 MB").x;
 
-                std::string fullLabel = shortcut.empty() ? label : std::format("[{}] {}", shortcut, label);
+            for (int i = 0; i < static_cast<int>(rows.size()); i++)
+            {
+                const bool isSelected = rows.selected() == i;
                 if (isSelected)
                 {
                     if (ImGui::Selectable("##hidden", isSelected))
                     {
-                        selectedIndex = i;
+                        rows.select(i);
                     }
 
                     ImGui::SameLine(ImGui::GetStyle().ItemInnerSpacing.x);
-                    ImGui::Text("%s", fullLabel.c_str());
+                    ImGui::TextUnformatted(rows.label(i));
                 }
                 else
                 {
                     // Regular selectable for non-selected items
-                    if (ImGui::Selectable(fullLabel.c_str(), isSelected))
+                    if (ImGui::Selectable(rows.label(i), isSelected))
                     {
-                        selectedIndex = i;
+                        rows.select(i);
                     }
                 }
 
@@ -332,6 +791,25 @@ std::vector<WindowInfo> launch_gui(std::vector<WindowInfo> desktops)
                 {
                     ImGui::SetScrollHereY(0.5f);
                 }
+
+                if (usage)
+                {
+                    if (const ProcessUsage* process = usage->find(rows.window(i).processId))
+                    {
+                        char text[32];
+                        const double megabytes = static_cast<double>(process->workingSetBytes) / (1024.0 * 1024.0);
+                        if (process->cpuPercent < 0)
+                        {
+                            snprintf(text, sizeof(text), "   --  %6.0f MB", megabytes);
+                        }
+                        else
+                        {
+                            snprintf(text, sizeof(text), "%5.1f%%  %6.0f MB", process->cpuPercent, megabytes);
+                        }
+                        ImGui::SameLine(usageX);
+                        ImGui::TextUnformatted(text);
+                    }
+                }
             }
 
             ImGui::EndListBox();
@@ -340,9 +818,59 @@ std::vector<WindowInfo> launch_gui(std::vector<WindowInfo> desktops)
 
         ImGui::End();
 
-        render(window, clear_color);
+        render(window, clear_color, open.probe ? &readback : nullptr);
+        std::chrono::steady_clock::time_point presentedAt;
+        if (lowLatencyPresent)
+        {
+            // the swap returned at once, the frame shows at the compositor's next vblank
+            glFinish();
+            presentedAt = pacer.frame_finished(frameStart, std::chrono::steady_clock::now());
+        }
+        else
+        {
+            // the vsync'd swap blocked until the vblank
+            presentedAt = std::chrono::steady_clock::now();
+        }
+
+        for (const auto inputAt : input.unpresented)
+        {
+            record_present_latency(presentedAt - inputAt);
+        }
+        input.unpresented.clear();
+        if (open.probe)
+        {
+            open.probe->frame(presentedAt, frame_content(readback));
+            // Enter closes a switcher with rows
+            if (!probe.active() && rows.empty()) glfwSetWindowShouldClose(window, GL_TRUE);
+        }
+
+        if (firstFrame)
+        {
+            record_switcher_latency(std::chrono::steady_clock::now() - open.openedAt);
+            firstFrame = false;
+        }
     }
+    probe.stop();
 
-    cleanup(window);
-    return desktops;
+    usage_sampling_stop();
+    // kept for the next opening until the residency policy finds it cold
+    glfwSetWindowUserPointer(window, nullptr);
+    glfwHideWindow(window);
+    if (switchTo)
+    {
+        BringWindowToFront(switchTo, switchedFrom);
+        if (switchToTab)
+        {
+            activate_tab(switchTo, switchToTab);
+        }
+    }
+    else if (!launchCommand.empty() && !window_backend().launch(launchCommand))
+    {
+        LOG_WARN("Unable to launch {}", launchCommand);
+    }
+    if (open.probe)
+    {
+        open.probe->closed(std::chrono::steady_clock::now());
+    }
+    return rows.release();
 }
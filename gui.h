@@ -1,8 +1,43 @@
 #ifndef FINDMYTABS_GUI_H
 #define FINDMYTABS_GUI_H
 
+#include <chrono>
+#include <cstddef>
+
+#include "quick_switch.h"
 #include "tabs.h"
 
-#endif //FINDMYTABS_GUI_H
+class LatencyProbe;
+
+// How the switcher hotkey opened the switcher
+struct SwitcherOpen
+{
+    int selected = 0;
+    // when it was decided to open, the first frame records the open latency from there
+    std::chrono::steady_clock::time_point openedAt = std::chrono::steady_clock::now();
+    // while the chord is held its presses move the selection and letting go
+    // switches, null for a switcher that stays open
+    QuickSwitch::Poll poll_chord = nullptr;
+    // presses the selection already moved for
+    unsigned presses = 1;
+    // sends this many synthetic arrow presses through the key callback, then Enter,
+    // and times each into probe from the frames read back, see latency_probe.h
+    int latencyProbe = 0;
+    LatencyProbe* probe = nullptr;
+};
+
+// Opt-in: no vsync'd swap, arrows handled as the key arrives and frames started
+// just before the vblank. Input to present latency is recorded in both modes.
+void set_low_latency_present(bool enabled);
 
-std::vector<WindowInfo> launch_gui(std::vector<WindowInfo> desktops);
\ No newline at end of file
+// The switcher's window, GL context and font atlas stay built, hidden, between
+// openings. gui_warm() builds them ahead of the hotkey, gui_release() gives them
+// back, both on the thread that calls launch_gui().
+void gui_warm();
+void gui_release();
+// Estimated from the framebuffer and font atlas sizes, 0 while released
+size_t gui_resident_bytes();
+
+std::vector<WindowInfo> launch_gui(std::vector<WindowInfo> desktops, const SwitcherOpen& open);
+
+#endif //FINDMYTABS_GUI_H
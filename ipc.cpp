@@ -0,0 +1,656 @@
+#ifdef _WIN32
+// winsock2 has to come before windows.h
+#include <winsock2.h>
+#include <afunix.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "ipc.h"
+#include "log.h"
+#include "query.h"
+#include "residency.h"
+#include "snapshot.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+using socket_t = SOCKET;
+static constexpr socket_t invalid_socket = INVALID_SOCKET;
+static constexpr int send_flags = 0;
+
+static void close_socket(const socket_t s)
+{
+    closesocket(s);
+}
+
+static bool set_nonblocking(const socket_t s)
+{
+    u_long mode = 1;
+    return ioctlsocket(s, FIONBIO, &mode) == 0;
+}
+
+static bool would_block()
+{
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+}
+
+static int poll_sockets(pollfd* fds, const size_t count, const int timeout)
+{
+    return WSAPoll(fds, static_cast<ULONG>(count), timeout);
+}
+
+static bool network_init()
+{
+    static const bool ready = []
+    {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    return ready;
+}
+#else
+using socket_t = int;
+static constexpr socket_t invalid_socket = -1;
+static constexpr int send_flags = MSG_NOSIGNAL;
+
+static void close_socket(const socket_t s)
+{
+    close(s);
+}
+
+static bool set_nonblocking(const socket_t s)
+{
+    const int flags = fcntl(s, F_GETFL, 0);
+    return flags >= 0 && fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static bool would_block()
+{
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+static int poll_sockets(pollfd* fds, const size_t count, const int timeout)
+{
+    return poll(fds, count, timeout);
+}
+
+static bool network_init()
+{
+    return true;
+}
+#endif
+
+static constexpr size_t max_request_line = 4096;
+
+std::string ipc_default_path()
+{
+    if (const char* overridden = std::getenv("FMW_IPC_PATH"))
+    {
+        return overridden;
+    }
+
+#ifdef _WIN32
+    char temp[MAX_PATH];
+    const DWORD length = GetTempPathA(sizeof(temp), temp);
+    return std::string(temp, length) + "findmywindows.sock";
+#else
+    const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+    const std::string dir = runtime && *runtime ? runtime : "/tmp";
+    return dir + "/findmywindows-" + std::to_string(getuid()) + ".sock";
+#endif
+}
+
+static bool make_address(const std::string& path, sockaddr_un& address)
+{
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        LOG_ERROR("IPC socket path too long: {}", path);
+        return false;
+    }
+
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+static socket_t connect_to(const std::string& path)
+{
+    sockaddr_un address;
+    if (!network_init() || !make_address(path, address)) return invalid_socket;
+
+    const socket_t s = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s == invalid_socket) return invalid_socket;
+
+    if (connect(s, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        close_socket(s);
+        return invalid_socket;
+    }
+    return s;
+}
+
+static void json_escape(std::string& out, const std::string_view text)
+{
+    out.push_back('"');
+    for (const char c : text)
+    {
+        switch (c)
+        {
+        case '"': out += "\\\"";
+            break;
+        case '\\': out += "\\\\";
+            break;
+        case '\n': out += "\\n";
+            break;
+        case '\r': out += "\\r";
+            break;
+        case '\t': out += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            }
+            else
+            {
+                out.push_back(c);
+            }
+        }
+    }
+    out.push_back('"');
+}
+
+static void append_number(std::string& out, const uint64_t value)
+{
+    char digits[24];
+    const int n = snprintf(digits, sizeof(digits), "%llu", static_cast<unsigned long long>(value));
+    out.append(digits, n);
+}
+
+static bool has_fields(const WindowSnapshot& snapshot, const WindowFields fields)
+{
+    return std::ranges::all_of(snapshot.windows, [&](const WindowInfo& window)
+    {
+        return (window.resolved & fields) == fields;
+    });
+}
+
+// Fields the list was published without are null
+static std::string encode_snapshot(const WindowSnapshot& snapshot)
+{
+    const std::vector<WindowInfo>& windows = snapshot.windows;
+    std::string out;
+    out.reserve(64 + windows.size() * 160);
+
+    out += "{\"version\":";
+    append_number(out, snapshot.version);
+    out += ",\"windows\":[";
+    for (size_t i = 0; i < windows.size(); ++i)
+    {
+        const WindowInfo& window = windows[i];
+        if (i > 0) out.push_back(',');
+
+        out += "{\"slot\":";
+        append_number(out, i + 1);
+        out += ",\"hwnd\":";
+        append_number(out, reinterpret_cast<uintptr_t>(window.hwnd));
+        const bool process = window.resolved & FIELD_PROCESS;
+        out += ",\"pid\":";
+        if (process) append_number(out, window.processId);
+        else out += "null";
+        out += ",\"process\":";
+        if (process) json_escape(out, window.processName);
+        else out += "null";
+        out += ",\"class\":";
+        if (window.resolved & FIELD_CLASS) json_escape(out, window.className);
+        else out += "null";
+        out += ",\"title\":";
+        if (window.resolved & FIELD_TITLE) json_escape(out, window.title);
+        else out += "null";
+        out += ",\"current\":";
+        out += window.isOnCurrentDesktop ? "true" : "false";
+        out.push_back('}');
+    }
+    out += "]}\n";
+    return out;
+}
+
+struct IpcClient
+{
+    socket_t fd;
+    std::string in{};
+    std::string out{};
+    bool subscribed = false;
+    uint64_t sentVersion = 0;
+    // a request waiting for fields the owner thread was asked to resolve
+    std::string deferred{};
+    bool closed = false;
+};
+
+static socket_t listen_socket = invalid_socket;
+static socket_t wake_send = invalid_socket;
+static socket_t wake_recv = invalid_socket;
+static std::thread server_thread;
+static std::atomic<bool> server_running{false};
+static IpcActivate activate_window = nullptr;
+static IpcResolve resolve_fields = nullptr;
+// asked for once, the owner keeps resolving them on every list it publishes
+static WindowFields requested_fields = 0;
+static std::string server_path;
+
+// Encoding is done once per snapshot version and shared by every client
+static uint64_t encoded_version = UINT64_MAX;
+static std::string encoded_snapshot;
+
+static const std::string& snapshot_json(const WindowSnapshot& snapshot)
+{
+    if (encoded_version != snapshot.version)
+    {
+        encoded_snapshot = encode_snapshot(snapshot);
+        encoded_version = snapshot.version;
+    }
+    return encoded_snapshot;
+}
+
+static void reply_focus(IpcClient& client, const WindowSnapshot& snapshot, const size_t index)
+{
+    if (index >= snapshot.windows.size())
+    {
+        client.out += "{\"ok\":false,\"error\":\"no such window\"}\n";
+        return;
+    }
+
+    const WindowInfo& window = snapshot.windows[index];
+    const bool ok = activate_window && activate_window(window.hwnd);
+    client.out += ok ? "{\"ok\":true,\"slot\":" : "{\"ok\":false,\"error\":\"activation failed\",\"slot\":";
+    append_number(client.out, index + 1);
+    client.out += ",\"title\":";
+    json_escape(client.out, window.title);
+    client.out += "}\n";
+}
+
+// {"total":N,"subsystems":[{"name":"gui","bytes":N,"resident":true,"releases":N,"warms":N},...]}
+static void reply_footprint(IpcClient& client)
+{
+    const auto footprint = current_footprint();
+    size_t total = 0;
+    for (const ResidentFootprint& subsystem : *footprint)
+    {
+        total += subsystem.bytes;
+    }
+
+    client.out += "{\"total\":";
+    append_number(client.out, total);
+    client.out += ",\"subsystems\":[";
+    for (const ResidentFootprint& subsystem : *footprint)
+    {
+        if (&subsystem != &footprint->front()) client.out += ',';
+        client.out += "{\"name\":";
+        json_escape(client.out, subsystem.name);
+        client.out += ",\"bytes\":";
+        append_number(client.out, subsystem.bytes);
+        client.out += subsystem.resident ? ",\"resident\":true,\"releases\":" : ",\"resident\":false,\"releases\":";
+        append_number(client.out, subsystem.releases);
+        client.out += ",\"warms\":";
+        append_number(client.out, subsystem.warms);
+        client.out += '}';
+    }
+    client.out += "]}\n";
+}
+
+// Whether the snapshot has the fields a request needs. If not the owner thread
+// is asked for them and the request waits for the list it publishes with them.
+static bool ready_for(IpcClient& client, const WindowSnapshot& snapshot, const std::string_view line,
+                      const WindowFields fields)
+{
+    if (!resolve_fields || has_fields(snapshot, fields)) return true;
+
+    if ((requested_fields & fields) != fields)
+    {
+        requested_fields |= fields;
+        resolve_fields(requested_fields);
+    }
+    client.deferred = line;
+    return false;
+}
+
+static void handle_request(IpcClient& client, std::string_view line)
+{
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+    const auto snapshot = current_snapshot();
+
+    if (line == "list")
+    {
+        if (!ready_for(client, *snapshot, line, ALL_WINDOW_FIELDS)) return;
+        client.out += snapshot_json(*snapshot);
+    }
+    else if (line == "subscribe")
+    {
+        if (!ready_for(client, *snapshot, line, ALL_WINDOW_FIELDS)) return;
+        client.subscribed = true;
+        client.sentVersion = snapshot->version;
+        client.out += snapshot_json(*snapshot);
+    }
+    else if (line == "footprint")
+    {
+        reply_footprint(client);
+    }
+    else if (line.starts_with("focus "))
+    {
+        const long slot = std::strtol(std::string(line.substr(6)).c_str(), nullptr, 10);
+        reply_focus(client, *snapshot, slot > 0 ? static_cast<size_t>(slot - 1) : SIZE_MAX);
+    }
+    else if (line.starts_with("find "))
+    {
+        WindowQuery query;
+        if (!query.compile(line.substr(5)))
+        {
+            client.out += "{\"ok\":false,\"error\":";
+            json_escape(client.out, query.error());
+            client.out += "}\n";
+            return;
+        }
+        if (!ready_for(client, *snapshot, line, query.fields())) return;
+        // without a resolver a window missing a field the query looks at doesn't match
+        const auto it = std::ranges::find_if(snapshot->windows, [&](const WindowInfo& window)
+        {
+            return (window.resolved & query.fields()) == query.fields() && query.matches(window);
+        });
+        reply_focus(client, *snapshot, it - snapshot->windows.begin());
+    }
+    else
+    {
+        client.out += "{\"ok\":false,\"error\":\"unknown request\"}\n";
+    }
+}
+
+static void flush_client(IpcClient& client)
+{
+    while (!client.out.empty())
+    {
+        const auto sent = send(client.fd, client.out.data(), static_cast<int>(client.out.size()), send_flags);
+        if (sent > 0)
+        {
+            client.out.erase(0, sent);
+            continue;
+        }
+        if (sent < 0 && would_block()) return;
+
+        client.closed = true;
+        return;
+    }
+}
+
+// Requests are answered in order, the ones after a deferred request wait behind it
+static void handle_lines(IpcClient& client)
+{
+    size_t newline;
+    while (client.deferred.empty() && (newline = client.in.find('\n')) != std::string::npos)
+    {
+        handle_request(client, std::string_view(client.in).substr(0, newline));
+        client.in.erase(0, newline + 1);
+    }
+}
+
+static void read_client(IpcClient& client)
+{
+    char buffer[1024];
+    for (;;)
+    {
+        const auto received = recv(client.fd, buffer, sizeof(buffer), 0);
+        if (received > 0)
+        {
+            client.in.append(buffer, received);
+            continue;
+        }
+        if (received < 0 && would_block()) break;
+
+        client.closed = true;
+        break;
+    }
+
+    handle_lines(client);
+    if (client.in.size() > max_request_line)
+    {
+        client.closed = true;
+    }
+}
+
+// A new list: deferred requests try again, subscribers get it
+static void push_to_subscribers(std::vector<IpcClient>& clients)
+{
+    const auto snapshot = current_snapshot();
+    for (auto& client : clients)
+    {
+        if (!client.deferred.empty())
+        {
+            const std::string line = std::move(client.deferred);
+            client.deferred.clear();
+            handle_request(client, line);
+            handle_lines(client);
+            flush_client(client);
+            continue;
+        }
+        if (client.subscribed && client.sentVersion != snapshot->version)
+        {
+            client.out += snapshot_json(*snapshot);
+            client.sentVersion = snapshot->version;
+            flush_client(client);
+        }
+    }
+}
+
+static void server_main()
+{
+    std::vector<IpcClient> clients;
+    std::vector<pollfd> fds;
+
+    while (server_running.load(std::memory_order_acquire))
+    {
+        fds.clear();
+        fds.push_back({listen_socket, POLLIN, 0});
+        fds.push_back({wake_recv, POLLIN, 0});
+        for (const auto& client : clients)
+        {
+            fds.push_back({client.fd, static_cast<short>(POLLIN | (client.out.empty() ? 0 : POLLOUT)), 0});
+        }
+
+        if (poll_sockets(fds.data(), fds.size(), -1) < 0)
+        {
+            continue;
+        }
+
+        if (fds[1].revents & POLLIN)
+        {
+            char drained[64];
+            while (recv(wake_recv, drained, sizeof(drained), 0) > 0)
+            {
+            }
+            push_to_subscribers(clients);
+        }
+
+        for (size_t i = 0; i < clients.size(); ++i)
+        {
+            const short events = fds[i + 2].revents;
+            if (events & (POLLIN | POLLHUP | POLLERR))
+            {
+                read_client(clients[i]);
+            }
+            if (!clients[i].closed)
+            {
+                flush_client(clients[i]);
+            }
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            socket_t accepted;
+            while ((accepted = accept(listen_socket, nullptr, nullptr)) != invalid_socket)
+            {
+                set_nonblocking(accepted);
+                clients.push_back({accepted});
+            }
+        }
+
+        std::erase_if(clients, [](const IpcClient& client)
+        {
+            if (client.closed) close_socket(client.fd);
+            return client.closed;
+        });
+    }
+
+    for (const auto& client : clients)
+    {
+        close_socket(client.fd);
+    }
+}
+
+static void wake_server()
+{
+    const char byte = 1;
+    send(wake_send, &byte, 1, send_flags);
+}
+
+bool ipc_server_start(const std::string& path, const IpcActivate activate, const IpcResolve resolve)
+{
+    if (server_running.load()) return true;
+
+    if (const socket_t existing = connect_to(path); existing != invalid_socket)
+    {
+        close_socket(existing);
+        LOG_WARN("Another instance is already serving {}", path);
+        return false;
+    }
+
+    sockaddr_un address;
+    if (!network_init() || !make_address(path, address)) return false;
+
+    // a previous run that crashed leaves the socket file behind
+    std::error_code ignored;
+    std::filesystem::remove(path, ignored);
+
+    listen_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_socket == invalid_socket ||
+        bind(listen_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listen_socket, 16) != 0)
+    {
+        LOG_ERROR("Unable to listen on {}", path);
+        if (listen_socket != invalid_socket) close_socket(listen_socket);
+        listen_socket = invalid_socket;
+        return false;
+    }
+
+    // Loopback connection used to wake poll() when a snapshot is published,
+    // unix sockets work the same on both platforms where pipes don't
+    wake_send = connect_to(path);
+    wake_recv = wake_send != invalid_socket ? accept(listen_socket, nullptr, nullptr) : invalid_socket;
+    if (wake_recv == invalid_socket)
+    {
+        LOG_ERROR("Unable to create IPC wake channel");
+        if (wake_send != invalid_socket) close_socket(wake_send);
+        close_socket(listen_socket);
+        listen_socket = wake_send = invalid_socket;
+        return false;
+    }
+
+    set_nonblocking(listen_socket);
+    set_nonblocking(wake_send);
+    set_nonblocking(wake_recv);
+
+    static bool listening_for_snapshots = false;
+    if (!listening_for_snapshots)
+    {
+        add_snapshot_listener([]
+        {
+            if (server_running.load(std::memory_order_acquire)) wake_server();
+        });
+        listening_for_snapshots = true;
+    }
+
+    activate_window = activate;
+    resolve_fields = resolve;
+    requested_fields = 0;
+    server_path = path;
+    server_running.store(true, std::memory_order_release);
+    server_thread = std::thread(server_main);
+
+    LOG_INFO("Serving window list on {}", path);
+    return true;
+}
+
+void ipc_server_stop()
+{
+    if (!server_running.exchange(false)) return;
+
+    wake_server();
+    server_thread.join();
+
+    close_socket(wake_send);
+    close_socket(wake_recv);
+    close_socket(listen_socket);
+    listen_socket = wake_send = wake_recv = invalid_socket;
+
+    std::error_code ignored;
+    std::filesystem::remove(server_path, ignored);
+}
+
+int ipc_client_run(const std::string& path, const std::string& request, const bool stream)
+{
+    const socket_t s = connect_to(path);
+    if (s == invalid_socket)
+    {
+        fprintf(stderr, "findmywindows is not running (no server at %s)\n", path.c_str());
+        return 2;
+    }
+
+    const std::string line = request + "\n";
+    if (send(s, line.data(), static_cast<int>(line.size()), send_flags) != static_cast<int>(line.size()))
+    {
+        close_socket(s);
+        return 2;
+    }
+
+    int exit_code = 2;
+    std::string pending;
+    char buffer[16 * 1024];
+    for (;;)
+    {
+        const auto received = recv(s, buffer, sizeof(buffer), 0);
+        if (received <= 0) break;
+        pending.append(buffer, received);
+
+        size_t newline;
+        while ((newline = pending.find('\n')) != std::string::npos)
+        {
+            fwrite(pending.data(), 1, newline + 1, stdout);
+            exit_code = std::string_view(pending).substr(0, newline).find("\"ok\":false") == std::string_view::npos
+                            ? 0
+                            : 1;
+            pending.erase(0, newline + 1);
+        }
+        fflush(stdout);
+
+        if (!stream && exit_code != 2) break;
+    }
+
+    close_socket(s);
+    return exit_code;
+}
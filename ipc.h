@@ -0,0 +1,46 @@
+#ifndef FINDMYWINDOWS_IPC_H
+#define FINDMYWINDOWS_IPC_H
+
+#include <string>
+
+#include "platform.h"
+#include "tabs.h"
+
+// Local query protocol over a unix domain socket (AF_UNIX on Windows 10 1803+ too).
+// Requests are single text lines, every response is a single JSON line:
+//
+//   list          {"version":N,"windows":[{"slot":1,"hwnd":..,"pid":..,"process":"..",...}]}
+//   subscribe     the list response now, then again every time the list changes
+//   focus <slot>  activates the window in that slot, 1-based like the Ctrl+N hotkeys
+//   find <query>  activates the first window matching the query, see query.h. A plain
+//                 word matches windows whose title or process contains it.
+//   footprint     {"total":N,"subsystems":[{"name":"gui","bytes":N,"resident":true,...}]},
+//                 what the daemon keeps in memory as of its last residency tick
+//
+// Everything is answered from current_snapshot(), a client never causes an enumeration
+// or a backend call on the server thread. Fields a lazy list was published without are
+// null, or with a resolver the request waits for the list published with them.
+
+std::string ipc_default_path();
+
+// Called on the server thread. Implementations hand the window to the thread
+// that owns the backend rather than activating it directly.
+using IpcActivate = bool (*)(HWND hwnd);
+
+// Called on the server thread when a request needs fields the published list lacks.
+// Implementations hand them to the owner thread, which resolves them from then on and
+// publishes the list again.
+using IpcResolve = void (*)(WindowFields fields);
+
+// Returns false if the socket can't be created or another instance already serves path.
+// Without resolve, requests are answered with what the list has.
+bool ipc_server_start(const std::string& path, IpcActivate activate, IpcResolve resolve = nullptr);
+
+void ipc_server_stop();
+
+// CLI side: sends one request and copies the response line(s) to stdout.
+// With stream set it keeps printing until the server goes away (for subscribe).
+// Returns the process exit code.
+int ipc_client_run(const std::string& path, const std::string& request, bool stream);
+
+#endif //FINDMYWINDOWS_IPC_H
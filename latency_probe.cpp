@@ -0,0 +1,167 @@
+#include "latency_probe.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+
+const char* probe_phase_name(const ProbePhase phase)
+{
+    switch (phase)
+    {
+    case ProbePhase::Open: return "open";
+    case ProbePhase::Navigate: return "navigate";
+    case ProbePhase::Close: return "close";
+    }
+    return "?";
+}
+
+FrameContent frame_content(const std::span<const uint8_t> pixels)
+{
+    FrameContent content;
+    if (pixels.size() < 4) return content;
+
+    // two pixels per word, the first one twice to compare against
+    uint32_t first;
+    memcpy(&first, pixels.data(), 4);
+    const uint64_t pattern = static_cast<uint64_t>(first) << 32 | first;
+
+    uint64_t hash = 0x9E3779B97F4A7C15ull;
+    uint64_t differs = 0;
+    size_t i = 0;
+    for (; i + 8 <= pixels.size(); i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, pixels.data() + i, 8);
+        differs |= word ^ pattern;
+        hash = (hash ^ word) * 0x100000001B3ull;
+        hash ^= hash >> 29;
+    }
+    for (; i < pixels.size(); ++i)
+    {
+        differs |= pixels[i] ^ pixels[i % 4];
+        hash = (hash ^ pixels[i]) * 0x100000001B3ull;
+    }
+    content.hash = hash;
+    content.uniform = differs == 0;
+    return content;
+}
+
+LatencyProbe::Phase& LatencyProbe::phase(const ProbePhase which)
+{
+    return phases[static_cast<size_t>(which)];
+}
+
+const LatencyProbe::Phase& LatencyProbe::phase(const ProbePhase which) const
+{
+    return phases[static_cast<size_t>(which)];
+}
+
+void LatencyProbe::resolve(Phase& phase, const time_point at)
+{
+    for (const time_point sentAt : phase.pending)
+    {
+        phase.latencies.push_back(at - sentAt);
+    }
+    phase.pending.clear();
+}
+
+void LatencyProbe::opening(const time_point at)
+{
+    phase(ProbePhase::Open).pending.push_back(at);
+    // the window shows what it drew last time until its first frame replaces it
+    hasFrame = false;
+}
+
+void LatencyProbe::received(const ProbePhase which, const time_point sentAt)
+{
+    phase(which).pending.push_back(sentAt);
+}
+
+void LatencyProbe::lost(const ProbePhase which)
+{
+    ++phase(which).missed;
+}
+
+void LatencyProbe::frame(const time_point presentedAt, const FrameContent& content)
+{
+    if (!content.uniform) resolve(phase(ProbePhase::Open), presentedAt);
+    // a press whose frame looks the same waits for the next change
+    if (hasFrame && content.hash != lastHash) resolve(phase(ProbePhase::Navigate), presentedAt);
+    hasFrame = true;
+    lastHash = content.hash;
+}
+
+void LatencyProbe::closed(const time_point at)
+{
+    resolve(phase(ProbePhase::Close), at);
+    for (const ProbePhase shown : {ProbePhase::Open, ProbePhase::Navigate})
+    {
+        phase(shown).missed += phase(shown).pending.size();
+        phase(shown).pending.clear();
+    }
+}
+
+ProbePercentiles LatencyProbe::percentiles(const ProbePhase which) const
+{
+    std::vector<std::chrono::steady_clock::duration> sorted = phase(which).latencies;
+    ProbePercentiles out;
+    out.count = sorted.size();
+    if (sorted.empty()) return out;
+
+    std::ranges::sort(sorted);
+    const auto at = [&](const double p)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            sorted[static_cast<size_t>(p * static_cast<double>(sorted.size() - 1))]);
+    };
+    out.p50 = at(0.5);
+    out.p90 = at(0.9);
+    out.p99 = at(0.99);
+    out.max = at(1.0);
+    return out;
+}
+
+size_t LatencyProbe::missed(const ProbePhase which) const
+{
+    return phase(which).missed;
+}
+
+std::string LatencyProbe::report() const
+{
+    std::string out;
+    for (size_t i = 0; i < probe_phase_count; ++i)
+    {
+        const auto which = static_cast<ProbePhase>(i);
+        const ProbePercentiles p = percentiles(which);
+        char line[160];
+        snprintf(line, sizeof(line), "%-8s %5zu inputs, p50 %6lld us, p90 %6lld us, p99 %6lld us, max %6lld us, "
+                 "%zu missed\n", probe_phase_name(which), p.count, static_cast<long long>(p.p50.count()),
+                 static_cast<long long>(p.p90.count()), static_cast<long long>(p.p99.count()),
+                 static_cast<long long>(p.max.count()), missed(which));
+        out += line;
+    }
+    return out;
+}
+
+bool parse_latency_budget(const std::string_view text, ProbePhase& phase, std::chrono::milliseconds& budget)
+{
+    const size_t equals = text.find('=');
+    if (equals == std::string_view::npos) return false;
+
+    const std::string_view name = text.substr(0, equals);
+    const std::string_view value = text.substr(equals + 1);
+    for (size_t i = 0; i < probe_phase_count; ++i)
+    {
+        if (name != probe_phase_name(static_cast<ProbePhase>(i))) continue;
+
+        unsigned milliseconds = 0;
+        const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), milliseconds);
+        if (ec != std::errc() || end != value.data() + value.size()) return false;
+
+        phase = static_cast<ProbePhase>(i);
+        budget = std::chrono::milliseconds(milliseconds);
+        return true;
+    }
+    return false;
+}
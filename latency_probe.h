@@ -0,0 +1,92 @@
+#ifndef FINDMYWINDOWS_LATENCY_PROBE_H
+#define FINDMYWINDOWS_LATENCY_PROBE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// What --latency-probe times, each from the input to the first frame read back
+// with its effect on screen, or for a close to the window activated
+enum class ProbePhase : uint8_t
+{
+    // the decision to open to the first frame that isn't a blank buffer
+    Open,
+    // an arrow press to the first frame that differs from the one before it
+    Navigate,
+    // Enter to the switcher hidden and the selected window activated
+    Close,
+};
+
+constexpr size_t probe_phase_count = 3;
+
+const char* probe_phase_name(ProbePhase phase);
+
+// A frame read back, without keeping its pixels
+struct FrameContent
+{
+    uint64_t hash = 0;
+    // every pixel the same, nothing drawn over the clear color yet
+    bool uniform = true;
+};
+
+// RGBA pixels as glReadPixels() returns them, one pass
+FrameContent frame_content(std::span<const uint8_t> pixels);
+
+struct ProbePercentiles
+{
+    size_t count = 0;
+    std::chrono::microseconds p50{};
+    std::chrono::microseconds p90{};
+    std::chrono::microseconds p99{};
+    std::chrono::microseconds max{};
+};
+
+// Pairs the inputs of one or more openings with the frames that showed them.
+// Inputs are stamped when sent, frames when presented, main thread only.
+class LatencyProbe
+{
+public:
+    using time_point = std::chrono::steady_clock::time_point;
+
+    // The switcher is about to open, decided at
+    void opening(time_point at);
+    // The switcher took an input sent at sentAt, before the frame it can show in started
+    void received(ProbePhase phase, time_point sentAt);
+    // An input sent that never reached the switcher, counted as missed
+    void lost(ProbePhase phase);
+    // A frame read back and presented at presentedAt
+    void frame(time_point presentedAt, const FrameContent& content);
+    // The switcher is gone and its window activated. Inputs no frame showed count as missed.
+    void closed(time_point at);
+
+    ProbePercentiles percentiles(ProbePhase phase) const;
+    size_t missed(ProbePhase phase) const;
+
+    // One line per phase
+    std::string report() const;
+
+private:
+    struct Phase
+    {
+        std::vector<std::chrono::steady_clock::duration> latencies;
+        std::vector<time_point> pending;
+        size_t missed = 0;
+    };
+
+    Phase& phase(ProbePhase which);
+    const Phase& phase(ProbePhase which) const;
+    void resolve(Phase& phase, time_point at);
+
+    Phase phases[probe_phase_count];
+    bool hasFrame = false;
+    uint64_t lastHash = 0;
+};
+
+// "<phase>=<milliseconds>", as --latency-budget takes it
+bool parse_latency_budget(std::string_view text, ProbePhase& phase, std::chrono::milliseconds& budget);
+
+#endif //FINDMYWINDOWS_LATENCY_PROBE_H
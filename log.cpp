@@ -0,0 +1,266 @@
+#include "log.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+// Bounded multi-producer ring (Vyukov style). Each cell carries a sequence number
+// that tells producers and the single consumer whose turn it is, so the hot path
+// is one CAS on enqueue_pos plus a plain copy of the arguments.
+static constexpr size_t ring_size = 1024;
+static constexpr size_t ring_mask = ring_size - 1;
+static_assert((ring_size & ring_mask) == 0, "ring size must be a power of two");
+
+// Cells hold their sequence relative to their index, so an all-zero ring is the
+// initial state and it needs no initializer that could run after a LOG_* call in
+// another translation unit's static initializer
+struct LogCell
+{
+    std::atomic<size_t> sequence;
+    LogRecord record;
+};
+
+static constinit LogCell ring[ring_size];
+static constinit std::atomic<size_t> enqueue_pos{0};
+static size_t dequeue_pos = 0; // only touched by the logging thread
+
+static constinit std::atomic<uint64_t> written{0};
+static constinit std::atomic<uint64_t> dropped_full{0};
+static constinit std::atomic<uint64_t> dropped_rate{0};
+
+static constinit std::atomic<bool> running{false};
+static std::thread worker;
+static unsigned lines_per_second = 200;
+static FILE* output = nullptr;
+
+static size_t load_sequence(const size_t pos, const std::memory_order order)
+{
+    return ring[pos & ring_mask].sequence.load(order) + (pos & ring_mask);
+}
+
+static void store_sequence(const size_t pos, const size_t sequence)
+{
+    ring[pos & ring_mask].sequence.store(sequence - (pos & ring_mask), std::memory_order_release);
+}
+
+static uint64_t now_ns()
+{
+    static const auto clock_origin = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - clock_origin).count();
+}
+
+LogRecord* log_begin(const LogLevel level, const char* fmt)
+{
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    LogCell* cell;
+    for (;;)
+    {
+        cell = &ring[pos & ring_mask];
+        const size_t seq = load_sequence(pos, std::memory_order_acquire);
+        const auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0)
+        {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            dropped_full.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        else
+        {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    LogRecord& record = cell->record;
+    record.position = pos;
+    record.timestamp = now_ns();
+    record.fmt = fmt;
+    record.level = level;
+    record.argc = 0;
+    record.text_used = 0;
+    return &record;
+}
+
+void log_commit(LogRecord* record)
+{
+    store_sequence(record->position, record->position + 1);
+}
+
+static const char* level_name(const LogLevel level)
+{
+    switch (level)
+    {
+    case LogLevel::Debug: return "DEBUG";
+    case LogLevel::Info: return "INFO ";
+    case LogLevel::Warn: return "WARN ";
+    case LogLevel::Error: return "ERROR";
+    }
+    return "?????";
+}
+
+static void append_arg(std::string& out, const LogRecord& record, const LogArg& arg)
+{
+    char buffer[32];
+    int n = 0;
+    switch (arg.type)
+    {
+    case LogArg::Type::Int:
+        n = snprintf(buffer, sizeof(buffer), "%" PRId64, arg.i);
+        break;
+    case LogArg::Type::UInt:
+        n = snprintf(buffer, sizeof(buffer), "%" PRIu64, arg.u);
+        break;
+    case LogArg::Type::Double:
+        n = snprintf(buffer, sizeof(buffer), "%g", arg.d);
+        break;
+    case LogArg::Type::Pointer:
+        n = snprintf(buffer, sizeof(buffer), "0x%" PRIxPTR, reinterpret_cast<uintptr_t>(arg.p));
+        break;
+    case LogArg::Type::String:
+        out.append(record.text + arg.offset, arg.length);
+        return;
+    }
+    out.append(buffer, n > 0 ? n : 0);
+}
+
+static void format_record(std::string& out, const LogRecord& record)
+{
+    char prefix[48];
+    const int n = snprintf(prefix, sizeof(prefix), "[%12.6f] %s ",
+                           static_cast<double>(record.timestamp) / 1e9, level_name(record.level));
+    out.append(prefix, n > 0 ? n : 0);
+
+    size_t next_arg = 0;
+    for (const char* c = record.fmt; *c != '\0'; ++c)
+    {
+        if (c[0] == '{' && c[1] == '}')
+        {
+            if (next_arg < record.argc)
+            {
+                append_arg(out, record, record.args[next_arg++]);
+            }
+            ++c;
+            continue;
+        }
+        out.push_back(*c);
+    }
+    out.push_back('\n');
+}
+
+// Token bucket on printed lines. Errors always go through.
+struct RateLimiter
+{
+    double tokens;
+    uint64_t last_refill;
+    uint64_t suppressed = 0;
+
+    bool allow(const LogLevel level, const uint64_t now)
+    {
+        const double capacity = lines_per_second;
+        tokens += static_cast<double>(now - last_refill) * capacity / 1e9;
+        if (tokens > capacity) tokens = capacity;
+        last_refill = now;
+
+        if (level == LogLevel::Error || tokens >= 1.0)
+        {
+            if (tokens >= 1.0) tokens -= 1.0;
+            return true;
+        }
+
+        ++suppressed;
+        dropped_rate.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+};
+
+static size_t drain(std::string& out, RateLimiter& limiter)
+{
+    size_t drained = 0;
+    for (;;)
+    {
+        LogCell& cell = ring[dequeue_pos & ring_mask];
+        if (load_sequence(dequeue_pos, std::memory_order_acquire) != dequeue_pos + 1)
+        {
+            break;
+        }
+
+        if (limiter.allow(cell.record.level, now_ns()))
+        {
+            if (limiter.suppressed > 0)
+            {
+                char note[64];
+                const int n = snprintf(note, sizeof(note), "... %" PRIu64 " log lines suppressed\n",
+                                       limiter.suppressed);
+                out.append(note, n > 0 ? n : 0);
+                limiter.suppressed = 0;
+            }
+            format_record(out, cell.record);
+            written.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        store_sequence(dequeue_pos, dequeue_pos + ring_size);
+        ++dequeue_pos;
+        ++drained;
+    }
+
+    if (!out.empty())
+    {
+        FILE* to = output ? output : stdout;
+        fwrite(out.data(), 1, out.size(), to);
+        fflush(to);
+        out.clear();
+    }
+    return drained;
+}
+
+static void log_thread_main()
+{
+    std::string out;
+    out.reserve(16 * 1024);
+    RateLimiter limiter{static_cast<double>(lines_per_second), now_ns()};
+
+    while (running.load(std::memory_order_acquire))
+    {
+        if (drain(out, limiter) == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+    drain(out, limiter);
+}
+
+void log_set_output(FILE* file)
+{
+    output = file;
+}
+
+void log_start(const unsigned max_lines_per_second)
+{
+    if (running.exchange(true)) return;
+
+    lines_per_second = max_lines_per_second > 0 ? max_lines_per_second : 1;
+    worker = std::thread(log_thread_main);
+}
+
+void log_stop()
+{
+    if (!running.exchange(false)) return;
+    worker.join();
+}
+
+LogStats log_stats()
+{
+    return {
+        written.load(std::memory_order_relaxed),
+        dropped_full.load(std::memory_order_relaxed),
+        dropped_rate.load(std::memory_order_relaxed),
+    };
+}
@@ -0,0 +1,196 @@
+#ifndef FINDMYWINDOWS_LOG_H
+#define FINDMYWINDOWS_LOG_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+// Compile-time log levels. Anything below FMW_LOG_LEVEL expands to nothing,
+// arguments included, so disabled levels cost zero at the call site.
+#define FMW_LOG_LEVEL_DEBUG 0
+#define FMW_LOG_LEVEL_INFO 1
+#define FMW_LOG_LEVEL_WARN 2
+#define FMW_LOG_LEVEL_ERROR 3
+#define FMW_LOG_LEVEL_OFF 4
+
+#ifndef FMW_LOG_LEVEL
+#define FMW_LOG_LEVEL FMW_LOG_LEVEL_INFO
+#endif
+
+enum class LogLevel : uint8_t
+{
+    Debug,
+    Info,
+    Warn,
+    Error,
+};
+
+struct LogArg
+{
+    enum class Type : uint8_t
+    {
+        Int,
+        UInt,
+        Double,
+        Pointer,
+        String,
+    };
+
+    Type type;
+    // String args live in LogRecord::text, this is the [offset, offset + length) slice
+    uint16_t offset;
+    uint16_t length;
+
+    union
+    {
+        int64_t i;
+        uint64_t u;
+        double d;
+        const void* p;
+    };
+};
+
+// One fixed-size slot in the ring buffer. The producer only copies raw values,
+// the "{}" placeholders in fmt are expanded later on the logging thread.
+struct LogRecord
+{
+    static constexpr size_t max_args = 6;
+    static constexpr size_t text_capacity = 96;
+
+    size_t position; // ring slot, owned by log.cpp
+    uint64_t timestamp;
+    const char* fmt; // must be a string literal
+    LogLevel level;
+    uint8_t argc;
+    uint16_t text_used;
+    LogArg args[max_args];
+    char text[text_capacity];
+};
+
+inline void log_capture(LogRecord& record, const std::string_view value)
+{
+    if (record.argc >= LogRecord::max_args) return;
+
+    const size_t room = LogRecord::text_capacity - record.text_used;
+    const size_t length = value.size() < room ? value.size() : room;
+    std::memcpy(record.text + record.text_used, value.data(), length);
+
+    LogArg& arg = record.args[record.argc++];
+    arg.type = LogArg::Type::String;
+    arg.offset = record.text_used;
+    arg.length = static_cast<uint16_t>(length);
+    record.text_used += static_cast<uint16_t>(length);
+}
+
+template <typename T>
+void log_capture(LogRecord& record, const T& value)
+{
+    using U = std::remove_cvref_t<T>;
+
+    if constexpr (std::is_convertible_v<const U&, std::string_view>)
+    {
+        log_capture(record, std::string_view(value));
+        return;
+    }
+    else
+    {
+        if (record.argc >= LogRecord::max_args) return;
+        LogArg& arg = record.args[record.argc++];
+
+        if constexpr (std::is_same_v<U, bool>)
+        {
+            arg.type = LogArg::Type::UInt;
+            arg.u = value ? 1 : 0;
+        }
+        else if constexpr (std::is_enum_v<U>)
+        {
+            arg.type = LogArg::Type::Int;
+            arg.i = static_cast<int64_t>(value);
+        }
+        else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>)
+        {
+            arg.type = LogArg::Type::Int;
+            arg.i = value;
+        }
+        else if constexpr (std::is_integral_v<U>)
+        {
+            arg.type = LogArg::Type::UInt;
+            arg.u = value;
+        }
+        else if constexpr (std::is_floating_point_v<U>)
+        {
+            arg.type = LogArg::Type::Double;
+            arg.d = value;
+        }
+        else
+        {
+            static_assert(std::is_pointer_v<U>, "unsupported log argument type");
+            arg.type = LogArg::Type::Pointer;
+            arg.p = reinterpret_cast<const void*>(value);
+        }
+    }
+}
+
+// Claims a ring slot, or nullptr when the ring is full (the record is dropped and counted).
+LogRecord* log_begin(LogLevel level, const char* fmt);
+
+void log_commit(LogRecord* record);
+
+template <typename... Args>
+void log_write(const LogLevel level, const char* fmt, const Args&... args)
+{
+    LogRecord* record = log_begin(level, fmt);
+    if (record == nullptr) return;
+
+    (log_capture(*record, args), ...);
+    log_commit(record);
+}
+
+struct LogStats
+{
+    uint64_t written;
+    uint64_t dropped_full; // ring was full on the producer side
+    uint64_t dropped_rate; // suppressed by the output rate limit
+};
+
+// Starts the background thread that formats and prints queued records.
+// Records logged before this are kept in the ring until it fills up.
+void log_start(unsigned max_lines_per_second = 200);
+
+// Where the logging thread prints, stdout when null. Set it before log_start().
+void log_set_output(FILE* file);
+
+// Drains whatever is still queued and joins the logging thread.
+void log_stop();
+
+LogStats log_stats();
+
+#if FMW_LOG_LEVEL <= FMW_LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) log_write(LogLevel::Debug, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if FMW_LOG_LEVEL <= FMW_LOG_LEVEL_INFO
+#define LOG_INFO(...) log_write(LogLevel::Info, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if FMW_LOG_LEVEL <= FMW_LOG_LEVEL_WARN
+#define LOG_WARN(...) log_write(LogLevel::Warn, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+
+#if FMW_LOG_LEVEL <= FMW_LOG_LEVEL_ERROR
+#define LOG_ERROR(...) log_write(LogLevel::Error, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
+
+#endif //FINDMYWINDOWS_LOG_H
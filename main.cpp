@@ -1,77 +1,310 @@
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
 #include <iostream>
 #include <map>
-#include <windows.h>
-#include <psapi.h>
+#include <memory>
+#include <mutex>
 #include <ranges>
 #include <vector>
 #include <string>
-#include <shobjidl.h>
-#include <wrl/client.h>
+#include <thread>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
 
+#include "actions.h"
+#include "app_index.h"
+#include "browser_tabs.h"
+#include "eligibility.h"
 #include "file.h"
+#include "fingerprint.h"
+#include "frame_pacer.h"
+#ifndef FMW_HEADLESS
 #include "gui.h"
+#endif
+#include "ipc.h"
+#include "latency_probe.h"
+#include "log.h"
+#include "mru.h"
+#include "predict.h"
+#include "quick_switch.h"
+#include "refresh.h"
+#include "replay.h"
+#include "residency.h"
+#include "snapshot.h"
+#include "state.h"
 #include "tabs.h"
+#include "trace.h"
+#include "window_list.h"
+#ifdef _WIN32
+#include "win32_backend.h"
+#else
+#include "fake_backend.h"
+#endif
 
 
-template <typename T>
-T* safeGet(std::vector<T>& vec, size_t idx)
+struct ShortcutConfig
 {
-    return idx < vec.size() ? &vec[idx] : nullptr;
+    int KeyModifiers;
+    int TriggerKey;
+    void (*callback)(std::vector<WindowInfo>* desktops, int triggerKey);
+    // served from a fresh window list, refreshed ahead of the callback when it is stale
+    bool needsList = true;
+};
+
+std::string transform(const WindowInfo& win)
+{
+    return saved_order_line(win);
 }
 
-void handle_sht(std::vector<WindowInfo>* windows, int trigger_key)
+const auto startTime = std::chrono::steady_clock::now();
+
+long long elapsed_ms()
 {
-    if (windows->empty())
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+constexpr auto STATE_SAVE_INTERVAL = std::chrono::seconds(60);
+
+// The process is usually killed at logoff rather than shut down cleanly,
+// so the state snapshot is also written while running, at most once a minute
+void save_state_if_due(const bool force)
+{
+    static uint64_t savedVersion = 0;
+    static std::chrono::steady_clock::time_point lastSave;
+
+    const auto snapshot = current_snapshot();
+    const auto now = std::chrono::steady_clock::now();
+    if (snapshot->version == savedVersion || (!force && now - lastSave < STATE_SAVE_INTERVAL))
     {
-        std::cout << "No windows found " << windows->size() << std::endl;
         return;
     }
 
-    if (const auto win = safeGet(*windows, trigger_key - 1))
+    // the snapshot keeps every field, lazily listed windows get theirs now
+    std::vector<WindowInfo> windows = snapshot->windows;
+    resolve_window_fields(window_backend(), windows, ALL_WINDOW_FIELDS);
+    fingerprint_windows(window_backend(), windows);
+    if (save_state(FIND_MY_WIN_STATE, windows))
     {
-        BringWindowToFront(win->hwnd);
+        savedVersion = snapshot->version;
+        lastSave = now;
     }
 }
 
-struct ShortcutConfig
+// Background refreshes run at most this often however many requests pile up
+constexpr auto REFRESH_MIN_INTERVAL = std::chrono::milliseconds(250);
+// A hotkey is served from a list at most this old, otherwise it refreshes first
+constexpr auto HOTKEY_MAX_AGE = std::chrono::milliseconds(100);
+
+void refresh_window_list()
 {
-    int KeyModifiers;
-    int TriggerKey;
-    void (*callback)(std::vector<WindowInfo>* desktops, int triggerKey);
-};
+    load_window_list();
+    save_state_if_due(false);
+    track_browser_windows(availableWindows);
+}
 
-const std::string FIND_MY_WIN_CONFIG = "findmywindows.txt";
+void log_refresh_stats(const RefreshScheduler& refreshes)
+{
+    const RefreshStats stats = refreshes.stats();
+    LOG_INFO("Refreshed the window list {} times for {} requests, {} ahead of a hotkey", stats.executed,
+             stats.requested, stats.forced);
+}
 
-std::vector<WindowInfo> availableWindows;
+// --residency overrides of the budgets below
+std::vector<std::pair<std::string, ResidencyBudget>> residencyBudgets;
 
-std::string transform(const WindowInfo& win)
+size_t list_bytes()
+{
+    const auto snapshot = current_snapshot();
+    size_t total = snapshot->windows.capacity() * sizeof(WindowInfo);
+    for (const WindowInfo& window : snapshot->windows)
+    {
+        total += window.title.capacity() + window.className.capacity() + window.processName.capacity();
+    }
+    return total;
+}
+
+size_t tabs_bytes()
+{
+    const auto tabs = current_tabs();
+    size_t total = tabs->tabs.capacity() * sizeof(BrowserTab) + tabs->foldedTitles.capacity() * sizeof(std::string);
+    for (const BrowserTab& tab : tabs->tabs)
+    {
+        // the folded copy is as long again
+        total += 2 * tab.title.capacity();
+    }
+    return total;
+}
+
+size_t apps_bytes()
 {
-    return win.processName;
+    return current_apps()->bytes();
 }
 
+#if defined(_WIN32) && !defined(FMW_HEADLESS)
+void start_app_index()
+{
+    app_index_start(default_app_roots(), FIND_MY_WIN_APPS, make_directory_watcher);
+}
+
+void start_tab_crawler()
+{
+    tab_crawler_start(make_uia_tree);
+}
+#endif
+
+// What the switcher keeps hot between hotkeys. The first activity, the loop
+// starting at login, builds everything.
+void add_resident_subsystems(ResidencyPolicy& residency)
+{
+#if defined(_WIN32) && !defined(FMW_HEADLESS)
+    // tens of ms to build the window, GL context and font atlas again
+    residency.add({"gui", gui_resident_bytes, gui_release, gui_warm}, {std::chrono::minutes(10), 0});
+    // reloaded from findmywindows.apps in a few ms
+    residency.add({"apps", apps_bytes, app_index_stop, start_app_index}, {std::chrono::minutes(30), 0});
+    // crawled again from scratch, tabs show up late in the first switcher after
+    residency.add({"tabs", tabs_bytes, tab_crawler_stop, start_tab_crawler}, {std::chrono::hours(1), 0});
+#endif
+    // swept by every enumeration already, only reported
+    residency.add({"metadata", metadata_cache_bytes}, {});
+    residency.add({"list", list_bytes}, {});
+
+    for (const auto& [name, budget] : residencyBudgets)
+    {
+        if (!residency.set_budget(name, budget)) LOG_WARN("No resident subsystem called {}", name);
+    }
+}
+
+void tick_residency(ResidencyPolicy& residency)
+{
+    if (residency.tick() > 0)
+    {
+        LOG_INFO("Released cold subsystems, {} KB resident", residency.resident_bytes() / 1024);
+    }
+    publish_footprint(residency.footprint());
+}
+
+void log_footprint(const ResidencyPolicy& residency)
+{
+    for (const ResidentFootprint& subsystem : residency.footprint())
+    {
+        LOG_INFO("Resident {}: {} KB, released {} times, warmed {} times", subsystem.name, subsystem.bytes / 1024,
+                 subsystem.releases, subsystem.warms);
+    }
+}
+
+#ifdef _WIN32
 constexpr auto trigger = MOD_CONTROL;
+constexpr INT SWITCHER_HOTKEY = 69;
+// the saved order covers the Ctrl+N slots
+constexpr size_t SLOT_COUNT = 7;
+
+// how long Win+Shift+Tab has to be held before the switcher opens, a shorter tap switches right away
+std::chrono::milliseconds switcherHoldDelay(150);
+
+#ifndef FMW_HEADLESS
+// RegisterHotKey swallows Tab while Win+Shift is down, so the presses are
+// counted from the key state. The press that started the chord counts as one.
+bool tabWasDown = true;
+unsigned chordPresses = 1;
+
+ChordState poll_switcher_chord()
+{
+    const auto down = [](const int key) { return (GetAsyncKeyState(key) & 0x8000) != 0; };
+    const bool tab = down(VK_TAB);
+    if (tab && !tabWasDown)
+    {
+        ++chordPresses;
+    }
+    tabWasDown = tab;
+    return {down(VK_SHIFT) && (down(VK_LWIN) || down(VK_RWIN)), chordPresses};
+}
+
+// The presses while the chord was held queued hotkey messages of their own,
+// they were handled here and mustn't open the switcher again
+void drain_switcher_hotkeys()
+{
+    std::vector<MSG> others;
+    MSG msg;
+    while (PeekMessage(&msg, nullptr, WM_HOTKEY, WM_HOTKEY, PM_REMOVE))
+    {
+        if (msg.wParam != SWITCHER_HOTKEY) others.push_back(msg);
+    }
+    for (const MSG& other : others)
+    {
+        PostThreadMessage(GetCurrentThreadId(), other.message, other.wParam, other.lParam);
+    }
+}
+
+void switcher_hotkey(std::vector<WindowInfo>* desktops, int)
+{
+    const auto pressedAt = std::chrono::steady_clock::now();
+    const HWND foreground = window_backend().foreground();
+
+    // a tap never builds the switcher, it only needs handles
+    std::vector<WindowInfo> entries = *desktops;
+    HWND likely = transition_model().predict(foreground);
+    if (!likely)
+    {
+        likely = mru_stack().previous(foreground);
+    }
+    const int target = quick_switch_target(entries, foreground, likely);
+    tabWasDown = true;
+    chordPresses = 1;
+    QuickSwitch hold(entries.size(), target, switcherHoldDelay, pressedAt);
+    const QuickSwitchStep step = hold.wait(poll_switcher_chord, std::chrono::steady_clock::now,
+                                           [] { std::this_thread::sleep_for(std::chrono::milliseconds(2)); });
+    if (step == QuickSwitchStep::Activate)
+    {
+        if (!entries.empty())
+        {
+            BringWindowToFront(entries[hold.selected()].hwnd, foreground);
+            record_tap_latency(std::chrono::steady_clock::now() - pressedAt);
+        }
+        drain_switcher_hotkeys();
+        return;
+    }
+
+    // rows show titles, the reordered list is saved by fingerprint and the filter may look at anything
+    resolve_window_fields(window_backend(), entries, ALL_WINDOW_FIELDS);
+    append_browser_tabs(entries);
+    SwitcherOpen open;
+    open.selected = hold.selected();
+    open.poll_chord = poll_switcher_chord;
+    open.presses = chordPresses;
+    availableWindows = launch_gui(std::move(entries), open);
+    drain_switcher_hotkeys();
+    // tab entries only live in the switcher
+    std::erase_if(availableWindows, [](const WindowInfo& window) { return window.tabNode != 0; });
+    fingerprint_windows(window_backend(), availableWindows);
+    std::vector<std::string> process_id_list;
+
+    std::ranges::transform(
+        availableWindows | std::views::take(SLOT_COUNT),
+        std::back_inserter(process_id_list),
+        transform
+    );
+
+    write_strings_to_file(saved_order_path(), process_id_list);
+}
+#endif
 
 const std::map<INT, ShortcutConfig> shortcuts = {
+#ifndef FMW_HEADLESS
     {
-        69, ShortcutConfig{
+        SWITCHER_HOTKEY, ShortcutConfig{
             MOD_WIN | MOD_SHIFT,
             VK_TAB,
-            [](std::vector<WindowInfo>* desktops, int)
-            {
-                availableWindows = launch_gui(*desktops);
-                std::vector<std::string> process_id_list;
-
-                std::ranges::transform(
-                    availableWindows | std::views::take(shortcuts.size() - 1),
-                    std::back_inserter(process_id_list),
-                    transform
-                );
-
-                write_strings_to_file(FIND_MY_WIN_CONFIG, process_id_list);
-            }
+            switcher_hotkey
         },
     },
+#endif
     {
         1, ShortcutConfig{
             trigger,
@@ -121,6 +354,14 @@ const std::map<INT, ShortcutConfig> shortcuts = {
             handle_sht
         },
     },
+    {
+        PREVIOUS_WINDOW_SHORTCUT, ShortcutConfig{
+            trigger,
+            '0',
+            handle_previous,
+            false
+        },
+    },
 };
 
 bool RegisterGlobalHotkey()
@@ -131,11 +372,11 @@ bool RegisterGlobalHotkey()
         // Register Alt+1 hotkey
         if (RegisterHotKey(nullptr, hotKeyID, config.KeyModifiers, config.TriggerKey))
         {
-            std::cout << "Registering shortcuts " << config.TriggerKey << std::endl;
+            LOG_INFO("Registering shortcuts {}", config.TriggerKey);
         }
         else
         {
-            std::cout << "Failed to register hotkey. Error code: " << GetLastError() << std::endl;
+            LOG_ERROR("Failed to register hotkey. Error code: {}", GetLastError());
             return false;
         }
     }
@@ -148,28 +389,184 @@ void UnregisterGlobalHotkey()
     for (auto [hotKeyID, config] : shortcuts)
     {
         UnregisterHotKey(nullptr, hotKeyID);
-        std::cout << "un registering shortcuts " << config.TriggerKey << std::endl;
+        LOG_DEBUG("un registering shortcuts {}", config.TriggerKey);
     }
 }
 
-void load_window_list();
+// Posted by the IPC server thread, wParam is the HWND to activate
+constexpr UINT WM_FMW_FOCUS = WM_APP + 1;
+// Posted by the startup reconcile thread, lParam owns a std::vector<WindowInfo>
+constexpr UINT WM_FMW_RECONCILED = WM_APP + 2;
+// Posted by the action worker after each batch, the refresh below picks up closed windows
+constexpr UINT WM_FMW_ACTION_DONE = WM_APP + 3;
+// Posted by the IPC server thread, wParam is the WindowFields a client needs
+constexpr UINT WM_FMW_RESOLVE = WM_APP + 4;
+constexpr UINT_PTR REFRESH_TIMER_MS = 2000;
+
+DWORD mainThreadId = 0;
+// set while the list restored from the state snapshot awaits its first real enumeration
+bool reconcilePending = false;
+
+bool post_focus(const HWND hwnd)
+{
+    return PostThreadMessage(mainThreadId, WM_FMW_FOCUS, reinterpret_cast<WPARAM>(hwnd), 0);
+}
+
+void post_resolve(const WindowFields fields)
+{
+    PostThreadMessage(mainThreadId, WM_FMW_RESOLVE, fields, 0);
+}
+
+// Enumerates on a thread with its own backend so hotkeys are served from the
+// restored list meanwhile. The result is applied on the message loop thread.
+void start_reconcile()
+{
+    reconcilePending = true;
+    std::thread([]
+    {
+        const auto backend = make_win32_backend();
+        auto* windows = new std::vector<WindowInfo>(build_window_list(*backend));
+        if (!PostThreadMessage(mainThreadId, WM_FMW_RECONCILED, 0, reinterpret_cast<LPARAM>(windows)))
+        {
+            delete windows;
+        }
+    }).detach();
+}
+
+void on_action_done(const ActionResult&)
+{
+    PostThreadMessage(mainThreadId, WM_FMW_ACTION_DONE, 0, 0);
+}
+
+// Keeps the MRU stack current. Out of context hooks are delivered through this
+// thread's message loop, one hash lookup each.
+void CALLBACK on_win_event(HWINEVENTHOOK, const DWORD event, const HWND hwnd, const LONG idObject,
+                           const LONG idChild, DWORD, DWORD)
+{
+    if (!hwnd || idObject != OBJID_WINDOW || idChild != CHILDID_SELF) return;
+
+    if (event == EVENT_SYSTEM_FOREGROUND)
+    {
+        mru_stack().touch(hwnd);
+    }
+    else if (event == EVENT_OBJECT_DESTROY)
+    {
+        // child windows land here too, they were never in the stack
+        mru_stack().remove(hwnd);
+        forget_window(hwnd);
+    }
+}
 
 void MessageLoop()
 {
+    // our own switcher window doesn't count as a switch
+    constexpr DWORD hookFlags = WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS;
+    const HWINEVENTHOOK foregroundHook = SetWinEventHook(EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND, nullptr,
+                                                         on_win_event, 0, 0, hookFlags);
+    const HWINEVENTHOOK destroyHook = SetWinEventHook(EVENT_OBJECT_DESTROY, EVENT_OBJECT_DESTROY, nullptr,
+                                                      on_win_event, 0, 0, hookFlags);
+    if (!foregroundHook || !destroyHook)
+    {
+        LOG_WARN("Foreground tracking unavailable, the previous window follows our own switches only");
+    }
+    mru_stack().touch(window_backend().foreground());
+
+    // keeps the published snapshot fresh for IPC subscribers between hotkeys
+    const UINT_PTR periodicTimer = SetTimer(nullptr, 0, REFRESH_TIMER_MS, nullptr);
+    // one-shot wakeup for a refresh held back by REFRESH_MIN_INTERVAL
+    UINT_PTR refreshTimer = 0;
+
+    // every message used to enumerate, now they only mark the list dirty and a
+    // burst of them costs one refresh
+    RefreshScheduler refreshes(refresh_window_list, REFRESH_MIN_INTERVAL, HOTKEY_MAX_AGE);
+
+    ResidencyPolicy residency;
+    add_resident_subsystems(residency);
+    residency.note_activity();
+    publish_footprint(residency.footprint());
+    // input anywhere in the session, polled on the periodic timer
+    LASTINPUTINFO lastInput{sizeof(LASTINPUTINFO), 0};
+    GetLastInputInfo(&lastInput);
+
     MSG msg;
     while (GetMessage(&msg, nullptr, 0, 0))
     {
-        load_window_list();
-        if (msg.message == WM_HOTKEY)
+        if (msg.message == WM_TIMER && msg.wParam == periodicTimer)
+        {
+            // the user is back (or never left), warm what went cold before a hotkey needs it
+            LASTINPUTINFO input{sizeof(LASTINPUTINFO), 0};
+            if (GetLastInputInfo(&input) && input.dwTime != lastInput.dwTime)
+            {
+                lastInput = input;
+                residency.note_activity();
+            }
+            tick_residency(residency);
+        }
+
+        if (msg.message == WM_TIMER && refreshTimer != 0 && msg.wParam == refreshTimer)
+        {
+            KillTimer(nullptr, refreshTimer);
+            refreshTimer = 0;
+        }
+        else if (msg.message == WM_FMW_FOCUS)
+        {
+            // served from the published snapshot, no enumeration needed
+            trace_focus(reinterpret_cast<HWND>(msg.wParam));
+            BringWindowToFront(reinterpret_cast<HWND>(msg.wParam));
+            refreshes.mark_dirty();
+        }
+        else if (msg.message == WM_FMW_RESOLVE)
+        {
+            publish_window_fields(static_cast<WindowFields>(msg.wParam));
+        }
+        else if (msg.message == WM_FMW_RECONCILED)
+        {
+            const std::unique_ptr<std::vector<WindowInfo>> windows(
+                reinterpret_cast<std::vector<WindowInfo>*>(msg.lParam));
+            apply_window_list(std::move(*windows));
+            reconcilePending = false;
+            LOG_INFO("Restored list reconciled {} ms after start", elapsed_ms());
+        }
+        else if (msg.message == WM_HOTKEY)
         {
+            residency.note_activity();
             auto item = shortcuts.find(msg.wParam);
-            if (item != shortcuts.end())
+            if (item == shortcuts.end())
             {
+                LOG_WARN("shortcut not found {}", msg.wParam);
+            }
+            else if (!item->second.needsList)
+            {
+                // no refresh before or after, the MRU stack keeps up with the focus on its own
+                trace_hotkey(item->first);
                 item->second.callback(&availableWindows, item->first);
             }
             else
             {
-                std::cout << "shortcut not found" << msg.wParam << std::endl;
+                // until the reconcile lands the first hotkeys are served from the restored list
+                if (!reconcilePending)
+                {
+                    refreshes.ensure_fresh();
+                }
+                trace_hotkey(item->first);
+                item->second.callback(&availableWindows, item->first);
+                // the activation reordered the z-order
+                refreshes.mark_dirty();
+            }
+        }
+        else
+        {
+            // the periodic timer, finished actions and whatever else arrives
+            refreshes.mark_dirty();
+        }
+
+        if (!reconcilePending)
+        {
+            refreshes.run_if_due();
+            const auto wait = refreshes.time_until_due();
+            if (wait != std::chrono::milliseconds::max() && refreshTimer == 0)
+            {
+                refreshTimer = SetTimer(nullptr, 0, static_cast<UINT>(wait.count()), nullptr);
             }
         }
 
@@ -181,59 +578,462 @@ void MessageLoop()
         // Sends the message to the appropriate window procedure for processing
         DispatchMessage(&msg);
     }
+
+    KillTimer(nullptr, periodicTimer);
+    if (refreshTimer != 0) KillTimer(nullptr, refreshTimer);
+    if (foregroundHook) UnhookWinEvent(foregroundHook);
+    if (destroyHook) UnhookWinEvent(destroyHook);
+    log_refresh_stats(refreshes);
+    log_footprint(residency);
+#ifndef FMW_HEADLESS
+    gui_release();
+#endif
+}
+#else
+constexpr auto REFRESH_INTERVAL = std::chrono::seconds(1);
+
+std::mutex focusMutex;
+std::condition_variable focusReady;
+std::vector<HWND> focusQueue;
+// fields IPC clients asked for, guarded by focusMutex
+WindowFields fieldsWanted = 0;
+std::atomic<bool> quitRequested{false};
+
+bool post_focus(const HWND hwnd)
+{
+    {
+        std::lock_guard lock(focusMutex);
+        focusQueue.push_back(hwnd);
+    }
+    focusReady.notify_one();
+    return true;
+}
+
+void post_resolve(const WindowFields fields)
+{
+    {
+        std::lock_guard lock(focusMutex);
+        fieldsWanted |= fields;
+    }
+    focusReady.notify_one();
+}
+
+// Stand-in for the hotkey message loop: refreshes the list on a timer and
+// performs focus requests handed over by the IPC server
+void HeadlessLoop()
+{
+    std::signal(SIGINT, [](int) { quitRequested.store(true); });
+    std::signal(SIGTERM, [](int) { quitRequested.store(true); });
+
+    RefreshScheduler refreshes(refresh_window_list, REFRESH_MIN_INTERVAL, HOTKEY_MAX_AGE);
+    auto nextTick = std::chrono::steady_clock::now();
+    ResidencyPolicy residency;
+    add_resident_subsystems(residency);
+    residency.note_activity();
+
+    std::vector<HWND> pending;
+    while (!quitRequested.load())
+    {
+        if (std::chrono::steady_clock::now() >= nextTick)
+        {
+            refreshes.mark_dirty();
+            tick_residency(residency);
+            nextTick = std::chrono::steady_clock::now() + REFRESH_INTERVAL;
+        }
+        refreshes.run_if_due();
+
+        // short waits so a signal is noticed without a wakeup from the handler
+        const auto wait = std::min({
+            std::chrono::milliseconds(200), refreshes.time_until_due(),
+            std::chrono::ceil<std::chrono::milliseconds>(nextTick - std::chrono::steady_clock::now()),
+        });
+        WindowFields wanted;
+        {
+            std::unique_lock lock(focusMutex);
+            focusReady.wait_for(lock, wait, [] { return !focusQueue.empty() || fieldsWanted != 0; });
+            pending.swap(focusQueue);
+            wanted = std::exchange(fieldsWanted, 0);
+        }
+        if (wanted != 0) publish_window_fields(wanted);
+
+        for (const HWND hwnd : pending)
+        {
+            trace_focus(hwnd);
+            BringWindowToFront(hwnd);
+            refreshes.mark_dirty();
+        }
+        // a client asking for a window is the only activity there is here
+        if (!pending.empty()) residency.note_activity();
+        pending.clear();
+    }
+
+    log_refresh_stats(refreshes);
+    log_footprint(residency);
 }
+#endif
 
 
-void load_window_list()
+struct Options
 {
-    std::vector<WindowInfo> orderedWindows;
+    // client mode when set
+    std::string request;
+    bool stream = false;
+    std::string socketPath = ipc_default_path();
 
-    std::vector<WindowInfo> initialWindows = ListWindowsByDesktop(true);
-    const std::vector<std::string> saved_process = read_strings_from_file(FIND_MY_WIN_CONFIG);
+    std::string recordPath;
+    std::string replayPath;
+    double replaySpeed = 1.0;
+    std::string synthesizePath;
+    size_t synthesizeEvents = 10000;
 
-    std::vector<WindowInfo> finalWindowList;
-    finalWindowList.reserve(initialWindows.size());
+    bool lazyMetadata = false;
+    // negative keeps the default
+    long long holdDelayMs = -1;
+    bool lowLatency = false;
+    int latencyProbe = 0;
+    int probeOpenings = 10;
+    std::vector<std::pair<ProbePhase, std::chrono::milliseconds>> latencyBudgets;
+    std::vector<std::pair<std::string, ResidencyBudget>> residency;
+};
 
-    // Iterate through the desired process order.
-    for (const auto& process_name : saved_process)
+void print_usage()
+{
+    std::cout << "usage: findmywindows [--list | --subscribe | --focus <slot|text> | --footprint] [--socket <path>]\n"
+        "       findmywindows [--record <trace>] [--lazy-metadata] [--hold-delay <ms>] [--low-latency]\n"
+        "                     [--residency <name>=<idle seconds>[:<idle KB>]]...\n"
+        "       findmywindows --latency-probe <presses> [--probe-openings <n>] [--low-latency]\n"
+        "                     [--latency-budget <open|navigate|close>=<ms>]...\n"
+        "       findmywindows --replay <trace> [--speed <x>] [--lazy-metadata]\n"
+        "       findmywindows --make-trace <trace> [--events <n>]\n"
+        "  --list        print the cached window list as JSON\n"
+        "  --subscribe   print the list, then again on every change\n"
+        "  --focus N     activate the window in slot N (like Ctrl+N)\n"
+        "  --focus text  activate the first window whose title or process contains text\n"
+        "  --footprint   print the memory each subsystem of the running instance keeps resident\n"
+        "  --socket      IPC socket of the running instance\n"
+        "  --record      record window events and hotkeys of this session\n"
+        "  --lazy-metadata  fetch window classes and process names only when something needs them\n"
+        "  --hold-delay  hold Win+Shift+Tab this long to open the switcher, a tap switches (default 150)\n"
+        "  --low-latency  switcher frames paced just before the vblank instead of a vsync'd swap. Only\n"
+        "                Windows reports the vblank, elsewhere frames are paced by the refresh rate\n"
+        "                alone and count as presented once finished\n"
+        "  --residency   release gui, apps or tabs after this long without input while holding more\n"
+        "                than this, 0 seconds keeps it (defaults gui=600, apps=1800, tabs=3600, all :0)\n"
+        "  --latency-probe  open the switcher, send this many synthetic arrow presses and Enter, and print\n"
+        "                input to photon latency of opening, navigating and closing\n"
+        "  --probe-openings  times the probe opens the switcher (default 10)\n"
+        "  --latency-budget  exit with 1 when the 90th percentile of a phase is over this\n"
+        "  --replay      replay a trace against the fake backend and report latency\n"
+        "  --speed       replay speed multiplier, 0 replays back to back (default 1)\n"
+        "  --make-trace  write a synthetic bursty trace for --replay\n";
+    std::cout << "Without a client option findmywindows runs as the resident hotkey process.\n";
+}
+
+bool parse_options(const int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; ++i)
     {
-        // Find the window corresponding to the saved process name.
-        auto it = std::ranges::find_if(
-            initialWindows,
-            [&](const WindowInfo& window)
+        const std::string_view arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--list")
+        {
+            options.request = "list";
+        }
+        else if (arg == "--footprint")
+        {
+            options.request = "footprint";
+        }
+        else if (arg == "--subscribe")
+        {
+            options.request = "subscribe";
+            options.stream = true;
+        }
+        else if (arg == "--focus" && has_value)
+        {
+            const std::string target = argv[++i];
+            const bool is_slot = !target.empty() && std::ranges::all_of(target, [](const char c)
             {
-                return window.processName == process_name;
+                return c >= '0' && c <= '9';
             });
-
-        // If the window was found in the available list...
-        if (it != initialWindows.end())
+            options.request = (is_slot ? "focus " : "find ") + target;
+        }
+        else if (arg == "--socket" && has_value)
+        {
+            options.socketPath = argv[++i];
+        }
+        else if (arg == "--record" && has_value)
+        {
+            options.recordPath = argv[++i];
+        }
+        else if (arg == "--replay" && has_value)
+        {
+            options.replayPath = argv[++i];
+        }
+        else if (arg == "--speed" && has_value)
+        {
+            options.replaySpeed = std::strtod(argv[++i], nullptr);
+        }
+        else if (arg == "--make-trace" && has_value)
+        {
+            options.synthesizePath = argv[++i];
+        }
+        else if (arg == "--events" && has_value)
+        {
+            options.synthesizeEvents = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--lazy-metadata")
+        {
+            options.lazyMetadata = true;
+        }
+        else if (arg == "--hold-delay" && has_value)
+        {
+            options.holdDelayMs = std::strtoll(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--low-latency")
+        {
+            options.lowLatency = true;
+        }
+        else if (arg == "--residency" && has_value)
+        {
+            auto& [name, budget] = options.residency.emplace_back();
+            if (!parse_residency_budget(argv[++i], name, budget)) return false;
+        }
+#ifdef FMW_HEADLESS
+        else if (arg == "--latency-probe" || arg == "--probe-openings" || arg == "--latency-budget")
+        {
+            // there is no switcher to time, carrying on would start the resident process instead
+            std::cerr << arg << " needs the switcher, this build is headless\n";
+            return false;
+        }
+#else
+        else if (arg == "--latency-probe" && has_value)
+        {
+            options.latencyProbe = std::atoi(argv[++i]);
+        }
+        else if (arg == "--probe-openings" && has_value)
+        {
+            options.probeOpenings = std::atoi(argv[++i]);
+        }
+        else if (arg == "--latency-budget" && has_value)
         {
-            // move it to our final list and erase it from the original
-            // to mark it as "processed".
-            finalWindowList.push_back(std::move(*it));
-            initialWindows.erase(it);
+            auto& [phase, budget] = options.latencyBudgets.emplace_back();
+            if (!parse_latency_budget(argv[++i], phase, budget)) return false;
+        }
+#endif
+        else
+        {
+            return false;
         }
     }
+    return true;
+}
 
-    finalWindowList.insert(
-        finalWindowList.end(),
-        std::make_move_iterator(initialWindows.begin()),
-        std::make_move_iterator(initialWindows.end())
-    );
+// Thin client mode, talks to the resident instance and never enumerates itself
+int run_cli(const Options& options)
+{
+#ifdef _WIN32
+    // release builds use the GUI subsystem, borrow the console we were started from
+    if (AttachConsole(ATTACH_PARENT_PROCESS))
+    {
+        freopen("CONOUT$", "w", stdout);
+        freopen("CONOUT$", "w", stderr);
+    }
+    // lets the resident process take the foreground on our behalf
+    AllowSetForegroundWindow(ASFW_ANY);
+#endif
 
-    availableWindows = finalWindowList;
+    return ipc_client_run(options.socketPath, options.request, options.stream);
 }
 
-int main()
+int main(int argc, char* argv[])
 {
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        print_usage();
+        return 2;
+    }
+
+    if (!options.request.empty())
+    {
+        return run_cli(options);
+    }
+
+    if (!options.synthesizePath.empty())
+    {
+        return write_synthetic_trace(options.synthesizePath, options.synthesizeEvents, 42) ? 0 : 1;
+    }
+
+    set_lazy_metadata(options.lazyMetadata);
+    residencyBudgets = options.residency;
+
+    if (!options.replayPath.empty())
+    {
+        log_start();
+        const int result = run_replay(options.replayPath, options.replaySpeed);
+        log_stop();
+        return result;
+    }
+
     std::cout << "FindMyTabs\n";
     std::cout << "==================================\n\n";
+    std::cout.flush();
+
+    log_start();
+
+#ifdef _WIN32
+    if (options.holdDelayMs >= 0)
+    {
+        switcherHoldDelay = std::chrono::milliseconds(options.holdDelayMs);
+    }
+    mainThreadId = GetCurrentThreadId();
+    // creates the thread's message queue so the reconcile thread can post to it
+    MSG unused;
+    PeekMessage(&unused, nullptr, WM_USER, WM_USER, PM_NOREMOVE);
+    set_window_backend(&win32_backend());
+#else
+    FakeBackend fakeBackend;
+    if (const char* fake_windows = std::getenv("FMW_FAKE_WINDOWS"))
+    {
+        fakeBackend.load(fake_windows);
+    }
+    else
+    {
+        fakeBackend.load_sample();
+    }
+    set_window_backend(&fakeBackend);
+#endif
 
+    if (!options.recordPath.empty())
+    {
+        trace_start(options.recordPath);
+    }
+
+#ifndef FMW_HEADLESS
+    set_low_latency_present(options.lowLatency);
+    if (options.latencyProbe > 0)
+    {
+        // the switcher on the current list, opened, driven and closed by synthetic
+        // presses rather than the hotkey
+        LatencyProbe probe;
+        for (int opening = 0; opening < std::max(options.probeOpenings, 1); ++opening)
+        {
+            load_window_list();
+            std::vector<WindowInfo> entries = availableWindows;
+            resolve_window_fields(window_backend(), entries, FIELD_TITLE | FIELD_PROCESS);
+            SwitcherOpen open;
+            open.latencyProbe = options.latencyProbe;
+            open.probe = &probe;
+            launch_gui(std::move(entries), open);
+        }
+        gui_release();
+
+        std::cout << "input to photon, " << (options.lowLatency ? "low latency" : "vsync") << ":\n" << probe.report();
+        // the full report is too long for a log line
+        LOG_INFO("Input to photon ({}): p90 open {} us, navigate {} us, close {} us",
+                 options.lowLatency ? "low latency" : "vsync", probe.percentiles(ProbePhase::Open).p90.count(),
+                 probe.percentiles(ProbePhase::Navigate).p90.count(), probe.percentiles(ProbePhase::Close).p90.count());
+        int result = 0;
+        for (const auto& [phase, budget] : options.latencyBudgets)
+        {
+            const auto p90 = probe.percentiles(phase).p90;
+            if (p90 <= budget) continue;
+
+            std::cout << probe_phase_name(phase) << " p90 " << p90.count() << " us is over its budget of "
+                << budget.count() << " ms\n";
+            result = 1;
+        }
+        trace_stop();
+        log_stop();
+        return result;
+    }
+#endif
+
+    // serve a real list from the first request on, from the last session's
+    // snapshot when its windows are still around
+    std::vector<WindowInfo> restored;
+    const bool warm = restore_state(FIND_MY_WIN_STATE, window_backend(), restored);
+    if (warm)
+    {
+        apply_window_list(std::move(restored));
+#ifdef _WIN32
+        start_reconcile();
+#endif
+    }
+    else
+    {
+        load_window_list();
+    }
+    const bool serving = ipc_server_start(options.socketPath, post_focus, post_resolve);
+
+#ifdef _WIN32
+    actions_start(make_win32_backend, on_action_done);
+#ifndef FMW_HEADLESS
+    // only the switcher shows tabs, resource usage and installed apps, the tab
+    // crawler and the app index start with the message loop's residency policy
+    set_usage_sampler(make_nt_sampler);
+#endif
+#else
+    // the fake backend is shared with the worker, the timer refresh picks up the changes
+    actions_start(nullptr, nullptr);
+#endif
+
+#ifdef _WIN32
     if (RegisterGlobalHotkey())
     {
+        LOG_INFO("Ready {} ms after start ({})", elapsed_ms(), warm ? "restored snapshot" : "cold enumeration");
         MessageLoop();
         UnregisterGlobalHotkey();
     }
+#else
+    LOG_INFO("Ready {} ms after start ({})", elapsed_ms(), warm ? "restored snapshot" : "cold enumeration");
+    HeadlessLoop();
+#endif
+
+    actions_stop();
+    tab_crawler_stop();
+    app_index_stop();
+
+    if (serving)
+    {
+        ipc_server_stop();
+    }
+
+    save_state_if_due(true);
+
+    for (const StageStats& stage : eligibility_stats())
+    {
+        LOG_INFO("Alt-tab stage {}: {} of {} windows rejected in {} us", stage.name, stage.rejected, stage.checked,
+                 stage.nanoseconds / 1000);
+    }
+    const WindowFieldStats fetched = window_field_stats();
+    LOG_INFO("Fetched {} titles, {} classes, {} pids, {} process names and {} desktops, walked {} UWP frames",
+             fetched.titles, fetched.classNames, fetched.processIds, fetched.processNames, fetched.desktops,
+             fetched.childWalks);
+
+    if (const LatencyStats present = present_latency_stats(); present.count > 0)
+    {
+        LOG_INFO("Switcher input to present: {} inputs in {} us on average (max {})", present.count,
+                 present.totalMicroseconds / present.count, present.maxMicroseconds);
+    }
+
+    const QuickSwitchStats quick = quick_switch_stats();
+    if (quick.tapToActivation.count > 0 || quick.switcherOpen.count > 0)
+    {
+        LOG_INFO("Switched on {} taps in {} us on average (max {}), opened the switcher {} times in {} us (max {})",
+                 quick.tapToActivation.count,
+                 quick.tapToActivation.totalMicroseconds / std::max<uint64_t>(quick.tapToActivation.count, 1),
+                 quick.tapToActivation.maxMicroseconds, quick.switcherOpen.count,
+                 quick.switcherOpen.totalMicroseconds / std::max<uint64_t>(quick.switcherOpen.count, 1),
+                 quick.switcherOpen.maxMicroseconds);
+    }
+
+    if (const PredictionStats prediction = transition_model().stats(); prediction.predictions > 0)
+    {
+        LOG_INFO("Predicted the next window for {} of {} switches", prediction.hits, prediction.predictions);
+    }
 
+    trace_stop();
+    log_stop();
     return 0;
 }
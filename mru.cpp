@@ -0,0 +1,175 @@
+#include "mru.h"
+
+#include <algorithm>
+
+static_assert((MruStack::capacity & (MruStack::capacity - 1)) == 0);
+
+static size_t home_slot(const HWND hwnd, const size_t mask)
+{
+    // handles are small multiples of 2 or 4, the multiply spreads them over the table
+    const uint64_t h = reinterpret_cast<uintptr_t>(hwnd) * 0x9E3779B97F4A7C15ull;
+    return static_cast<size_t>(h >> 32) & mask;
+}
+
+MruStack::MruStack()
+{
+    clear();
+}
+
+void MruStack::clear()
+{
+    std::fill(std::begin(table), std::end(table), none);
+    for (uint32_t i = 0; i < capacity; ++i)
+    {
+        nodes[i] = Node{nullptr, none, i + 1 < capacity ? i + 1 : none};
+    }
+    freeNodes = 0;
+    head = none;
+    tail = none;
+    count = 0;
+}
+
+uint32_t MruStack::find(const HWND hwnd) const
+{
+    constexpr size_t mask = table_size - 1;
+    // the table is at most half full, so an empty slot always ends the probe
+    for (size_t slot = home_slot(hwnd, mask);; slot = (slot + 1) & mask)
+    {
+        const uint32_t node = table[slot];
+        if (node == none || nodes[node].hwnd == hwnd) return node;
+    }
+}
+
+void MruStack::unlink(const uint32_t node)
+{
+    Node& entry = nodes[node];
+    if (entry.prev != none) nodes[entry.prev].next = entry.next;
+    else head = entry.next;
+    if (entry.next != none) nodes[entry.next].prev = entry.prev;
+    else tail = entry.prev;
+    entry.prev = none;
+    entry.next = none;
+}
+
+void MruStack::push_front(const uint32_t node)
+{
+    nodes[node].prev = none;
+    nodes[node].next = head;
+    if (head != none) nodes[head].prev = node;
+    head = node;
+    if (tail == none) tail = node;
+}
+
+void MruStack::table_insert(const uint32_t node)
+{
+    constexpr size_t mask = table_size - 1;
+    size_t slot = home_slot(nodes[node].hwnd, mask);
+    while (table[slot] != none)
+    {
+        slot = (slot + 1) & mask;
+    }
+    table[slot] = node;
+}
+
+// Backward shift deletion, later entries of the probe move up so no tombstones pile up
+void MruStack::table_erase(const HWND hwnd)
+{
+    constexpr size_t mask = table_size - 1;
+    size_t hole = home_slot(hwnd, mask);
+    while (table[hole] != none && nodes[table[hole]].hwnd != hwnd)
+    {
+        hole = (hole + 1) & mask;
+    }
+    if (table[hole] == none) return;
+
+    for (size_t slot = (hole + 1) & mask; table[slot] != none; slot = (slot + 1) & mask)
+    {
+        const size_t home = home_slot(nodes[table[slot]].hwnd, mask);
+        // the entry may fill the hole unless its home lies cyclically in (hole, slot]
+        const bool stays = hole <= slot ? hole < home && home <= slot : hole < home || home <= slot;
+        if (!stays)
+        {
+            table[hole] = table[slot];
+            hole = slot;
+        }
+    }
+    table[hole] = none;
+}
+
+void MruStack::touch(const HWND hwnd)
+{
+    if (!hwnd) return;
+
+    uint32_t node = find(hwnd);
+    if (node != none)
+    {
+        if (node != head)
+        {
+            unlink(node);
+            push_front(node);
+        }
+        return;
+    }
+
+    if (freeNodes == none)
+    {
+        remove(nodes[tail].hwnd);
+    }
+    node = freeNodes;
+    freeNodes = nodes[node].next;
+
+    nodes[node].hwnd = hwnd;
+    table_insert(node);
+    push_front(node);
+    ++count;
+}
+
+void MruStack::remove(const HWND hwnd)
+{
+    const uint32_t node = find(hwnd);
+    if (node == none) return;
+
+    unlink(node);
+    table_erase(hwnd);
+    nodes[node].hwnd = nullptr;
+    nodes[node].next = freeNodes;
+    freeNodes = node;
+    --count;
+}
+
+HWND MruStack::previous(const HWND current) const
+{
+    for (uint32_t node = head; node != none; node = nodes[node].next)
+    {
+        // at most the second node, current is either the front or not in front at all
+        if (nodes[node].hwnd != current) return nodes[node].hwnd;
+    }
+    return nullptr;
+}
+
+HWND MruStack::front() const
+{
+    return head == none ? nullptr : nodes[head].hwnd;
+}
+
+size_t MruStack::size() const
+{
+    return count;
+}
+
+std::vector<HWND> MruStack::order() const
+{
+    std::vector<HWND> out;
+    out.reserve(count);
+    for (uint32_t node = head; node != none; node = nodes[node].next)
+    {
+        out.push_back(nodes[node].hwnd);
+    }
+    return out;
+}
+
+MruStack& mru_stack()
+{
+    static MruStack stack;
+    return stack;
+}
@@ -0,0 +1,69 @@
+#ifndef FINDMYWINDOWS_MRU_H
+#define FINDMYWINDOWS_MRU_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "platform.h"
+
+// Windows by when they last had the focus, most recent first. A doubly linked
+// list threaded through a fixed node array, found through an open addressing
+// table on the handle, so moving a window to the front and dropping a destroyed
+// one are constant time and the stack never allocates after construction.
+class MruStack
+{
+public:
+    static constexpr size_t capacity = 4096;
+
+    MruStack();
+
+    // Moves hwnd to the front, adding it when new. When full the least recently
+    // focused window makes room.
+    void touch(HWND hwnd);
+
+    // Drops a destroyed window, unknown handles are ignored
+    void remove(HWND hwnd);
+
+    // The most recently focused window other than current, null when there is none
+    HWND previous(HWND current) const;
+
+    HWND front() const;
+    size_t size() const;
+
+    // Front to back
+    std::vector<HWND> order() const;
+
+    void clear();
+
+private:
+    static constexpr uint32_t none = UINT32_MAX;
+    static constexpr size_t table_size = capacity * 2;
+
+    struct Node
+    {
+        HWND hwnd = nullptr;
+        uint32_t prev = none;
+        uint32_t next = none;
+    };
+
+    uint32_t find(HWND hwnd) const;
+    void unlink(uint32_t node);
+    void push_front(uint32_t node);
+    void table_insert(uint32_t node);
+    void table_erase(HWND hwnd);
+
+    Node nodes[capacity];
+    // node index per slot, none when the slot is empty
+    uint32_t table[table_size];
+    uint32_t head = none;
+    uint32_t tail = none;
+    // unused nodes, chained through next
+    uint32_t freeNodes = 0;
+    size_t count = 0;
+};
+
+// Fed from the foreground and destroy notifications and from BringWindowToFront(), main thread only
+MruStack& mru_stack();
+
+#endif //FINDMYWINDOWS_MRU_H
@@ -0,0 +1,24 @@
+#ifndef FINDMYWINDOWS_PLATFORM_H
+#define FINDMYWINDOWS_PLATFORM_H
+
+// The handful of Win32 types the portable code passes around. Off-Windows they
+// are opaque stand-ins so the list, ordering and IPC code builds unchanged.
+#ifdef _WIN32
+#include <windows.h>
+#include <dwmapi.h>
+#else
+#include <cstdint>
+
+struct HWND__;
+typedef HWND__* HWND;
+typedef uint32_t DWORD;
+
+#define WS_EX_TOOLWINDOW 0x00000080L
+#define WS_EX_APPWINDOW 0x00040000L
+
+#define DWM_CLOAKED_APP 0x1
+#define DWM_CLOAKED_SHELL 0x2
+#define DWM_CLOAKED_INHERITED 0x4
+#endif
+
+#endif //FINDMYWINDOWS_PLATFORM_H
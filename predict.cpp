@@ -0,0 +1,139 @@
+#include "predict.h"
+
+#include <cmath>
+
+// a count halves every this many switches away from the same window
+constexpr float half_life = 8.0f;
+// slots looked at for a source, the oldest one in the window is evicted when all are taken
+constexpr size_t probe_length = 8;
+
+static_assert((TransitionModel::source_capacity & (TransitionModel::source_capacity - 1)) == 0);
+
+static size_t slot_of(const HWND hwnd)
+{
+    // handles are small multiples of 2 or 4, the multiply spreads them over the table
+    const uint64_t h = reinterpret_cast<uintptr_t>(hwnd) * 0x9E3779B97F4A7C15ull;
+    return static_cast<size_t>(h >> 32) & (TransitionModel::source_capacity - 1);
+}
+
+float TransitionModel::weight_now(const Source& source, const Successor& successor)
+{
+    return successor.weight * std::exp2(-static_cast<float>(source.switches - successor.tick) / half_life);
+}
+
+const TransitionModel::Source* TransitionModel::find(const HWND from) const
+{
+    const size_t start = slot_of(from);
+    for (size_t i = 0; i < probe_length; ++i)
+    {
+        const Source& source = sources[(start + i) & (source_capacity - 1)];
+        if (source.hwnd == from) return &source;
+    }
+    return nullptr;
+}
+
+TransitionModel::Source& TransitionModel::find_or_evict(const HWND from)
+{
+    const size_t start = slot_of(from);
+    Source* victim = nullptr;
+    for (size_t i = 0; i < probe_length; ++i)
+    {
+        Source& source = sources[(start + i) & (source_capacity - 1)];
+        if (source.hwnd == from) return source;
+
+        if (!victim || (victim->hwnd && (!source.hwnd || source.lastUsed < victim->lastUsed)))
+        {
+            victim = &source;
+        }
+    }
+
+    *victim = Source{};
+    victim->hwnd = from;
+    return *victim;
+}
+
+void TransitionModel::record(const HWND from, const HWND to)
+{
+    if (!from || !to || from == to) return;
+
+    if (const HWND predicted = predict(from))
+    {
+        ++counters.predictions;
+        if (predicted == to) ++counters.hits;
+    }
+
+    ++tick;
+    Source& source = find_or_evict(from);
+    source.lastUsed = tick;
+    ++source.switches;
+
+    // bump the successor, or take the slot of the weakest one
+    Successor* target = nullptr;
+    float targetWeight = 0;
+    for (Successor& successor : source.next)
+    {
+        if (successor.hwnd == to)
+        {
+            target = &successor;
+            targetWeight = weight_now(source, successor);
+            break;
+        }
+
+        const float weight = successor.hwnd ? weight_now(source, successor) : -1.0f;
+        if (!target || weight < targetWeight)
+        {
+            target = &successor;
+            targetWeight = weight;
+        }
+    }
+
+    if (target->hwnd != to)
+    {
+        target->hwnd = to;
+        targetWeight = 0;
+    }
+    target->weight = targetWeight + 1.0f;
+    target->tick = source.switches;
+}
+
+HWND TransitionModel::predict(const HWND from) const
+{
+    const Source* source = from ? find(from) : nullptr;
+    if (!source) return nullptr;
+
+    HWND best = nullptr;
+    float bestWeight = 0;
+    for (const Successor& successor : source->next)
+    {
+        if (!successor.hwnd) continue;
+
+        const float weight = weight_now(*source, successor);
+        if (weight > bestWeight)
+        {
+            best = successor.hwnd;
+            bestWeight = weight;
+        }
+    }
+    return best;
+}
+
+PredictionStats TransitionModel::stats() const
+{
+    return counters;
+}
+
+void TransitionModel::clear()
+{
+    for (Source& source : sources)
+    {
+        source = Source{};
+    }
+    tick = 0;
+    counters = {};
+}
+
+TransitionModel& transition_model()
+{
+    static TransitionModel model;
+    return model;
+}
@@ -0,0 +1,68 @@
+#ifndef FINDMYWINDOWS_PREDICT_H
+#define FINDMYWINDOWS_PREDICT_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "platform.h"
+
+struct PredictionStats
+{
+    // switches whose source window had a prediction, and how many of those it got right
+    uint64_t predictions = 0;
+    uint64_t hits = 0;
+};
+
+// Order-1 Markov model over window handles: which window the user switches to
+// from which. Counts decay with a half-life measured in switches away from the
+// same window, so a new habit there takes over after a handful of them while a
+// window left alone for a day keeps what it learned.
+// Fixed-size tables, record() and predict() touch one source entry and its
+// few successors, so both are constant time and the model never grows.
+class TransitionModel
+{
+public:
+    static constexpr size_t source_capacity = 512;
+    static constexpr size_t successors_per_source = 4;
+
+    // from may be null, e.g. nothing had focus. Switches to the same window are ignored.
+    void record(HWND from, HWND to);
+
+    // Most likely next window after from, null when no switch away from it is known
+    HWND predict(HWND from) const;
+
+    PredictionStats stats() const;
+
+    void clear();
+
+private:
+    struct Successor
+    {
+        HWND hwnd = nullptr;
+        float weight = 0;
+        uint32_t tick = 0;
+    };
+
+    struct Source
+    {
+        HWND hwnd = nullptr;
+        uint32_t lastUsed = 0;
+        // switches away from hwnd, the clock its successors decay on
+        uint32_t switches = 0;
+        Successor next[successors_per_source];
+    };
+
+    const Source* find(HWND from) const;
+    Source& find_or_evict(HWND from);
+    static float weight_now(const Source& source, const Successor& successor);
+
+    Source sources[source_capacity];
+    // switches recorded so far, for picking the least recently used source to evict
+    uint32_t tick = 0;
+    PredictionStats counters;
+};
+
+// The model trained by BringWindowToFront(), main thread only
+TransitionModel& transition_model();
+
+#endif //FINDMYWINDOWS_PREDICT_H
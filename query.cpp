@@ -0,0 +1,429 @@
+#include "query.h"
+
+#include <algorithm>
+#include <charconv>
+
+static char fold(const char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+static bool is_space(const char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+// Cheapest first: integer compares, then the short names, then titles
+static uint32_t field_cost(const WindowQuery::Field field)
+{
+    switch (field)
+    {
+    case WindowQuery::Field::Desktop:
+    case WindowQuery::Field::Pid:
+        return 0;
+    case WindowQuery::Field::Process:
+    case WindowQuery::Field::Class:
+    case WindowQuery::Field::Package:
+        return 2;
+    case WindowQuery::Field::Title:
+        return 4;
+    case WindowQuery::Field::Any:
+        return 6;
+    }
+    return 6;
+}
+
+static WindowFields field_needs(const WindowQuery::Field field)
+{
+    switch (field)
+    {
+    case WindowQuery::Field::Desktop:
+        return 0;
+    case WindowQuery::Field::Pid:
+    case WindowQuery::Field::Process:
+    case WindowQuery::Field::Package:
+        return FIELD_PROCESS;
+    case WindowQuery::Field::Class:
+        return FIELD_CLASS;
+    case WindowQuery::Field::Title:
+        return FIELD_TITLE;
+    case WindowQuery::Field::Any:
+        return FIELD_TITLE | FIELD_PROCESS;
+    }
+    return ALL_WINDOW_FIELDS;
+}
+
+static const char* field_name(const WindowQuery::Field field)
+{
+    static constexpr const char* names[] = {"desktop", "pid", "proc", "class", "package", "title", "any"};
+    return names[static_cast<size_t>(field)];
+}
+
+static bool parse_field(const std::string_view name, WindowQuery::Field& field)
+{
+    static constexpr std::pair<std::string_view, WindowQuery::Field> fields[] = {
+        {"proc", WindowQuery::Field::Process}, {"process", WindowQuery::Field::Process},
+        {"class", WindowQuery::Field::Class}, {"title", WindowQuery::Field::Title},
+        {"package", WindowQuery::Field::Package}, {"pid", WindowQuery::Field::Pid},
+        {"desktop", WindowQuery::Field::Desktop},
+    };
+    const auto it = std::ranges::find(fields, name, &std::pair<std::string_view, WindowQuery::Field>::first);
+    if (it == std::end(fields)) return false;
+
+    field = it->second;
+    return true;
+}
+
+// needle is folded already
+static bool contains_folded(const std::string_view text, const std::string_view needle)
+{
+    if (needle.size() > text.size()) return false;
+
+    const char first = needle.front();
+    for (size_t i = 0; i + needle.size() <= text.size(); ++i)
+    {
+        if (fold(text[i]) != first) continue;
+
+        size_t j = 1;
+        while (j < needle.size() && fold(text[i + j]) == needle[j]) ++j;
+        if (j == needle.size()) return true;
+    }
+    return false;
+}
+
+// pattern is folded and matches anywhere, as if it began and ended with *.
+// Backtracks to the last * only, which is enough for * and ? and never recurses.
+static bool glob_anywhere(const std::string_view text, const std::string_view pattern)
+{
+    size_t t = 0;
+    size_t p = 0;
+    // the implicit leading * is where matching restarts
+    size_t starP = 0;
+    size_t starT = 0;
+    while (p < pattern.size())
+    {
+        if (pattern[p] == '*')
+        {
+            starP = ++p;
+            starT = t;
+            continue;
+        }
+        if (t < text.size() && (pattern[p] == '?' || fold(text[t]) == pattern[p]))
+        {
+            ++p;
+            ++t;
+            continue;
+        }
+        if (starT >= text.size()) return false;
+
+        p = starP;
+        t = ++starT;
+    }
+    return true;
+}
+
+bool WindowQuery::compile(const std::string_view text)
+{
+    program.clear();
+    patterns.clear();
+    terms.clear();
+    errorText = "";
+    needed = 0;
+
+    if (!parse(text))
+    {
+        program.clear();
+        needed = 0;
+        return false;
+    }
+    emit();
+    return true;
+}
+
+bool WindowQuery::add_term(const bool negate, const Field field, const std::string_view value, const uint32_t clause)
+{
+    Term term{Op::Contains, field, negate, 0, 0, clause, field_cost(field)};
+    if (value.empty())
+    {
+        errorText = "a field needs a value after the colon";
+        return false;
+    }
+
+    if (field == Field::Desktop)
+    {
+        const auto is = [&](const std::string_view word)
+        {
+            return std::ranges::equal(value, word, [](const char a, const char b) { return fold(a) == b; });
+        };
+        if (!is("current") && !is("other"))
+        {
+            errorText = "desktop: is current or other";
+            return false;
+        }
+        term.op = Op::Desktop;
+        term.arg = is("current");
+    }
+    else if (field == Field::Pid)
+    {
+        const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), term.arg);
+        if (ec != std::errc() || end != value.data() + value.size())
+        {
+            errorText = "pid: needs a number";
+            return false;
+        }
+        term.op = Op::Pid;
+    }
+    else
+    {
+        if (value.find_first_of("*?") != std::string_view::npos)
+        {
+            term.op = Op::Glob;
+            term.cost += 1;
+        }
+        term.arg = static_cast<uint32_t>(patterns.size());
+        term.length = static_cast<uint32_t>(value.size());
+        for (const char c : value)
+        {
+            patterns.push_back(fold(c));
+        }
+    }
+
+    needed |= field_needs(field);
+    terms.push_back(term);
+    return true;
+}
+
+bool WindowQuery::parse(const std::string_view text)
+{
+    uint32_t clause = 0;
+    bool orPending = false;
+    size_t i = 0;
+    while (true)
+    {
+        while (i < text.size() && is_space(text[i])) ++i;
+        if (i == text.size()) break;
+
+        size_t end = i;
+        while (end < text.size() && !is_space(text[end])) ++end;
+        if (text.substr(i, end - i) == "OR")
+        {
+            if (terms.empty() || orPending)
+            {
+                errorText = "OR needs a term on both sides";
+                return false;
+            }
+            orPending = true;
+            i = end;
+            continue;
+        }
+
+        const bool negate = text[i] == '-' && i + 1 < text.size() && !is_space(text[i + 1]);
+        if (negate) ++i;
+
+        // field: prefix, anything else before a colon is part of the text
+        Field field = Field::Any;
+        const size_t colon = text.find(':', i);
+        if (colon != std::string_view::npos && colon < end && parse_field(text.substr(i, colon - i), field))
+        {
+            i = colon + 1;
+        }
+
+        std::string_view value;
+        if (i < text.size() && text[i] == '"')
+        {
+            const size_t close = text.find('"', i + 1);
+            if (close == std::string_view::npos)
+            {
+                errorText = "unterminated \"";
+                return false;
+            }
+            value = text.substr(i + 1, close - i - 1);
+            i = close + 1;
+        }
+        else
+        {
+            end = i;
+            while (end < text.size() && !is_space(text[end])) ++end;
+            value = text.substr(i, end - i);
+            i = end;
+        }
+
+        if (!terms.empty() && !orPending) ++clause;
+        orPending = false;
+        if (!add_term(negate, field, value, clause)) return false;
+    }
+
+    if (orPending)
+    {
+        errorText = "OR needs a term on both sides";
+        return false;
+    }
+    return true;
+}
+
+void WindowQuery::emit()
+{
+    if (terms.empty()) return;
+
+    // clauses are ANDed and the terms of one ORed, so both can run in any order
+    clauseCosts.assign(terms.back().clause + 1, 0);
+    for (const Term& term : terms)
+    {
+        clauseCosts[term.clause] += term.cost;
+    }
+    const auto before = [&](const Term& a, const Term& b)
+    {
+        if (clauseCosts[a.clause] != clauseCosts[b.clause]) return clauseCosts[a.clause] < clauseCosts[b.clause];
+        if (a.clause != b.clause) return a.clause < b.clause;
+        return a.cost < b.cost;
+    };
+    // insertion sort, stable and without the buffer std::stable_sort allocates, a
+    // typed query has a handful of terms
+    for (size_t i = 1; i < terms.size(); ++i)
+    {
+        const Term term = terms[i];
+        size_t j = i;
+        for (; j > 0 && before(term, terms[j - 1]); --j)
+        {
+            terms[j] = terms[j - 1];
+        }
+        terms[j] = term;
+    }
+
+    program.reserve(terms.size());
+    for (size_t begin = 0; begin < terms.size();)
+    {
+        size_t end = begin;
+        while (end < terms.size() && terms[end].clause == terms[begin].clause) ++end;
+
+        // true moves on to the next clause, false to the next alternative
+        const uint32_t next = end < terms.size() ? static_cast<uint32_t>(end) : accept;
+        for (size_t i = begin; i < end; ++i)
+        {
+            const Term& term = terms[i];
+            program.push_back({
+                term.op, term.field, term.negate, term.arg, term.length, next,
+                i + 1 < end ? static_cast<uint32_t>(i + 1) : reject,
+            });
+        }
+        begin = end;
+    }
+}
+
+bool WindowQuery::test(const Instruction& instruction, const Subject& subject) const
+{
+    switch (instruction.op)
+    {
+    case Op::Desktop:
+        return subject.desktop == static_cast<int>(instruction.arg);
+    case Op::Pid:
+        return subject.processId != 0 && subject.processId == instruction.arg;
+    case Op::Contains:
+    case Op::Glob:
+        break;
+    }
+
+    const std::string_view pattern(patterns.data() + instruction.arg, instruction.length);
+    const auto match = [&](const std::string_view value)
+    {
+        return instruction.op == Op::Glob ? glob_anywhere(value, pattern) : contains_folded(value, pattern);
+    };
+    switch (instruction.field)
+    {
+    case Field::Process:
+        return match(subject.process);
+    case Field::Class:
+        return match(subject.className);
+    case Field::Package:
+        return match(subject.package);
+    case Field::Title:
+        return match(subject.title);
+    case Field::Any:
+        return match(subject.title) || match(subject.process);
+    default:
+        return false;
+    }
+}
+
+bool WindowQuery::run(const Subject& subject) const
+{
+    uint32_t pc = program.empty() ? accept : 0;
+    while (pc < program.size())
+    {
+        const Instruction& instruction = program[pc];
+        pc = test(instruction, subject) != instruction.negate ? instruction.onTrue : instruction.onFalse;
+    }
+    return pc == accept;
+}
+
+bool WindowQuery::matches(const WindowInfo& window) const
+{
+    return run({window.title, window.processName, window.className, window.package, window.processId,
+                window.isOnCurrentDesktop ? 1 : 0});
+}
+
+bool WindowQuery::matches_app(const std::string_view name, const std::string_view command) const
+{
+    return run({name, command, {}, {}, 0, -1});
+}
+
+WindowFields WindowQuery::fields() const
+{
+    return needed;
+}
+
+bool WindowQuery::empty() const
+{
+    return program.empty();
+}
+
+const char* WindowQuery::error() const
+{
+    return errorText;
+}
+
+std::vector<WindowQuery::Field> WindowQuery::plan() const
+{
+    std::vector<Field> fields;
+    fields.reserve(program.size());
+    for (const Instruction& instruction : program)
+    {
+        fields.push_back(instruction.field);
+    }
+    return fields;
+}
+
+std::string WindowQuery::disassemble() const
+{
+    const auto target = [](const uint32_t pc)
+    {
+        return pc == accept ? std::string("accept") : pc == reject ? std::string("reject") : std::to_string(pc);
+    };
+
+    std::string out;
+    for (size_t pc = 0; pc < program.size(); ++pc)
+    {
+        const Instruction& instruction = program[pc];
+        out += std::to_string(pc);
+        out += ": ";
+        if (instruction.negate) out += "not ";
+        out += field_name(instruction.field);
+        switch (instruction.op)
+        {
+        case Op::Desktop:
+            out += instruction.arg ? " is current" : " is other";
+            break;
+        case Op::Pid:
+            out += " = " + std::to_string(instruction.arg);
+            break;
+        case Op::Contains:
+        case Op::Glob:
+            out += instruction.op == Op::Glob ? " glob \"" : " contains \"";
+            out.append(patterns, instruction.arg, instruction.length);
+            out += '"';
+            break;
+        }
+        out += " ? " + target(instruction.onTrue) + " : " + target(instruction.onFalse) + "\n";
+    }
+    return out;
+}
@@ -0,0 +1,129 @@
+#ifndef FINDMYWINDOWS_QUERY_H
+#define FINDMYWINDOWS_QUERY_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "tabs.h"
+
+// Switcher filter and IPC find queries:
+//
+//   proc:code title:"*.cpp" desktop:current -class:ConsoleWindowClass
+//
+// Terms are field:value, all of them have to match. A bare word matches the title
+// or the process. Values match anywhere in the field, ignoring case for ASCII,
+// with * and ? as wildcards, and are quoted when they hold spaces. Fields are
+// proc (process), class, title, package, pid and desktop (current or other).
+// A leading - negates a term and OR between terms makes either one do.
+class WindowQuery
+{
+public:
+    // Replaces the query, an empty one matches every window. On a syntax error the
+    // query matches every window and error() says what is wrong. Reuses the
+    // buffers of the previous query.
+    bool compile(std::string_view text);
+
+    // Runs the program over window, never allocates
+    bool matches(const WindowInfo& window) const;
+    // Same for an installed app: title terms test its name, proc terms its
+    // command. It has no class, package, pid or desktop.
+    bool matches_app(std::string_view name, std::string_view command) const;
+
+    // What matches() looks at, lazily listed windows need these filled in
+    WindowFields fields() const;
+
+    bool empty() const;
+    // "" when the query compiled
+    const char* error() const;
+
+    // One instruction per line, for the log and the benchmarks
+    std::string disassemble() const;
+
+    enum class Field : uint8_t
+    {
+        Desktop,
+        Pid,
+        Process,
+        Class,
+        Package,
+        Title,
+        // a bare word, title or process
+        Any,
+    };
+
+    // Field tested by each instruction, in execution order
+    std::vector<Field> plan() const;
+
+private:
+    enum class Op : uint8_t
+    {
+        // arg is 1 for current, 0 for other
+        Desktop,
+        // arg is the pid
+        Pid,
+        // arg and length are the folded needle in patterns
+        Contains,
+        // same, with * and ? in it
+        Glob,
+    };
+
+    static constexpr uint32_t accept = UINT32_MAX - 1;
+    static constexpr uint32_t reject = UINT32_MAX;
+
+    // Every term is one instruction. A result jumps to the next instruction or to
+    // accept/reject, which is what makes the evaluation short-circuit.
+    struct Instruction
+    {
+        Op op;
+        Field field;
+        bool negate;
+        uint32_t arg;
+        uint32_t length;
+        uint32_t onTrue;
+        uint32_t onFalse;
+    };
+
+    // A parsed term, clause numbers the OR groups the terms are ANDed from
+    struct Term
+    {
+        Op op;
+        Field field;
+        bool negate;
+        uint32_t arg;
+        uint32_t length;
+        uint32_t clause;
+        uint32_t cost;
+    };
+
+    // What the instructions test, a window or an app
+    struct Subject
+    {
+        std::string_view title;
+        std::string_view process;
+        std::string_view className;
+        std::string_view package;
+        DWORD processId;
+        // 1 on the current desktop, 0 on another, -1 on none
+        int desktop;
+    };
+
+    bool parse(std::string_view text);
+    bool add_term(bool negate, Field field, std::string_view value, uint32_t clause);
+    void emit();
+    bool test(const Instruction& instruction, const Subject& subject) const;
+    bool run(const Subject& subject) const;
+
+    std::vector<Instruction> program;
+    // folded needles of every Contains and Glob
+    std::string patterns;
+    WindowFields needed = 0;
+    const char* errorText = "";
+
+    // compile() scratch
+    std::vector<Term> terms;
+    std::vector<uint32_t> clauseCosts;
+};
+
+#endif //FINDMYWINDOWS_QUERY_H
@@ -0,0 +1,84 @@
+#include "quick_switch.h"
+
+#include <algorithm>
+
+QuickSwitch::QuickSwitch(const size_t rows, const int target, const std::chrono::milliseconds holdDelay,
+                         const std::chrono::steady_clock::time_point pressedAt) :
+    rows(rows),
+    selectedRow(rows == 0 ? 0 : std::clamp(target, 0, static_cast<int>(rows) - 1)),
+    holdDelay(holdDelay),
+    pressedAt(pressedAt)
+{
+}
+
+QuickSwitchStep QuickSwitch::update(const ChordState& chord, const std::chrono::steady_clock::time_point now)
+{
+    // presses in between polls still count, even in the poll that sees the release
+    if (chord.presses > presses)
+    {
+        if (rows > 0)
+        {
+            selectedRow = static_cast<int>((selectedRow + (chord.presses - presses)) % rows);
+        }
+        presses = chord.presses;
+    }
+
+    if (!chord.held) return QuickSwitchStep::Activate;
+    if (now - pressedAt >= holdDelay) return QuickSwitchStep::ShowSwitcher;
+    return QuickSwitchStep::Wait;
+}
+
+QuickSwitchStep QuickSwitch::wait(const Poll poll, const Clock now, void (*idle)())
+{
+    while (true)
+    {
+        const QuickSwitchStep step = update(poll(), now());
+        if (step != QuickSwitchStep::Wait) return step;
+        idle();
+    }
+}
+
+int QuickSwitch::selected() const
+{
+    return selectedRow;
+}
+
+int quick_switch_target(const std::vector<WindowInfo>& windows, const HWND foreground, const HWND predicted)
+{
+    if (predicted && predicted != foreground)
+    {
+        const auto it = std::ranges::find(windows, predicted, &WindowInfo::hwnd);
+        if (it != windows.end()) return static_cast<int>(it - windows.begin());
+    }
+
+    const auto it = std::ranges::find_if(windows, [foreground](const WindowInfo& window)
+    {
+        return window.hwnd != foreground && window.tabNode == 0;
+    });
+    return it != windows.end() ? static_cast<int>(it - windows.begin()) : 0;
+}
+
+void LatencyStats::add(const std::chrono::steady_clock::duration latency)
+{
+    const auto us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+    ++count;
+    totalMicroseconds += us;
+    maxMicroseconds = std::max(maxMicroseconds, us);
+}
+
+static QuickSwitchStats stats;
+
+void record_tap_latency(const std::chrono::steady_clock::duration latency)
+{
+    stats.tapToActivation.add(latency);
+}
+
+void record_switcher_latency(const std::chrono::steady_clock::duration latency)
+{
+    stats.switcherOpen.add(latency);
+}
+
+QuickSwitchStats quick_switch_stats()
+{
+    return stats;
+}
@@ -0,0 +1,82 @@
+#ifndef FINDMYWINDOWS_QUICK_SWITCH_H
+#define FINDMYWINDOWS_QUICK_SWITCH_H
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "tabs.h"
+
+// The switcher hotkey chord at one poll
+struct ChordState
+{
+    // the modifiers are still down
+    bool held = false;
+    // trigger key presses since the chord went down, the one that started it included
+    unsigned presses = 0;
+};
+
+enum class QuickSwitchStep
+{
+    Wait,
+    // released before the delay, switch to selected() without a switcher
+    Activate,
+    // held past the delay
+    ShowSwitcher,
+};
+
+// Alt+Tab hold semantics for the switcher hotkey. A tap switches straight to the
+// target, more presses while the chord is held cycle through the rows, and the
+// switcher only opens once the chord is held past holdDelay. Knows nothing of
+// Win32 or ImGui, the caller polls the keyboard.
+class QuickSwitch
+{
+public:
+    using Clock = std::chrono::steady_clock::time_point (*)();
+    using Poll = ChordState (*)();
+
+    QuickSwitch(size_t rows, int target, std::chrono::milliseconds holdDelay,
+                std::chrono::steady_clock::time_point pressedAt);
+
+    QuickSwitchStep update(const ChordState& chord, std::chrono::steady_clock::time_point now);
+
+    // Polls until the step isn't Wait, calling idle between polls
+    QuickSwitchStep wait(Poll poll, Clock now, void (*idle)());
+
+    int selected() const;
+
+private:
+    size_t rows;
+    int selectedRow;
+    unsigned presses = 1;
+    std::chrono::milliseconds holdDelay;
+    std::chrono::steady_clock::time_point pressedAt;
+};
+
+// Where a tap goes: the predicted window when it is listed, otherwise the first
+// window that isn't already in front. 0 for an empty list.
+int quick_switch_target(const std::vector<WindowInfo>& windows, HWND foreground, HWND predicted);
+
+struct LatencyStats
+{
+    uint64_t count = 0;
+    uint64_t totalMicroseconds = 0;
+    uint64_t maxMicroseconds = 0;
+
+    void add(std::chrono::steady_clock::duration latency);
+};
+
+struct QuickSwitchStats
+{
+    // hotkey press to the target activated, for taps
+    LatencyStats tapToActivation;
+    // decision to open to the switcher's first frame, without the hold delay
+    LatencyStats switcherOpen;
+};
+
+// Main thread only, like the hotkeys
+void record_tap_latency(std::chrono::steady_clock::duration latency);
+void record_switcher_latency(std::chrono::steady_clock::duration latency);
+QuickSwitchStats quick_switch_stats();
+
+#endif //FINDMYWINDOWS_QUICK_SWITCH_H
@@ -0,0 +1,60 @@
+#include "refresh.h"
+
+#include <algorithm>
+
+RefreshScheduler::RefreshScheduler(const Refresh refresh, const std::chrono::milliseconds minInterval,
+                                   const std::chrono::milliseconds maxAge, const Clock now) :
+    refresh(refresh), minInterval(minInterval), maxAge(maxAge), now(now)
+{
+}
+
+void RefreshScheduler::mark_dirty()
+{
+    ++counters.requested;
+    dirty = true;
+}
+
+bool RefreshScheduler::run_if_due()
+{
+    if (time_until_due() != std::chrono::milliseconds::zero()) return false;
+
+    run();
+    return true;
+}
+
+bool RefreshScheduler::ensure_fresh()
+{
+    if (!dirty && refreshed && now() - lastRefresh <= maxAge) return false;
+
+    ++counters.forced;
+    run();
+    return true;
+}
+
+std::chrono::milliseconds RefreshScheduler::time_until_due() const
+{
+    if (!dirty) return std::chrono::milliseconds::max();
+    if (!refreshed) return std::chrono::milliseconds::zero();
+
+    const auto elapsed = now() - lastRefresh;
+    if (elapsed >= minInterval) return std::chrono::milliseconds::zero();
+
+    // rounded up, waking a millisecond early would only mean another wait
+    return std::max(std::chrono::ceil<std::chrono::milliseconds>(minInterval - elapsed),
+                    std::chrono::milliseconds(1));
+}
+
+RefreshStats RefreshScheduler::stats() const
+{
+    return counters;
+}
+
+void RefreshScheduler::run()
+{
+    // cleared first, a request made while refreshing still needs a refresh of its own
+    dirty = false;
+    refreshed = true;
+    lastRefresh = now();
+    ++counters.executed;
+    refresh();
+}
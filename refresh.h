@@ -0,0 +1,57 @@
+#ifndef FINDMYWINDOWS_REFRESH_H
+#define FINDMYWINDOWS_REFRESH_H
+
+#include <chrono>
+#include <cstdint>
+
+struct RefreshStats
+{
+    // mark_dirty() calls, and refreshes actually run (forced ones included)
+    uint64_t requested = 0;
+    uint64_t executed = 0;
+    // refreshes run by ensure_fresh() ahead of a hotkey
+    uint64_t forced = 0;
+};
+
+// Coalesces refresh requests so a burst of messages costs one enumeration.
+// Requests only mark the list dirty. run_if_due() refreshes when it is dirty
+// and minInterval has passed since the last refresh, and ensure_fresh() refreshes
+// right away when the list is dirty or older than maxAge, for serving hotkeys.
+// The clock and the refresh are plain function pointers so the behaviour can be
+// driven step by step. Not thread safe, it belongs to the message loop.
+class RefreshScheduler
+{
+public:
+    using Clock = std::chrono::steady_clock::time_point (*)();
+    using Refresh = void (*)();
+
+    RefreshScheduler(Refresh refresh, std::chrono::milliseconds minInterval, std::chrono::milliseconds maxAge,
+                     Clock now = std::chrono::steady_clock::now);
+
+    void mark_dirty();
+
+    // Returns whether it refreshed
+    bool run_if_due();
+    bool ensure_fresh();
+
+    // How long until run_if_due() would refresh, zero when it would now and
+    // milliseconds::max() when the list is clean
+    std::chrono::milliseconds time_until_due() const;
+
+    RefreshStats stats() const;
+
+private:
+    void run();
+
+    Refresh refresh;
+    std::chrono::milliseconds minInterval;
+    std::chrono::milliseconds maxAge;
+    Clock now;
+
+    bool dirty = true;
+    bool refreshed = false;
+    std::chrono::steady_clock::time_point lastRefresh;
+    RefreshStats counters;
+};
+
+#endif //FINDMYWINDOWS_REFRESH_H
@@ -0,0 +1,350 @@
+#include "replay.h"
+#include "fake_backend.h"
+#include "log.h"
+#include "trace.h"
+#include "window_list.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+// counts the calling thread's heap allocations, null leaves them out of the report
+static uint64_t (*allocationCounter)() = nullptr;
+
+static uint64_t allocation_count()
+{
+    return allocationCounter ? allocationCounter() : 0;
+}
+
+static HWND to_hwnd(const uint64_t handle)
+{
+    return reinterpret_cast<HWND>(static_cast<uintptr_t>(handle));
+}
+
+// Makes the fake desktop look the way the recorded one did at this point
+static void apply_event(FakeBackend& backend, const TraceEvent& event)
+{
+    switch (event.type)
+    {
+    case TraceEventType::WindowCreated:
+        backend.add_window({
+            .hwnd = to_hwnd(event.hwnd),
+            .title = event.title,
+            .className = event.className,
+            .processName = event.processName,
+            .processId = event.processId,
+        });
+        break;
+    case TraceEventType::WindowDestroyed:
+        backend.remove_window(to_hwnd(event.hwnd));
+        break;
+    case TraceEventType::WindowRetitled:
+        backend.set_title(to_hwnd(event.hwnd), event.title);
+        break;
+    case TraceEventType::Hotkey:
+    case TraceEventType::Focus:
+        break;
+    }
+}
+
+// The work the resident process does in response, through the same entry points
+static void process_event(const TraceEvent& event)
+{
+    switch (event.type)
+    {
+    case TraceEventType::Hotkey:
+        if (event.shortcut == PREVIOUS_WINDOW_SHORTCUT)
+        {
+            // the one hotkey served without a refresh
+            handle_previous(&availableWindows, event.shortcut);
+            break;
+        }
+        // MessageLoop refreshes before dispatching every hotkey
+        load_window_list();
+        if (event.shortcut >= 1 && event.shortcut <= 7)
+        {
+            handle_sht(&availableWindows, event.shortcut);
+        }
+        break;
+    case TraceEventType::Focus:
+        BringWindowToFront(to_hwnd(event.hwnd));
+        break;
+    default:
+        load_window_list();
+        break;
+    }
+}
+
+struct ReplaySample
+{
+    uint64_t ns;
+    uint64_t allocations;
+    TraceEventType type;
+};
+
+static uint64_t percentile(const std::vector<uint64_t>& sorted, const double p)
+{
+    if (sorted.empty()) return 0;
+    const auto index = static_cast<size_t>(p * static_cast<double>(sorted.size()));
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+static const char* event_name(const TraceEventType type)
+{
+    switch (type)
+    {
+    case TraceEventType::WindowCreated: return "created";
+    case TraceEventType::WindowDestroyed: return "destroyed";
+    case TraceEventType::WindowRetitled: return "retitled";
+    case TraceEventType::Hotkey: return "hotkey";
+    case TraceEventType::Focus: return "focus";
+    }
+    return "?";
+}
+
+static void print_report(const std::vector<ReplaySample>& samples, const double wallSeconds)
+{
+    std::vector<uint64_t> latencies;
+    latencies.reserve(samples.size());
+    uint64_t busyNs = 0;
+    uint64_t allocations = 0;
+    uint64_t maxAllocations = 0;
+    for (const auto& sample : samples)
+    {
+        latencies.push_back(sample.ns);
+        busyNs += sample.ns;
+        allocations += sample.allocations;
+        maxAllocations = std::max(maxAllocations, sample.allocations);
+    }
+    std::ranges::sort(latencies);
+
+    const double events = static_cast<double>(samples.size());
+    printf("events        %zu in %.3f s wall, %.3f s busy\n", samples.size(), wallSeconds, busyNs / 1e9);
+    printf("throughput    %.0f events/s (busy time)\n", busyNs ? events * 1e9 / busyNs : 0.0);
+    printf("latency us    p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+           percentile(latencies, 0.50) / 1e3, percentile(latencies, 0.90) / 1e3,
+           percentile(latencies, 0.99) / 1e3, percentile(latencies, 0.999) / 1e3,
+           latencies.empty() ? 0.0 : latencies.back() / 1e3);
+    if (allocationCounter)
+    {
+        printf("allocations   %.1f per event, max %llu\n", allocations / events,
+               static_cast<unsigned long long>(maxAllocations));
+    }
+
+    for (const auto type : {
+             TraceEventType::WindowCreated, TraceEventType::WindowDestroyed, TraceEventType::WindowRetitled,
+             TraceEventType::Hotkey, TraceEventType::Focus
+         })
+    {
+        std::vector<uint64_t> perType;
+        uint64_t perTypeAllocations = 0;
+        for (const auto& sample : samples)
+        {
+            if (sample.type != type) continue;
+            perType.push_back(sample.ns);
+            perTypeAllocations += sample.allocations;
+        }
+        if (perType.empty()) continue;
+
+        std::ranges::sort(perType);
+        printf("  %-10s %8zu  p50 %8.1f us  p99 %8.1f us", event_name(type), perType.size(),
+               percentile(perType, 0.50) / 1e3, percentile(perType, 0.99) / 1e3);
+        if (allocationCounter)
+        {
+            printf("  %6.1f allocs/event",
+                   static_cast<double>(perTypeAllocations) / static_cast<double>(perType.size()));
+        }
+        printf("\n");
+    }
+}
+
+void set_replay_allocation_counter(uint64_t (*count)())
+{
+    allocationCounter = count;
+}
+
+int run_replay(const std::string& path, const double speed)
+{
+    std::vector<TraceEvent> events;
+    if (!read_trace(path, events))
+    {
+        return 2;
+    }
+    if (events.empty())
+    {
+        printf("%s has no events\n", path.c_str());
+        return 1;
+    }
+
+    FakeBackend backend;
+    set_window_backend(&backend);
+    availableWindows.clear();
+
+    std::vector<ReplaySample> samples;
+    samples.reserve(events.size());
+
+    printf("replaying %s, %zu events at %s\n", path.c_str(), events.size(),
+           speed > 0 ? (std::to_string(speed) + "x").c_str() : "full speed");
+
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto& event : events)
+    {
+        if (speed > 0)
+        {
+            std::this_thread::sleep_until(start + std::chrono::microseconds(
+                static_cast<uint64_t>(static_cast<double>(event.timeUs) / speed)));
+        }
+
+        apply_event(backend, event);
+
+        const uint64_t allocationsBefore = allocation_count();
+        const auto before = std::chrono::steady_clock::now();
+        process_event(event);
+        const auto after = std::chrono::steady_clock::now();
+
+        samples.push_back({
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count()),
+            allocation_count() - allocationsBefore,
+            event.type,
+        });
+    }
+    const double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    print_report(samples, wallSeconds);
+    return 0;
+}
+
+struct SyntheticApp
+{
+    const char* processName;
+    const char* className;
+    const char* title;
+};
+
+static constexpr SyntheticApp synthetic_apps[] = {
+    {"chrome.exe", "Chrome_WidgetWin_1", "New Tab - Google Chrome"},
+    {"Code.exe", "Chrome_WidgetWin_1", "main.cpp - findmywindows - Visual Studio Code"},
+    {"explorer.exe", "CabinetWClass", "Downloads"},
+    {"WindowsTerminal.exe", "CASCADIA_HOSTING_WINDOW_CLASS", "PowerShell"},
+    {"OUTLOOK.EXE", "rctrl_renwnd32", "Inbox - Outlook"},
+    {"ms-teams.exe", "TeamsWebView", "Chat | Microsoft Teams"},
+    {"devenv.exe", "HwndWrapper[DefaultDomain;;]", "findmywindows - Microsoft Visual Studio"},
+    {"slack.exe", "Chrome_WidgetWin_1", "general - Slack"},
+};
+
+bool write_synthetic_trace(const std::string& path, const size_t events, const uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    const auto between = [&](const uint64_t low, const uint64_t high)
+    {
+        return std::uniform_int_distribution<uint64_t>(low, high)(rng);
+    };
+
+    std::vector<TraceEvent> trace;
+    trace.reserve(events + 64);
+    std::vector<TraceEvent> live; // created events of the windows still open
+    uint64_t now = 0;
+    uint64_t nextHandle = 0x20000;
+    DWORD nextProcessId = 4000;
+
+    const auto create = [&](const SyntheticApp& app, std::string title)
+    {
+        TraceEvent event;
+        event.timeUs = now;
+        event.type = TraceEventType::WindowCreated;
+        event.hwnd = nextHandle += 0x10;
+        event.processId = nextProcessId++;
+        event.processName = app.processName;
+        event.className = app.className;
+        event.title = std::move(title);
+        trace.push_back(event);
+        live.push_back(std::move(event));
+    };
+
+    const auto destroy = [&](const size_t index)
+    {
+        TraceEvent event;
+        event.timeUs = now;
+        event.type = TraceEventType::WindowDestroyed;
+        event.hwnd = live[index].hwnd;
+        trace.push_back(event);
+        live.erase(live.begin() + static_cast<std::ptrdiff_t>(index));
+    };
+
+    // the desktop at login
+    for (int i = 0; i < 30; ++i)
+    {
+        const auto& app = synthetic_apps[between(0, std::size(synthetic_apps) - 1)];
+        create(app, app.title);
+        now += between(1000, 50000);
+    }
+
+    while (trace.size() < events)
+    {
+        const uint64_t scenario = between(0, 99);
+        if (scenario < 45)
+        {
+            // a browser or editor retitling itself while tabs load or files change
+            const size_t index = between(0, live.size() - 1);
+            for (uint64_t i = between(5, 30); i > 0; --i)
+            {
+                now += between(5000, 40000);
+                TraceEvent event;
+                event.timeUs = now;
+                event.type = TraceEventType::WindowRetitled;
+                event.hwnd = live[index].hwnd;
+                event.title = live[index].title + " (" + std::to_string(i) + ")";
+                trace.push_back(std::move(event));
+            }
+        }
+        else if (scenario < 60)
+        {
+            // a build spawning compiler consoles and closing them again
+            const uint64_t spawned = between(3, 12);
+            const SyntheticApp compiler{"cl.exe", "ConsoleWindowClass", "cl.exe"};
+            for (uint64_t i = 0; i < spawned; ++i)
+            {
+                now += between(2000, 10000);
+                create(compiler, "cl.exe " + std::to_string(i));
+            }
+            now += between(500000, 3000000);
+            for (uint64_t i = 0; i < spawned; ++i)
+            {
+                now += between(1000, 5000);
+                destroy(live.size() - 1);
+            }
+        }
+        else if (scenario < 85)
+        {
+            now += between(200000, 2000000);
+            TraceEvent event;
+            event.timeUs = now;
+            event.type = TraceEventType::Hotkey;
+            event.shortcut = static_cast<int>(between(1, 7));
+            trace.push_back(std::move(event));
+        }
+        else if (scenario < 95 && live.size() > 10)
+        {
+            now += between(100000, 1000000);
+            if (between(0, 1) == 0)
+            {
+                destroy(between(0, live.size() - 1));
+            }
+            else
+            {
+                const auto& app = synthetic_apps[between(0, std::size(synthetic_apps) - 1)];
+                create(app, app.title);
+            }
+        }
+        else
+        {
+            now += between(1000000, 5000000);
+        }
+    }
+
+    trace.resize(events);
+    return write_trace(path, trace);
+}
@@ -0,0 +1,22 @@
+#ifndef FINDMYWINDOWS_REPLAY_H
+#define FINDMYWINDOWS_REPLAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Feeds a recorded trace through load_window_list() and handle_sht() on top of a
+// FakeBackend and prints throughput, latency percentiles and allocations per event.
+// speed scales the recorded timing (2 replays twice as fast), 0 replays back to back.
+// Returns the process exit code.
+int run_replay(const std::string& path, double speed);
+
+// Counts the calling thread's heap allocations for the report, which leaves them out
+// without one. The app replaces no allocator, the tests pass thread_alloc_count().
+void set_replay_allocation_counter(uint64_t (*count)());
+
+// Writes a bursty synthetic session (tab retitle storms, build tools spawning and
+// closing consoles, Ctrl+N presses) so the harness has input off Windows.
+bool write_synthetic_trace(const std::string& path, size_t events, uint32_t seed);
+
+#endif //FINDMYWINDOWS_REPLAY_H
@@ -0,0 +1,136 @@
+#include "residency.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <utility>
+
+ResidencyPolicy::ResidencyPolicy(const Clock now) : now(now), lastActivity(now())
+{
+}
+
+void ResidencyPolicy::add(const ResidentSubsystem subsystem, const ResidencyBudget budget)
+{
+    // nothing to warm or release, it is simply always there
+    entries.push_back({subsystem, budget, subsystem.release == nullptr});
+}
+
+bool ResidencyPolicy::set_budget(const std::string& name, const ResidencyBudget budget)
+{
+    const auto it = std::ranges::find_if(entries, [&](const Entry& entry) { return name == entry.subsystem.name; });
+    if (it == entries.end()) return false;
+
+    it->budget = budget;
+    return true;
+}
+
+void ResidencyPolicy::note_activity()
+{
+    lastActivity = now();
+    for (Entry& entry : entries)
+    {
+        if (entry.resident) continue;
+
+        if (entry.subsystem.warm) entry.subsystem.warm();
+        entry.resident = true;
+        ++entry.warms;
+    }
+}
+
+bool ResidencyPolicy::cold(const Entry& entry, const std::chrono::steady_clock::time_point at) const
+{
+    return entry.budget.idleAfter.count() > 0 && at - lastActivity >= entry.budget.idleAfter;
+}
+
+size_t ResidencyPolicy::tick()
+{
+    const auto at = now();
+    size_t released = 0;
+    for (Entry& entry : entries)
+    {
+        if (!entry.subsystem.release || !cold(entry, at)) continue;
+        // within budget it stays, a released one that grew back goes again
+        if (entry.subsystem.bytes() <= entry.budget.idleBytes) continue;
+
+        entry.subsystem.release();
+        entry.resident = false;
+        ++entry.releases;
+        ++released;
+    }
+    return released;
+}
+
+std::chrono::milliseconds ResidencyPolicy::time_until_due() const
+{
+    const auto at = now();
+    auto until = std::chrono::milliseconds::max();
+    for (const Entry& entry : entries)
+    {
+        if (!entry.subsystem.release || !entry.resident || entry.budget.idleAfter.count() <= 0 || cold(entry, at))
+        {
+            continue;
+        }
+        until = std::min(until, std::chrono::ceil<std::chrono::milliseconds>(lastActivity + entry.budget.idleAfter - at));
+    }
+    return until;
+}
+
+std::vector<ResidentFootprint> ResidencyPolicy::footprint() const
+{
+    std::vector<ResidentFootprint> out;
+    out.reserve(entries.size());
+    for (const Entry& entry : entries)
+    {
+        out.push_back({entry.subsystem.name, entry.subsystem.bytes(), entry.resident, entry.releases, entry.warms});
+    }
+    return out;
+}
+
+size_t ResidencyPolicy::resident_bytes() const
+{
+    size_t total = 0;
+    for (const Entry& entry : entries)
+    {
+        total += entry.subsystem.bytes();
+    }
+    return total;
+}
+
+static bool parse_number(const std::string_view text, uint64_t& out)
+{
+    const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), out);
+    return ec == std::errc() && end == text.data() + text.size();
+}
+
+bool parse_residency_budget(const std::string_view text, std::string& name, ResidencyBudget& budget)
+{
+    const size_t equals = text.find('=');
+    if (equals == 0 || equals == std::string_view::npos) return false;
+
+    const std::string_view value = text.substr(equals + 1);
+    const size_t colon = value.find(':');
+    uint64_t seconds = 0;
+    uint64_t kilobytes = 0;
+    if (!parse_number(value.substr(0, colon), seconds)) return false;
+    if (colon != std::string_view::npos && !parse_number(value.substr(colon + 1), kilobytes)) return false;
+
+    name = text.substr(0, equals);
+    budget.idleAfter = std::chrono::seconds(seconds);
+    budget.idleBytes = static_cast<size_t>(kilobytes) * 1024;
+    return true;
+}
+
+static std::atomic<std::shared_ptr<const std::vector<ResidentFootprint>>> publishedFootprint{
+    std::make_shared<const std::vector<ResidentFootprint>>()
+};
+
+void publish_footprint(std::vector<ResidentFootprint> footprint)
+{
+    publishedFootprint.store(std::make_shared<const std::vector<ResidentFootprint>>(std::move(footprint)),
+                             std::memory_order_release);
+}
+
+std::shared_ptr<const std::vector<ResidentFootprint>> current_footprint()
+{
+    return publishedFootprint.load(std::memory_order_acquire);
+}
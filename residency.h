@@ -0,0 +1,97 @@
+#ifndef FINDMYWINDOWS_RESIDENCY_H
+#define FINDMYWINDOWS_RESIDENCY_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Something the daemon keeps in memory to answer a hotkey faster. Plain function
+// pointers, the subsystems are process-wide already.
+struct ResidentSubsystem
+{
+    const char* name = "";
+    // what it holds now, its own estimate
+    size_t (*bytes)() = nullptr;
+    // gives back everything it can rebuild, null for a subsystem that is only reported
+    void (*release)() = nullptr;
+    // builds it again ahead of use, null when its next use does that anyway
+    void (*warm)() = nullptr;
+};
+
+struct ResidencyBudget
+{
+    // no activity for this long makes the subsystem cold, zero never does
+    std::chrono::milliseconds idleAfter = std::chrono::minutes(10);
+    // what a cold subsystem may keep, one holding more is released
+    size_t idleBytes = 0;
+};
+
+struct ResidentFootprint
+{
+    std::string name;
+    size_t bytes = 0;
+    bool resident = false;
+    uint64_t releases = 0;
+    uint64_t warms = 0;
+};
+
+// Trades memory for latency over a day of sitting in the background. Activity (a
+// hotkey, input anywhere, the session starting) keeps every subsystem resident;
+// once a subsystem's idleAfter passed without any, tick() releases it unless it
+// holds no more than its idle budget, and keeps doing so if it grows past it
+// while still cold. The next activity warms what was released, ahead of the
+// hotkey that will need it. The clock is a plain function pointer like
+// RefreshScheduler's, not thread safe, it belongs to the message loop, which is
+// also the thread the switcher's window has to be built and torn down on.
+class ResidencyPolicy
+{
+public:
+    using Clock = std::chrono::steady_clock::time_point (*)();
+
+    explicit ResidencyPolicy(Clock now = std::chrono::steady_clock::now);
+
+    // Subsystems that can be released start out released, the first activity warms them
+    void add(ResidentSubsystem subsystem, ResidencyBudget budget);
+    // Budget of an added subsystem, false when there is none by that name
+    bool set_budget(const std::string& name, ResidencyBudget budget);
+
+    // Warms whatever was released, cheap when nothing was
+    void note_activity();
+
+    // Releases the cold subsystems over their budget, returns how many
+    size_t tick();
+    // Until the next subsystem goes cold, milliseconds::max() when none will
+    std::chrono::milliseconds time_until_due() const;
+
+    std::vector<ResidentFootprint> footprint() const;
+    size_t resident_bytes() const;
+
+private:
+    struct Entry
+    {
+        ResidentSubsystem subsystem;
+        ResidencyBudget budget;
+        bool resident = false;
+        uint64_t releases = 0;
+        uint64_t warms = 0;
+    };
+
+    bool cold(const Entry& entry, std::chrono::steady_clock::time_point at) const;
+
+    Clock now;
+    std::chrono::steady_clock::time_point lastActivity;
+    std::vector<Entry> entries;
+};
+
+// "name=<idle seconds>[:<idle KB>]", as --residency takes it
+bool parse_residency_budget(std::string_view text, std::string& name, ResidencyBudget& budget);
+
+// The message loop's footprint as of its last tick, for the IPC server. Never null.
+void publish_footprint(std::vector<ResidentFootprint> footprint);
+std::shared_ptr<const std::vector<ResidentFootprint>> current_footprint();
+
+#endif //FINDMYWINDOWS_RESIDENCY_H
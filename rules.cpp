@@ -0,0 +1,1038 @@
+#include "rules.h"
+#include "log.h"
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+const std::string FIND_MY_WIN_RULES = "findmywindows.rules";
+
+// Appended to the file: the switcher's own window
+static constexpr std::string_view builtin_rules = "exclude title=\"Find My Windows\"\n";
+
+static unsigned char fold(const unsigned char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<unsigned char>(c - 'A' + 'a') : c;
+}
+
+using ByteSet = std::bitset<256>;
+
+// Thompson NFA for all patterns of one field, matched through a DFA that is
+// built one transition at a time as input needs it (the RE2 approach). Input
+// and patterns are ASCII-folded to lower case up front.
+class RuleAutomaton
+{
+public:
+    // Returns the pattern id, or -1 with error set
+    int add(std::string_view pattern, bool regex, std::string& error);
+
+    // Ids of the patterns matching text, in ascending order
+    void match(std::string_view text, std::vector<uint32_t>& accepted);
+
+    size_t patterns() const
+    {
+        return starts.size();
+    }
+
+    size_t states() const
+    {
+        return dfa.size();
+    }
+
+    // Approximate bytes held by the DFA cache
+    size_t memory() const;
+
+private:
+    static constexpr uint32_t none = UINT32_MAX;
+    // the cache is dropped and rebuilt from scratch when it grows past this
+    static constexpr size_t max_dfa_bytes = 8 << 20;
+    static constexpr int32_t dead_state = 0;
+
+    enum class Kind : uint8_t
+    {
+        Bytes,
+        Epsilon,
+        Match,
+    };
+
+    struct NfaState
+    {
+        Kind kind;
+        uint32_t out = none;
+        uint32_t out1 = none;
+        // Bytes: index into sets, Match: pattern id
+        uint32_t arg = 0;
+    };
+
+    struct DfaState
+    {
+        // sorted NFA states, stored once as the dfaIndex key
+        const std::string* nfa;
+        std::vector<uint32_t> accepts;
+    };
+
+    // Fragment under construction, end is an epsilon state whose out is still open
+    struct Fragment
+    {
+        uint32_t start;
+        uint32_t end;
+    };
+
+    struct Parser
+    {
+        std::string_view text;
+        size_t pos = 0;
+        std::string error{};
+
+        bool done() const
+        {
+            return pos >= text.size();
+        }
+
+        unsigned char peek() const
+        {
+            return static_cast<unsigned char>(text[pos]);
+        }
+    };
+
+    uint32_t add_state(Kind kind, uint32_t out = none, uint32_t out1 = none, uint32_t arg = 0);
+    uint32_t epsilon();
+    Fragment bytes(const ByteSet& set);
+    Fragment literal(unsigned char c);
+    Fragment concat(Fragment a, Fragment b);
+    Fragment alternate(Fragment a, Fragment b);
+    Fragment star(Fragment a);
+    Fragment plus(Fragment a);
+    Fragment optional(Fragment a);
+    Fragment any_byte_star();
+    Fragment any_char();
+    Fragment char_class(Parser& parser);
+    Fragment class_fragment(ByteSet set, bool negated);
+
+    bool parse_glob(Parser& parser, Fragment& out);
+    bool parse_alternation(Parser& parser, Fragment& out);
+    bool parse_concat(Parser& parser, Fragment& out);
+    bool parse_repeat(Parser& parser, Fragment& out);
+    bool parse_atom(Parser& parser, Fragment& out);
+
+    void compute_byte_classes();
+    void closure(std::vector<uint32_t>& pending, std::vector<uint32_t>& out);
+    void nfa_states(int32_t state, std::vector<uint32_t>& out) const;
+    int32_t intern(const std::vector<uint32_t>& set);
+    void reset_dfa();
+    int32_t build_next(int32_t state, unsigned char c);
+
+    std::vector<NfaState> nfa;
+    std::vector<ByteSet> sets;
+    std::vector<uint32_t> starts;
+
+    // bytes no pattern tells apart share a column of the transition table,
+    // which keeps a DFA state at a few hundred bytes rather than 1 KB
+    std::array<uint8_t, 256> byteClass{};
+    size_t classCount = 0;
+
+    std::vector<DfaState> dfa;
+    // dfa.size() x classCount, -1 until the transition is first taken
+    std::vector<int32_t> transitions;
+    std::unordered_map<std::string, int32_t> dfaIndex;
+    size_t dfaBytes = 0;
+    int32_t startState = -1;
+
+    // closure scratch
+    std::vector<uint32_t> marks;
+    uint32_t markGeneration = 0;
+    std::vector<uint32_t> pending;
+    std::vector<uint32_t> stepped;
+    std::vector<uint32_t> current;
+};
+
+uint32_t RuleAutomaton::add_state(const Kind kind, const uint32_t out, const uint32_t out1, const uint32_t arg)
+{
+    nfa.push_back({kind, out, out1, arg});
+    return static_cast<uint32_t>(nfa.size() - 1);
+}
+
+uint32_t RuleAutomaton::epsilon()
+{
+    return add_state(Kind::Epsilon);
+}
+
+RuleAutomaton::Fragment RuleAutomaton::bytes(const ByteSet& set)
+{
+    sets.push_back(set);
+    const uint32_t end = epsilon();
+    return {add_state(Kind::Bytes, end, none, static_cast<uint32_t>(sets.size() - 1)), end};
+}
+
+RuleAutomaton::Fragment RuleAutomaton::literal(const unsigned char c)
+{
+    ByteSet set;
+    set.set(fold(c));
+    return bytes(set);
+}
+
+RuleAutomaton::Fragment RuleAutomaton::concat(const Fragment a, const Fragment b)
+{
+    nfa[a.end].out = b.start;
+    return {a.start, b.end};
+}
+
+RuleAutomaton::Fragment RuleAutomaton::alternate(const Fragment a, const Fragment b)
+{
+    const uint32_t end = epsilon();
+    nfa[a.end].out = end;
+    nfa[b.end].out = end;
+    return {add_state(Kind::Epsilon, a.start, b.start), end};
+}
+
+RuleAutomaton::Fragment RuleAutomaton::star(const Fragment a)
+{
+    const uint32_t end = epsilon();
+    const uint32_t loop = add_state(Kind::Epsilon, a.start, end);
+    nfa[a.end].out = loop;
+    return {loop, end};
+}
+
+RuleAutomaton::Fragment RuleAutomaton::plus(const Fragment a)
+{
+    const uint32_t end = epsilon();
+    nfa[a.end].out = add_state(Kind::Epsilon, a.start, end);
+    return {a.start, end};
+}
+
+RuleAutomaton::Fragment RuleAutomaton::optional(const Fragment a)
+{
+    const uint32_t end = epsilon();
+    nfa[a.end].out = end;
+    return {add_state(Kind::Epsilon, a.start, end), end};
+}
+
+RuleAutomaton::Fragment RuleAutomaton::any_byte_star()
+{
+    ByteSet all;
+    all.set();
+    return star(bytes(all));
+}
+
+// One UTF-8 encoded character: an ASCII byte, or a lead byte and its continuations
+RuleAutomaton::Fragment RuleAutomaton::any_char()
+{
+    return class_fragment(ByteSet(), true);
+}
+
+// ASCII class, negated ones also match any non-ASCII character
+RuleAutomaton::Fragment RuleAutomaton::class_fragment(ByteSet set, const bool negated)
+{
+    for (int c = 'A'; c <= 'Z'; ++c)
+    {
+        if (set.test(c)) set.set(c - 'A' + 'a');
+    }
+    if (!negated) return bytes(set);
+
+    ByteSet ascii;
+    for (int c = 0; c < 0x80; ++c)
+    {
+        ascii.set(c, !set.test(c));
+    }
+
+    ByteSet lead;
+    ByteSet continuation;
+    for (int c = 0xC0; c <= 0xFF; ++c) lead.set(c);
+    for (int c = 0x80; c <= 0xBF; ++c) continuation.set(c);
+    return alternate(bytes(ascii), concat(bytes(lead), star(bytes(continuation))));
+}
+
+static bool class_escape(const unsigned char c, ByteSet& set, bool& negated)
+{
+    const auto range = [&](const int from, const int to)
+    {
+        for (int i = from; i <= to; ++i) set.set(i);
+    };
+
+    switch (c)
+    {
+    case 'D':
+    case 'd':
+        range('0', '9');
+        break;
+    case 'W':
+    case 'w':
+        range('0', '9');
+        range('a', 'z');
+        range('A', 'Z');
+        set.set('_');
+        break;
+    case 'S':
+    case 's':
+        for (const char space : {' ', '\t', '\r', '\n', '\f', '\v'}) set.set(static_cast<unsigned char>(space));
+        break;
+    default:
+        return false;
+    }
+    negated = c >= 'A' && c <= 'Z';
+    return true;
+}
+
+// After the opening bracket, up to and including the closing one
+RuleAutomaton::Fragment RuleAutomaton::char_class(Parser& parser)
+{
+    ByteSet set;
+    bool negated = false;
+    if (!parser.done() && parser.peek() == '^')
+    {
+        negated = true;
+        ++parser.pos;
+    }
+
+    bool first = true;
+    while (!parser.done() && (parser.peek() != ']' || first))
+    {
+        first = false;
+        unsigned char c = parser.peek();
+        ++parser.pos;
+        if (c == '\\' && !parser.done())
+        {
+            c = parser.peek();
+            ++parser.pos;
+            ByteSet escaped;
+            bool escapedNegated = false;
+            if (class_escape(c, escaped, escapedNegated))
+            {
+                if (escapedNegated)
+                {
+                    parser.error = "negated escapes aren't supported inside []";
+                    return {};
+                }
+                set |= escaped;
+                continue;
+            }
+        }
+        if (c >= 0x80)
+        {
+            parser.error = "[] only supports ASCII";
+            return {};
+        }
+
+        if (parser.pos + 1 < parser.text.size() && parser.peek() == '-' && parser.text[parser.pos + 1] != ']')
+        {
+            const auto to = static_cast<unsigned char>(parser.text[parser.pos + 1]);
+            parser.pos += 2;
+            if (to < c || to >= 0x80)
+            {
+                parser.error = "bad range in []";
+                return {};
+            }
+            for (int i = c; i <= to; ++i) set.set(i);
+            continue;
+        }
+        set.set(c);
+    }
+
+    if (parser.done())
+    {
+        parser.error = "unterminated [";
+        return {};
+    }
+    ++parser.pos;
+    return class_fragment(set, negated);
+}
+
+bool RuleAutomaton::parse_glob(Parser& parser, Fragment& out)
+{
+    const uint32_t empty = epsilon();
+    out = {empty, empty};
+    while (!parser.done())
+    {
+        const unsigned char c = parser.peek();
+        ++parser.pos;
+
+        Fragment next;
+        if (c == '*')
+        {
+            next = any_byte_star();
+        }
+        else if (c == '?')
+        {
+            next = any_char();
+        }
+        else if (c == '[')
+        {
+            next = char_class(parser);
+            if (!parser.error.empty()) return false;
+        }
+        else if (c == '\\' && !parser.done())
+        {
+            next = literal(parser.peek());
+            ++parser.pos;
+        }
+        else
+        {
+            next = literal(c);
+        }
+        out = concat(out, next);
+    }
+    return true;
+}
+
+bool RuleAutomaton::parse_alternation(Parser& parser, Fragment& out)
+{
+    if (!parse_concat(parser, out)) return false;
+    while (!parser.done() && parser.peek() == '|')
+    {
+        ++parser.pos;
+        Fragment right;
+        if (!parse_concat(parser, right)) return false;
+        out = alternate(out, right);
+    }
+    return true;
+}
+
+bool RuleAutomaton::parse_concat(Parser& parser, Fragment& out)
+{
+    const uint32_t empty = epsilon();
+    out = {empty, empty};
+    while (!parser.done() && parser.peek() != '|' && parser.peek() != ')')
+    {
+        Fragment next;
+        if (!parse_repeat(parser, next)) return false;
+        out = concat(out, next);
+    }
+    return true;
+}
+
+bool RuleAutomaton::parse_repeat(Parser& parser, Fragment& out)
+{
+    if (!parse_atom(parser, out)) return false;
+    while (!parser.done())
+    {
+        const unsigned char c = parser.peek();
+        if (c == '*') out = star(out);
+        else if (c == '+') out = plus(out);
+        else if (c == '?') out = optional(out);
+        else if (c == '{')
+        {
+            parser.error = "counted repetition {m,n} isn't supported";
+            return false;
+        }
+        else break;
+        ++parser.pos;
+    }
+    return true;
+}
+
+bool RuleAutomaton::parse_atom(Parser& parser, Fragment& out)
+{
+    const unsigned char c = parser.peek();
+    ++parser.pos;
+    switch (c)
+    {
+    case '(':
+        if (parser.text.substr(parser.pos).starts_with("?:")) parser.pos += 2;
+        if (!parse_alternation(parser, out)) return false;
+        if (parser.done() || parser.peek() != ')')
+        {
+            parser.error = "missing )";
+            return false;
+        }
+        ++parser.pos;
+        return true;
+    case '[':
+        out = char_class(parser);
+        return parser.error.empty();
+    case '.':
+        out = any_char();
+        return true;
+    case '*':
+    case '+':
+    case '?':
+        parser.error = "nothing to repeat";
+        return false;
+    case '^':
+    case '$':
+        parser.error = "^ and $ are only supported at the ends";
+        return false;
+    case '\\':
+        {
+            if (parser.done())
+            {
+                parser.error = "trailing backslash";
+                return false;
+            }
+            const unsigned char escaped = parser.peek();
+            ++parser.pos;
+            ByteSet set;
+            bool negated = false;
+            out = class_escape(escaped, set, negated) ? class_fragment(set, negated) : literal(escaped);
+            return true;
+        }
+    default:
+        out = literal(c);
+        return true;
+    }
+}
+
+int RuleAutomaton::add(std::string_view pattern, const bool regex, std::string& error)
+{
+    const size_t stateCount = nfa.size();
+    const size_t setCount = sets.size();
+
+    Fragment fragment;
+    bool ok;
+    if (regex)
+    {
+        const bool anchoredStart = pattern.starts_with('^');
+        if (anchoredStart) pattern.remove_prefix(1);
+
+        // a trailing $ anchors unless it is escaped
+        size_t backslashes = 0;
+        while (backslashes + 1 < pattern.size() && pattern[pattern.size() - 2 - backslashes] == '\\') ++backslashes;
+        const bool anchoredEnd = pattern.ends_with('$') && backslashes % 2 == 0;
+        if (anchoredEnd) pattern.remove_suffix(1);
+
+        Parser parser{pattern};
+        ok = parse_alternation(parser, fragment);
+        if (ok && !parser.done())
+        {
+            parser.error = "unmatched )";
+            ok = false;
+        }
+        error = parser.error;
+
+        if (ok && !anchoredStart) fragment = concat(any_byte_star(), fragment);
+        if (ok && !anchoredEnd) fragment = concat(fragment, any_byte_star());
+    }
+    else
+    {
+        Parser parser{pattern};
+        ok = parse_glob(parser, fragment);
+        error = parser.error;
+    }
+
+    if (!ok)
+    {
+        nfa.resize(stateCount);
+        sets.resize(setCount);
+        return -1;
+    }
+
+    const auto id = static_cast<uint32_t>(starts.size());
+    nfa[fragment.end].out = add_state(Kind::Match, none, none, id);
+    starts.push_back(fragment.start);
+
+    // the DFA describes the old pattern set
+    dfa.clear();
+    dfaIndex.clear();
+    classCount = 0;
+    return static_cast<int>(id);
+}
+
+// Follows epsilons from pending, out gets the sorted Bytes and Match states reached
+void RuleAutomaton::closure(std::vector<uint32_t>& pending, std::vector<uint32_t>& out)
+{
+    if (marks.size() < nfa.size()) marks.resize(nfa.size(), 0);
+    if (++markGeneration == 0)
+    {
+        std::ranges::fill(marks, 0);
+        markGeneration = 1;
+    }
+
+    out.clear();
+    while (!pending.empty())
+    {
+        const uint32_t s = pending.back();
+        pending.pop_back();
+        if (s == none || marks[s] == markGeneration) continue;
+        marks[s] = markGeneration;
+
+        const NfaState& state = nfa[s];
+        if (state.kind == Kind::Epsilon)
+        {
+            pending.push_back(state.out1);
+            pending.push_back(state.out);
+        }
+        else
+        {
+            out.push_back(s);
+        }
+    }
+    std::ranges::sort(out);
+}
+
+void RuleAutomaton::compute_byte_classes()
+{
+    // refine by every set in turn: two bytes stay together while no set has one without the other
+    byteClass.fill(0);
+    classCount = 1;
+    std::array<uint8_t, 256> refined{};
+    std::vector<int> remap;
+    for (const ByteSet& set : sets)
+    {
+        remap.assign(classCount * 2, -1);
+        size_t count = 0;
+        for (size_t b = 0; b < 256; ++b)
+        {
+            int& target = remap[byteClass[b] * 2 + set.test(b)];
+            if (target < 0) target = static_cast<int>(count++);
+            refined[b] = static_cast<uint8_t>(target);
+        }
+        byteClass = refined;
+        classCount = count;
+    }
+}
+
+void RuleAutomaton::nfa_states(const int32_t state, std::vector<uint32_t>& out) const
+{
+    const std::string& key = *dfa[state].nfa;
+    out.resize(key.size() / sizeof(uint32_t));
+    if (!key.empty()) std::memcpy(out.data(), key.data(), key.size());
+}
+
+int32_t RuleAutomaton::intern(const std::vector<uint32_t>& set)
+{
+    std::string key(reinterpret_cast<const char*>(set.data()), set.size() * sizeof(uint32_t));
+    const auto [it, inserted] = dfaIndex.try_emplace(std::move(key), static_cast<int32_t>(dfa.size()));
+    if (!inserted) return it->second;
+
+    DfaState state{&it->first, {}};
+    for (const uint32_t s : set)
+    {
+        if (nfa[s].kind == Kind::Match) state.accepts.push_back(nfa[s].arg);
+    }
+    std::ranges::sort(state.accepts);
+
+    dfaBytes += it->first.size() + state.accepts.size() * sizeof(uint32_t) + classCount * sizeof(int32_t) +
+        sizeof(DfaState) + sizeof(*it);
+    dfa.push_back(std::move(state));
+    transitions.resize(transitions.size() + classCount, -1);
+    return it->second;
+}
+
+void RuleAutomaton::reset_dfa()
+{
+    if (classCount == 0) compute_byte_classes();
+
+    dfa.clear();
+    transitions.clear();
+    dfaIndex.clear();
+    dfaBytes = 0;
+    intern({}); // dead_state
+
+    pending.assign(starts.begin(), starts.end());
+    closure(pending, current);
+    startState = intern(current);
+}
+
+int32_t RuleAutomaton::build_next(int32_t state, const unsigned char c)
+{
+    nfa_states(state, current);
+    if (dfaBytes >= max_dfa_bytes)
+    {
+        reset_dfa();
+        state = intern(current);
+    }
+
+    pending.clear();
+    for (const uint32_t s : current)
+    {
+        const NfaState& nfaState = nfa[s];
+        if (nfaState.kind == Kind::Bytes && sets[nfaState.arg].test(c))
+        {
+            pending.push_back(nfaState.out);
+        }
+    }
+    closure(pending, stepped);
+
+    const int32_t next = intern(stepped);
+    transitions[state * classCount + byteClass[c]] = next;
+    return next;
+}
+
+void RuleAutomaton::match(const std::string_view text, std::vector<uint32_t>& accepted)
+{
+    accepted.clear();
+    if (starts.empty()) return;
+    if (dfa.empty()) reset_dfa();
+
+    int32_t state = startState;
+    for (const char c : text)
+    {
+        const unsigned char folded = fold(static_cast<unsigned char>(c));
+        const int32_t next = transitions[state * classCount + byteClass[folded]];
+        state = next >= 0 ? next : build_next(state, folded);
+        if (state == dead_state) return;
+    }
+    accepted = dfa[state].accepts;
+}
+
+size_t RuleAutomaton::memory() const
+{
+    return dfaBytes;
+}
+
+// ---- rules -------------------------------------------------------------------
+
+static constexpr std::string_view field_names[] = {"process", "class", "title"};
+
+WindowRules::WindowRules() = default;
+
+WindowRules::~WindowRules() = default;
+
+// Next whitespace separated token, "quoted" tokens may contain spaces and \" \\ escapes
+static bool next_token(std::string_view& line, std::string& token)
+{
+    token.clear();
+    while (!line.empty() && (line.front() == ' ' || line.front() == '\t')) line.remove_prefix(1);
+    if (line.empty()) return false;
+
+    bool quoted = false;
+    while (!line.empty())
+    {
+        const char c = line.front();
+        if (!quoted && (c == ' ' || c == '\t')) break;
+        line.remove_prefix(1);
+
+        if (c == '"')
+        {
+            quoted = !quoted;
+        }
+        else if (quoted && c == '\\' && !line.empty() && (line.front() == '"' || line.front() == '\\'))
+        {
+            token += line.front();
+            line.remove_prefix(1);
+        }
+        else
+        {
+            token += c;
+        }
+    }
+    return true;
+}
+
+bool WindowRules::parse_line(std::string_view line, std::string& error)
+{
+    std::string token;
+    next_token(line, token);
+
+    Rule rule;
+    if (token == "pin")
+    {
+        rule.action = Action::Pin;
+        if (!next_token(line, token) ||
+            std::from_chars(token.data(), token.data() + token.size(), rule.slot).ec != std::errc() || rule.slot < 1)
+        {
+            error = "pin needs a slot number from 1";
+            return false;
+        }
+    }
+    else if (token == "exclude")
+    {
+        rule.action = Action::Exclude;
+    }
+    else if (token == "rename")
+    {
+        rule.action = Action::Rename;
+        if (!next_token(line, rule.rename))
+        {
+            error = "rename needs the new name";
+            return false;
+        }
+    }
+    else
+    {
+        error = "unknown action " + token;
+        return false;
+    }
+
+    // conditions are parsed before anything is added, a bad line leaves no patterns behind
+    struct Condition
+    {
+        size_t field;
+        bool regex;
+        std::string pattern;
+    };
+    std::vector<Condition> conditions;
+    while (next_token(line, token))
+    {
+        const size_t op = token.find_first_of("=~");
+        const auto field = std::ranges::find(field_names, std::string_view(token).substr(0, op));
+        if (op == std::string::npos || field == std::end(field_names))
+        {
+            error = "expected process=, class= or title= (or ~ for a regex), got " + token;
+            return false;
+        }
+        conditions.push_back({
+            static_cast<size_t>(field - std::begin(field_names)), token[op] == '~', token.substr(op + 1)
+        });
+    }
+    if (conditions.empty())
+    {
+        error = "a rule needs at least one condition";
+        return false;
+    }
+
+    const auto ruleIndex = static_cast<uint32_t>(rules.size());
+    std::vector<std::pair<size_t, int>> added;
+    for (const auto& condition : conditions)
+    {
+        const int id = automata[condition.field]->add(condition.pattern, condition.regex, error);
+        if (id < 0)
+        {
+            error = std::string(field_names[condition.field]) + " pattern " + condition.pattern + ": " + error;
+            // patterns of earlier conditions stay compiled but unreferenced
+            for (const auto& [field, addedId] : added) patternRules[field][addedId].pop_back();
+            return false;
+        }
+
+        auto& users = patternRules[condition.field];
+        if (users.size() <= static_cast<size_t>(id)) users.resize(id + 1);
+        users[id].push_back(ruleIndex);
+        added.emplace_back(condition.field, id);
+    }
+
+    rule.conditions = static_cast<uint32_t>(conditions.size());
+    rules.push_back(std::move(rule));
+    return true;
+}
+
+size_t WindowRules::compile(const std::string_view text)
+{
+    rules.clear();
+    for (size_t field = 0; field < field_count; ++field)
+    {
+        automata[field] = std::make_unique<RuleAutomaton>();
+        patternRules[field].clear();
+    }
+
+    size_t lineNumber = 0;
+    size_t start = 0;
+    while (start < text.size())
+    {
+        size_t end = text.find('\n', start);
+        if (end == std::string_view::npos) end = text.size();
+        std::string_view line = text.substr(start, end - start);
+        start = end + 1;
+        ++lineNumber;
+
+        if (line.ends_with('\r')) line.remove_suffix(1);
+        const size_t first = line.find_first_not_of(" \t");
+        if (first == std::string_view::npos || line[first] == '#') continue;
+
+        std::string error;
+        if (!parse_line(line, error))
+        {
+            LOG_WARN("Rule on line {} skipped: {}", lineNumber, error);
+        }
+    }
+
+    hits.assign(rules.size(), 0);
+    return rules.size();
+}
+
+RuleMatch WindowRules::evaluate(const WindowInfo& window)
+{
+    RuleMatch match;
+    if (rules.empty()) return match;
+
+    const std::string_view values[field_count] = {window.processName, window.className, window.title};
+    uint32_t pinRule = UINT32_MAX;
+    uint32_t renameRule = UINT32_MAX;
+    for (size_t field = 0; field < field_count; ++field)
+    {
+        automata[field]->match(values[field], accepted);
+        for (const uint32_t pattern : accepted)
+        {
+            for (const uint32_t ruleIndex : patternRules[field][pattern])
+            {
+                if (hits[ruleIndex]++ == 0) touched.push_back(ruleIndex);
+                if (hits[ruleIndex] != rules[ruleIndex].conditions) continue;
+
+                switch (rules[ruleIndex].action)
+                {
+                case Action::Exclude:
+                    match.excluded = true;
+                    break;
+                case Action::Pin:
+                    pinRule = std::min(pinRule, ruleIndex);
+                    break;
+                case Action::Rename:
+                    renameRule = std::min(renameRule, ruleIndex);
+                    break;
+                }
+            }
+        }
+    }
+
+    for (const uint32_t ruleIndex : touched) hits[ruleIndex] = 0;
+    touched.clear();
+
+    if (pinRule != UINT32_MAX) match.pinnedSlot = rules[pinRule].slot;
+    if (renameRule != UINT32_MAX) match.rename = &rules[renameRule].rename;
+    return match;
+}
+
+static std::string expand_rename(const std::string& format, const WindowInfo& window)
+{
+    std::string out;
+    size_t pos = 0;
+    while (pos < format.size())
+    {
+        const size_t brace = format.find('{', pos);
+        out.append(format, pos, brace == std::string::npos ? std::string::npos : brace - pos);
+        if (brace == std::string::npos) break;
+
+        const std::string_view rest = std::string_view(format).substr(brace);
+        if (rest.starts_with("{title}"))
+        {
+            out += window.title;
+            pos = brace + 7;
+        }
+        else if (rest.starts_with("{process}"))
+        {
+            out += window.processName;
+            pos = brace + 9;
+        }
+        else
+        {
+            out += '{';
+            pos = brace + 1;
+        }
+    }
+    return out;
+}
+
+bool WindowRules::apply(WindowInfo& window)
+{
+    const RuleMatch match = evaluate(window);
+    if (match.excluded) return false;
+
+    window.pinnedSlot = match.pinnedSlot;
+    if (match.rename) window.title = expand_rename(*match.rename, window);
+    return true;
+}
+
+void WindowRules::apply(std::vector<WindowInfo>& windows)
+{
+    if (rules.empty()) return;
+
+    std::erase_if(windows, [&](WindowInfo& window) { return !apply(window); });
+}
+
+WindowFields WindowRules::fields() const
+{
+    // same order as the values in evaluate()
+    constexpr WindowFields by_field[field_count] = {FIELD_PROCESS, FIELD_CLASS, FIELD_TITLE};
+
+    WindowFields used = 0;
+    for (size_t field = 0; field < field_count; ++field)
+    {
+        if (automata[field] && automata[field]->patterns() > 0) used |= by_field[field];
+    }
+    // a rename replaces the title and may quote the title and process
+    if (std::ranges::any_of(rules, [](const Rule& rule) { return rule.action == Action::Rename; }))
+    {
+        used |= FIELD_TITLE | FIELD_PROCESS;
+    }
+    return used;
+}
+
+size_t WindowRules::rule_count() const
+{
+    return rules.size();
+}
+
+size_t WindowRules::pattern_count() const
+{
+    size_t count = 0;
+    for (const auto& automaton : automata)
+    {
+        if (automaton) count += automaton->patterns();
+    }
+    return count;
+}
+
+size_t WindowRules::dfa_states() const
+{
+    size_t count = 0;
+    for (const auto& automaton : automata)
+    {
+        if (automaton) count += automaton->states();
+    }
+    return count;
+}
+
+size_t WindowRules::dfa_memory() const
+{
+    size_t bytes = 0;
+    for (const auto& automaton : automata)
+    {
+        if (automaton) bytes += automaton->memory();
+    }
+    return bytes;
+}
+
+static std::mutex activeRulesMutex;
+static bool activeRulesCompiled = false;
+
+// The rules apply_window_rules() uses, callers hold activeRulesMutex
+static WindowRules& active_rules()
+{
+    static WindowRules rules;
+    return rules;
+}
+
+// Compiles FIND_MY_WIN_RULES again whenever it changed, callers hold activeRulesMutex
+static void reload_rules()
+{
+    static std::filesystem::file_time_type loadedTime;
+
+    // one stat per refresh, the file is only read again when it changed
+    std::error_code error;
+    const auto modified = std::filesystem::last_write_time(FIND_MY_WIN_RULES, error);
+    const auto current = error ? std::filesystem::file_time_type::min() : modified;
+    if (!activeRulesCompiled || current != loadedTime)
+    {
+        std::string text;
+        if (!error)
+        {
+            std::ifstream file(FIND_MY_WIN_RULES, std::ios::binary);
+            std::ostringstream contents;
+            contents << file.rdbuf();
+            text = contents.str() + "\n";
+        }
+        // after the file so warnings keep its line numbers
+        text += builtin_rules;
+
+        // however many of them the built-in text compiles to, counted on their own once
+        static const size_t builtinCount = WindowRules().compile(builtin_rules);
+        const size_t count = active_rules().compile(text);
+        if (!error)
+        {
+            LOG_INFO("Loaded {} window rules from {}", count > builtinCount ? count - builtinCount : 0,
+                     FIND_MY_WIN_RULES);
+        }
+        activeRulesCompiled = true;
+        loadedTime = current;
+    }
+}
+
+WindowFields window_rule_fields()
+{
+    std::lock_guard lock(activeRulesMutex);
+    reload_rules();
+    return active_rules().fields();
+}
+
+bool apply_window_rules(WindowInfo& window)
+{
+    std::lock_guard lock(activeRulesMutex);
+    // the file is checked once per enumeration, by window_rule_fields()
+    if (!activeRulesCompiled) reload_rules();
+    return active_rules().apply(window);
+}
@@ -0,0 +1,105 @@
+#ifndef FINDMYWINDOWS_RULES_H
+#define FINDMYWINDOWS_RULES_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "tabs.h"
+
+// Window rules, one per line:
+//
+//   pin 1 process=chrome.exe title="*GitHub*"
+//   exclude class~"^Shell_.*TrayWnd$"
+//   rename "Mail: {title}" process=outlook.exe
+//
+// field=pattern is a glob (* ? [..]) over the whole value, field~pattern a regex
+// (. [..] \d \w \s * + ? | ( ) ^ $) that matches anywhere unless anchored.
+// Fields are process, class and title, every condition of a rule has to match
+// and case is ignored for ASCII. A window is dropped when any exclude rule
+// matches, otherwise the first matching pin and rename rules apply.
+// {title} and {process} in a rename stand for the original values.
+extern const std::string FIND_MY_WIN_RULES;
+
+struct RuleMatch
+{
+    bool excluded = false;
+    int pinnedSlot = 0;
+    const std::string* rename = nullptr;
+};
+
+class RuleAutomaton;
+
+// Every pattern of every rule is compiled into one lazily built DFA per field,
+// so a window costs one pass over its process name, class and title however
+// many rules there are. evaluate() grows the DFA cache and isn't thread safe.
+class WindowRules
+{
+public:
+    WindowRules();
+    ~WindowRules();
+
+    WindowRules(const WindowRules&) = delete;
+    WindowRules& operator=(const WindowRules&) = delete;
+
+    // Replaces the rules with the parsed text and returns how many were kept.
+    // Malformed lines are logged with their line number and skipped.
+    size_t compile(std::string_view text);
+
+    RuleMatch evaluate(const WindowInfo& window);
+
+    // false when the window is excluded, otherwise renames and sets pinnedSlot in place
+    bool apply(WindowInfo& window);
+    // Drops excluded windows, renames and sets pinnedSlot in place
+    void apply(std::vector<WindowInfo>& windows);
+
+    // What evaluate() looks at, lazily listed windows need these filled in
+    WindowFields fields() const;
+
+    size_t rule_count() const;
+    size_t pattern_count() const;
+    // DFA states built so far across the fields
+    size_t dfa_states() const;
+    size_t dfa_memory() const;
+
+private:
+    enum class Action
+    {
+        Pin,
+        Exclude,
+        Rename,
+    };
+
+    struct Rule
+    {
+        Action action;
+        int slot = 0;
+        std::string rename;
+        uint32_t conditions = 0;
+    };
+
+    bool parse_line(std::string_view line, std::string& error);
+
+    static constexpr size_t field_count = 3;
+
+    std::vector<Rule> rules;
+    std::unique_ptr<RuleAutomaton> automata[field_count];
+    // pattern id -> rules using it, per field
+    std::vector<std::vector<uint32_t>> patternRules[field_count];
+
+    // evaluate() scratch, kept to avoid allocating per window
+    std::vector<uint32_t> hits;
+    std::vector<uint32_t> touched;
+    std::vector<uint32_t> accepted;
+};
+
+// WindowRules::fields() of FIND_MY_WIN_RULES plus the built-in rule that hides
+// the switcher itself. Compiles the file again when it changed, the enumeration
+// calls it once before applying the rules to each window.
+WindowFields window_rule_fields();
+
+// WindowRules::apply() with the rules window_rule_fields() loaded
+bool apply_window_rules(WindowInfo& window);
+
+#endif //FINDMYWINDOWS_RULES_H
@@ -0,0 +1,53 @@
+#include "snapshot.h"
+
+#include <algorithm>
+#include <atomic>
+
+static std::atomic<std::shared_ptr<const WindowSnapshot>> snapshot{
+    std::make_shared<const WindowSnapshot>(WindowSnapshot{0, {}})
+};
+
+// registered during startup, before any thread publishes
+static std::vector<void (*)()> listeners;
+
+static bool same_window(const WindowInfo& a, const WindowInfo& b)
+{
+    return a.hwnd == b.hwnd &&
+        a.processId == b.processId &&
+        a.isOnCurrentDesktop == b.isOnCurrentDesktop &&
+        a.title == b.title &&
+        a.processName == b.processName &&
+        a.package == b.package &&
+        a.className == b.className &&
+        a.resolved == b.resolved;
+}
+
+std::shared_ptr<const WindowSnapshot> current_snapshot()
+{
+    return snapshot.load(std::memory_order_acquire);
+}
+
+bool publish_snapshot(const std::vector<WindowInfo>& windows)
+{
+    const auto previous = snapshot.load(std::memory_order_acquire);
+    if (std::ranges::equal(previous->windows, windows, same_window))
+    {
+        return false;
+    }
+
+    snapshot.store(
+        std::make_shared<const WindowSnapshot>(WindowSnapshot{previous->version + 1, windows}),
+        std::memory_order_release
+    );
+
+    for (const auto listener : listeners)
+    {
+        listener();
+    }
+    return true;
+}
+
+void add_snapshot_listener(void (*listener)())
+{
+    listeners.push_back(listener);
+}
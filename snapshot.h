@@ -0,0 +1,26 @@
+#ifndef FINDMYWINDOWS_SNAPSHOT_H
+#define FINDMYWINDOWS_SNAPSHOT_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "tabs.h"
+
+// Immutable copy of the ordered window list as last seen by the message loop.
+// Readers on other threads (the IPC server) never trigger an enumeration.
+struct WindowSnapshot
+{
+    uint64_t version;
+    std::vector<WindowInfo> windows;
+};
+
+std::shared_ptr<const WindowSnapshot> current_snapshot();
+
+// Publishes a new version only when the list differs from the current one and
+// returns whether it did. Listeners are called after the swap.
+bool publish_snapshot(const std::vector<WindowInfo>& windows);
+
+void add_snapshot_listener(void (*listener)());
+
+#endif //FINDMYWINDOWS_SNAPSHOT_H
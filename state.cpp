@@ -0,0 +1,281 @@
+#include "state.h"
+#include "backend.h"
+#include "fingerprint.h"
+#include "log.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const std::string FIND_MY_WIN_STATE = "findmywindows.state";
+
+static constexpr char state_magic[4] = {'F', 'M', 'W', 'S'};
+static constexpr uint32_t state_version = 3;
+
+// Read-only view of a whole file, unmapped on destruction
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& path)
+    {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) return;
+
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) return;
+
+        data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (data) length = static_cast<size_t>(fileSize.QuadPart);
+#else
+        descriptor = open(path.c_str(), O_RDONLY);
+        if (descriptor < 0) return;
+
+        struct stat info;
+        if (fstat(descriptor, &info) != 0 || info.st_size == 0) return;
+
+        void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapped == MAP_FAILED) return;
+
+        data = static_cast<const char*>(mapped);
+        length = static_cast<size_t>(info.st_size);
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifdef _WIN32
+        if (data) UnmapViewOfFile(data);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+        if (data) munmap(const_cast<char*>(data), length);
+        if (descriptor >= 0) close(descriptor);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view view() const
+    {
+        return {data, length};
+    }
+
+private:
+    const char* data = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int descriptor = -1;
+#endif
+};
+
+template <typename T>
+static void put(std::string& out, const T value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static void put_text(std::string& out, const std::string& text, const size_t length)
+{
+    out.append(text, 0, length);
+}
+
+static uint16_t clamp_length(const std::string& text)
+{
+    return static_cast<uint16_t>(text.size() < UINT16_MAX ? text.size() : UINT16_MAX);
+}
+
+bool save_state(const std::string& path, const std::vector<WindowInfo>& windows)
+{
+    // process table, shared by every window of that process
+    std::unordered_map<DWORD, uint16_t> processIndex;
+    std::vector<const WindowInfo*> processes;
+    for (const auto& window : windows)
+    {
+        if (processes.size() < UINT16_MAX && processIndex.try_emplace(window.processId,
+                                                                      static_cast<uint16_t>(processes.size())).second)
+        {
+            processes.push_back(&window);
+        }
+    }
+
+    std::string out(state_magic, sizeof(state_magic));
+    put(out, state_version);
+    put(out, static_cast<uint32_t>(processes.size()));
+    put(out, static_cast<uint32_t>(windows.size()));
+
+    for (const WindowInfo* process : processes)
+    {
+        const uint16_t length = clamp_length(process->processName);
+        put(out, static_cast<uint32_t>(process->processId));
+        put(out, length);
+        put_text(out, process->processName, length);
+    }
+
+    for (const auto& window : windows)
+    {
+        const auto index = processIndex.find(window.processId);
+        const uint16_t classLength = clamp_length(window.className);
+        const uint16_t titleLength = clamp_length(window.title);
+        const uint16_t packageLength = clamp_length(window.package);
+        put(out, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(window.hwnd)));
+        put(out, window.fingerprint);
+        put(out, static_cast<uint32_t>(window.processId));
+        put(out, index != processIndex.end() ? index->second : static_cast<uint16_t>(UINT16_MAX));
+        put(out, static_cast<uint8_t>(window.isOnCurrentDesktop));
+        put(out, classLength);
+        put(out, titleLength);
+        put(out, packageLength);
+        put_text(out, window.className, classLength);
+        put_text(out, window.title, titleLength);
+        put_text(out, window.package, packageLength);
+    }
+
+    const std::string temp = path + ".tmp";
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        file.write(out.data(), static_cast<std::streamsize>(out.size()));
+        if (!file)
+        {
+            LOG_ERROR("Unable to write state snapshot: {}", temp);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp, path, error);
+    if (error)
+    {
+        LOG_ERROR("Unable to replace state snapshot: {}", path);
+        return false;
+    }
+    return true;
+}
+
+// Bounds-checked reads straight out of the mapping
+struct StateReader
+{
+    std::string_view data;
+    size_t pos = 0;
+    bool ok = true;
+
+    template <typename T>
+    T get()
+    {
+        T value{};
+        if (data.size() - pos < sizeof(T))
+        {
+            ok = false;
+            return value;
+        }
+        std::memcpy(&value, data.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+
+    std::string_view text(const size_t length)
+    {
+        if (data.size() - pos < length)
+        {
+            ok = false;
+            return {};
+        }
+        const std::string_view value = data.substr(pos, length);
+        pos += length;
+        return value;
+    }
+};
+
+bool restore_state(const std::string& path, WindowBackend& backend, std::vector<WindowInfo>& windows)
+{
+    const MappedFile file(path);
+    StateReader reader{file.view()};
+
+    if (reader.text(sizeof(state_magic)) != std::string_view(state_magic, sizeof(state_magic)) ||
+        reader.get<uint32_t>() != state_version)
+    {
+        return false;
+    }
+
+    const auto processCount = reader.get<uint32_t>();
+    const auto windowCount = reader.get<uint32_t>();
+
+    std::vector<std::string_view> processNames;
+    processNames.reserve(processCount < 4096 ? processCount : 4096);
+    for (uint32_t i = 0; i < processCount && reader.ok; ++i)
+    {
+        reader.get<uint32_t>();
+        const auto length = reader.get<uint16_t>();
+        processNames.push_back(reader.text(length));
+    }
+
+    size_t stale = 0;
+    for (uint32_t i = 0; i < windowCount && reader.ok; ++i)
+    {
+        const auto hwnd = reinterpret_cast<HWND>(static_cast<uintptr_t>(reader.get<uint64_t>()));
+        const auto fingerprint = reader.get<uint64_t>();
+        const auto processId = static_cast<DWORD>(reader.get<uint32_t>());
+        const auto process = reader.get<uint16_t>();
+        const auto onCurrentDesktop = reader.get<uint8_t>() != 0;
+        const auto classLength = reader.get<uint16_t>();
+        const auto titleLength = reader.get<uint16_t>();
+        const auto packageLength = reader.get<uint16_t>();
+        const std::string_view className = reader.text(classLength);
+        const std::string_view title = reader.text(titleLength);
+        const std::string_view package = reader.text(packageLength);
+        if (!reader.ok) break;
+
+        // handles survive a restart of this process but not of the window's app,
+        // and a dead handle reports no owner. A UWP frame is listed with the pid of the
+        // app it hosts, its handle belongs to the frame host.
+        if (package.empty() ? backend.process_id(hwnd) != processId : backend.class_name(hwnd) != className)
+        {
+            ++stale;
+            continue;
+        }
+
+        WindowInfo window;
+        window.hwnd = hwnd;
+        window.title = title;
+        window.className = className;
+        // a UWP frame's package is the hosted app's, the frame's own process can't tell it
+        window.package = package;
+        window.processId = processId;
+        window.isOnCurrentDesktop = onCurrentDesktop;
+        // the window keeps its launch ordinal while this process restarts
+        window.fingerprint = fingerprint;
+        seed_fingerprint(hwnd, processId, fingerprint);
+        if (process < processNames.size())
+        {
+            window.processName = processNames[process];
+            seed_process_name(processId, window.processName);
+        }
+        windows.push_back(std::move(window));
+    }
+
+    if (!reader.ok)
+    {
+        LOG_WARN("State snapshot {} is truncated, ignoring the rest", path);
+    }
+    LOG_INFO("Restored {} windows from {} ({} no longer open)", windows.size(), path, stale);
+    return !windows.empty();
+}
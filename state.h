@@ -0,0 +1,28 @@
+#ifndef FINDMYWINDOWS_STATE_H
+#define FINDMYWINDOWS_STATE_H
+
+#include <string>
+#include <vector>
+
+#include "tabs.h"
+
+class WindowBackend;
+
+// Cold start snapshot written at shutdown (and periodically, since the process
+// is usually killed at logoff) and memory-mapped at startup
+extern const std::string FIND_MY_WIN_STATE;
+
+// Layout, native endian: "FMWS", u32 version, u32 process count, u32 window count,
+// then the process table (u32 pid, u16 length, name) and the windows in slot order
+// (u64 hwnd, u64 fingerprint, u32 pid, u16 process index, u8 on current desktop, u16 class length,
+// u16 title length, u16 package length, class, title, package). Written to a temp file and renamed
+// into place.
+bool save_state(const std::string& path, const std::vector<WindowInfo>& windows);
+
+// Maps path and keeps the windows whose handle still belongs to the same pid, a
+// single cheap query per window. Their process names seed the name cache, their
+// fingerprints the launch ordinals.
+// Returns false when there is no usable snapshot.
+bool restore_state(const std::string& path, WindowBackend& backend, std::vector<WindowInfo>& windows);
+
+#endif //FINDMYWINDOWS_STATE_H
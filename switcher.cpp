@@ -0,0 +1,267 @@
+#include "switcher.h"
+
+#include <algorithm>
+#include <utility>
+
+// "[CTRL 9] " plus "* ", longer than "[tab] " or "[app] "
+constexpr size_t max_prefix = 11;
+
+static const WindowInfo no_window{};
+
+SwitcherList::SwitcherList(std::vector<WindowInfo> windows, const int selected, const std::span<const HWND> recent)
+{
+    const size_t count = windows.size();
+    views.assign(std::move(windows), recent);
+    labels.resize(count);
+    marks.reserve(count);
+    shown.reserve(count + app_row_limit);
+    for (uint32_t slot = 0; slot < count; ++slot)
+    {
+        labels[slot].reserve(views.window(slot).title.size() + max_prefix);
+        format_label(slot);
+    }
+    apply_query();
+    select(selected);
+}
+
+size_t SwitcherList::size() const
+{
+    return shown.size();
+}
+
+bool SwitcherList::empty() const
+{
+    return shown.empty();
+}
+
+const WindowInfo& SwitcherList::window(const size_t row) const
+{
+    return is_app(row) ? no_window : views.window(shown[row]);
+}
+
+const char* SwitcherList::label(const size_t row) const
+{
+    return is_app(row) ? appLabels[shown[row] & ~app_row].c_str() : labels[shown[row]].c_str();
+}
+
+bool SwitcherList::is_marked(const size_t row) const
+{
+    if (is_app(row)) return false;
+
+    const WindowInfo& window = views.window(shown[row]);
+    return window.tabNode == 0 && std::ranges::find(marks, window.hwnd) != marks.end();
+}
+
+int SwitcherList::selected() const
+{
+    return selectedRow;
+}
+
+void SwitcherList::select(const int row)
+{
+    selectedRow = std::clamp(row, 0, std::max(static_cast<int>(shown.size()) - 1, 0));
+}
+
+void SwitcherList::move_selection(const int delta)
+{
+    if (shown.empty()) return;
+
+    const int count = static_cast<int>(shown.size());
+    selectedRow = ((selectedRow + delta) % count + count) % count;
+}
+
+void SwitcherList::move_selected(const int delta)
+{
+    const int target = selectedRow + delta;
+    if (currentView != SortView::Saved || shown.empty() || target < 0 || target >= static_cast<int>(shown.size()))
+    {
+        return;
+    }
+
+    // filtered, the two windows trade places in the whole list, which leaves the
+    // rows between them where they were
+    const uint32_t from = shown[selectedRow];
+    const uint32_t to = shown[target];
+    if ((from | to) & app_row) return;
+
+    views.swap_saved(from, to);
+    std::swap(shown[selectedRow], shown[target]);
+    format_label(from);
+    format_label(to);
+    selectedRow = target;
+}
+
+void SwitcherList::toggle_mark()
+{
+    if (shown.empty() || is_app(selectedRow) || window(selectedRow).tabNode != 0) return;
+
+    const HWND hwnd = window(selectedRow).hwnd;
+    if (std::erase(marks, hwnd) == 0)
+    {
+        marks.push_back(hwnd);
+    }
+    format_label(shown[selectedRow]);
+}
+
+std::vector<HWND> SwitcherList::take_targets()
+{
+    std::vector<HWND> targets;
+    if (marks.empty())
+    {
+        if (!shown.empty() && !is_app(selectedRow) && window(selectedRow).tabNode == 0)
+        {
+            targets.push_back(window(selectedRow).hwnd);
+        }
+        return targets;
+    }
+
+    targets = marks;
+    marks.clear();
+    for (const uint32_t slot : views.order(SortView::Saved))
+    {
+        format_label(slot);
+    }
+    return targets;
+}
+
+void SwitcherList::remove(const std::vector<HWND>& hwnds)
+{
+    // tab rows go with their window
+    std::vector<uint32_t> closed;
+    for (const uint32_t slot : views.order(SortView::Saved))
+    {
+        if (std::ranges::find(hwnds, views.window(slot).hwnd) != hwnds.end()) closed.push_back(slot);
+    }
+    for (const uint32_t slot : closed)
+    {
+        views.remove(slot);
+        labels[slot].clear();
+    }
+    std::erase_if(marks, [&](const HWND hwnd) { return std::ranges::find(hwnds, hwnd) != hwnds.end(); });
+
+    // the windows after them moved up in the saved order
+    for (const uint32_t slot : views.order(SortView::Saved))
+    {
+        format_label(slot);
+    }
+    apply_query();
+    select(selectedRow);
+}
+
+bool SwitcherList::set_query(const std::string_view text)
+{
+    const uint32_t selectedSlot = shown.empty() ? UINT32_MAX : shown[selectedRow];
+    const bool compiled = filter.compile(text);
+    apply_query();
+    select_slot(selectedSlot);
+    return compiled;
+}
+
+const WindowQuery& SwitcherList::query() const
+{
+    return filter;
+}
+
+void SwitcherList::set_view(const SortView view)
+{
+    if (view == currentView) return;
+
+    const uint32_t selectedSlot = shown.empty() ? UINT32_MAX : shown[selectedRow];
+    currentView = view;
+    apply_query();
+    select_slot(selectedSlot);
+}
+
+SortView SwitcherList::view() const
+{
+    return currentView;
+}
+
+void SwitcherList::set_apps(std::shared_ptr<const AppIndex> apps)
+{
+    const uint32_t selectedSlot = shown.empty() ? UINT32_MAX : shown[selectedRow];
+    appIndex = std::move(apps);
+    appMatches.reserve(app_row_limit);
+    appLabels.resize(app_row_limit);
+    apply_query();
+    select_slot(selectedSlot);
+}
+
+bool SwitcherList::is_app(const size_t row) const
+{
+    return (shown[row] & app_row) != 0;
+}
+
+uint32_t SwitcherList::app_entry(const size_t row) const
+{
+    return appMatches[shown[row] & ~app_row];
+}
+
+const AppIndex* SwitcherList::apps() const
+{
+    return appIndex.get();
+}
+
+void SwitcherList::apply_query()
+{
+    // the capacity reserved for every window is enough, filtering never allocates
+    shown.clear();
+    for (const uint32_t slot : views.order(currentView))
+    {
+        if (filter.matches(views.window(slot)))
+        {
+            shown.push_back(slot);
+        }
+    }
+
+    // an empty query would list every app
+    if (!appIndex || filter.empty()) return;
+
+    appIndex->search(filter, appMatches, app_row_limit);
+    for (uint32_t index = 0; index < appMatches.size(); ++index)
+    {
+        std::string& label = appLabels[index];
+        label.clear();
+        label += "[app] ";
+        label += appIndex->name(appMatches[index]);
+        shown.push_back(app_row | index);
+    }
+}
+
+void SwitcherList::select_slot(const uint32_t slot)
+{
+    const auto it = std::ranges::find(shown, slot);
+    select(it != shown.end() ? static_cast<int>(it - shown.begin()) : 0);
+}
+
+std::vector<WindowInfo> SwitcherList::release()
+{
+    labels.clear();
+    marks.clear();
+    shown.clear();
+    selectedRow = 0;
+    return views.release();
+}
+
+void SwitcherList::format_label(const uint32_t slot)
+{
+    std::string& label = labels[slot];
+    const WindowInfo& window = views.window(slot);
+    const size_t index = views.position(SortView::Saved, slot);
+    label.clear();
+    if (window.tabNode != 0)
+    {
+        label += "[tab] ";
+    }
+    else if (index < shortcut_count)
+    {
+        label += "[CTRL ";
+        label += static_cast<char>('1' + index);
+        label += "] ";
+    }
+    if (window.tabNode == 0 && std::ranges::find(marks, window.hwnd) != marks.end())
+    {
+        label += "* ";
+    }
+    label += window.title;
+}
@@ -0,0 +1,104 @@
+#ifndef FINDMYWINDOWS_SWITCHER_H
+#define FINDMYWINDOWS_SWITCHER_H
+
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "app_index.h"
+#include "query.h"
+#include "tabs.h"
+#include "views.h"
+
+// Rows of the switcher, independent of ImGui. Each row's label ("[CTRL 3] * title")
+// is formatted when the row changes rather than on every frame, into a buffer
+// reserved once with room for any prefix, so drawing a frame, navigating,
+// reordering and marking don't touch the heap.
+//
+// A query filters the rows without dropping windows, rows are the windows it
+// matches in the order of the current view and release() still returns all of
+// them. Labels keep the Ctrl+N shortcut of the window's place in the saved order.
+// Installed apps the query matches follow the windows as launcher rows.
+class SwitcherList
+{
+public:
+    // Rows beyond this have no Ctrl+N shortcut, browser tab rows never do
+    static constexpr int shortcut_count = 9;
+    // Launcher rows after the windows, the best matches by name
+    static constexpr size_t app_row_limit = 20;
+
+    // windows in saved order, recent the most recently focused first
+    SwitcherList(std::vector<WindowInfo> windows, int selected, std::span<const HWND> recent = {});
+
+    size_t size() const;
+    bool empty() const;
+
+    // A launcher row reads as an empty window
+    const WindowInfo& window(size_t row) const;
+    const char* label(size_t row) const;
+    bool is_marked(size_t row) const;
+
+    int selected() const;
+    void select(int row);
+
+    // Moves the selection by delta rows, wrapping around
+    void move_selection(int delta);
+
+    // Moves the selected row up or down by one in the saved order, keeping it
+    // selected. No wrapping, and nothing in the other views.
+    void move_selected(int delta);
+
+    // Browser tab rows can't be marked, actions work on whole windows
+    void toggle_mark();
+
+    // The marked windows, or the selected one when none are marked and it is
+    // a window rather than a tab. Clears the marks.
+    std::vector<HWND> take_targets();
+
+    void remove(const std::vector<HWND>& hwnds);
+
+    // Compiles text and shows the windows it matches, keeping the selected window
+    // selected when it still matches. All of them on a syntax error, see
+    // WindowQuery::error(). The windows need query().fields() filled in.
+    bool set_query(std::string_view text);
+    const WindowQuery& query() const;
+
+    // Shows the rows in another order, keeping the selected window selected
+    void set_view(SortView view);
+    SortView view() const;
+
+    // Searched with every non-empty query, searching can allocate unlike filtering
+    void set_apps(std::shared_ptr<const AppIndex> apps);
+    bool is_app(size_t row) const;
+    // The launcher row's entry in apps()
+    uint32_t app_entry(size_t row) const;
+    const AppIndex* apps() const;
+
+    // Every window in saved order, the list is empty afterwards
+    std::vector<WindowInfo> release();
+
+private:
+    // shown holds launcher rows as app_row | their index in appMatches
+    static constexpr uint32_t app_row = 0x80000000u;
+
+    void format_label(uint32_t slot);
+    void apply_query();
+    // Selects the row of slot, the first row when it isn't shown
+    void select_slot(uint32_t slot);
+
+    WindowViews views;
+    SortView currentView = SortView::Saved;
+    // by slot, reserved for the slot's title
+    std::vector<std::string> labels;
+    // slots the query matches in the current view's order, the rows
+    std::vector<uint32_t> shown;
+    WindowQuery filter;
+    std::shared_ptr<const AppIndex> appIndex;
+    std::vector<uint32_t> appMatches;
+    std::vector<std::string> appLabels;
+    std::vector<HWND> marks;
+    int selectedRow = 0;
+};
+
+#endif //FINDMYWINDOWS_SWITCHER_H
@@ -1,220 +1,397 @@
 #include "tabs.h"
-
-#include <iostream>
-#include <windows.h>
-#include <psapi.h>
+#include "app_identity.h"
+#include "backend.h"
+#include "eligibility.h"
+#include "log.h"
+#include "mru.h"
+#include "predict.h"
+#include "rules.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 #include <string>
-#include <wrl/client.h>
 
-using Microsoft::WRL::ComPtr;
+static WindowBackend* current_backend = nullptr;
 
-// Virtual Desktop Manager interface (Windows 10/11)
-// These are undocumented COM interfaces that Windows uses internally
-DEFINE_GUID(CLSID_VirtualDesktopManager, 0xaa509086, 0x4258, 0x4bd1, 0x94, 0xcf, 0x3f, 0xde, 0x1c, 0x5d, 0x4b, 0xce);
-DEFINE_GUID(IID_IVirtualDesktopManager, 0xa5cd92ff, 0x29be, 0x454c, 0x8d, 0x04, 0xd8, 0x28, 0x79, 0xfb, 0x3f, 0x1b);
+// pid -> process name. Resolving a name opens the process, the most expensive call
+// per window, so it happens once per process. Entries are dropped as soon as an
+// enumeration no longer sees the pid, which keeps pid reuse from serving stale names.
+struct CachedProcessName
+{
+    std::string name;
+    uint64_t generation;
+};
 
-// Interface declaration
-MIDL_INTERFACE("a5cd92ff-29be-454c-8d04-d82879fb3f1b")
-    IVirtualDesktopManager : public IUnknown
+// hwnd -> what can't change during the window's life, lazy mode only. Swept like
+// the process names, so a reused handle starts over.
+struct CachedWindow
 {
-public:
-    virtual ~IVirtualDesktopManager() = default;
-    virtual HRESULT STDMETHODCALLTYPE IsWindowOnCurrentVirtualDesktop(
-        HWND topLevelWindow,
-        BOOL* onCurrentDesktop) = 0;
-
-    virtual HRESULT STDMETHODCALLTYPE GetWindowDesktopId(
-        HWND topLevelWindow,
-        GUID* desktopId) = 0;
-
-    virtual HRESULT STDMETHODCALLTYPE MoveWindowToDesktop(
-        HWND topLevelWindow,
-        REFGUID desktopId) = 0;
+    std::string className;
+    DWORD processId = 0;
+    // FIELD_CLASS and FIELD_PROCESS (the pid) once fetched
+    WindowFields known = 0;
+    uint64_t generation = 0;
 };
 
-// Function to check if a window should appear in Alt+Tab
-bool IsAltTabWindow(HWND hwnd)
+// guards the caches and the stats, held across the backend calls that fill them
+static std::mutex metadataMutex;
+static std::unordered_map<DWORD, CachedProcessName> processNames;
+static std::unordered_map<HWND, CachedWindow> windowCache;
+static HostedAppResolver hostedApps;
+static uint64_t metadataGeneration = 0;
+static WindowFieldStats fieldStats;
+
+// handles forget_window() was told about, dropped from the caches by the next
+// enumeration. Their own lock so the destroy notification never waits for one.
+static std::mutex destroyedMutex;
+static std::vector<HWND> destroyedWindows;
+
+static std::atomic<bool> lazyMode{false};
+static std::atomic<WindowFields> requiredFields{0};
+
+static const std::string& cached_process_name(WindowBackend& backend, const DWORD processId)
+{
+    auto [it, inserted] = processNames.try_emplace(processId);
+    if (inserted)
+    {
+        it->second.name = backend.process_name(processId);
+        ++fieldStats.processNames;
+    }
+    it->second.generation = metadataGeneration;
+    return it->second.name;
+}
+
+// Fills in the fields info is missing, callers hold metadataMutex
+static void fill_fields(WindowBackend& backend, WindowInfo& info, const WindowFields fields, const bool cache)
 {
-    if (!IsWindowVisible(hwnd))
+    const WindowFields missing = fields & ~info.resolved;
+    if (missing == 0) return;
+
+    if (missing & FIELD_TITLE)
     {
-        return false;
+        info.title = backend.title(info.hwnd);
+        ++fieldStats.titles;
     }
 
-    DWORD exStyle = GetWindowLong(hwnd, GWL_EXSTYLE);
-    if (exStyle & WS_EX_TOOLWINDOW)
+    CachedWindow* cached = nullptr;
+    if (cache && (missing & (FIELD_CLASS | FIELD_PROCESS)))
     {
-        return false;
+        cached = &windowCache[info.hwnd];
+        cached->generation = metadataGeneration;
     }
 
-    HWND owner = GetWindow(hwnd, GW_OWNER);
-    if (!(exStyle & WS_EX_APPWINDOW) && owner != nullptr)
+    if (missing & FIELD_CLASS)
     {
-        return false;
+        if (!cached || !(cached->known & FIELD_CLASS))
+        {
+            info.className = backend.class_name(info.hwnd);
+            ++fieldStats.classNames;
+            if (cached)
+            {
+                cached->className = info.className;
+                cached->known |= FIELD_CLASS;
+            }
+        }
+        else
+        {
+            info.className = cached->className;
+        }
     }
 
-    char title[256];
-    GetWindowTextA(hwnd, title, sizeof(title));
-    if (strlen(title) == 0)
+    if (missing & FIELD_PROCESS)
     {
-        if (!(exStyle & WS_EX_APPWINDOW))
+        if (!cached || !(cached->known & FIELD_PROCESS))
+        {
+            info.processId = backend.process_id(info.hwnd);
+            ++fieldStats.processIds;
+            if (cached)
+            {
+                cached->processId = info.processId;
+                cached->known |= FIELD_PROCESS;
+            }
+        }
+        else
         {
-            return false;
+            info.processId = cached->processId;
+        }
+        info.processName = cached_process_name(backend, info.processId);
+
+        // a UWP frame, the app behind it is what the window is listed and ordered by
+        if (is_frame_host(info.processName))
+        {
+            if (const AppIdentity* app = hostedApps.resolve(backend, info.hwnd, info.processId, metadataGeneration))
+            {
+                info.processId = app->processId;
+                info.processName = app->processName;
+                info.package = app->package;
+            }
         }
     }
 
-    return true;
+    info.resolved |= missing;
 }
 
-// Get process name from process ID
-std::string GetProcessName(const DWORD processId)
+// Keeps the cache entries of a listed window alive without fetching anything
+static void touch_cached(const HWND hwnd)
 {
-    const HANDLE hProcess = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, processId);
-    if (hProcess)
+    const auto it = windowCache.find(hwnd);
+    if (it == windowCache.end()) return;
+
+    it->second.generation = metadataGeneration;
+    hostedApps.keep(hwnd, metadataGeneration);
+    if (it->second.known & FIELD_PROCESS)
     {
-        char processName[MAX_PATH];
-        if (GetModuleBaseNameA(hProcess, nullptr, processName, sizeof(processName)))
+        if (const auto name = processNames.find(it->second.processId); name != processNames.end())
         {
-            CloseHandle(hProcess);
-            return std::string(processName);
+            name->second.generation = metadataGeneration;
         }
-        CloseHandle(hProcess);
     }
-    return "Unknown";
 }
 
-// Callback function for EnumWindows
-BOOL CALLBACK EnumWindowsForDesktopProc(
-    HWND hwnd,
-    LPARAM lParam,
-    IVirtualDesktopManager* vdm,
-    std::vector<WindowInfo>* g_windows
-)
+void seed_process_name(const DWORD processId, const std::string& name)
+{
+    std::lock_guard lock(metadataMutex);
+    processNames.try_emplace(processId, CachedProcessName{name, metadataGeneration});
+}
+
+void forget_window(const HWND hwnd)
+{
+    std::lock_guard lock(destroyedMutex);
+    destroyedWindows.push_back(hwnd);
+}
+
+// Callers hold metadataMutex
+static void drop_destroyed_windows()
 {
-    if (IsAltTabWindow(hwnd))
+    std::vector<HWND> destroyed;
+    {
+        std::lock_guard lock(destroyedMutex);
+        destroyed.swap(destroyedWindows);
+    }
+    for (const HWND hwnd : destroyed)
     {
-        WindowInfo info;
-        info.hwnd = hwnd;
+        windowCache.erase(hwnd);
+        hostedApps.forget(hwnd);
+    }
+}
 
-        // Get window title
-        char title[256];
-        GetWindowTextA(hwnd, title, sizeof(title));
-        info.title = title;
+void set_lazy_metadata(const bool lazy)
+{
+    lazyMode = lazy;
+}
 
-        // Get class name
-        char className[256];
-        GetClassNameA(hwnd, className, sizeof(className));
-        info.className = className;
+bool lazy_metadata()
+{
+    return lazyMode;
+}
 
-        // Get process ID
-        GetWindowThreadProcessId(hwnd, &info.processId);
+void set_required_window_fields(const WindowFields fields)
+{
+    requiredFields = fields;
+}
 
-        // Check if window is on current virtual desktop
-        info.isOnCurrentDesktop = false;
-        if (vdm)
-        {
-            BOOL onCurrentDesktop = FALSE;
-            HRESULT hr = vdm->IsWindowOnCurrentVirtualDesktop(hwnd, &onCurrentDesktop);
-            if (SUCCEEDED(hr))
-            {
-                info.isOnCurrentDesktop = onCurrentDesktop == TRUE;
-            }
-        }
+void resolve_window_fields(WindowBackend& backend, const std::span<WindowInfo> windows, const WindowFields fields)
+{
+    const auto complete = [&](const WindowInfo& window) { return (window.resolved & fields) == fields; };
+    if (std::ranges::all_of(windows, complete)) return;
 
-        info.processName = GetProcessName(info.processId);
-        g_windows->push_back(info);
+    std::lock_guard lock(metadataMutex);
+    drop_destroyed_windows();
+    for (auto& window : windows)
+    {
+        fill_fields(backend, window, fields, true);
     }
+}
 
-    return TRUE;
+WindowFieldStats window_field_stats()
+{
+    std::lock_guard lock(metadataMutex);
+    WindowFieldStats stats = fieldStats;
+    stats.childWalks = hostedApps.walks();
+    return stats;
 }
 
+size_t metadata_cache_bytes()
+{
+    const auto heap_bytes = [](const std::string& text)
+    {
+        return text.capacity() > std::string().capacity() ? text.capacity() + 1 : 0;
+    };
+
+    std::lock_guard lock(metadataMutex);
+    size_t total = hostedApps.bytes();
+    total += processNames.bucket_count() * sizeof(void*) + windowCache.bucket_count() * sizeof(void*);
+    for (const auto& [processId, cached] : processNames)
+    {
+        total += sizeof(std::pair<const DWORD, CachedProcessName>) + 2 * sizeof(void*) + heap_bytes(cached.name);
+    }
+    for (const auto& [hwnd, cached] : windowCache)
+    {
+        total += sizeof(std::pair<const HWND, CachedWindow>) + 2 * sizeof(void*) + heap_bytes(cached.className);
+    }
+    return total;
+}
+
+WindowBackend& window_backend()
+{
+    return *current_backend;
+}
+
+void set_window_backend(WindowBackend* backend)
+{
+    current_backend = backend;
+}
+
+// User rules last, they may need the class or the process name. The fields they
+// look at are fetched here and count towards the stage.
+struct RulesStage
+{
+    static constexpr const char* name = "rules";
+    static constexpr int cost = 4;
+
+    WindowFields fields = 0;
+    bool lazy = false;
+
+    void begin()
+    {
+        fields = window_rule_fields();
+    }
+
+    bool accept(Candidate& window) const
+    {
+        fill_fields(window.backend, window.info, fields, lazy);
+        return apply_window_rules(window.info);
+    }
+};
+
+// guarded by metadataMutex
+static EligibilityPipeline<VisibleStage, ToolWindowStage, OwnerStage, CloakedStage, TitleStage, RulesStage>
+    altTabPipeline;
+
+std::vector<StageStats> eligibility_stats()
+{
+    std::lock_guard lock(metadataMutex);
+    const auto stats = altTabPipeline.stats();
+    return {stats.begin(), stats.end()};
+}
+
+// Collects the details for one enumerated window, callers hold metadataMutex
+static void EnumWindowsForDesktopProc(
+    WindowBackend& backend,
+    const HWND hwnd,
+    std::vector<WindowInfo>* g_windows,
+    const WindowFields fields,
+    const bool lazy
+)
+{
+    Candidate candidate(backend, hwnd);
+    const bool accepted = altTabPipeline.accept(candidate);
+    if (candidate.fetchedTitle)
+    {
+        ++fieldStats.titles;
+    }
+    if (!accepted)
+    {
+        return;
+    }
+
+    WindowInfo& info = candidate.info;
+    if (lazy)
+    {
+        touch_cached(hwnd);
+    }
+    fill_fields(backend, info, lazy ? fields : ALL_WINDOW_FIELDS, lazy);
+
+    // Check if window is on current virtual desktop
+    info.isOnCurrentDesktop = backend.is_on_current_desktop(hwnd);
+    ++fieldStats.desktops;
+
+    g_windows->push_back(std::move(info));
+}
+
+// Debug dump of the enumeration result. Uses the process name already resolved
+// during enumeration and compiles away entirely below debug level.
 void print_windows(
     const bool currentDesktopOnly,
     const std::vector<WindowInfo>& currentDesktopWindows,
     const std::vector<WindowInfo>& otherDesktopWindows
 )
 {
+#if FMW_LOG_LEVEL <= FMW_LOG_LEVEL_DEBUG
     if (currentDesktopOnly)
     {
-        std::cout << "Windows on CURRENT Virtual Desktop (" << currentDesktopWindows.size() << " found):\n";
-        std::cout << "============================================\n\n";
+        LOG_DEBUG("Windows on CURRENT Virtual Desktop ({} found)", currentDesktopWindows.size());
 
         for (size_t i = 0; i < currentDesktopWindows.size(); ++i)
         {
             const WindowInfo& info = currentDesktopWindows[i];
-            std::string processName = GetProcessName(info.processId);
-
-            std::cout << "[" << (i + 1) << "] " << info.title << "\n";
-            std::cout << "    Handle: 0x" << std::hex << info.hwnd << std::dec << "\n";
-            std::cout << "    Class:  " << info.className << "\n";
-            std::cout << "    Process: " << processName << " (PID: " << info.processId << ")\n\n";
+            LOG_DEBUG("[{}] {} | handle {} | class {} | {} (PID: {})",
+                      i + 1, info.title, info.hwnd, info.className, info.processName, info.processId);
         }
     }
     else
     {
-        // Show all windows with desktop indication
-        std::cout << "All Windows with Desktop Status:\n";
-        std::cout << "================================\n\n";
-
-        std::cout << "CURRENT DESKTOP (" << currentDesktopWindows.size() << " windows):\n";
-        std::cout << "-------------------\n";
+        LOG_DEBUG("CURRENT DESKTOP ({} windows)", currentDesktopWindows.size());
         for (const auto& info : currentDesktopWindows)
         {
-            std::string processName = GetProcessName(info.processId);
-            std::cout << "• " << info.title << " (" << processName << ")\n";
+            LOG_DEBUG("  {} ({})", info.title, info.processName);
         }
 
-        std::cout << "\nOTHER DESKTOPS (" << otherDesktopWindows.size() << " windows):\n";
-        std::cout << "------------------\n";
+        LOG_DEBUG("OTHER DESKTOPS ({} windows)", otherDesktopWindows.size());
         for (const auto& info : otherDesktopWindows)
         {
-            std::string processName = GetProcessName(info.processId);
-            std::cout << "• " << info.title << " (" << processName << ")\n";
+            LOG_DEBUG("  {} ({})", info.title, info.processName);
         }
     }
+#else
+    (void)currentDesktopOnly;
+    (void)currentDesktopWindows;
+    (void)otherDesktopWindows;
+#endif
 }
 
 // Function to list windows filtered by desktop
-std::vector<WindowInfo> ListWindowsByDesktop(bool currentDesktopOnly = true)
+std::vector<WindowInfo> ListWindowsByDesktop(WindowBackend& backend, bool currentDesktopOnly,
+                                             const WindowFields fields)
 {
-    // Initialize COM
-    HRESULT hr = CoInitialize(nullptr);
-    if (FAILED(hr))
-    {
-        std::cout << "Failed to initialize COM: " << std::hex << hr << std::endl;
-        return {};
-    }
-
-    // Create Virtual Desktop Manager
-    ComPtr<IVirtualDesktopManager> vdm;
-    hr = CoCreateInstance(CLSID_VirtualDesktopManager, nullptr, CLSCTX_ALL,
-                          IID_IVirtualDesktopManager, &vdm);
-
-    if (FAILED(hr))
+    if (!backend.has_virtual_desktops())
     {
-        std::cout << "Virtual Desktop Manager not available (Windows 10/11 required)" << std::endl;
-        std::cout << "Listing all windows instead...\n" << std::endl;
         currentDesktopOnly = false;
     }
 
+    // Enumerate all windows
+    std::vector<HWND> handles;
+    backend.enum_windows(handles);
 
-    struct EnumContext
-    {
-        IVirtualDesktopManager* vdm;
-        std::vector<WindowInfo>* windows;
-    };
+    const bool lazy = lazyMode;
+    const WindowFields wanted = fields | requiredFields;
 
     std::vector<WindowInfo> windows;
-    IVirtualDesktopManager* g_vdm = vdm.Get();
+    {
+        std::lock_guard lock(metadataMutex);
+        ++metadataGeneration;
+        drop_destroyed_windows();
+        altTabPipeline.stage<RulesStage>().lazy = lazy;
+        altTabPipeline.begin();
 
-    EnumContext context = {g_vdm, &windows};
+        for (const HWND hwnd : handles)
+        {
+            EnumWindowsForDesktopProc(backend, hwnd, &windows, wanted, lazy);
+        }
 
-    // Enumerate all windows
-    EnumWindows([](const HWND hwnd, const LPARAM lParam) -> BOOL
-    {
-        const auto ctx = reinterpret_cast<EnumContext*>(lParam);
-        return EnumWindowsForDesktopProc(hwnd, 0, ctx->vdm, ctx->windows);
-    }, reinterpret_cast<LPARAM>(&context));
+        std::erase_if(processNames, [](const auto& entry)
+        {
+            return entry.second.generation != metadataGeneration;
+        });
+        std::erase_if(windowCache, [](const auto& entry)
+        {
+            return entry.second.generation != metadataGeneration;
+        });
+        hostedApps.sweep(metadataGeneration);
+    }
 
     // Filter and display results
     std::vector<WindowInfo> currentDesktopWindows;
@@ -234,58 +411,30 @@ std::vector<WindowInfo> ListWindowsByDesktop(bool currentDesktopOnly = true)
 
     print_windows(currentDesktopOnly, currentDesktopWindows, otherDesktopWindows);
 
-    // let ComPtr handle the release automatically, then uninitialize COM
-    vdm.Reset(); // Explicitly release the COM object
-    CoUninitialize();
-
     return otherDesktopWindows;
 }
 
-// Function to get desktop GUID for a window
-void ShowWindowDesktopInfo(const HWND hwnd)
+std::vector<WindowInfo> ListWindowsByDesktop(const bool currentDesktopOnly)
 {
-    HRESULT hr = CoInitialize(nullptr);
-    if (FAILED(hr)) return;
-
-    ComPtr<IVirtualDesktopManager> vdm;
-    hr = CoCreateInstance(CLSID_VirtualDesktopManager, nullptr, CLSCTX_ALL,
-                          IID_IVirtualDesktopManager, &vdm);
-
-    if (SUCCEEDED(hr))
-    {
-        GUID desktopId;
-        hr = vdm->GetWindowDesktopId(hwnd, &desktopId);
-        if (SUCCEEDED(hr))
-        {
-            std::cout << "Desktop ID: {" << std::hex
-                << desktopId.Data1 << "-" << desktopId.Data2 << "-"
-                << desktopId.Data3 << "-";
-            for (int i = 0; i < 8; i++)
-            {
-                std::cout << static_cast<int>(desktopId.Data4[i]);
-                if (i == 1) std::cout << "-";
-            }
-            std::cout << "}" << std::dec << std::endl;
-        }
-    }
-
-    CoUninitialize();
+    return ListWindowsByDesktop(window_backend(), currentDesktopOnly, ALL_WINDOW_FIELDS);
 }
 
 // Function to bring a window to front
-void BringWindowToFront(HWND hwnd)
+bool BringWindowToFront(const HWND hwnd, HWND from)
 {
-    // Restore if minimized
-    if (IsIconic(hwnd))
+    WindowBackend& backend = window_backend();
+    if (!from) from = backend.foreground();
+
+    if (backend.activate(hwnd))
     {
-        ShowWindow(hwnd, SW_RESTORE);
+        LOG_DEBUG("Brought window to front: {}", hwnd);
+        transition_model().record(from, hwnd);
+        // the foreground notification does the same on Win32, this covers desktops without one
+        mru_stack().touch(from);
+        mru_stack().touch(hwnd);
+        return true;
     }
 
-    // Bring to foreground
-    SetForegroundWindow(hwnd);
-    BringWindowToTop(hwnd);
-
-    char title[256];
-    GetWindowTextA(hwnd, title, sizeof(title));
-    std::cout << "Brought window to front: " << title << std::endl;
+    LOG_WARN("Could not bring window to front: {}", hwnd);
+    return false;
 }
@@ -1,22 +1,94 @@
 #ifndef FINDMYTABS_TABS_H
 #define FINDMYTABS_TABS_H
 
-#include <windows.h>
+#include <cstdint>
+#include <span>
 #include <vector>
 #include <string>
 
+#include "platform.h"
+
+// Window metadata that costs backend calls to fetch. Desktop membership isn't
+// one of them, it decides whether a window is listed at all.
+using WindowFields = uint8_t;
+constexpr WindowFields FIELD_TITLE = 1;
+constexpr WindowFields FIELD_CLASS = 2;
+// processId and processName
+constexpr WindowFields FIELD_PROCESS = 4;
+constexpr WindowFields ALL_WINDOW_FIELDS = FIELD_TITLE | FIELD_CLASS | FIELD_PROCESS;
+
 struct WindowInfo
 {
-    HWND hwnd;
-    std::string title;
-    std::string className;
+    HWND hwnd = nullptr;
+    std::string title{};
+    std::string className{};
     std::string processName = "";
-    DWORD processId;
-    bool isOnCurrentDesktop;
+    DWORD processId = 0;
+    bool isOnCurrentDesktop = false;
+    // slot from a pin rule, 1-based, 0 when not pinned
+    int pinnedSlot = 0;
+    // set on switcher entries for a browser tab of hwnd, see browser_tabs.h
+    uint64_t tabNode = 0;
+    // fields filled in, the others stay empty until resolve_window_fields()
+    WindowFields resolved = ALL_WINDOW_FIELDS;
+    // package family name of a UWP app, whose frame belongs to another process.
+    // processId and processName are the app's then, see app_identity.h
+    std::string package{};
+    // identity across restarts, set by fingerprint_windows(), 0 until then, see fingerprint.h
+    uint64_t fingerprint = 0;
 };
 
+// Backend calls made for each field by the enumeration and resolve_window_fields()
+struct WindowFieldStats
+{
+    uint64_t titles = 0;
+    uint64_t classNames = 0;
+    uint64_t processIds = 0;
+    uint64_t processNames = 0;
+    uint64_t desktops = 0;
+    // frame host windows walked for the app inside
+    uint64_t childWalks = 0;
+};
+
+class WindowBackend;
+
+// Lazy mode lists only the fields asked for plus what the alt-tab filter had to
+// fetch anyway, eager mode (the default) always lists every field
+std::vector<WindowInfo> ListWindowsByDesktop(WindowBackend& backend, bool currentDesktopOnly,
+                                             WindowFields fields = ALL_WINDOW_FIELDS);
+
+// Lists through window_backend()
 std::vector<WindowInfo> ListWindowsByDesktop(bool currentDesktopOnly);
 
-void BringWindowToFront(HWND hwnd);
+// Primes the process name cache, e.g. from a restored state snapshot.
+// Only seed pids that were just confirmed to still own a window.
+void seed_process_name(DWORD processId, const std::string& name);
+
+// A window was destroyed, its handle can come back as a different window. The
+// caches keyed by handle drop it on the next enumeration, any thread.
+void forget_window(HWND hwnd);
+
+// In lazy mode a window's class and pid are fetched once and kept until an
+// enumeration no longer sees it, titles and desktops are fetched every time
+void set_lazy_metadata(bool lazy);
+bool lazy_metadata();
+
+// Fields every enumeration fetches in lazy mode too, for a consumer that looks
+// at every window on each refresh. 0 when it goes away.
+void set_required_window_fields(WindowFields fields);
+
+// Fills in the fields the windows were listed without. Cheap for windows that
+// have them already, any thread.
+void resolve_window_fields(WindowBackend& backend, std::span<WindowInfo> windows, WindowFields fields);
+
+WindowFieldStats window_field_stats();
+
+// What the process name, class, pid and UWP app caches hold, an estimate
+size_t metadata_cache_bytes();
+
+// Activates hwnd, trains transition_model() on the switch and moves both windows
+// up the MRU stack. from is the window the switch started at, the current
+// foreground window when null. Returns whether the window came to the front.
+bool BringWindowToFront(HWND hwnd, HWND from = nullptr);
 
 #endif //FINDMYTABS_TABS_H
@@ -0,0 +1,169 @@
+#include "actions.h"
+#include "backend.h"
+#include "fake_backend.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+static bool overlaps(const WindowRect& a, const WindowRect& b)
+{
+    return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+// Cells stay inside the area, don't overlap and cover it completely
+static size_t check_tile_layout(const WindowRect& area, const size_t count)
+{
+    const auto cells = tile_layout(area, count);
+    long long covered = 0;
+    bool ok = cells.size() == count;
+    for (size_t i = 0; i < cells.size() && ok; ++i)
+    {
+        const WindowRect& cell = cells[i];
+        ok = cell.width > 0 && cell.height > 0 && cell.x >= area.x && cell.y >= area.y &&
+            cell.x + cell.width <= area.x + area.width && cell.y + cell.height <= area.y + area.height;
+        covered += static_cast<long long>(cell.width) * cell.height;
+        for (size_t j = i + 1; j < cells.size() && ok; ++j)
+        {
+            ok = !overlaps(cell, cells[j]);
+        }
+    }
+    if (ok && covered == static_cast<long long>(area.width) * area.height) return 0;
+
+    printf("  tile layout of %zu windows in %dx%d is wrong\n", count, area.width, area.height);
+    return 1;
+}
+
+static std::mutex actionResultsMutex;
+static std::vector<ActionResult> actionResults;
+
+static void record_action(const ActionResult& result)
+{
+    std::lock_guard lock(actionResultsMutex);
+    actionResults.push_back(result);
+}
+
+int test_actions()
+{
+    size_t failures = 0;
+    for (size_t count = 1; count <= 64; ++count)
+    {
+        failures += check_tile_layout({0, 0, 1920, 1040}, count);
+        failures += check_tile_layout({-1280, 17, 1277, 1001}, count);
+    }
+
+    FakeBackend backend;
+    std::vector<HWND> handles;
+    for (int i = 0; i < 64; ++i)
+    {
+        handles.push_back(backend.add_window({
+            .title = "window " + std::to_string(i), .className = "Fake", .processName = "fake.exe",
+            .onCurrentDesktop = i % 2 == 0,
+        }));
+    }
+    set_window_backend(&backend);
+    actionResults.clear();
+    actions_start(nullptr, record_action);
+
+    const auto take = [&](const size_t from, const size_t count)
+    {
+        return std::vector(handles.begin() + static_cast<ptrdiff_t>(from),
+                           handles.begin() + static_cast<ptrdiff_t>(from + count));
+    };
+
+    // tile: one positioning batch for the whole selection
+    const size_t batchesBefore = backend.position_batches();
+    submit_action({WindowActionType::Tile, take(0, 9)});
+    actions_wait_idle();
+    if (backend.position_batches() != batchesBefore + 1)
+    {
+        printf("  tiling 9 windows took %zu positioning batches\n", backend.position_batches() - batchesBefore);
+        ++failures;
+    }
+    const auto cells = tile_layout(backend.work_area(), 9);
+    for (size_t i = 0; i < 9; ++i)
+    {
+        FakeWindow window;
+        if (!backend.get_window(handles[i], window) || window.rect.x != cells[i].x || window.rect.y != cells[i].y ||
+            window.rect.width != cells[i].width || window.rect.height != cells[i].height)
+        {
+            printf("  window %zu was not placed in its tile\n", i);
+            ++failures;
+        }
+    }
+
+    submit_action({WindowActionType::Minimize, take(10, 4)});
+    submit_action({WindowActionType::MoveToDesktop, take(20, 6), handles[1]});
+    submit_action({WindowActionType::Close, take(30, 8)});
+    // already closed, reported as failures rather than dropped
+    submit_action({WindowActionType::Close, take(34, 8)});
+    actions_wait_idle();
+
+    for (size_t i = 0; i < handles.size(); ++i)
+    {
+        FakeWindow window;
+        const bool exists = backend.get_window(handles[i], window);
+        const bool closed = i >= 30 && i < 42;
+        const bool minimized = i >= 10 && i < 14;
+        const bool onCurrent = i >= 20 && i < 26 ? false : i % 2 == 0;
+        if (exists == closed || (exists && (window.minimized != minimized || window.onCurrentDesktop != onCurrent)))
+        {
+            printf("  window %zu is in the wrong state after the batch\n", i);
+            ++failures;
+        }
+    }
+
+    {
+        std::lock_guard lock(actionResultsMutex);
+        const bool partialReported = actionResults.size() == 5 && actionResults[4].requested == 8 &&
+            actionResults[4].succeeded == 4;
+        if (!partialReported)
+        {
+            printf("  per-action results missing or wrong\n");
+            ++failures;
+        }
+        actionResults.clear();
+    }
+
+    // timing: how long the caller is held up versus how long the batch takes
+    constexpr int rounds = 2000;
+    uint64_t submitNs = 0;
+    for (int round = 0; round < rounds; ++round)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        submit_action({WindowActionType::Tile, take(0, 16)});
+        submitNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).
+            count();
+    }
+    actions_wait_idle();
+    actions_stop();
+
+    uint64_t runUs = 0;
+    uint64_t queuedUs = 0;
+    uint64_t maxQueuedUs = 0;
+    for (const auto& result : actionResults)
+    {
+        runUs += result.runUs;
+        queuedUs += result.queuedUs;
+        maxQueuedUs = std::max(maxQueuedUs, result.queuedUs);
+    }
+    const double count = static_cast<double>(actionResults.size());
+    printf("tile x16     %d actions, submit %.2f us, run %.2f us, queued %.1f us avg / %llu us max\n", rounds,
+           submitNs / 1e3 / rounds, count ? runUs / count : 0.0, count ? queuedUs / count : 0.0,
+           static_cast<unsigned long long>(maxQueuedUs));
+    if (actionResults.size() != rounds)
+    {
+        printf("  %zu of %d actions reported\n", actionResults.size(), rounds);
+        ++failures;
+    }
+
+    if (failures)
+    {
+        printf("actions: %zu failures\n", failures);
+        return 1;
+    }
+    printf("actions: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,50 @@
+#include "tests/alloc_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+// Per-thread so measuring one thread isn't disturbed by the logger or IPC threads,
+// and the increment stays a plain store on the allocation path.
+static thread_local uint64_t allocations = 0;
+
+uint64_t thread_alloc_count()
+{
+    return allocations;
+}
+
+// The nothrow forms forward to these by default, the sized and array ones are
+// replaced too so every deallocation ends up in the same free().
+void* operator new(const std::size_t size)
+{
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](const std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    operator delete(p);
+}
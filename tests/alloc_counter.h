@@ -0,0 +1,11 @@
+#ifndef FINDMYWINDOWS_ALLOC_COUNTER_H
+#define FINDMYWINDOWS_ALLOC_COUNTER_H
+
+#include <cstdint>
+
+// Heap allocations made by the calling thread so far, counted by the global
+// operator new replacement in alloc_counter.cpp. Only the tests link it, the app
+// keeps the library's allocator. Take the difference around the code under measurement.
+uint64_t thread_alloc_count();
+
+#endif //FINDMYWINDOWS_ALLOC_COUNTER_H
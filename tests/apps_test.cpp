@@ -0,0 +1,295 @@
+#include "app_index.h"
+#include "query.h"
+#include "switcher.h"
+#include "tabs.h"
+#include "tests/test_support.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// path, name and command of every entry, to compare two indexes
+static std::vector<std::string> index_contents(const AppIndex& index)
+{
+    std::vector<std::string> contents;
+    for (uint32_t entry = 0; entry < index.size(); ++entry)
+    {
+        contents.push_back(std::string(index.path(entry)) + "|" + std::string(index.name(entry)) + "|" +
+                           std::string(index.command(entry)));
+    }
+    return contents;
+}
+
+int test_apps()
+{
+    size_t failures = 0;
+    const auto expect = [&](const bool ok, const char* what)
+    {
+        if (!ok)
+        {
+            printf("  apps: %s\n", what);
+            ++failures;
+        }
+    };
+
+    // coalescing keeps the last change of each path, in order
+    std::vector<AppChange> burst{
+        {AppChange::Kind::Changed, "a"}, {AppChange::Kind::Changed, "b"}, {AppChange::Kind::Removed, "a"},
+    };
+    coalesce_changes(burst);
+    expect(burst.size() == 2 && burst[0].path == "b" && burst[1].kind == AppChange::Kind::Removed,
+           "coalescing kept the wrong changes");
+
+    // a system tree of 300 directories with 100 entries each and a small user one
+    const std::filesystem::path base = std::filesystem::temp_directory_path() / "fmw_apps_bench";
+    std::filesystem::remove_all(base);
+    const std::filesystem::path system = base / "system";
+    const std::filesystem::path user = base / "user";
+    constexpr size_t dirCount = 300;
+    constexpr size_t perDir = 100;
+    size_t expected = 0;
+    const auto generated = seconds_for([&]
+    {
+        for (size_t dir = 0; dir < dirCount; ++dir)
+        {
+            const std::filesystem::path folder = system / ("vendor" + std::to_string(dir));
+            std::filesystem::create_directories(folder);
+            write_text(folder / "README.txt", "not an app\n");
+            for (size_t file = 0; file < perDir; ++file)
+            {
+                const size_t id = dir * perDir + file;
+                const bool shown = id % 50 != 7;
+                write_text(folder / ("app" + std::to_string(id) + ".desktop"),
+                           desktop_file("App " + std::to_string(id), "/opt/app" + std::to_string(id) + "/bin/app",
+                                        shown));
+                expected += shown;
+            }
+        }
+        std::filesystem::create_directories(user / "Tools");
+        for (size_t file = 0; file < 10; ++file)
+        {
+            write_text(user / ("mine" + std::to_string(file) + ".desktop"),
+                       desktop_file("Mine " + std::to_string(file), "mine --id=" + std::to_string(file)));
+        }
+        write_text(user / "Tools" / "Notepad++.lnk", "");
+        expected += 11;
+    });
+    const std::vector<std::string> roots{system.string(), user.string() + "/"};
+    printf("  generated %zu entries in %.2f s\n", expected, generated);
+
+    AppIndex index;
+    const double scanSeconds = seconds_for([&] { index.scan(roots); });
+    printf("  full scan: %zu apps in %.0f ms, %.1f us per file, %zu bytes (%.0f per app)\n", index.size(),
+           scanSeconds * 1e3, scanSeconds * 1e6 / static_cast<double>(index.stats().parsed), index.bytes(),
+           static_cast<double>(index.bytes()) / static_cast<double>(std::max<size_t>(index.size(), 1)));
+    expect(index.size() == expected, "the scan missed entries or kept hidden ones");
+    expect(index.bytes() < index.size() * 160, "the index takes more than 160 bytes an app");
+
+    bool fieldsRight = false;
+    bool shortcutRight = false;
+    for (uint32_t entry = 0; entry < index.size(); ++entry)
+    {
+        if (index.path(entry).ends_with("app1234.desktop"))
+        {
+            fieldsRight = index.name(entry) == "App 1234" && index.command(entry) == "/opt/app1234/bin/app";
+        }
+        if (index.path(entry).ends_with("Notepad++.lnk"))
+        {
+            shortcutRight = index.name(entry) == "Notepad++" && index.command(entry) == index.path(entry);
+        }
+    }
+    expect(fieldsRight, "a .desktop entry has the wrong name or kept its field codes");
+    expect(shortcutRight, "a shortcut isn't named after its file");
+
+    // searching 30k apps with the switcher's query
+    WindowQuery query;
+    query.compile("app 12");
+    std::vector<uint32_t> found;
+    constexpr size_t searches = 50;
+    const double searchSeconds = seconds_for([&]
+    {
+        for (size_t i = 0; i < searches; ++i) index.search(query, found, SwitcherList::app_row_limit);
+    });
+    printf("  searching %zu apps: %.0f us per query\n", index.size(), searchSeconds * 1e6 / searches);
+    expect(found.size() == SwitcherList::app_row_limit, "the search returned the wrong number of apps");
+    expect(std::ranges::all_of(found, [&](const uint32_t entry)
+    {
+        return icontains(index.name(entry), "app") && icontains(index.name(entry), "12");
+    }), "the search returned an app the query doesn't match");
+    expect(std::ranges::is_sorted(found, {}, [&](const uint32_t entry) { return lowered(index.name(entry)); }),
+           "the search results aren't sorted by name");
+    query.compile("proc:mine");
+    index.search(query, found, SwitcherList::app_row_limit);
+    expect(found.size() == 10, "proc: doesn't search the commands");
+    query.compile("desktop:current app");
+    index.search(query, found, SwitcherList::app_row_limit);
+    expect(found.empty(), "an app matched a desktop term");
+
+    // the saved index, and one saved for other roots
+    const std::string indexPath = (base / "findmywindows.apps").string();
+    const double saveSeconds = seconds_for([&] { expect(index.save(indexPath), "saving the index failed"); });
+    AppIndex loaded;
+    bool loadedOk = false;
+    const double loadSeconds = seconds_for([&] { loadedOk = loaded.load(indexPath, roots); });
+    printf("  saved in %.1f ms, loaded in %.1f ms, %ju bytes on disk\n", saveSeconds * 1e3, loadSeconds * 1e3,
+           static_cast<uintmax_t>(std::filesystem::file_size(indexPath)));
+    expect(loadedOk && index_contents(loaded) == index_contents(index), "the loaded index differs from the saved one");
+    AppIndex other;
+    expect(!other.load(indexPath, {system.string()}), "an index of other roots loaded");
+    {
+        const std::string truncated = (base / "truncated.apps").string();
+        std::filesystem::copy_file(indexPath, truncated);
+        std::filesystem::resize_file(truncated, std::filesystem::file_size(truncated) / 2);
+        expect(!other.load(truncated, roots), "a truncated index loaded");
+    }
+
+    // changes while nothing watched: only the directories that changed are listed again
+    for (size_t file = 0; file < 5; ++file)
+    {
+        write_text(system / "vendor17" / ("late" + std::to_string(file) + ".desktop"),
+                   desktop_file("Late " + std::to_string(file), "late"));
+    }
+    for (size_t file = 0; file < 3; ++file)
+    {
+        std::filesystem::remove(system / "vendor42" / ("app" + std::to_string(4200 + file) + ".desktop"));
+    }
+    std::filesystem::remove_all(system / "vendor99");
+    std::filesystem::create_directories(system / "late" / "deeper");
+    write_text(system / "late" / "deeper" / "deep.desktop", desktop_file("Deep", "deep"));
+
+    AppIndex stale;
+    std::vector<std::string> newDirs;
+    size_t relisted = 0;
+    const double refreshSeconds = seconds_for([&]
+    {
+        stale.load(indexPath, roots);
+        relisted = stale.refresh_stale(newDirs);
+    });
+    AppIndex fresh;
+    fresh.scan(roots);
+    printf("  restart after offline changes: %.1f ms, %zu directories relisted, %llu files read\n",
+           refreshSeconds * 1e3, relisted, static_cast<unsigned long long>(stale.stats().parsed));
+    expect(index_contents(stale) == index_contents(fresh), "the refreshed index differs from a fresh scan");
+    expect(stale.stats().parsed < 3 * perDir, "the stale check read files in unchanged directories");
+    expect(std::ranges::find(newDirs, (system / "late" / "deeper").string()) != newDirs.end(),
+           "a directory added offline wasn't reported for watching");
+
+    // notifications: every change is one binary search and one file read, never a rescan
+    std::unique_ptr<DirectoryWatcher> watcher = make_directory_watcher();
+    if (!watcher)
+    {
+        printf("  no directory watcher on this platform, notifications not checked\n");
+    }
+    else
+    {
+        AppIndex live;
+        live.scan(roots);
+        for (const std::string& dir : live.directories()) watcher->watch(dir);
+        const uint64_t parsedBefore = live.stats().parsed;
+
+        for (size_t file = 0; file < 200; ++file)
+        {
+            write_text(system / ("vendor" + std::to_string(file % dirCount)) / ("new" + std::to_string(file) + ".desktop"),
+                       desktop_file("New " + std::to_string(file), "new"));
+        }
+        for (size_t file = 0; file < 50; ++file)
+        {
+            const size_t id = 100 * perDir + file;
+            write_text(system / "vendor100" / ("app" + std::to_string(id) + ".desktop"),
+                       desktop_file("Renamed " + std::to_string(id), "renamed"));
+            std::filesystem::remove(system / "vendor101" / ("app" + std::to_string(101 * perDir + file) + ".desktop"));
+        }
+        std::filesystem::rename(system / "vendor102" / "app10200.desktop", system / "vendor102" / "app10200.bak");
+        std::filesystem::create_directories(system / "fresh");
+        for (size_t file = 0; file < 20; ++file)
+        {
+            write_text(system / "fresh" / ("fresh" + std::to_string(file) + ".desktop"),
+                       desktop_file("Fresh " + std::to_string(file), "fresh"));
+        }
+        std::filesystem::remove_all(system / "vendor103");
+
+        AppIndex target;
+        target.scan(roots);
+        const std::vector<std::string> wanted = index_contents(target);
+        std::vector<AppChange> changes;
+        size_t applied = 0;
+        double applySeconds = 0;
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (index_contents(live) != wanted && std::chrono::steady_clock::now() < deadline)
+        {
+            changes.clear();
+            watcher->wait(changes, std::chrono::milliseconds(50));
+            coalesce_changes(changes);
+            newDirs.clear();
+            applySeconds += seconds_for([&]
+            {
+                for (const AppChange& change : changes) live.apply(change, newDirs);
+            });
+            for (const std::string& dir : newDirs) watcher->watch(dir);
+            applied += changes.size();
+        }
+        printf("  %zu notifications applied in %.1f us each, %llu files read\n", applied,
+               applySeconds * 1e6 / static_cast<double>(std::max<size_t>(applied, 1)),
+               static_cast<unsigned long long>(live.stats().parsed - parsedBefore));
+        expect(index_contents(live) == wanted, "the notified index differs from a fresh scan");
+        expect(live.stats().parsed - parsedBefore < 1000, "notifications caused a rescan");
+    }
+
+    // the worker: loads the saved index, then follows the user root
+    const std::string workerIndex = (base / "worker.apps").string();
+    const auto wait_for = [](const auto& done)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!done() && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return done();
+    };
+    app_index_start({user.string()}, workerIndex, make_directory_watcher);
+    expect(wait_for([] { return current_apps()->size() == 11; }), "the worker didn't publish the user apps");
+    if (watcher)
+    {
+        write_text(user / "added.desktop", desktop_file("Added", "added"));
+        expect(wait_for([] { return current_apps()->size() == 12; }), "the worker didn't follow a new file");
+    }
+    app_index_stop();
+    expect(current_apps()->size() == 0 && std::filesystem::exists(workerIndex),
+           "stopping the worker kept its index or didn't save it");
+
+    // launcher rows in the switcher, after the windows and never window targets
+    std::vector<WindowInfo> windows{
+        {handle_of(1), "Mine 3 notes - Editor", "Notepad", "notepad.exe", 10, true},
+        {handle_of(2), "Inbox", "Mail", "mail.exe", 11, true},
+    };
+    SwitcherList rows(windows, 0);
+    rows.set_apps(std::make_shared<const AppIndex>(fresh));
+    expect(rows.size() == 2, "launcher rows showed without a query");
+    rows.set_query("mine 3");
+    expect(rows.size() == 2 && !rows.is_app(0) && rows.is_app(1), "launcher rows don't follow the matching windows");
+    rows.select(1);
+    expect(std::string_view(rows.label(1)) == "[app] Mine 3" && rows.window(1).hwnd == nullptr &&
+           rows.apps()->command(rows.app_entry(1)) == "mine --id=3", "a launcher row reads wrong");
+    rows.toggle_mark();
+    expect(!rows.is_marked(1) && rows.take_targets().empty(), "a launcher row took part in a window action");
+    rows.move_selected(-1);
+    expect(rows.is_app(rows.selected()) && !rows.is_app(0), "a launcher row was reordered");
+    FakeBackend backend;
+    expect(backend.launch(std::string(rows.apps()->command(rows.app_entry(1)))) && backend.launches().size() == 1,
+           "the fake desktop didn't record the launch");
+    expect(rows.release().size() == windows.size(), "launcher rows ended up in the window list");
+
+    std::filesystem::remove_all(base);
+    if (failures != 0)
+    {
+        printf("apps: %zu failures\n", failures);
+        return 1;
+    }
+    printf("apps: all checks passed\n");
+    return 0;
+}
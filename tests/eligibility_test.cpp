@@ -0,0 +1,140 @@
+#include "eligibility.h"
+#include "fake_backend.h"
+#include "platform.h"
+#include "tabs.h"
+#include "tests/test_support.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Stage counters gathered since before, same order as eligibility_stats()
+static std::vector<StageStats> stage_stats_since(const std::vector<StageStats>& before)
+{
+    std::vector<StageStats> stats = eligibility_stats();
+    for (size_t i = 0; i < stats.size(); ++i)
+    {
+        stats[i].checked -= before[i].checked;
+        stats[i].rejected -= before[i].rejected;
+        stats[i].nanoseconds -= before[i].nanoseconds;
+    }
+    return stats;
+}
+
+// Windows per stage that should stop there, and what survives, for a desktop of
+// repeats copies of every kind of window
+static void add_window_kinds(FakeBackend& backend, const size_t repeats)
+{
+    for (size_t i = 0; i < repeats; ++i)
+    {
+        const HWND owner = backend.add_window({.title = "main", .processName = "app.exe"});
+        backend.add_window({.title = "hidden", .processName = "app.exe", .visible = false});
+        backend.add_window({.title = "palette", .processName = "app.exe", .exStyle = WS_EX_TOOLWINDOW});
+        backend.add_window({.title = "dialog", .processName = "app.exe", .owner = owner});
+        backend.add_window({.title = "listed dialog", .processName = "app.exe", .exStyle = WS_EX_APPWINDOW,
+                            .owner = owner});
+        backend.add_window({.title = "suspended", .processName = "uwp.exe", .cloaked = DWM_CLOAKED_APP});
+        backend.add_window({.title = "other desktop", .processName = "app.exe", .cloaked = DWM_CLOAKED_SHELL});
+        backend.add_window({.title = "", .processName = "app.exe"});
+        backend.add_window({.title = "", .processName = "app.exe", .exStyle = WS_EX_APPWINDOW});
+        backend.add_window({.title = "Find My Windows", .processName = "findmywindows.exe"});
+    }
+}
+
+// A stage outside tabs.cpp, composed with the built-in ones
+struct ShortTitleStage
+{
+    static constexpr const char* name = "short title";
+    static constexpr int cost = 3;
+    size_t minimum = 6;
+
+    bool accept(Candidate& window) const
+    {
+        return window.title().size() >= minimum;
+    }
+};
+
+int test_eligibility()
+{
+    size_t failures = 0;
+    constexpr size_t repeats = 100;
+
+    forget_process_names();
+    FakeBackend backend;
+    add_window_kinds(backend, repeats);
+
+    const auto before = eligibility_stats();
+    const auto listed = ListWindowsByDesktop(backend, true);
+    const auto stats = stage_stats_since(before);
+
+    // main, listed dialog, other desktop and the untitled app window
+    if (listed.size() != 4 * repeats)
+    {
+        printf("  listed %zu windows, expected %zu\n", listed.size(), 4 * repeats);
+        ++failures;
+    }
+
+    constexpr struct
+    {
+        const char* name;
+        size_t rejected;
+    } expected[] = {
+        {"visible", 1}, {"tool window", 1}, {"owned", 1}, {"cloaked", 1}, {"untitled", 1}, {"rules", 1},
+    };
+    if (stats.size() != std::size(expected))
+    {
+        printf("  %zu stages, expected %zu\n", stats.size(), std::size(expected));
+        return 1;
+    }
+    const double windows = 10.0 * repeats;
+    for (size_t i = 0; i < stats.size(); ++i)
+    {
+        printf("  %-12s %5llu checked %5llu rejected %6.1f ns per window\n", stats[i].name,
+               static_cast<unsigned long long>(stats[i].checked), static_cast<unsigned long long>(stats[i].rejected),
+               static_cast<double>(stats[i].nanoseconds) / windows);
+        if (std::strcmp(stats[i].name, expected[i].name) != 0 || stats[i].rejected != expected[i].rejected * repeats)
+        {
+            printf("  stage %zu should be %s rejecting %zu\n", i, expected[i].name, expected[i].rejected * repeats);
+            ++failures;
+        }
+    }
+
+    // every field is fetched at most once per window, and only once the cheaper stages passed it
+    const size_t visible = 9 * repeats;
+    if (backend.calls(FakeCall::ExStyle) != visible || backend.calls(FakeCall::Title) != 10 * repeats - 4 * repeats ||
+        backend.calls(FakeCall::Cloaked) != stats[3].checked || backend.calls(FakeCall::ClassName) != listed.size())
+    {
+        printf("  fetched %zu ex-styles, %zu titles, %zu cloak states and %zu classes\n",
+               backend.calls(FakeCall::ExStyle), backend.calls(FakeCall::Title), backend.calls(FakeCall::Cloaked),
+               backend.calls(FakeCall::ClassName));
+        ++failures;
+    }
+
+    // composing another stage, on the same candidates
+    EligibilityPipeline<VisibleStage, ToolWindowStage, TitleStage, ShortTitleStage> custom;
+    custom.stage<ShortTitleStage>().minimum = 4;
+    std::vector<HWND> handles;
+    backend.enum_windows(handles);
+    size_t accepted = 0;
+    for (const HWND hwnd : handles)
+    {
+        Candidate candidate(backend, hwnd);
+        accepted += custom.accept(candidate);
+    }
+    // hidden, palette, the untitled one and the untitled app window are out
+    const auto customStats = custom.stats();
+    if (accepted != 6 * repeats || customStats[3].rejected != repeats)
+    {
+        printf("  the composed pipeline accepted %zu windows\n", accepted);
+        ++failures;
+    }
+
+    forget_process_names();
+    if (failures != 0)
+    {
+        printf("eligibility: %zu failures\n", failures);
+        return 1;
+    }
+    printf("eligibility: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,343 @@
+#include "fake_backend.h"
+#include "file.h"
+#include "fingerprint.h"
+#include "state.h"
+#include "tabs.h"
+#include "window_list.h"
+#include "tests/test_support.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+static const char* const titleWords[] = {
+    "inbox", "report", "budget", "notes", "draft", "review", "design", "meeting", "invoice", "roadmap", "backlog",
+    "sprint", "release", "summary", "agenda", "contract", "proposal", "schedule", "metrics", "feedback", "outline",
+    "chapter", "figures", "minutes", "pricing", "survey", "travel", "hiring", "support", "incident", "postmortem",
+    "onboarding", "checklist", "inventory", "forecast", "campaign", "research", "archive", "welcome", "settings",
+};
+
+// three to six words, sometimes with a counter, which the fingerprint ignores
+static std::string word_title(std::mt19937& rng, const std::string& app)
+{
+    std::uniform_int_distribution<size_t> word(0, std::size(titleWords) - 1);
+    std::string title;
+    const size_t words = 3 + rng() % 4;
+    for (size_t i = 0; i < words; ++i)
+    {
+        if (i > 0) title += ' ';
+        title += titleWords[word(rng)];
+    }
+    if (rng() % 3 == 0) title += " (" + std::to_string(rng() % 100) + ")";
+    return title + " - " + app;
+}
+
+// a word swapped for another, what a tab or document switch does to a title
+static std::string edit_title(std::mt19937& rng, const std::string& title)
+{
+    const size_t space = title.find(' ');
+    return titleWords[rng() % std::size(titleWords)] + title.substr(space);
+}
+
+static WindowInfo fingerprint_window(const HWND hwnd, const DWORD processId, const std::string& process,
+                                     const std::string& className, const std::string& title)
+{
+    return {hwnd, title, className, process, processId, true};
+}
+
+int test_fingerprint()
+{
+    size_t failures = 0;
+    const auto expect = [&](const bool ok, const char* what)
+    {
+        if (!ok)
+        {
+            printf("  fingerprint: %s\n", what);
+            ++failures;
+        }
+    };
+    std::mt19937 rng(49);
+
+    // normalization
+    expect(title_simhash("Inbox (12) - Outlook") == title_simhash("Inbox (3) - Outlook"), "counters change the hash");
+    expect(title_simhash("INBOX - outlook") == title_simhash("Inbox - Outlook"), "case changes the hash");
+    expect(title_simhash("") == 0 && title_simhash(" - ()") == 0, "a title without words hashes to something");
+    expect(app_hash("ab", "c") != app_hash("a", "bc") && app_hash("Code.exe", "X") == app_hash("code.exe", "x"),
+           "app hashes run process and class together or depend on case");
+    const WindowFingerprint packed = make_fingerprint(0xDEADBEEF, 300, 0x1ABCDEF);
+    expect(fingerprint_app(packed) == 0xDEADBEEF && fingerprint_ordinal(packed) == 255 &&
+           fingerprint_title(packed) == 0xABCDEF, "fields don't unpack to what was packed");
+
+    // title distances: a word changed against unrelated titles of the same app
+    constexpr size_t pairs = 20000;
+    double editedDistance = 0;
+    double unrelatedDistance = 0;
+    for (size_t i = 0; i < pairs; ++i)
+    {
+        const std::string title = word_title(rng, "Editor");
+        const WindowFingerprint a = make_fingerprint(1, 0, title_simhash(title));
+        editedDistance += title_distance(a, make_fingerprint(1, 0, title_simhash(edit_title(rng, title))));
+        unrelatedDistance += title_distance(a, make_fingerprint(1, 0, title_simhash(word_title(rng, "Editor"))));
+    }
+    editedDistance /= pairs;
+    unrelatedDistance /= pairs;
+    printf("  title distance: %.2f bits after a word changed, %.2f between unrelated titles\n", editedDistance,
+           unrelatedDistance);
+    expect(editedDistance < unrelatedDistance / 2, "edited titles aren't nearer than unrelated ones");
+
+    // collisions: app hashes of distinct apps, titles of distinct normalized titles,
+    // full fingerprints of distinct windows of a large desktop
+    constexpr size_t apps = 200000;
+    std::vector<uint32_t> appHashes;
+    appHashes.reserve(apps);
+    for (size_t i = 0; i < apps; ++i)
+    {
+        appHashes.push_back(app_hash("app" + std::to_string(i) + ".exe", i % 2 ? "Window" : "Chrome_WidgetWin_1"));
+    }
+    std::ranges::sort(appHashes);
+    const size_t appCollisions = appHashes.size() - static_cast<size_t>(std::ranges::distance(
+        appHashes.begin(), std::ranges::unique(appHashes).begin()));
+    // 200k values in 32 bits collide about 4.7 times by chance
+    printf("  app hash: %zu collisions among %zu apps, %.4f%% (%.1f expected by chance)\n", appCollisions, apps,
+           100.0 * static_cast<double>(appCollisions) / apps, apps * (apps - 1.0) / 2 / 4294967296.0);
+    expect(appCollisions <= 15, "app hashes collide far more often than chance");
+
+    // words made up, the few of word_title() would repeat whole titles in another order
+    std::unordered_map<std::string, uint32_t> titles;
+    while (titles.size() < 50000)
+    {
+        std::string title;
+        for (size_t word = 0, words = 2 + rng() % 5; word < words; ++word)
+        {
+            for (size_t letter = 0, letters = 3 + rng() % 6; letter < letters; ++letter)
+            {
+                title.push_back(static_cast<char>('a' + rng() % 26));
+            }
+            title.push_back(' ');
+        }
+        titles.try_emplace(title, title_simhash(title));
+    }
+    std::vector<uint32_t> titleHashes;
+    for (const auto& [title, hash] : titles) titleHashes.push_back(hash);
+    std::ranges::sort(titleHashes);
+    const size_t titleCollisions = titleHashes.size() - static_cast<size_t>(std::ranges::distance(
+        titleHashes.begin(), std::ranges::unique(titleHashes).begin()));
+    // a simhash isn't uniform, titles sharing a word are nearer, and 24 bits is short
+    printf("  title hash: %zu of %zu distinct titles share a hash, %.2f%% (%.0f expected of a uniform hash)\n",
+           titleCollisions, titles.size(), 100.0 * static_cast<double>(titleCollisions) / titles.size(),
+           titles.size() * (titles.size() - 1.0) / 2 / 16777216.0);
+    expect(titleCollisions * 100 < titles.size(), "more than 1% of distinct titles share a hash");
+
+    FakeBackend big;
+    FingerprintRegistry registry;
+    std::vector<WindowInfo> desktop;
+    constexpr size_t desktopApps = 1000;
+    constexpr size_t perApp = 10;
+    for (size_t i = 0; i < desktopApps * perApp; ++i)
+    {
+        const std::string process = "app" + std::to_string(i % desktopApps) + ".exe";
+        const HWND hwnd = big.add_window({.title = word_title(rng, process), .className = "Window",
+                                          .processName = process, .onCurrentDesktop = true});
+        desktop.push_back(fingerprint_window(hwnd, big.process_id(hwnd), process, "Window", big.title(hwnd)));
+    }
+    const double firstSeconds = seconds_for([&] { registry.update(big, desktop); });
+    const double steadySeconds = seconds_for([&] { registry.update(big, desktop); });
+    std::vector<WindowFingerprint> fingerprints;
+    for (const WindowInfo& window : desktop) fingerprints.push_back(window.fingerprint);
+    std::ranges::sort(fingerprints);
+    const size_t windowCollisions = fingerprints.size() - static_cast<size_t>(std::ranges::distance(
+        fingerprints.begin(), std::ranges::unique(fingerprints).begin()));
+    printf("  %zu windows: %zu share a fingerprint, %.0f ns per window to fingerprint, %.0f ns once known\n",
+           desktop.size(), windowCollisions, firstSeconds * 1e9 / desktop.size(), steadySeconds * 1e9 / desktop.size());
+    expect(windowCollisions == 0, "distinct windows share a fingerprint");
+
+    // matching: titles edited in place, then a restart after the first window of
+    // every app was closed, which moves the others' ordinals down
+    std::vector<WindowFingerprint> saved;
+    for (const WindowInfo& window : desktop) saved.push_back(window.fingerprint);
+    for (WindowInfo& window : desktop)
+    {
+        if (rng() % 3 == 0) window.title = edit_title(rng, window.title);
+    }
+    registry.update(big, desktop);
+
+    size_t editedRight = 0;
+    const double matchSeconds = seconds_for([&]
+    {
+        FingerprintMatcher matcher(desktop);
+        const std::vector<size_t> matched = matcher.match(saved);
+        for (size_t i = 0; i < saved.size(); ++i)
+        {
+            editedRight += matched[i] == i;
+        }
+    });
+
+    FingerprintRegistry restarted;
+    std::vector<WindowInfo> reopened;
+    std::vector<WindowFingerprint> reopenedSaved;
+    for (size_t i = desktopApps; i < desktop.size(); ++i)
+    {
+        WindowInfo window = desktop[i];
+        window.hwnd = handle_of(100000 + i);
+        reopened.push_back(std::move(window));
+        reopenedSaved.push_back(saved[i]);
+    }
+    // the new handles aren't the fake backend's, nothing is alive to keep an ordinal
+    restarted.update(big, reopened);
+    size_t shiftedRight = 0;
+    FingerprintMatcher matcher(reopened);
+    const std::vector<size_t> shifted = matcher.match(reopenedSaved);
+    for (size_t i = 0; i < reopened.size(); ++i)
+    {
+        shiftedRight += shifted[i] == i;
+    }
+    printf("  matching %zu saved fingerprints: %.0f ns each, %.2f%% right with a third of the titles edited, "
+           "%.2f%% with the first window of each app closed\n", saved.size(), matchSeconds * 1e9 / saved.size(),
+           100.0 * static_cast<double>(editedRight) / saved.size(),
+           100.0 * static_cast<double>(shiftedRight) / reopened.size());
+    expect(editedRight * 100 >= saved.size() * 99, "edited titles lost more than 1% of their windows");
+    expect(shiftedRight * 100 >= reopened.size() * 90, "closing a window lost more than 10% of its siblings");
+
+    // ordinals: lowest free, kept while alive but unlisted, given back when closed
+    FakeBackend backend;
+    std::vector<WindowInfo> windows;
+    for (int i = 0; i < 4; ++i)
+    {
+        const HWND hwnd = backend.add_window({.title = "shell " + std::string(1, static_cast<char>('a' + i)),
+                                              .className = "Console", .processName = "term.exe"});
+        windows.push_back(fingerprint_window(hwnd, backend.process_id(hwnd), "term.exe", "Console",
+                                             backend.title(hwnd)));
+    }
+    FingerprintRegistry ordinals;
+    ordinals.update(backend, windows);
+    const auto ordinal_of = [&](const size_t i) { return fingerprint_ordinal(windows[i].fingerprint); };
+    expect(ordinal_of(0) == 0 && ordinal_of(1) == 1 && ordinal_of(2) == 2 && ordinal_of(3) == 3,
+           "launch ordinals aren't 0 to 3");
+    const WindowInfo offDesktop = windows[2];
+    windows.erase(windows.begin() + 2);
+    ordinals.update(backend, windows);
+    backend.remove_window(windows[0].hwnd);
+    windows.erase(windows.begin());
+    ordinals.update(backend, windows);
+    const HWND added = backend.add_window({.title = "shell e", .className = "Console", .processName = "term.exe"});
+    windows.push_back(fingerprint_window(added, backend.process_id(added), "term.exe", "Console", "shell e"));
+    windows.push_back(offDesktop);
+    ordinals.update(backend, windows);
+    expect(fingerprint_ordinal(windows[2].fingerprint) == 0 && windows[3].fingerprint == offDesktop.fingerprint,
+           "a closed window's ordinal wasn't reused or an unlisted one lost its own");
+    const WindowFingerprint before = windows[0].fingerprint;
+    windows[0].title = "shell b (7)";
+    ordinals.update(backend, windows);
+    expect(fingerprint_app(windows[0].fingerprint) == fingerprint_app(before) &&
+           fingerprint_ordinal(windows[0].fingerprint) == fingerprint_ordinal(before) &&
+           windows[0].fingerprint != before, "a title change didn't change just the title bits");
+
+    // a reused handle is a new window of another app
+    const HWND reused = windows[0].hwnd;
+    backend.remove_window(reused);
+    backend.add_window({.hwnd = reused, .title = "notes", .className = "Edit", .processName = "notepad.exe"});
+    windows[0] = fingerprint_window(reused, backend.process_id(reused), "notepad.exe", "Edit", "notes");
+    ordinals.update(backend, windows);
+    const HWND another = backend.add_window({.title = "shell f", .className = "Console", .processName = "term.exe"});
+    windows.push_back(fingerprint_window(another, backend.process_id(another), "term.exe", "Console", "shell f"));
+    ordinals.update(backend, windows);
+    expect(fingerprint_ordinal(windows[0].fingerprint) == 0 && fingerprint_ordinal(windows.back().fingerprint) == 1,
+           "a reused handle kept the old window's ordinal");
+
+    // seeded ordinals survive the restart, a conflicting one starts over
+    FingerprintRegistry seeded;
+    const WindowFingerprint third = windows[3].fingerprint;
+    seeded.seed(windows[3].hwnd, windows[3].processId, third);
+    seeded.seed(another, windows.back().processId, third);
+    seeded.update(backend, windows);
+    expect(windows[3].fingerprint == third && fingerprint_ordinal(windows.back().fingerprint) != fingerprint_ordinal(third),
+           "a seeded ordinal was lost or handed out twice");
+
+    // 300 windows of one app share the last ordinal
+    std::vector<WindowInfo> many;
+    for (size_t i = 0; i < 300; ++i)
+    {
+        many.push_back(fingerprint_window(handle_of(200000 + i), 1, "many.exe", "Many", "window"));
+    }
+    FingerprintRegistry saturated;
+    saturated.update(backend, many);
+    expect(fingerprint_ordinal(many[254].fingerprint) == 254 && fingerprint_ordinal(many[299].fingerprint) == 255,
+           "ordinals don't saturate at 255");
+
+    // a restart through the saved order: the same windows come back with new handles
+    // and a changed counter, and take the slots they were saved in
+    forget_process_names();
+    FakeBackend session;
+    const char* const processes[] = {"code.exe", "term.exe", "mail.exe"};
+    const char* const sessionTitles[] = {"budget review", "release notes", "hiring plan", "travel (3)"};
+    for (const char* process : processes)
+    {
+        for (const char* title : sessionTitles)
+        {
+            session.add_window({.title = title, .className = "Main", .processName = process});
+        }
+    }
+    const std::string orderPath = saved_order_path();
+    write_strings_to_file(orderPath, {});
+    std::vector<WindowInfo> list = build_window_list(session);
+    fingerprint_windows(session, list);
+    std::ranges::shuffle(list, rng);
+    std::vector<std::string> lines;
+    for (const WindowInfo& window : list) lines.push_back(saved_order_line(window));
+    write_strings_to_file(orderPath, lines);
+    const auto savedTime = std::filesystem::last_write_time(orderPath);
+
+    FakeBackend next;
+    size_t launched = 0;
+    for (const char* process : processes)
+    {
+        for (const char* title : sessionTitles)
+        {
+            const std::string now = std::string_view(title) == "travel (3)" ? "travel (12)" : title;
+            next.add_window({.hwnd = handle_of(300000 + launched++), .title = now, .className = "Main",
+                             .processName = process});
+        }
+    }
+    std::filesystem::last_write_time(orderPath, savedTime + std::chrono::seconds(1));
+    const std::vector<WindowInfo> restored = build_window_list(next);
+    size_t inPlace = 0;
+    for (size_t i = 0; i < list.size() && i < restored.size(); ++i)
+    {
+        const std::string title = list[i].title == "travel (3)" ? "travel (12)" : list[i].title;
+        inPlace += restored[i].processName == list[i].processName && restored[i].title == title;
+    }
+    printf("  restart: %zu of %zu windows back in their saved slot\n", inPlace, list.size());
+    expect(inPlace == list.size(), "restored windows aren't in their saved slots");
+
+    // the legacy file format still orders by process
+    write_strings_to_file(orderPath, {"mail.exe", "code.exe"});
+    std::filesystem::last_write_time(orderPath, savedTime + std::chrono::seconds(2));
+    const std::vector<WindowInfo> legacy = build_window_list(next);
+    expect(legacy.size() == 12 && legacy[0].processName == "mail.exe" && legacy[1].processName == "code.exe",
+           "an order file without fingerprints isn't applied");
+    std::filesystem::remove(orderPath);
+
+    // the state snapshot keeps them
+    const std::string statePath = (std::filesystem::temp_directory_path() / "fmw_fingerprint_bench.state").string();
+    std::vector<WindowInfo> snapshot = build_window_list(next);
+    fingerprint_windows(next, snapshot);
+    std::vector<WindowInfo> reloaded;
+    expect(save_state(statePath, snapshot) && restore_state(statePath, next, reloaded) &&
+           std::ranges::equal(snapshot, reloaded, {}, &WindowInfo::fingerprint, &WindowInfo::fingerprint),
+           "fingerprints didn't survive the state snapshot");
+    std::filesystem::remove(statePath);
+    forget_process_names();
+
+    if (failures)
+    {
+        printf("fingerprint: %zu failures\n", failures);
+        return 1;
+    }
+    printf("fingerprint: all checks passed\n");
+    return 0;
+}
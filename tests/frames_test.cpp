@@ -0,0 +1,153 @@
+#include "backend.h"
+#include "fake_backend.h"
+#include "predict.h"
+#include "switcher.h"
+#include "tabs.h"
+#include "window_list.h"
+#include "tests/alloc_counter.h"
+#include "tests/test_support.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// What the switcher's list box reads from the rows on every frame
+static size_t draw_rows(const SwitcherList& rows)
+{
+    size_t drawn = 0;
+    for (size_t row = 0; row < rows.size(); ++row)
+    {
+        drawn += std::strlen(rows.label(row)) + (static_cast<int>(row) == rows.selected());
+    }
+    return drawn;
+}
+
+static std::string expected_label(const SwitcherList& rows, const size_t row)
+{
+    std::string label;
+    if (row < SwitcherList::shortcut_count) label = "[CTRL " + std::to_string(row + 1) + "] ";
+    if (rows.is_marked(row)) label += "* ";
+    return label + rows.window(row).title;
+}
+
+static size_t check_labels(const SwitcherList& rows, const char* when)
+{
+    for (size_t row = 0; row < rows.size(); ++row)
+    {
+        if (rows.label(row) != expected_label(rows, row))
+        {
+            printf("  frames: %s, row %zu reads \"%s\", expected \"%s\"\n", when, row, rows.label(row),
+                   expected_label(rows, row).c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int test_frames()
+{
+    size_t failures = 0;
+    std::mt19937 rng(34);
+
+    // titles well past the small string buffer, like real ones
+    std::vector<WindowInfo> windows;
+    for (size_t i = 0; i < 200; ++i)
+    {
+        std::string title = "Document " + std::to_string(i) + " - ";
+        title.append(20 + rng() % 100, static_cast<char>('a' + i % 26));
+        windows.push_back({handle_of(i), title, "Fake", "fake.exe", 1000, true});
+    }
+    SwitcherList rows(windows, 3);
+    failures += check_labels(rows, "after construction");
+
+    // navigation, reordering and marks, then a redraw, the way a user drives it
+    constexpr size_t frames = 20000;
+    size_t drawn = draw_rows(rows);
+    const uint64_t allocationsBefore = thread_alloc_count();
+    const double seconds = seconds_for([&]
+    {
+        for (size_t frame = 0; frame < frames; ++frame)
+        {
+            if (frame % 3 == 0) rows.move_selection(frame % 2 ? 1 : -2);
+            if (frame % 7 == 0) rows.move_selected(frame % 2 ? 1 : -1);
+            if (frame % 11 == 0) rows.toggle_mark();
+            drawn += draw_rows(rows);
+        }
+    });
+    const uint64_t frameAllocations = thread_alloc_count() - allocationsBefore;
+    printf("  %zu frames over %zu rows: %.2f us per frame, %llu allocations (%zu bytes drawn)\n", frames,
+           rows.size(), seconds * 1e6 / frames, static_cast<unsigned long long>(frameAllocations), drawn);
+    if (frameAllocations != 0)
+    {
+        printf("  frames: steady-state frames allocated %llu times\n", static_cast<unsigned long long>(frameAllocations));
+        ++failures;
+    }
+    failures += check_labels(rows, "after the frames");
+
+    // the rows kept every window exactly once
+    std::vector<HWND> seen;
+    for (size_t row = 0; row < rows.size(); ++row) seen.push_back(rows.window(row).hwnd);
+    std::ranges::sort(seen);
+    if (seen.size() != windows.size() || std::ranges::adjacent_find(seen) != seen.end())
+    {
+        printf("  frames: reordering lost or duplicated rows\n");
+        ++failures;
+    }
+
+    // actions may allocate, they only have to leave the labels right
+    const std::vector<HWND> targets = rows.take_targets();
+    rows.remove(targets);
+    failures += check_labels(rows, "after closing the marked windows");
+    if (rows.size() != windows.size() - targets.size())
+    {
+        printf("  frames: closing %zu windows left %zu rows\n", targets.size(), rows.size());
+        ++failures;
+    }
+
+    // Ctrl+N against the fake desktop
+    FakeBackend backend;
+    std::vector<WindowInfo> slots;
+    for (size_t i = 0; i < 9; ++i)
+    {
+        const HWND hwnd = backend.add_window({.title = windows[i].title, .className = "Fake", .processName = "fake.exe"});
+        slots.push_back({hwnd, windows[i].title, "Fake", "fake.exe", 1000, true});
+    }
+    set_window_backend(&backend);
+
+    constexpr size_t activations = 20000;
+    handle_sht(&slots, 1);
+    const uint64_t activationAllocationsBefore = thread_alloc_count();
+    const double activationSeconds = seconds_for([&]
+    {
+        for (size_t i = 0; i < activations; ++i)
+        {
+            handle_sht(&slots, static_cast<int>(1 + i * 5 % 9));
+        }
+    });
+    const uint64_t activationAllocations = thread_alloc_count() - activationAllocationsBefore;
+    printf("  %zu Ctrl+N activations: %.2f us each, %llu allocations\n", activations,
+           activationSeconds * 1e6 / activations, static_cast<unsigned long long>(activationAllocations));
+    if (activationAllocations != 0)
+    {
+        printf("  frames: activations allocated %llu times\n", static_cast<unsigned long long>(activationAllocations));
+        ++failures;
+    }
+    if (backend.foreground() != slots[(activations - 1) * 5 % 9].hwnd)
+    {
+        printf("  frames: the last activation didn't reach the desktop\n");
+        ++failures;
+    }
+
+    set_window_backend(nullptr);
+    transition_model().clear();
+
+    if (failures != 0)
+    {
+        printf("frames: %zu failures\n", failures);
+        return 1;
+    }
+    printf("frames: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,269 @@
+#include "app_identity.h"
+#include "fake_backend.h"
+#include "state.h"
+#include "tabs.h"
+#include "window_list.h"
+#include "tests/test_support.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+// A UWP frame like ApplicationFrameHost.exe makes them: its own title bar child first,
+// then the app's CoreWindow from the app process when app isn't null. Apps sharing
+// an executable are separate processes, appId tells them apart.
+static HWND add_frame(FakeBackend& backend, const std::string& title, const char* app, const std::string& package,
+                      const DWORD appId = 0)
+{
+    const HWND frame = backend.add_window({.title = title, .className = "ApplicationFrameWindow",
+                                           .processName = "ApplicationFrameHost.exe"});
+    backend.add_child(frame, {.className = "ApplicationFrameTitleBarWindow",
+                              .processName = "ApplicationFrameHost.exe"});
+    if (app)
+    {
+        backend.add_child(frame, {.title = title, .className = "Windows.UI.Core.CoreWindow", .processName = app,
+                                  .processId = appId, .package = package});
+    }
+    return frame;
+}
+
+static const WindowInfo* find_listed(const std::vector<WindowInfo>& windows, const HWND hwnd)
+{
+    const auto it = std::ranges::find(windows, hwnd, &WindowInfo::hwnd);
+    return it != windows.end() ? &*it : nullptr;
+}
+
+// The resolver alone: one walk per frame, retries backing off, a new host pid starting over
+static size_t check_resolver()
+{
+    size_t failures = 0;
+    FakeBackend backend;
+    const HWND frame = add_frame(backend, "Calculator", "CalculatorApp.exe", "Microsoft.WindowsCalculator_8wekyb3d8bbwe");
+    const HWND empty = add_frame(backend, "Starting", nullptr, {});
+    FakeWindow host;
+    backend.get_window(frame, host);
+
+    HostedAppResolver resolver;
+    const AppIdentity* app = nullptr;
+    for (uint64_t generation = 1; generation <= 100; ++generation)
+    {
+        app = resolver.resolve(backend, frame, host.processId, generation);
+        resolver.resolve(backend, empty, host.processId, generation);
+    }
+    // the empty frame at 1, 2, 4, 8, 16, 32 and 64, then every 64
+    if (!app || app->processName != "CalculatorApp.exe" || app->package != "Microsoft.WindowsCalculator_8wekyb3d8bbwe" ||
+        app->processId == host.processId || resolver.walks() != 1 + 7)
+    {
+        printf("  100 resolutions of a frame and an empty frame walked %llu times\n",
+               static_cast<unsigned long long>(resolver.walks()));
+        ++failures;
+    }
+
+    // same handle, another host process: the destroy went unnoticed
+    resolver.resolve(backend, frame, host.processId + 1, 101);
+    if (resolver.walks() != 1 + 7 + 1)
+    {
+        printf("  a handle of another host kept the old app\n");
+        ++failures;
+    }
+
+    resolver.keep(empty, 102);
+    resolver.sweep(102);
+    if (resolver.size() != 1)
+    {
+        printf("  the sweep kept %zu frames instead of 1\n", resolver.size());
+        ++failures;
+    }
+    resolver.forget(empty);
+    if (resolver.size() != 0)
+    {
+        printf("  a forgotten frame stayed\n");
+        ++failures;
+    }
+
+    if (!is_frame_host("applicationframehost.EXE") || is_frame_host("ApplicationFrameHost.exe.bak"))
+    {
+        printf("  frame host names matched wrong\n");
+        ++failures;
+    }
+    return failures;
+}
+
+int test_hosted()
+{
+    using std::chrono::microseconds;
+    constexpr size_t refreshes = 30;
+    size_t failures = check_resolver();
+
+    // 200 ordinary windows and 20 UWP apps, 5 of them JavaScript apps sharing WWAHost.exe
+    forget_process_names();
+    FakeBackend backend;
+    populate(backend, 200, 20);
+    std::vector<HWND> frames;
+    for (int i = 0; i < 20; ++i)
+    {
+        const std::string name = "Store app " + std::to_string(i);
+        const std::string exe = i < 5 ? "WWAHost.exe" : "StoreApp" + std::to_string(i) + ".exe";
+        frames.push_back(add_frame(backend, name, exe.c_str(), "Vendor.App" + std::to_string(i) + "_8wekyb3d8bbwe",
+                                   static_cast<DWORD>(5000 + i)));
+    }
+    set_desktop_latencies(backend);
+    backend.set_latency(FakeCall::ChildWindows, {microseconds(40), microseconds(400)});
+    backend.set_latency(FakeCall::PackageName, {microseconds(60), microseconds(1500)});
+
+    std::vector<WindowInfo> windows;
+    std::vector<microseconds> costs;
+    for (size_t i = 0; i < refreshes; ++i)
+    {
+        const auto before = backend.charged();
+        windows = ListWindowsByDesktop(backend, false);
+        costs.push_back(backend.charged() - before);
+    }
+    const size_t walks = backend.calls(FakeCall::ChildWindows);
+    const size_t packages = backend.calls(FakeCall::PackageName);
+    microseconds later{0};
+    for (size_t i = 1; i < refreshes; ++i) later += costs[i];
+    printf("  first refresh %.2f ms, later ones %.2f ms on average, %zu walks of %zu frames in %zu refreshes\n",
+           static_cast<double>(costs[0].count()) / 1000.0,
+           static_cast<double>(later.count()) / 1000.0 / static_cast<double>(refreshes - 1), walks, frames.size(),
+           refreshes);
+
+    if (walks != frames.size() || packages != frames.size())
+    {
+        printf("  %zu child walks and %zu package queries for %zu frames\n", walks, packages, frames.size());
+        ++failures;
+    }
+
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
+        const WindowInfo* window = find_listed(windows, frames[i]);
+        if (!window || is_frame_host(window->processName) ||
+            window->package != "Vendor.App" + std::to_string(i) + "_8wekyb3d8bbwe")
+        {
+            printf("  frame %zu is listed as %s\n", i, window ? window->processName.c_str() : "nothing");
+            ++failures;
+            continue;
+        }
+        keys.push_back(ordering_key(*window));
+    }
+    std::ranges::sort(keys);
+    if (std::ranges::adjacent_find(keys) != keys.end())
+    {
+        printf("  UWP apps share an ordering key\n");
+        ++failures;
+    }
+
+    // the frame is destroyed and its handle handed to another app's frame before the next refresh
+    const HWND reused = frames[7];
+    forget_window(reused);
+    backend.remove_window(reused);
+    backend.add_window({.hwnd = reused, .title = "Photos", .className = "ApplicationFrameWindow",
+                        .processName = "ApplicationFrameHost.exe"});
+    backend.add_child(reused, {.className = "Windows.UI.Core.CoreWindow", .processName = "Microsoft.Photos.exe",
+                               .package = "Microsoft.Windows.Photos_8wekyb3d8bbwe"});
+    windows = ListWindowsByDesktop(backend, false);
+    const WindowInfo* replaced = find_listed(windows, reused);
+    if (!replaced || replaced->processName != "Microsoft.Photos.exe" ||
+        backend.calls(FakeCall::ChildWindows) != walks + 1)
+    {
+        printf("  a destroyed frame's handle kept its old app\n");
+        ++failures;
+    }
+
+    // an app still starting shows as the host until its window turns up, walked again with backoff
+    const HWND starting = add_frame(backend, "Mail", nullptr, {});
+    const size_t walksBefore = backend.calls(FakeCall::ChildWindows);
+    for (size_t i = 0; i < refreshes; ++i)
+    {
+        windows = ListWindowsByDesktop(backend, false);
+    }
+    const WindowInfo* pending = find_listed(windows, starting);
+    const size_t retries = backend.calls(FakeCall::ChildWindows) - walksBefore;
+    if (!pending || pending->processName != "ApplicationFrameHost.exe" || retries > 6)
+    {
+        printf("  a frame without its app was walked %zu times in %zu refreshes\n", retries, refreshes);
+        ++failures;
+    }
+    backend.add_child(starting, {.className = "Windows.UI.Core.CoreWindow", .processName = "HxOutlook.exe",
+                                 .package = "microsoft.windowscommunicationsapps_8wekyb3d8bbwe"});
+    for (size_t i = 0; i < HostedAppResolver::max_retry_interval; ++i)
+    {
+        windows = ListWindowsByDesktop(backend, false);
+    }
+    pending = find_listed(windows, starting);
+    if (!pending || pending->processName != "HxOutlook.exe")
+    {
+        printf("  the app's window turning up didn't resolve the frame\n");
+        ++failures;
+    }
+
+    // lazy mode resolves the frame when the process is first asked for, then keeps it
+    forget_process_names();
+    set_lazy_metadata(true);
+    const size_t lazyBefore = backend.calls(FakeCall::ChildWindows);
+    for (size_t i = 0; i < refreshes; ++i)
+    {
+        windows = ListWindowsByDesktop(backend, false, i < 3 ? 0 : FIELD_PROCESS);
+    }
+    const size_t lazyWalks = backend.calls(FakeCall::ChildWindows) - lazyBefore;
+    set_lazy_metadata(false);
+    if (lazyWalks != frames.size() + 1)
+    {
+        printf("  lazy refreshes walked %zu times for %zu frames\n", lazyWalks, frames.size() + 1);
+        ++failures;
+    }
+
+    // a restart restores the frames with the app and package they are ordered by
+    const std::string statePath = (std::filesystem::temp_directory_path() / "fmw_hosted_state.bin").string();
+    windows = ListWindowsByDesktop(backend, false);
+    std::vector<WindowInfo> restored;
+    const bool saved = save_state(statePath, windows) && restore_state(statePath, backend, restored);
+    std::filesystem::remove(statePath);
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
+        if (frames[i] == reused) continue;
+
+        const WindowInfo* window = find_listed(restored, frames[i]);
+        if (!saved || !window || window->package != "Vendor.App" + std::to_string(i) + "_8wekyb3d8bbwe")
+        {
+            printf("  frame %zu was restored without its package\n", i);
+            ++failures;
+            break;
+        }
+    }
+
+    // a script describes the same tree
+    const std::string script = (std::filesystem::temp_directory_path() / "fmw_hosted_bench.txt").string();
+    {
+        std::ofstream out(script);
+        out << "ApplicationFrameHost.exe|ApplicationFrameWindow|Calculator\n"
+               "[child] ApplicationFrameHost.exe|ApplicationFrameTitleBarWindow|\n"
+               "[child package=Microsoft.WindowsCalculator_8wekyb3d8bbwe] CalculatorApp.exe|"
+               "Windows.UI.Core.CoreWindow|Calculator\n"
+               "explorer.exe|CabinetWClass|Downloads\n";
+    }
+    forget_process_names();
+    FakeBackend scripted;
+    scripted.load(script);
+    std::filesystem::remove(script);
+    windows = ListWindowsByDesktop(scripted, false);
+    if (windows.size() != 2 || windows[0].processName != "CalculatorApp.exe" ||
+        windows[0].package != "Microsoft.WindowsCalculator_8wekyb3d8bbwe" || windows[1].processName != "explorer.exe")
+    {
+        printf("  the scripted frame was not resolved\n");
+        ++failures;
+    }
+
+    forget_process_names();
+    if (failures != 0)
+    {
+        printf("hosted: %zu failures\n", failures);
+        return 1;
+    }
+    printf("hosted: all checks passed\n");
+    return 0;
+}
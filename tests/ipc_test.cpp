@@ -0,0 +1,241 @@
+#include "backend.h"
+#include "fake_backend.h"
+#include "ipc.h"
+#include "snapshot.h"
+#include "tabs.h"
+#include "window_list.h"
+#include "tests/test_support.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// What the server hands to the owner thread, which is the test's own here
+static std::mutex ownerMutex;
+static std::condition_variable ownerWake;
+static std::vector<HWND> focusRequests;
+static WindowFields fieldsRequested = 0;
+
+static bool queue_focus(const HWND hwnd)
+{
+    {
+        std::lock_guard lock(ownerMutex);
+        focusRequests.push_back(hwnd);
+    }
+    ownerWake.notify_one();
+    return true;
+}
+
+static void queue_resolve(const WindowFields fields)
+{
+    {
+        std::lock_guard lock(ownerMutex);
+        fieldsRequested |= fields;
+    }
+    ownerWake.notify_one();
+}
+
+// Does what the headless loop does with the requests, waiting up to a second for one
+static void serve_owner_requests()
+{
+    std::vector<HWND> focus;
+    WindowFields fields;
+    {
+        std::unique_lock lock(ownerMutex);
+        ownerWake.wait_for(lock, std::chrono::seconds(1), [] { return !focusRequests.empty() || fieldsRequested; });
+        focus.swap(focusRequests);
+        fields = std::exchange(fieldsRequested, 0);
+    }
+    for (const HWND hwnd : focus) BringWindowToFront(hwnd);
+    if (fields != 0) publish_window_fields(fields);
+}
+
+// A blocking client reading one response line at a time
+class TestClient
+{
+public:
+    explicit TestClient(const std::string& path)
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    ~TestClient()
+    {
+        if (fd >= 0) close(fd);
+    }
+
+    bool connected() const
+    {
+        return fd >= 0;
+    }
+
+    void send_text(const std::string& text) const
+    {
+        if (fd >= 0) send(fd, text.data(), text.size(), MSG_NOSIGNAL);
+    }
+
+    // The next line without its newline, empty after a second without one or
+    // when the server closed the connection
+    std::string read_line()
+    {
+        for (;;)
+        {
+            if (const size_t newline = pending.find('\n'); newline != std::string::npos)
+            {
+                std::string line = pending.substr(0, newline);
+                pending.erase(0, newline + 1);
+                return line;
+            }
+            pollfd ready{fd, POLLIN, 0};
+            char buffer[4096];
+            if (fd < 0 || poll(&ready, 1, 1000) <= 0) return {};
+            const auto received = recv(fd, buffer, sizeof(buffer), 0);
+            if (received <= 0) return {};
+            pending.append(buffer, received);
+        }
+    }
+
+    std::string request(const std::string& line)
+    {
+        send_text(line + "\n");
+        return read_line();
+    }
+
+    // Whether the server hung up, waiting up to a second
+    bool closed_by_server() const
+    {
+        pollfd ready{fd, POLLIN, 0};
+        char byte;
+        return poll(&ready, 1, 1000) > 0 && recv(fd, &byte, 1, 0) == 0;
+    }
+
+private:
+    int fd = -1;
+    std::string pending;
+};
+
+static bool contains(const std::string& text, const std::string& part)
+{
+    return text.find(part) != std::string::npos;
+}
+
+int test_ipc()
+{
+    size_t failures = 0;
+    const auto expect = [&](const bool ok, const char* what)
+    {
+        if (!ok)
+        {
+            printf("  ipc: %s\n", what);
+            ++failures;
+        }
+    };
+
+    forget_process_names();
+    FakeBackend backend;
+    set_window_backend(&backend);
+    backend.add_window({.title = "Inbox - Outlook", .className = "rctrl_renwnd32", .processName = "OUTLOOK.EXE"});
+    backend.add_window({.title = "notes.txt - Notepad", .className = "Notepad", .processName = "notepad.exe"});
+    backend.add_window({.title = "Windows PowerShell", .className = "ConsoleWindowClass",
+                        .processName = "powershell.exe"});
+    load_window_list();
+
+    const std::string path = (std::filesystem::temp_directory_path() / "fmw_ipc_test.sock").string();
+    expect(ipc_server_start(path, queue_focus, queue_resolve), "the server didn't start");
+
+    // list, every window with its fields
+    TestClient client(path);
+    expect(client.connected(), "couldn't connect");
+    const std::string list = client.request("list");
+    printf("  list: %zu bytes for %zu windows\n", list.size(), availableWindows.size());
+    expect(contains(list, "\"slot\":3") && contains(list, "\"process\":\"notepad.exe\"") &&
+           contains(list, "\"class\":\"ConsoleWindowClass\"") && contains(list, "\"title\":\"Inbox - Outlook\""),
+           "list doesn't carry every window and field");
+
+    // subscribe gets the list now and again once a changed one is published
+    TestClient subscriber(path);
+    const std::string first = subscriber.request("subscribe");
+    backend.add_window({.title = "budget.xlsx - Excel", .className = "XLMAIN", .processName = "EXCEL.EXE"});
+    load_window_list();
+    const std::string update = subscriber.read_line();
+    expect(contains(first, "\"version\":") && !contains(first, "Excel"), "subscribe didn't answer with the list");
+    expect(contains(update, "budget.xlsx - Excel") && update != first, "the subscriber missed the republish");
+
+    // focus hands the window to the owner thread, the fake foreground follows
+    const std::string focus = client.request("focus 3");
+    serve_owner_requests();
+    expect(contains(focus, "\"ok\":true") && backend.foreground() == availableWindows[2].hwnd,
+           "focus didn't activate slot 3");
+    // the activation raised the window, the subscriber hears about the new order
+    load_window_list();
+    expect(contains(subscriber.read_line(), "\"version\":"), "the subscriber missed the reorder");
+
+    const std::string found = client.request("find notepad");
+    serve_owner_requests();
+    expect(contains(found, "\"ok\":true") && contains(found, "Notepad") &&
+           backend.title(backend.foreground()) == "notes.txt - Notepad", "find didn't activate the match");
+    expect(contains(client.request("find class=NoSuchClass"), "no such window"), "find matched nothing yet succeeded");
+
+    // malformed requests get an error and leave the connection usable
+    expect(contains(client.request("bogus"), "unknown request"), "an unknown request wasn't rejected");
+    expect(contains(client.request("focus 0"), "no such window") &&
+           contains(client.request("focus 99"), "no such window"), "focus out of range wasn't rejected");
+    expect(contains(client.request("find (title=x"), "\"ok\":false"), "a malformed query wasn't rejected");
+    expect(contains(client.request("list\r"), "\"windows\":["), "a CRLF request wasn't served");
+    TestClient flooding(path);
+    flooding.send_text(std::string(8192, 'x'));
+    expect(flooding.closed_by_server(), "a request line over the limit didn't close the connection");
+
+    // a lazy list lacks fields, the request waits for the owner thread to resolve them
+    set_lazy_metadata(true);
+    forget_process_names();
+    backend.add_window({.title = "lazy window", .className = "Lazy", .processName = "lazy.exe"});
+    load_window_list();
+    const bool lacking = current_snapshot()->windows.front().resolved != ALL_WINDOW_FIELDS;
+    client.send_text("list\n");
+    serve_owner_requests();
+    const std::string resolved = client.read_line();
+    expect(lacking && contains(resolved, "\"class\":\"Lazy\"") && contains(resolved, "\"process\":\"lazy.exe\""),
+           "a lazy list wasn't resolved on the owner thread before it was served");
+    set_lazy_metadata(false);
+    publish_window_fields(0);
+
+    ipc_server_stop();
+    expect(!std::filesystem::exists(path), "the socket file was left behind");
+    set_window_backend(nullptr);
+    forget_process_names();
+
+    if (failures)
+    {
+        printf("ipc: %zu failures\n", failures);
+        return 1;
+    }
+    printf("ipc: all checks passed\n");
+    return 0;
+}
+#else
+int test_ipc()
+{
+    printf("ipc: skipped, the test client is POSIX only\n");
+    return 0;
+}
+#endif
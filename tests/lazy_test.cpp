@@ -0,0 +1,211 @@
+#include "fake_backend.h"
+#include "file.h"
+#include "fingerprint.h"
+#include "platform.h"
+#include "rules.h"
+#include "tabs.h"
+#include "window_list.h"
+#include "tests/test_support.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <cstdio>
+#include <span>
+#include <vector>
+
+static WindowFieldStats field_stats_since(const WindowFieldStats& before)
+{
+    const WindowFieldStats now = window_field_stats();
+    return {
+        now.titles - before.titles, now.classNames - before.classNames, now.processIds - before.processIds,
+        now.processNames - before.processNames, now.desktops - before.desktops,
+    };
+}
+
+static void print_field_stats(const char* mode, const WindowFieldStats& stats, const double ms)
+{
+    printf("  %-5s %6llu titles %6llu classes %6llu pids %4llu process names %6llu desktops, %.2f ms per refresh\n",
+           mode, static_cast<unsigned long long>(stats.titles), static_cast<unsigned long long>(stats.classNames),
+           static_cast<unsigned long long>(stats.processIds), static_cast<unsigned long long>(stats.processNames),
+           static_cast<unsigned long long>(stats.desktops), ms);
+}
+
+// 20 refreshes of 300 windows, 20 of them app windows whose title the alt-tab check skips
+static std::vector<WindowInfo> refresh_lazily(const bool lazy, WindowFieldStats& stats, double& msPerRefresh)
+{
+    constexpr size_t refreshes = 20;
+    forget_process_names();
+    set_lazy_metadata(lazy);
+
+    FakeBackend backend;
+    populate(backend, 280, 30);
+    for (int i = 0; i < 20; ++i)
+    {
+        backend.add_window({.title = "app " + std::to_string(i), .className = "App", .processName = "app.exe",
+                            .exStyle = WS_EX_APPWINDOW});
+    }
+    set_desktop_latencies(backend);
+
+    const WindowFieldStats before = window_field_stats();
+    std::vector<WindowInfo> windows;
+    for (size_t i = 0; i < refreshes; ++i)
+    {
+        windows = build_window_list(backend);
+    }
+    stats = field_stats_since(before);
+    msPerRefresh = static_cast<double>(backend.charged().count()) / 1000.0 / refreshes;
+
+    resolve_window_fields(backend, windows, ALL_WINDOW_FIELDS);
+    return windows;
+}
+
+// Lazy refreshes of the same desktop under a saved order, the fields they fetched
+static WindowFieldStats refresh_in_order(const std::vector<std::string>& lines, std::vector<WindowInfo>& windows,
+                                         double& msPerRefresh)
+{
+    forget_process_names();
+    set_lazy_metadata(true);
+
+    FakeBackend backend;
+    populate(backend, 280, 30);
+    for (int i = 0; i < 20; ++i)
+    {
+        backend.add_window({.title = "app " + std::to_string(i), .className = "App", .processName = "app.exe",
+                            .exStyle = WS_EX_APPWINDOW});
+    }
+    set_desktop_latencies(backend);
+
+    // the order is read again when its time changes, which a quick rewrite may not do
+    const std::string path = saved_order_path();
+    const auto written = std::filesystem::exists(path) ? std::filesystem::last_write_time(path)
+                                                       : std::filesystem::file_time_type::clock::now();
+    write_strings_to_file(path, lines);
+    std::filesystem::last_write_time(path, written + std::chrono::seconds(1));
+
+    const WindowFieldStats before = window_field_stats();
+    for (int i = 0; i < 20; ++i)
+    {
+        windows = build_window_list(backend);
+    }
+    msPerRefresh = static_cast<double>(backend.charged().count()) / 1000.0 / 20;
+    return field_stats_since(before);
+}
+
+int test_lazy()
+{
+    size_t failures = 0;
+
+    WindowFieldStats eager;
+    WindowFieldStats lazy;
+    double eagerMs = 0;
+    double lazyMs = 0;
+    const auto eagerWindows = refresh_lazily(false, eager, eagerMs);
+    const auto lazyWindows = refresh_lazily(true, lazy, lazyMs);
+    print_field_stats("eager", eager, eagerMs);
+    print_field_stats("lazy", lazy, lazyMs);
+
+    // every refresh needs the titles, once per window, the rest only once per window in lazy mode
+    if (eager.titles != 20 * 300 || eager.classNames != 20 * 300 || eager.processIds != 20 * 300)
+    {
+        printf("  eager refreshes didn't fetch every field exactly once per window\n");
+        ++failures;
+    }
+    if (lazy.titles != 20 * 300 || lazy.classNames != 0 || lazy.processIds > 300 || lazy.processNames > 31)
+    {
+        printf("  lazy refreshes fetched classes or pids more than once per window\n");
+        ++failures;
+    }
+    const auto same = [](const WindowInfo& a, const WindowInfo& b)
+    {
+        return a.hwnd == b.hwnd && a.title == b.title && a.className == b.className &&
+            a.processId == b.processId && a.processName == b.processName && a.resolved == b.resolved;
+    };
+    if (!std::ranges::equal(eagerWindows, lazyWindows, same))
+    {
+        printf("  resolving the lazy list didn't give the eager one\n");
+        ++failures;
+    }
+
+    // a saved order needs the process of every window, the class only of the apps it
+    // has a fingerprint for, and those once
+    std::vector<WindowInfo> ordered;
+    double orderMs = 0;
+    const WindowFieldStats byProcess = refresh_in_order({"app1.exe"}, ordered, orderMs);
+    print_field_stats("order", byProcess, orderMs);
+    if (byProcess.classNames != 0 || byProcess.processIds > 300 || ordered.empty() ||
+        ordered[0].processName != "app1.exe")
+    {
+        printf("  a saved order by process fetched classes or didn't apply\n");
+        ++failures;
+    }
+    const WindowFingerprint saved = make_fingerprint(app_hash("app.exe", "App"), 0, title_simhash("app 1"));
+    const WindowFieldStats byFingerprint = refresh_in_order({saved_order_line({.processName = "app.exe",
+                                                                               .fingerprint = saved})},
+                                                               ordered, orderMs);
+    print_field_stats("print", byFingerprint, orderMs);
+    if (byFingerprint.classNames > 20 || byFingerprint.processIds > 300 || ordered.empty() ||
+        ordered[0].processName != "app.exe" || ordered[0].fingerprint != saved)
+    {
+        printf("  a saved fingerprint fetched %llu classes for an app with 20 windows\n",
+               static_cast<unsigned long long>(byFingerprint.classNames));
+        ++failures;
+    }
+
+    // resolving later fetches classes once, a handle that comes back after an
+    // enumeration missed it is a new window
+    forget_process_names();
+    FakeBackend backend;
+    populate(backend, 50, 5);
+    auto windows = ListWindowsByDesktop(backend, true, 0);
+    const WindowFieldStats before = window_field_stats();
+    resolve_window_fields(backend, std::span(windows).first(15), FIELD_CLASS);
+    resolve_window_fields(backend, std::span(windows).first(15), FIELD_CLASS);
+    windows = ListWindowsByDesktop(backend, true, 0);
+    resolve_window_fields(backend, windows, FIELD_CLASS);
+    const WindowFieldStats resolved = field_stats_since(before);
+    if (resolved.classNames != windows.size() || !std::ranges::all_of(windows, [](const WindowInfo& window)
+        {
+            return window.className == "Fake" && (window.resolved & FIELD_CLASS);
+        }))
+    {
+        printf("  resolving classes of 15 then %zu windows fetched %llu\n", windows.size(),
+               static_cast<unsigned long long>(resolved.classNames));
+        ++failures;
+    }
+
+    const HWND reused = windows[0].hwnd;
+    backend.remove_window(reused);
+    ListWindowsByDesktop(backend, true, 0);
+    backend.add_window({.hwnd = reused, .title = "reused", .className = "Other", .processName = "other.exe"});
+    windows = ListWindowsByDesktop(backend, true, FIELD_CLASS | FIELD_PROCESS);
+    const auto again = std::ranges::find(windows, reused, &WindowInfo::hwnd);
+    if (again == windows.end() || again->className != "Other" || again->processName != "other.exe")
+    {
+        printf("  a reused handle kept the old window's class or process\n");
+        ++failures;
+    }
+
+    // the rules say which fields they need
+    WindowRules rules;
+    rules.compile("pin 1 class=Chrome_WidgetWin_1\n");
+    const WindowFields classOnly = rules.fields();
+    rules.compile("exclude title=\"Find My Windows\"\nrename \"{process}\" title=*\n");
+    const WindowFields renaming = rules.fields();
+    if (classOnly != FIELD_CLASS || renaming != (FIELD_TITLE | FIELD_PROCESS))
+    {
+        printf("  rules reported fields %u and %u\n", classOnly, renaming);
+        ++failures;
+    }
+
+    set_lazy_metadata(false);
+    forget_process_names();
+    if (failures != 0)
+    {
+        printf("lazy: %zu failures\n", failures);
+        return 1;
+    }
+    printf("lazy: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,175 @@
+#include "log.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Everything the logging thread printed to file since it was started
+static std::string read_output(FILE* file)
+{
+    std::string text;
+    rewind(file);
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) text.append(buffer, n);
+    return text;
+}
+
+static LogStats stats_since(const LogStats& before)
+{
+    const LogStats now = log_stats();
+    return {
+        now.written - before.written, now.dropped_full - before.dropped_full,
+        now.dropped_rate - before.dropped_rate,
+    };
+}
+
+// Each producer numbers its records, the output has to keep every producer's in order
+static bool in_order_per_producer(const std::string& text, const size_t producers, size_t& lines)
+{
+    std::vector<long> last(producers, -1);
+    lines = 0;
+    for (size_t at = text.find("producer "); at != std::string::npos; at = text.find("producer ", at + 1))
+    {
+        unsigned producer;
+        long record;
+        if (sscanf(text.c_str() + at, "producer %u record %ld", &producer, &record) != 2 || producer >= producers ||
+            record <= last[producer])
+        {
+            return false;
+        }
+        last[producer] = record;
+        ++lines;
+    }
+    return true;
+}
+
+int test_log()
+{
+    size_t failures = 0;
+    const auto expect = [&](const bool ok, const char* what)
+    {
+        if (!ok)
+        {
+            printf("  log: %s\n", what);
+            ++failures;
+        }
+    };
+
+    FILE* output = tmpfile();
+    if (!output)
+    {
+        printf("log: no temporary file\n");
+        return 1;
+    }
+    log_set_output(output);
+    // empties the ring of whatever was logged before
+    log_start(1000000);
+    log_stop();
+
+    // without a consumer the ring takes 1024 records from concurrent producers, the rest are dropped and counted
+    constexpr size_t producers = 4;
+    constexpr long perProducer = 1000;
+    LogStats before = log_stats();
+    std::vector<std::thread> threads;
+    for (unsigned p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([p]
+        {
+            for (long i = 0; i < perProducer; ++i) log_write(LogLevel::Info, "producer {} record {}", p, i);
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    threads.clear();
+    LogStats full = stats_since(before);
+    expect(full.dropped_full == producers * perProducer - 1024, "a full ring didn't take exactly 1024 records");
+
+    log_start(1000000);
+    log_stop();
+    full = stats_since(before);
+    size_t lines = 0;
+    std::string text = read_output(output);
+    expect(full.written == 1024 && in_order_per_producer(text, producers, lines) && lines == 1024,
+           "the records a full ring took weren't all printed in order");
+
+    // with the consumer running the positions wrap around the ring many times over: every round the
+    // producers fill most of it concurrently and wait for the logging thread to empty it again
+    constexpr size_t rounds = 25;
+    constexpr long perRound = 200;
+    fclose(output);
+    output = tmpfile();
+    log_set_output(output);
+    before = log_stats();
+    log_start(100000000);
+    bool drained = true;
+    for (size_t round = 0; round < rounds && drained; ++round)
+    {
+        for (unsigned p = 0; p < producers; ++p)
+        {
+            threads.emplace_back([p, round]
+            {
+                for (long i = 0; i < perRound; ++i)
+                {
+                    log_write(LogLevel::Info, "producer {} record {} {} {}", p, round * perRound + i, 2.5, "text");
+                }
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        threads.clear();
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (stats_since(before).written < (round + 1) * producers * perRound &&
+               stats_since(before).dropped_full == 0 && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        drained = stats_since(before).written == (round + 1) * producers * perRound;
+    }
+    log_stop();
+    const LogStats wrapped = stats_since(before);
+    text = read_output(output);
+    printf("  %zu producers, %zu rounds: %llu printed, %llu dropped\n", producers, rounds,
+           static_cast<unsigned long long>(wrapped.written),
+           static_cast<unsigned long long>(wrapped.dropped_full + wrapped.dropped_rate));
+    expect(drained && wrapped.written == rounds * producers * perRound && wrapped.dropped_full == 0 &&
+           wrapped.dropped_rate == 0, "records were dropped while the ring had room");
+    expect(in_order_per_producer(text, producers, lines) && lines == wrapped.written &&
+           text.find("record 0 2.5 text\n") != std::string::npos, "records printed out of order or garbled");
+
+    // the token bucket lets a burst of its capacity through, suppresses the rest
+    // and says so, errors always get through
+    fclose(output);
+    output = tmpfile();
+    log_set_output(output);
+    before = log_stats();
+    log_start(50);
+    for (int i = 0; i < 500; ++i)
+    {
+        log_write(i % 100 == 0 ? LogLevel::Error : LogLevel::Info, "burst {}", i);
+        // slower than the logging thread drains, the ring never fills
+        if (i % 64 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    log_stop();
+    const LogStats limited = stats_since(before);
+    text = read_output(output);
+    size_t errors = 0;
+    for (size_t at = text.find("ERROR burst"); at != std::string::npos; at = text.find("ERROR burst", at + 1)) ++errors;
+    printf("  rate limit 50 lines/s: %llu of 500 printed, %llu suppressed\n",
+           static_cast<unsigned long long>(limited.written), static_cast<unsigned long long>(limited.dropped_rate));
+    expect(limited.written + limited.dropped_rate == 500 && limited.dropped_full == 0,
+           "the rate limit lost count of records");
+    expect(limited.written >= 50 && limited.written < 150, "the rate limit didn't hold the burst to its capacity");
+    expect(errors == 5, "errors were suppressed by the rate limit");
+    expect(text.find("log lines suppressed") != std::string::npos, "suppressed lines weren't reported");
+
+    log_set_output(nullptr);
+    fclose(output);
+    if (failures)
+    {
+        printf("log: %zu failures\n", failures);
+        return 1;
+    }
+    printf("log: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include "backend.h"
+#include "fake_backend.h"
+#include "mru.h"
+#include "predict.h"
+#include "tabs.h"
+#include "window_list.h"
+#include "tests/alloc_counter.h"
+#include "tests/test_support.h"
+
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Random touches and removals over more handles than fit, against a plain vector
+static size_t check_mru_against_reference()
+{
+    size_t failures = 0;
+    const auto stack = std::make_unique<MruStack>();
+    std::vector<HWND> reference;
+    std::mt19937 random(11);
+    std::uniform_int_distribution<size_t> pick(1, MruStack::capacity + MruStack::capacity / 2);
+
+    for (size_t step = 0; step < 200000 && failures == 0; ++step)
+    {
+        const HWND hwnd = handle_of(pick(random));
+        if (random() % 4 == 0)
+        {
+            stack->remove(hwnd);
+            std::erase(reference, hwnd);
+        }
+        else
+        {
+            stack->touch(hwnd);
+            std::erase(reference, hwnd);
+            reference.insert(reference.begin(), hwnd);
+            if (reference.size() > MruStack::capacity) reference.pop_back();
+        }
+
+        if (step % 10007 == 0 || stack->size() != reference.size())
+        {
+            if (stack->order() != reference || stack->previous(reference.front()) != reference[1])
+            {
+                printf("  the stack diverged from the reference after %zu steps, %zu vs %zu windows\n", step,
+                       stack->size(), reference.size());
+                ++failures;
+            }
+        }
+    }
+    if (stack->order() != reference)
+    {
+        printf("  the final order differs from the reference\n");
+        ++failures;
+    }
+    return failures;
+}
+
+int test_mru()
+{
+    size_t failures = check_mru_against_reference();
+
+    double firstTouchNs = 0;
+    for (const size_t windowCount : {100, 1000, 4000})
+    {
+        FakeBackend backend;
+        std::vector<HWND> handles;
+        for (size_t i = 0; i < windowCount; ++i)
+        {
+            handles.push_back(backend.add_window({.title = "window " + std::to_string(i), .processName = "app.exe"}));
+        }
+        set_window_backend(&backend);
+        mru_stack().clear();
+
+        // foreground changes all over the stack, what the notifications do
+        constexpr size_t touches = 2000000;
+        std::mt19937 random(5);
+        std::vector<HWND> sequence(4096);
+        for (HWND& hwnd : sequence)
+        {
+            hwnd = handles[random() % handles.size()];
+        }
+        for (const HWND hwnd : handles)
+        {
+            mru_stack().touch(hwnd);
+        }
+        const double touchSeconds = seconds_for([&]
+        {
+            for (size_t i = 0; i < touches; ++i)
+            {
+                mru_stack().touch(sequence[i & (sequence.size() - 1)]);
+            }
+        });
+        const double touchNs = touchSeconds * 1e9 / touches;
+        if (firstTouchNs == 0) firstTouchNs = touchNs;
+
+        // then the hotkey, toggling between the last two windows
+        const HWND first = handles[1];
+        const HWND second = handles[2];
+        BringWindowToFront(first);
+        BringWindowToFront(second);
+        constexpr size_t toggles = 20000;
+        const uint64_t allocationsBefore = thread_alloc_count();
+        size_t wrong = 0;
+        const double toggleSeconds = seconds_for([&]
+        {
+            for (size_t i = 0; i < toggles; ++i)
+            {
+                handle_previous(nullptr, PREVIOUS_WINDOW_SHORTCUT);
+                wrong += backend.foreground() != (i % 2 == 0 ? first : second);
+            }
+        });
+        const uint64_t allocations = thread_alloc_count() - allocationsBefore;
+
+        printf("  %5zu windows: %5.1f ns per focus change, %6.3f us per previous-window hotkey, %llu allocations\n",
+               windowCount, touchNs, toggleSeconds * 1e6 / toggles, static_cast<unsigned long long>(allocations));
+        if (wrong != 0 || allocations != 0 || backend.calls(FakeCall::EnumWindows) != 0 ||
+            backend.calls(FakeCall::Title) != 0 || mru_stack().size() != windowCount)
+        {
+            printf("  %zu wrong toggles, %zu enumerations, %zu windows in the stack\n", wrong,
+                   backend.calls(FakeCall::EnumWindows), mru_stack().size());
+            ++failures;
+        }
+        // constant time, the stack doesn't slow down with the window count
+        if (touchNs > firstTouchNs * 4 + 20)
+        {
+            printf("  focus changes got %.1fx slower with %zu windows\n", touchNs / firstTouchNs, windowCount);
+            ++failures;
+        }
+
+        // a window closed without a notification is skipped and dropped
+        backend.close_window(first);
+        handle_previous(nullptr, PREVIOUS_WINDOW_SHORTCUT);
+        if (backend.foreground() == second || mru_stack().size() != windowCount - 1)
+        {
+            printf("  a closed window was still switched to\n");
+            ++failures;
+        }
+        set_window_backend(nullptr);
+    }
+
+    mru_stack().clear();
+    transition_model().clear();
+    if (failures != 0)
+    {
+        printf("mru: %zu failures\n", failures);
+        return 1;
+    }
+    printf("mru: all checks passed\n");
+    return 0;
+}
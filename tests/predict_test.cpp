@@ -0,0 +1,141 @@
+#include "predict.h"
+#include "tests/test_support.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static size_t check_prediction_cases()
+{
+    size_t failures = 0;
+    const auto expect = [&](const bool ok, const char* what)
+    {
+        if (!ok)
+        {
+            printf("  predict: %s\n", what);
+            ++failures;
+        }
+    };
+
+    TransitionModel model;
+    const HWND a = handle_of(1), b = handle_of(2), c = handle_of(3), d = handle_of(4);
+    expect(model.predict(a) == nullptr, "empty model predicts");
+
+    model.record(a, a);
+    model.record(nullptr, a);
+    expect(model.predict(a) == nullptr, "self and null switches were recorded");
+
+    for (int i = 0; i < 3; ++i) model.record(a, b);
+    expect(model.predict(a) == b, "a -> b not learned");
+
+    for (int i = 0; i < 10; ++i) model.record(a, c);
+    expect(model.predict(a) == c, "a -> c didn't take over");
+
+    // decay runs on switches away from a, other activity leaves it alone
+    for (int i = 0; i < 200; ++i) model.record(i % 2 ? b : d, i % 2 ? d : b);
+    expect(model.predict(a) == c, "a forgot while unused");
+    expect(model.predict(b) == d && model.predict(d) == b, "b <-> d not learned");
+
+    // more successors than slots, the strongest survives
+    for (int i = 0; i < 20; ++i) model.record(c, a);
+    for (size_t i = 10; i < 30; ++i) model.record(c, handle_of(i));
+    model.record(c, a);
+    expect(model.predict(c) == a, "strong successor evicted by one-offs");
+
+    // far more sources than the table holds, recent ones stay
+    for (size_t i = 0; i < 100000; ++i) model.record(handle_of(1000 + i), handle_of(i % 7));
+    expect(model.predict(handle_of(1000 + 99999)) == handle_of(99999 % 7), "recent source evicted");
+
+    model.clear();
+    expect(model.predict(b) == nullptr && model.stats().predictions == 0, "clear kept state");
+    return failures;
+}
+
+int test_predict()
+{
+    size_t failures = check_prediction_cases();
+
+    // a user with habits: from each window 60% go to a favourite, 20% to a second
+    // favourite, the rest anywhere. Halfway through the habits change.
+    constexpr size_t windowCount = 40;
+    constexpr size_t switches = 20000;
+    std::mt19937 rng(33);
+
+    std::vector<size_t> first(windowCount), second(windowCount);
+    const auto new_habits = [&]
+    {
+        for (size_t i = 0; i < windowCount; ++i)
+        {
+            first[i] = (i + 1 + rng() % (windowCount - 1)) % windowCount;
+            do second[i] = rng() % windowCount; while (second[i] == i || second[i] == first[i]);
+        }
+    };
+    new_habits();
+
+    TransitionModel model;
+    size_t current = 0;
+    size_t previous = 1;
+    size_t mruHits = 0;
+    size_t settledPredictions = 0;
+    size_t settledHits = 0;
+    for (size_t step = 0; step < switches; ++step)
+    {
+        if (step == switches / 2) new_habits();
+
+        const unsigned roll = rng() % 100;
+        size_t next = roll < 60 ? first[current] : roll < 80 ? second[current] : rng() % windowCount;
+        if (next == current) next = (next + 1) % windowCount;
+
+        // back-and-forth like Alt+Tab, the baseline
+        mruHits += next == previous;
+
+        // the second half once the new habits had 1000 switches to sink in
+        const HWND predicted = model.predict(handle_of(current));
+        if (step >= switches / 2 + 1000 && predicted)
+        {
+            ++settledPredictions;
+            settledHits += predicted == handle_of(next);
+        }
+
+        model.record(handle_of(current), handle_of(next));
+        previous = current;
+        current = next;
+    }
+
+    const PredictionStats stats = model.stats();
+    const double hitRate = static_cast<double>(stats.hits) / static_cast<double>(std::max<uint64_t>(stats.predictions, 1));
+    const double settledRate = static_cast<double>(settledHits) / static_cast<double>(std::max<size_t>(settledPredictions, 1));
+    printf("  %zu switches over %zu windows: predicted %llu, hit rate %.1f%% (%.1f%% after the habit change), "
+           "previous window %.1f%%\n",
+           switches, windowCount, static_cast<unsigned long long>(stats.predictions), hitRate * 100,
+           settledRate * 100, static_cast<double>(mruHits) * 100 / switches);
+    if (settledRate < 0.5)
+    {
+        printf("  predict: hit rate %.2f after the habit change, expected at least 0.5\n", settledRate);
+        ++failures;
+    }
+
+    constexpr size_t operations = 2000000;
+    size_t predicted = 0;
+    const double seconds = seconds_for([&]
+    {
+        for (size_t i = 0; i < operations; ++i)
+        {
+            const HWND from = handle_of(i * 7 % 3000);
+            model.record(from, handle_of(i * 13 % 3001));
+            predicted += model.predict(from) != nullptr;
+        }
+    });
+    printf("  record + predict: %.1f ns (%zu predicted), model %zu bytes (%zu sources x %zu successors)\n",
+           seconds * 1e9 / operations, predicted, sizeof(TransitionModel), TransitionModel::source_capacity,
+           TransitionModel::successors_per_source);
+
+    if (failures != 0)
+    {
+        printf("predict: %zu failures\n", failures);
+        return 1;
+    }
+    printf("predict: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,244 @@
+#include "frame_pacer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static size_t check_pacer_arithmetic()
+{
+    using std::chrono::milliseconds;
+    size_t failures = 0;
+    const std::chrono::steady_clock::time_point zero;
+    FramePacer pacer(milliseconds(16));
+    pacer.set_vblank(zero + milliseconds(100), milliseconds(10));
+
+    const struct
+    {
+        int at;
+        int vblank;
+    } vblanks[] = {{100, 110}, {105, 110}, {109, 110}, {110, 120}, {95, 100}, {90, 100}, {-3, 0}};
+    for (const auto& test : vblanks)
+    {
+        if (pacer.next_vblank(zero + milliseconds(test.at)) != zero + milliseconds(test.vblank))
+        {
+            printf("  the vblank after %d ms isn't at %d ms\n", test.at, test.vblank);
+            ++failures;
+        }
+    }
+
+    // 2 ms of rendering and the margin before 110, or before 120 once that is too close
+    const auto early = pacer.next_frame_start(zero + milliseconds(101));
+    const auto late = pacer.next_frame_start(zero + milliseconds(108));
+    const auto lead = milliseconds(2) + FramePacer::margin;
+    if (early != zero + milliseconds(110) - lead || late != zero + milliseconds(120) - lead)
+    {
+        printf("  frames start at the wrong time before a vblank\n");
+        ++failures;
+    }
+
+    // a slow frame raises the estimate at once, fast ones bring it down slowly
+    pacer.frame_rendered(milliseconds(6));
+    const auto afterSlow = pacer.render_estimate();
+    pacer.frame_rendered(milliseconds(1));
+    if (afterSlow != milliseconds(6) || pacer.render_estimate() >= afterSlow ||
+        pacer.render_estimate() < milliseconds(5))
+    {
+        printf("  the render estimate doesn't follow the frames\n");
+        ++failures;
+    }
+    return failures;
+}
+
+struct PresentRun
+{
+    std::vector<std::chrono::nanoseconds> latencies;
+    size_t frames = 0;
+    // paced frames that finished after the vblank they aimed for
+    size_t missed = 0;
+};
+
+// A 60 Hz display, frames of 2 ms now and then 5, and key presses 5 to 40 ms apart
+static std::vector<std::chrono::nanoseconds> simulated_presses(const size_t count)
+{
+    std::mt19937 random(9);
+    std::uniform_int_distribution<int> gap(5000, 40000);
+    std::vector<std::chrono::nanoseconds> presses;
+    std::chrono::nanoseconds at{std::chrono::milliseconds(50)};
+    for (size_t i = 0; i < count; ++i)
+    {
+        at += std::chrono::microseconds(gap(random));
+        presses.push_back(at);
+    }
+    return presses;
+}
+
+static std::chrono::nanoseconds simulated_render_time(std::mt19937& random)
+{
+    return random() % 10 == 0 ? std::chrono::microseconds(5000) : std::chrono::microseconds(1800 + random() % 400);
+}
+
+constexpr std::chrono::nanoseconds displayPeriod{16666667};
+
+// Input is looked at when a frame starts, and the swap blocks until the vblank after rendering
+static PresentRun present_vsync(const std::vector<std::chrono::nanoseconds>& presses)
+{
+    PresentRun run;
+    std::mt19937 random(4);
+    size_t next = 0;
+    std::chrono::nanoseconds now{0};
+    while (next < presses.size())
+    {
+        const size_t first = next;
+        while (next < presses.size() && presses[next] <= now) ++next;
+        const auto finished = now + simulated_render_time(random);
+        const auto vblank = (finished / displayPeriod + 1) * displayPeriod;
+        for (size_t i = first; i < next; ++i) run.latencies.push_back(vblank - presses[i]);
+        ++run.frames;
+        now = vblank;
+    }
+    return run;
+}
+
+// The loop sleeps until a press or the paced frame start, as launch_gui() does in low-latency mode
+static PresentRun present_paced(const std::vector<std::chrono::nanoseconds>& presses)
+{
+    PresentRun run;
+    std::mt19937 random(4);
+    const std::chrono::steady_clock::time_point zero;
+    FramePacer pacer(displayPeriod);
+    pacer.set_vblank(zero, displayPeriod);
+
+    size_t next = 0;
+    std::chrono::nanoseconds now{0};
+    while (next < presses.size())
+    {
+        const auto start = pacer.next_frame_start(zero + now) - zero;
+        const bool pendingInput = presses[next] <= now;
+        bool paced = false;
+        if (!pendingInput)
+        {
+            paced = start < presses[next];
+            now = paced ? start : presses[next];
+        }
+
+        const size_t first = next;
+        while (next < presses.size() && presses[next] <= now) ++next;
+        const auto renderTime = simulated_render_time(random);
+        const auto finished = now + renderTime;
+        const auto presented = pacer.next_vblank(zero + finished) - zero;
+        if (paced && presented != pacer.next_vblank(zero + now + pacer.render_estimate()) - zero) ++run.missed;
+        pacer.frame_rendered(renderTime);
+        for (size_t i = first; i < next; ++i) run.latencies.push_back(presented - presses[i]);
+        ++run.frames;
+        now = finished;
+    }
+    return run;
+}
+
+// The low-latency loop of launch_gui() on a fake clock. Its vblank is measured every
+// frame the way update_vblank() takes it from the compositor, the last one before
+// now. The sleep until the frame start comes back late by a scheduler's wakeup
+// jitter, now and then by more than the margin, and only those frames may miss.
+static size_t check_paced_loop()
+{
+    using std::chrono::microseconds;
+    size_t failures = 0;
+    constexpr auto renderTime = microseconds(2500);
+    constexpr int frames = 600;
+    std::mt19937 random(11);
+    std::chrono::steady_clock::time_point now{std::chrono::seconds(5)};
+    // the display's phase has nothing to do with when the loop starts
+    const auto firstVblank = now - microseconds(7300);
+    FramePacer pacer(displayPeriod);
+
+    size_t made = 0;
+    size_t lateWakeups = 0;
+    std::vector<std::chrono::nanoseconds> leads;
+    for (int i = 0; i < frames; ++i)
+    {
+        pacer.set_vblank(firstVblank + (now - firstVblank) / displayPeriod * displayPeriod, displayPeriod);
+        const auto start = pacer.next_frame_start(now);
+        const auto wakeup = random() % 20 == 0 ? microseconds(2000 + random() % 2000) : microseconds(random() % 400);
+        lateWakeups += wakeup > FramePacer::margin;
+
+        const auto frameStart = start + wakeup;
+        now = frameStart + renderTime;
+        const auto target = pacer.next_vblank(start);
+        if (pacer.frame_finished(frameStart, now) == target) ++made;
+        leads.push_back(target - frameStart);
+        // waiting for events until the vblank has passed
+        now = std::max(now, target);
+    }
+
+    std::ranges::sort(leads);
+    const auto lead = leads[leads.size() / 2];
+    printf("  paced loop: %zu of %d frames made their vblank, %zu late wakeups, started %.2f ms ahead of it\n",
+           made, frames, lateWakeups, std::chrono::duration<double, std::milli>(lead).count());
+    // a wakeup within the margin makes the vblank, a later one misses it
+    if (made + lateWakeups != static_cast<size_t>(frames))
+    {
+        printf("  paced frames made or missed their vblank regardless of the wakeup\n");
+        ++failures;
+    }
+    // ahead by the render and not much more, a frame started a period early is vsync's latency
+    if (lead < renderTime || lead > renderTime + FramePacer::margin)
+    {
+        printf("  paced frames don't start just ahead of the vblank\n");
+        ++failures;
+    }
+    return failures;
+}
+
+static double percentile_ms(std::vector<std::chrono::nanoseconds> latencies, const double p)
+{
+    std::ranges::sort(latencies);
+    const auto at = latencies[static_cast<size_t>(p * static_cast<double>(latencies.size() - 1))];
+    return std::chrono::duration<double, std::milli>(at).count();
+}
+
+int test_present()
+{
+    size_t failures = check_pacer_arithmetic();
+    failures += check_paced_loop();
+
+    const auto presses = simulated_presses(2000);
+    const PresentRun vsync = present_vsync(presses);
+    const PresentRun paced = present_paced(presses);
+    for (const auto& [name, run] : {std::pair{"vsync", &vsync}, std::pair{"low latency", &paced}})
+    {
+        printf("  %-11s input to present p50 %5.1f ms  p99 %5.1f ms  max %5.1f ms, %zu frames, %zu late\n", name,
+               percentile_ms(run->latencies, 0.5), percentile_ms(run->latencies, 0.99),
+               percentile_ms(run->latencies, 1.0), run->frames, run->missed);
+    }
+
+    if (vsync.latencies.size() != presses.size() || paced.latencies.size() != presses.size())
+    {
+        printf("  presses went unpresented\n");
+        ++failures;
+    }
+    // vsync shows a press one to two periods later. Paced, the worst is a press
+    // just too late for a vblank behind a slow frame, a period and two frames.
+    const double worstPaced = std::chrono::duration<double, std::milli>(displayPeriod).count() + 2 * 5.0 + 1.0;
+    if (percentile_ms(paced.latencies, 0.5) > 0.7 * percentile_ms(vsync.latencies, 0.5) ||
+        percentile_ms(paced.latencies, 1.0) > worstPaced)
+    {
+        printf("  low-latency mode isn't faster than vsync\n");
+        ++failures;
+    }
+    // only the occasional frame slower than any before may miss its vblank
+    if (paced.missed * 50 > paced.frames)
+    {
+        printf("  %zu of %zu paced frames missed their vblank\n", paced.missed, paced.frames);
+        ++failures;
+    }
+
+    if (failures != 0)
+    {
+        printf("present: %zu failures\n", failures);
+        return 1;
+    }
+    printf("present: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,187 @@
+#include "latency_probe.h"
+#include "tests/test_support.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// A switcher frame as the GPU would leave it: the clear color only while the list
+// isn't drawn yet, then rows of 10 pixels with the selected one highlighted
+static void draw_switcher_frame(std::vector<uint8_t>& pixels, const int width, const int height, const bool drawn,
+                                const int selected)
+{
+    pixels.resize(static_cast<size_t>(width) * height * 4);
+    for (int y = 0; y < height; ++y)
+    {
+        const uint8_t shade = !drawn ? 38 : y / 10 == selected ? 166 : 31;
+        for (int x = 0; x < width; ++x)
+        {
+            uint8_t* pixel = &pixels[(static_cast<size_t>(y) * width + x) * 4];
+            pixel[0] = shade;
+            pixel[1] = !drawn ? 38 : static_cast<uint8_t>(31 + (x % 7 == 0) * 40);
+            pixel[2] = 46;
+            pixel[3] = 255;
+        }
+    }
+}
+
+static std::chrono::microseconds percentile_of(std::vector<std::chrono::steady_clock::duration> latencies,
+                                               const double p)
+{
+    std::ranges::sort(latencies);
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        latencies[static_cast<size_t>(p * static_cast<double>(latencies.size() - 1))]);
+}
+
+int test_probe()
+{
+    using std::chrono::microseconds;
+    using std::chrono::milliseconds;
+    using time_point = std::chrono::steady_clock::time_point;
+    size_t failures = 0;
+    const auto expect = [&](const bool ok, const char* what)
+    {
+        if (!ok)
+        {
+            printf("  probe: %s\n", what);
+            ++failures;
+        }
+    };
+
+    // what a frame read back looks like
+    std::vector<uint8_t> pixels;
+    draw_switcher_frame(pixels, 256, 160, false, 0);
+    const FrameContent blank = frame_content(pixels);
+    draw_switcher_frame(pixels, 256, 160, true, 3);
+    const FrameContent list = frame_content(pixels);
+    pixels[pixels.size() / 2 + 1] ^= 1;
+    const FrameContent onePixel = frame_content(pixels);
+    const std::vector<uint8_t> odd(4 * 3 + 4, 9);
+    expect(blank.uniform && !list.uniform && onePixel.hash != list.hash && frame_content(odd).uniform &&
+           frame_content({}).uniform, "frame contents compare wrong");
+
+    ProbePhase phase;
+    milliseconds budget;
+    expect(parse_latency_budget("navigate=16", phase, budget) && phase == ProbePhase::Navigate &&
+           budget == milliseconds(16), "a budget parsed wrong");
+    expect(!parse_latency_budget("scroll=5", phase, budget) && !parse_latency_budget("open=", phase, budget) &&
+           !parse_latency_budget("close", phase, budget), "a malformed budget parsed");
+
+    // openings of a switcher at 60 Hz: the first frame comes out blank, presses sent
+    // at random moments show in the frame that starts after them, one in ten moves
+    // past the last row and changes nothing until a later press changes the frame
+    constexpr int openings = 50;
+    constexpr int presses = 20;
+    constexpr int rows = 12;
+    constexpr auto period = microseconds(16667);
+    std::mt19937 rng(50);
+    std::uniform_int_distribution<int> gap(5000, 40000);
+    LatencyProbe probe;
+    std::vector<std::chrono::steady_clock::duration> opens, navigates, closes;
+    size_t missed = 0;
+    time_point now{};
+    for (int opening = 0; opening < openings; ++opening)
+    {
+        const time_point openedAt = now;
+        probe.opening(openedAt);
+        // sent at, and whether it changes nothing
+        std::vector<std::pair<time_point, bool>> sent;
+        time_point at = now;
+        for (int press = 0; press < presses; ++press)
+        {
+            at += microseconds(gap(rng));
+            sent.emplace_back(at, rng() % 10 == 0);
+        }
+        const time_point enterAt = at + microseconds(gap(rng));
+
+        int selected = 0;
+        bool drawn = false;
+        std::vector<time_point> unshown;
+        size_t next = 0;
+        for (time_point frameStart = now + microseconds(500);; frameStart += period)
+        {
+            // delivered as the frame starts
+            const int before = selected;
+            for (; next < sent.size() && sent[next].first <= frameStart; ++next)
+            {
+                probe.received(ProbePhase::Navigate, sent[next].first);
+                unshown.push_back(sent[next].first);
+                if (!sent[next].second) selected = (selected + 1) % rows;
+            }
+            const bool enter = enterAt <= frameStart;
+            if (enter) probe.received(ProbePhase::Close, enterAt);
+
+            const time_point presentedAt = frameStart + period - microseconds(500);
+            const bool firstDrawn = !drawn && frameStart > now + period;
+            draw_switcher_frame(pixels, 256, 160, drawn || firstDrawn, selected);
+            probe.frame(presentedAt, frame_content(pixels));
+            if (firstDrawn) opens.push_back(presentedAt - openedAt);
+            if (firstDrawn || (drawn && selected != before))
+            {
+                for (const time_point sentAt : unshown) navigates.push_back(presentedAt - sentAt);
+                unshown.clear();
+            }
+            drawn = drawn || firstDrawn;
+
+            if (enter)
+            {
+                const time_point activatedAt = presentedAt + microseconds(800);
+                probe.closed(activatedAt);
+                closes.push_back(activatedAt - enterAt);
+                missed += unshown.size();
+                now = activatedAt + milliseconds(200);
+                break;
+            }
+        }
+    }
+
+    const ProbePercentiles open = probe.percentiles(ProbePhase::Open);
+    const ProbePercentiles navigate = probe.percentiles(ProbePhase::Navigate);
+    const ProbePercentiles close = probe.percentiles(ProbePhase::Close);
+    const std::string report = probe.report();
+    for (size_t line = 0; line < report.size();)
+    {
+        const size_t end = report.find('\n', line);
+        printf("  %s\n", report.substr(line, end - line).c_str());
+        line = end + 1;
+    }
+    expect(open.count == openings && open.p50 == percentile_of(opens, 0.5) && open.max == percentile_of(opens, 1.0),
+           "open latencies aren't the first drawn frames");
+    expect(navigate.count == navigates.size() && navigate.p50 == percentile_of(navigates, 0.5) &&
+           navigate.p99 == percentile_of(navigates, 0.99) && navigate.max == percentile_of(navigates, 1.0),
+           "navigate latencies aren't the frames that showed the presses");
+    expect(probe.missed(ProbePhase::Navigate) == missed && navigate.count + missed == openings * presses,
+           "presses no frame showed weren't counted as missed");
+    expect(close.count == openings && close.p90 == percentile_of(closes, 0.9), "close latencies are off");
+
+    // a key that never reached the switcher is missed, not timed
+    probe.lost(ProbePhase::Close);
+    expect(probe.missed(ProbePhase::Close) == 1 && probe.percentiles(ProbePhase::Close).count == openings,
+           "a lost Enter wasn't counted as missed");
+
+    // readback cost, one 1080p frame
+    draw_switcher_frame(pixels, 1920, 1080, true, 5);
+    FrameContent hashed;
+    constexpr int frames = 50;
+    const double seconds = seconds_for([&]
+    {
+        for (int i = 0; i < frames; ++i)
+        {
+            pixels[static_cast<size_t>(i) * 4] ^= 1;
+            hashed = frame_content(pixels);
+        }
+    });
+    printf("  frame content of a 1920x1080 readback: %.2f ms, %.1f GB/s\n", seconds * 1e3 / frames,
+           static_cast<double>(pixels.size()) * frames / seconds / 1e9);
+    expect(!hashed.uniform, "a drawn 1080p frame reads as blank");
+
+    if (failures)
+    {
+        printf("probe: %zu failures\n", failures);
+        return 1;
+    }
+    printf("probe: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,184 @@
+#include "query.h"
+#include "switcher.h"
+#include "tabs.h"
+#include "tests/alloc_counter.h"
+#include "tests/test_support.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <regex>
+#include <string_view>
+#include <vector>
+
+struct QueryCase
+{
+    const char* text;
+    bool (*expected)(const WindowInfo&);
+};
+
+static const QueryCase query_cases[] = {
+    {"proc:code title:\"*.cpp\" desktop:current -class:ConsoleWindowClass", [](const WindowInfo& w)
+    {
+        return icontains(w.processName, "code") && icontains(w.title, ".cpp") && w.isOnCurrentDesktop &&
+            !icontains(w.className, "ConsoleWindowClass");
+    }},
+    {"chrome OR firefox", [](const WindowInfo& w)
+    {
+        return icontains(w.title, "chrome") || icontains(w.processName, "chrome") || icontains(w.title, "firefox") ||
+            icontains(w.processName, "firefox");
+    }},
+    {"-desktop:current pid:1234", [](const WindowInfo& w) { return !w.isOnCurrentDesktop && w.processId == 1234; }},
+    {"title:doc?ment1*7.h", [](const WindowInfo& w)
+    {
+        static const std::regex pattern("doc.ment1.*7\\.h", std::regex::icase);
+        return std::regex_search(w.title, pattern);
+    }},
+    {"class:chrome_widget proc:CHROME OR proc:code -title:project", [](const WindowInfo& w)
+    {
+        return icontains(w.className, "chrome_widget") &&
+            (icontains(w.processName, "chrome") || icontains(w.processName, "code")) && !icontains(w.title, "project");
+    }},
+    {"package:vendor.app3 OR desktop:other project", [](const WindowInfo& w)
+    {
+        return (icontains(w.package, "vendor.app3") || !w.isOnCurrentDesktop) &&
+            (icontains(w.title, "project") || icontains(w.processName, "project"));
+    }},
+    {"\"project 4\"", [](const WindowInfo& w) { return icontains(w.title, "project 4"); }},
+    {"", [](const WindowInfo&) { return true; }},
+};
+
+static size_t check_query_errors()
+{
+    size_t failures = 0;
+    static constexpr const char* malformed[] = {
+        "title:\"unterminated", "OR code", "code OR", "code OR OR chrome", "desktop:elsewhere", "pid:12a", "proc:",
+    };
+    WindowQuery query;
+    const WindowInfo window{handle_of(1), "title", "class", "proc.exe", 1, false};
+    for (const char* text : malformed)
+    {
+        if (query.compile(text) || query.error()[0] == '\0' || !query.matches(window))
+        {
+            printf("  \"%s\" wasn't rejected, or the rejected query filtered\n", text);
+            ++failures;
+        }
+    }
+
+    // a colon that isn't a field prefix is part of the text
+    if (!query.compile("http://") || query.fields() != (FIELD_TITLE | FIELD_PROCESS) ||
+        !query.matches({handle_of(1), "http://example.com", "", "", 1, false}))
+    {
+        printf("  \"http://\" didn't match as text\n");
+        ++failures;
+    }
+
+    // cheapest fields first, the desktop flag before any string
+    query.compile(query_cases[0].text);
+    const std::vector<WindowQuery::Field> expected = {WindowQuery::Field::Desktop, WindowQuery::Field::Process,
+                                                      WindowQuery::Field::Class, WindowQuery::Field::Title};
+    if (query.plan() != expected || query.fields() != ALL_WINDOW_FIELDS)
+    {
+        printf("  the example query runs as\n%s", query.disassemble().c_str());
+        ++failures;
+    }
+    return failures;
+}
+
+int test_query()
+{
+    size_t failures = check_query_errors();
+    const std::vector<WindowInfo> windows = query_windows(10000);
+
+    WindowQuery query;
+    for (const QueryCase& test : query_cases)
+    {
+        constexpr size_t compiles = 20000;
+        constexpr size_t passes = 50;
+        query.compile(test.text);
+
+        const uint64_t compileAllocationsBefore = thread_alloc_count();
+        const double compileSeconds = seconds_for([&]
+        {
+            for (size_t i = 0; i < compiles; ++i) query.compile(test.text);
+        });
+        const uint64_t compileAllocations = thread_alloc_count() - compileAllocationsBefore;
+
+        size_t matched = 0;
+        const uint64_t evalAllocationsBefore = thread_alloc_count();
+        const double evalSeconds = seconds_for([&]
+        {
+            for (size_t pass = 0; pass < passes; ++pass)
+            {
+                for (const WindowInfo& window : windows) matched += query.matches(window);
+            }
+        });
+        const uint64_t evalAllocations = thread_alloc_count() - evalAllocationsBefore;
+        matched /= passes;
+
+        const size_t expected = static_cast<size_t>(std::ranges::count_if(windows, test.expected));
+        printf("  %-64s %5zu of %zu, compile %5.2f us, %5.1f ns per window\n", test.text, matched, windows.size(),
+               compileSeconds * 1e6 / compiles, evalSeconds * 1e9 / static_cast<double>(passes * windows.size()));
+
+        if (matched != expected)
+        {
+            printf("  \"%s\" matched %zu windows, expected %zu\n", test.text, matched, expected);
+            ++failures;
+        }
+        if (compileAllocations != 0 || evalAllocations != 0)
+        {
+            printf("  \"%s\" allocated %llu times compiling again and %llu times matching\n", test.text,
+                   static_cast<unsigned long long>(compileAllocations),
+                   static_cast<unsigned long long>(evalAllocations));
+            ++failures;
+        }
+    }
+
+    // typing a query into the switcher, one recompile and filter per keystroke
+    SwitcherList rows(windows, 0);
+    const std::string typed = query_cases[0].text;
+    rows.set_query(typed);
+    rows.set_query("");
+    size_t shownRows = 0;
+    const uint64_t typingAllocationsBefore = thread_alloc_count();
+    const double typingSeconds = seconds_for([&]
+    {
+        for (size_t length = 1; length <= typed.size(); ++length)
+        {
+            rows.set_query(std::string_view(typed).substr(0, length));
+            shownRows += rows.size();
+        }
+    });
+    const uint64_t typingAllocations = thread_alloc_count() - typingAllocationsBefore;
+    printf("  typing the first query over %zu rows: %.1f us per keystroke, %llu allocations\n", windows.size(),
+           typingSeconds * 1e6 / static_cast<double>(typed.size()), static_cast<unsigned long long>(typingAllocations));
+    if (typingAllocations != 0)
+    {
+        printf("  filtering the switcher allocated %llu times\n", static_cast<unsigned long long>(typingAllocations));
+        ++failures;
+    }
+
+    const size_t expectedRows = static_cast<size_t>(std::ranges::count_if(windows, query_cases[0].expected));
+    const HWND picked = rows.empty() ? nullptr : rows.window(rows.size() / 2).hwnd;
+    rows.select(static_cast<int>(rows.size() / 2));
+    rows.set_query(std::string(typed) + " ");
+    if (rows.size() != expectedRows || rows.empty() || rows.window(rows.selected()).hwnd != picked)
+    {
+        printf("  the filtered switcher shows %zu rows, expected %zu, or lost the selection\n", rows.size(),
+               expectedRows);
+        ++failures;
+    }
+    const std::vector<WindowInfo> released = rows.release();
+    if (released.size() != windows.size())
+    {
+        printf("  the filter dropped windows from the list\n");
+        ++failures;
+    }
+
+    if (failures != 0)
+    {
+        printf("query: %zu failures\n", failures);
+        return 1;
+    }
+    printf("query: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include "fake_backend.h"
+#include "quick_switch.h"
+#include "tabs.h"
+#include "tests/test_support.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// A scripted keyboard: the chord as seen at each millisecond of fake time
+struct ChordEvent
+{
+    int64_t atMs;
+    ChordState state;
+};
+
+static std::chrono::steady_clock::time_point chordNow;
+static std::vector<ChordEvent> chordScript;
+static size_t chordPolls = 0;
+
+static std::chrono::steady_clock::time_point chord_clock()
+{
+    return chordNow;
+}
+
+static void chord_idle()
+{
+    chordNow += std::chrono::milliseconds(1);
+}
+
+static ChordState scripted_chord()
+{
+    ++chordPolls;
+    ChordState state{true, 1};
+    for (const ChordEvent& event : chordScript)
+    {
+        if (std::chrono::milliseconds(event.atMs) > chordNow - std::chrono::steady_clock::time_point()) break;
+        state = event.state;
+    }
+    return state;
+}
+
+struct QuickCase
+{
+    const char* name;
+    std::vector<ChordEvent> script;
+    QuickSwitchStep step;
+    int selected;
+    int64_t decidedAtMs;
+};
+
+static size_t check_quick_cases()
+{
+    size_t failures = 0;
+    constexpr auto delay = std::chrono::milliseconds(150);
+    const QuickCase cases[] = {
+        {"tap", {{40, {false, 1}}}, QuickSwitchStep::Activate, 2, 40},
+        {"hold", {}, QuickSwitchStep::ShowSwitcher, 2, 150},
+        {"two taps", {{30, {true, 2}}, {60, {false, 2}}}, QuickSwitchStep::Activate, 3, 60},
+        // cycling wraps past the last row
+        {"four taps", {{20, {true, 3}}, {40, {true, 5}}, {90, {false, 5}}}, QuickSwitchStep::Activate, 1, 90},
+        // a press in the same poll as the release still counts
+        {"press and release", {{10, {false, 2}}}, QuickSwitchStep::Activate, 3, 10},
+        {"cycle then hold", {{100, {true, 2}}}, QuickSwitchStep::ShowSwitcher, 3, 150},
+    };
+
+    for (const QuickCase& test : cases)
+    {
+        chordNow = std::chrono::steady_clock::time_point();
+        chordScript = test.script;
+        QuickSwitch hold(5, 2, delay, chordNow);
+        const QuickSwitchStep step = hold.wait(scripted_chord, chord_clock, chord_idle);
+        const int64_t decidedAt = std::chrono::duration_cast<std::chrono::milliseconds>(
+            chordNow - std::chrono::steady_clock::time_point()).count();
+        if (step != test.step || hold.selected() != test.selected || decidedAt != test.decidedAtMs)
+        {
+            printf("  %s: step %d row %d at %lld ms, expected step %d row %d at %lld ms\n", test.name,
+                   static_cast<int>(step), hold.selected(), static_cast<long long>(decidedAt),
+                   static_cast<int>(test.step), test.selected, static_cast<long long>(test.decidedAtMs));
+            ++failures;
+        }
+    }
+
+    // out of range targets and an empty list stay in range
+    if (QuickSwitch(3, 7, delay, chordNow).selected() != 2 || QuickSwitch(0, 1, delay, chordNow).selected() != 0)
+    {
+        printf("  the first row isn't clamped to the list\n");
+        ++failures;
+    }
+    return failures;
+}
+
+static size_t check_quick_targets()
+{
+    size_t failures = 0;
+    std::vector<WindowInfo> windows(4);
+    for (size_t i = 0; i < windows.size(); ++i)
+    {
+        windows[i].hwnd = handle_of(i + 1);
+        windows[i].tabNode = 0;
+    }
+    windows[1].tabNode = 7;
+
+    const struct
+    {
+        HWND foreground;
+        HWND predicted;
+        int target;
+    } cases[] = {
+        {handle_of(1), handle_of(4), 3}, // the prediction wins
+        {handle_of(1), nullptr, 2}, // the first other window, tab rows skipped
+        {handle_of(1), handle_of(1), 2}, // never the window already in front
+        {handle_of(3), handle_of(9), 0}, // unlisted prediction
+        {nullptr, nullptr, 0},
+    };
+    for (const auto& test : cases)
+    {
+        const int target = quick_switch_target(windows, test.foreground, test.predicted);
+        if (target != test.target)
+        {
+            printf("  target %d, expected %d\n", target, test.target);
+            ++failures;
+        }
+    }
+    if (quick_switch_target({}, handle_of(1), handle_of(2)) != 0)
+    {
+        printf("  an empty list has no target\n");
+        ++failures;
+    }
+    return failures;
+}
+
+int test_quick()
+{
+    size_t failures = check_quick_cases() + check_quick_targets();
+
+    // a tap on a simulated desktop: the list is already cached, picking and
+    // activating the target is all the hotkey pays for
+    FakeBackend backend;
+    set_desktop_latencies(backend);
+    backend.set_latency(FakeCall::Activate, {std::chrono::microseconds(300), std::chrono::microseconds(4000)});
+    constexpr size_t desktopWindows = 30;
+    populate(backend, desktopWindows, 10);
+    forget_process_names();
+    std::vector<WindowInfo> windows = ListWindowsByDesktop(backend, false);
+    const HWND foreground = windows.empty() ? nullptr : windows[0].hwnd;
+
+    constexpr int taps = 1000;
+    LatencyStats tapLatency;
+    chordScript = {{0, {false, 1}}};
+    for (int i = 0; i < taps; ++i)
+    {
+        chordNow = std::chrono::steady_clock::time_point();
+        const auto startedAt = simulatedNow;
+        const auto wallStart = std::chrono::steady_clock::now();
+        QuickSwitch hold(windows.size(), quick_switch_target(windows, foreground, nullptr),
+                         std::chrono::milliseconds(150), chordNow);
+        if (hold.wait(scripted_chord, chord_clock, chord_idle) != QuickSwitchStep::Activate ||
+            !backend.activate(windows[hold.selected()].hwnd))
+        {
+            ++failures;
+            break;
+        }
+        tapLatency.add(std::chrono::steady_clock::now() - wallStart + (simulatedNow - startedAt));
+    }
+    printf("  tap to activation: %.1f us on average, %llu us max, %zu activations\n",
+           static_cast<double>(tapLatency.totalMicroseconds) / taps,
+           static_cast<unsigned long long>(tapLatency.maxMicroseconds), backend.calls(FakeCall::Activate));
+    // the titles are from the one enumeration that built the list
+    if (backend.calls(FakeCall::Activate) != taps || backend.calls(FakeCall::Title) != desktopWindows)
+    {
+        printf("  %zu activations and %zu title fetches for %d taps\n", backend.calls(FakeCall::Activate),
+               backend.calls(FakeCall::Title), taps);
+        ++failures;
+    }
+    forget_process_names();
+
+    if (failures != 0)
+    {
+        printf("quick: %zu failures\n", failures);
+        return 1;
+    }
+    printf("quick: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include "refresh.h"
+#include "tests/test_support.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+static std::chrono::steady_clock::time_point lastFakeRefresh;
+static RefreshScheduler* refreshUnderTest = nullptr;
+static bool requestWhileRefreshing = false;
+
+static void fake_refresh()
+{
+    lastFakeRefresh = fakeNow;
+    if (requestWhileRefreshing) refreshUnderTest->mark_dirty();
+}
+
+int test_refresh()
+{
+    using std::chrono::milliseconds;
+    size_t failures = 0;
+    const auto expect = [&](const bool ok, const char* what)
+    {
+        if (!ok)
+        {
+            printf("  refresh: %s\n", what);
+            ++failures;
+        }
+    };
+
+    {
+        fakeNow = {};
+        RefreshScheduler refreshes(fake_refresh, milliseconds(250), milliseconds(100), fake_clock);
+        refreshUnderTest = &refreshes;
+
+        expect(refreshes.time_until_due() == milliseconds::zero(), "first refresh not due at once");
+        expect(refreshes.run_if_due(), "first refresh didn't run");
+        expect(!refreshes.run_if_due(), "clean list refreshed");
+        expect(refreshes.time_until_due() == milliseconds::max(), "clean list has a due time");
+
+        // a burst right after a refresh waits out the interval as one refresh
+        fakeNow += milliseconds(10);
+        for (int i = 0; i < 50; ++i)
+        {
+            refreshes.mark_dirty();
+            refreshes.run_if_due();
+        }
+        expect(refreshes.stats().executed == 1, "burst refreshed before the interval");
+        expect(refreshes.time_until_due() == milliseconds(240), "wrong wait after a burst");
+        fakeNow += milliseconds(240);
+        expect(refreshes.run_if_due(), "burst never refreshed");
+        expect(refreshes.stats().executed == 2 && refreshes.stats().requested == 50, "burst counters");
+
+        // hotkeys: a clean list young enough is served as is, anything else refreshes now
+        fakeNow += milliseconds(100);
+        expect(!refreshes.ensure_fresh(), "fresh list refreshed for a hotkey");
+        fakeNow += milliseconds(1);
+        expect(refreshes.ensure_fresh(), "old list served to a hotkey");
+        fakeNow += milliseconds(5);
+        refreshes.mark_dirty();
+        expect(refreshes.ensure_fresh(), "dirty list served to a hotkey inside the interval");
+        expect(refreshes.stats().forced == 2, "forced counter");
+
+        // a request made while refreshing isn't lost
+        refreshes.mark_dirty();
+        requestWhileRefreshing = true;
+        fakeNow += milliseconds(300);
+        refreshes.run_if_due();
+        requestWhileRefreshing = false;
+        expect(refreshes.time_until_due() == milliseconds(250), "request during the refresh dropped");
+    }
+
+    // a message storm: a message every millisecond for 10 s, a hotkey every 300 ms
+    fakeNow = {};
+    RefreshScheduler refreshes(fake_refresh, milliseconds(250), milliseconds(100), fake_clock);
+    refreshUnderTest = &refreshes;
+    constexpr int storm_ms = 10000;
+    size_t staleHotkeys = 0;
+    size_t hotkeys = 0;
+    milliseconds longestDirty{0};
+    std::chrono::steady_clock::time_point dirtySince{};
+    bool dirty = false;
+    for (int ms = 0; ms < storm_ms; ++ms)
+    {
+        fakeNow = std::chrono::steady_clock::time_point{} + milliseconds(ms);
+        if (!dirty) dirtySince = fakeNow;
+        refreshes.mark_dirty();
+        dirty = true;
+
+        if (ms % 300 == 150)
+        {
+            ++hotkeys;
+            refreshes.ensure_fresh();
+            if (lastFakeRefresh != fakeNow && fakeNow - lastFakeRefresh > milliseconds(100)) ++staleHotkeys;
+            refreshes.mark_dirty();
+        }
+
+        if (refreshes.run_if_due() || lastFakeRefresh == fakeNow)
+        {
+            longestDirty = std::max(longestDirty, std::chrono::duration_cast<milliseconds>(fakeNow - dirtySince));
+            dirty = false;
+        }
+    }
+
+    const RefreshStats stats = refreshes.stats();
+    printf("  %d messages over %d s with %zu hotkeys: %llu refreshes (%llu forced), longest dirty %lld ms\n",
+           storm_ms, storm_ms / 1000, hotkeys, static_cast<unsigned long long>(stats.executed),
+           static_cast<unsigned long long>(stats.forced), static_cast<long long>(longestDirty.count()));
+    expect(staleHotkeys == 0, "a hotkey was served a stale list");
+    expect(stats.executed <= storm_ms / 250 + hotkeys + 1, "the storm wasn't coalesced");
+    expect(longestDirty <= milliseconds(250), "a request waited longer than the interval");
+
+    refreshUnderTest = nullptr;
+    if (failures != 0)
+    {
+        printf("refresh: %zu failures\n", failures);
+        return 1;
+    }
+    printf("refresh: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,211 @@
+#include "app_index.h"
+#include "fake_backend.h"
+#include "residency.h"
+#include "tabs.h"
+#include "tests/test_support.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Stand-ins for the GUI, a cache and a history, sized in bytes
+static size_t fakeGuiBytes = 0;
+static size_t fakeCacheBytes = 0;
+static size_t fakeHistoryBytes = 0;
+
+int test_residency()
+{
+    using std::chrono::milliseconds;
+    using std::chrono::minutes;
+    size_t failures = 0;
+    const auto expect = [&](const bool ok, const char* what)
+    {
+        if (!ok)
+        {
+            printf("  residency: %s\n", what);
+            ++failures;
+        }
+    };
+
+    std::string name;
+    ResidencyBudget parsed;
+    expect(parse_residency_budget("gui=300:2048", name, parsed) && name == "gui" &&
+           parsed.idleAfter == std::chrono::seconds(300) && parsed.idleBytes == 2048 * 1024, "a budget parsed wrong");
+    expect(parse_residency_budget("apps=0", name, parsed) && parsed.idleAfter.count() == 0 && parsed.idleBytes == 0,
+           "a budget without bytes parsed wrong");
+    expect(!parse_residency_budget("=5", name, parsed) && !parse_residency_budget("gui", name, parsed) &&
+           !parse_residency_budget("gui=x", name, parsed) && !parse_residency_budget("gui=5:", name, parsed),
+           "a malformed budget parsed");
+
+    fakeNow = {};
+    fakeGuiBytes = fakeCacheBytes = fakeHistoryBytes = 0;
+    constexpr size_t listBytes = 200 * 1024;
+    constexpr size_t historyBudget = 512 * 1024;
+    // what the history gains every tick whatever the user does
+    constexpr size_t historyGrowth = 4 * 1024;
+    ResidencyPolicy residency(fake_clock);
+    residency.add({"gui", [] { return fakeGuiBytes; }, [] { fakeGuiBytes = 0; }, [] { fakeGuiBytes = 8 << 20; }},
+                  {minutes(10), 0});
+    residency.add({"cache", [] { return fakeCacheBytes; }, [] { fakeCacheBytes = 0; }, [] { fakeCacheBytes = 1 << 20; }},
+                  {minutes(5), 256 * 1024});
+    // trimmed in place, its next use refills it
+    residency.add({"history", [] { return fakeHistoryBytes; }, [] { fakeHistoryBytes = 0; }, nullptr},
+                  {minutes(5), historyBudget});
+    residency.add({"list", [] { return listBytes; }}, {});
+
+    expect(residency.resident_bytes() == listBytes, "something was built before any activity");
+    residency.note_activity();
+    expect(fakeGuiBytes == 8 << 20 && fakeCacheBytes == 1 << 20, "the first activity didn't warm everything");
+    expect(residency.time_until_due() == minutes(5), "the first subsystem isn't due after its idle time");
+    fakeNow += minutes(5);
+    expect(residency.tick() == 1 && fakeCacheBytes == 0 && fakeGuiBytes != 0, "the wrong subsystems went cold");
+    expect(residency.time_until_due() == minutes(5), "the next one isn't due after the rest of its idle time");
+
+    // a simulated day at the message loop's 2 s tick: work in bursts, breaks, lunch and the night
+    std::mt19937 random(11);
+    const auto day = fakeNow + std::chrono::hours(24);
+    auto lastActivity = fakeNow;
+    auto breakUntil = fakeNow;
+    size_t activePeak = 0;
+    size_t idlePeak = 0;
+    size_t idleTicks = 0;
+    bool releasedWhileActive = false;
+    bool coldAfterActivity = false;
+    const auto started = std::chrono::steady_clock::now();
+    size_t ticks = 0;
+    while (fakeNow < day)
+    {
+        fakeNow += milliseconds(2000);
+        fakeHistoryBytes += historyGrowth;
+        if (fakeNow >= breakUntil)
+        {
+            if (std::uniform_int_distribution(0, 3)(random) == 0)
+            {
+                residency.note_activity();
+                lastActivity = fakeNow;
+                fakeCacheBytes += 64 * 1024;
+                for (const ResidentFootprint& subsystem : residency.footprint())
+                {
+                    coldAfterActivity |= !subsystem.resident;
+                }
+            }
+            // now and then the user leaves, for a coffee, for lunch or for the night
+            const int leave = std::uniform_int_distribution(0, 2000)(random);
+            if (leave < 12) breakUntil = fakeNow + minutes(std::uniform_int_distribution(3, 40)(random));
+            else if (leave < 13) breakUntil = fakeNow + minutes(60);
+            else if (leave < 14) breakUntil = fakeNow + std::chrono::hours(12);
+        }
+
+        const size_t before = residency.resident_bytes();
+        const size_t released = residency.tick();
+        ++ticks;
+        if (fakeNow - lastActivity < minutes(5))
+        {
+            releasedWhileActive |= released != 0;
+            activePeak = std::max(activePeak, before);
+        }
+        if (fakeNow - lastActivity >= minutes(10))
+        {
+            // every subsystem is cold: the budgets, one tick of history growth and what is only reported
+            ++idleTicks;
+            idlePeak = std::max(idlePeak, residency.resident_bytes());
+        }
+    }
+    const double tickSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    const size_t idleBound = 256 * 1024 + historyBudget + historyGrowth + listBytes;
+
+    uint64_t releases = 0;
+    uint64_t warms = 0;
+    for (const ResidentFootprint& subsystem : residency.footprint())
+    {
+        releases += subsystem.releases;
+        warms += subsystem.warms;
+    }
+    printf("  simulated day: %.1f MB peak while active, %.2f MB at most over %zu idle ticks (bound %.2f MB)\n",
+           static_cast<double>(activePeak) / (1 << 20), static_cast<double>(idlePeak) / (1 << 20), idleTicks,
+           static_cast<double>(idleBound) / (1 << 20));
+    printf("  %llu releases, %llu warms, %.2f us per simulated tick\n", static_cast<unsigned long long>(releases),
+           static_cast<unsigned long long>(warms), tickSeconds * 1e6 / static_cast<double>(ticks));
+    expect(idleTicks > 10000, "the simulated day had too little idle time to say anything");
+    expect(idlePeak <= idleBound, "idle memory went over the budgets");
+    expect(activePeak > 8 << 20, "the subsystems weren't resident while in use");
+    expect(!releasedWhileActive, "something was released while the user was active");
+    expect(!coldAfterActivity, "activity didn't warm everything that was released");
+    expect(releases > 10 && warms > 10, "the day had too few cold and warm cycles");
+
+    // no idle time keeps a subsystem for good
+    residency.note_activity();
+    residency.set_budget("gui", {milliseconds(0), 0});
+    fakeNow += std::chrono::hours(8);
+    residency.tick();
+    expect(fakeGuiBytes != 0, "a subsystem without an idle time was released");
+    expect(!residency.set_budget("thumbnails", {}), "a budget was set for a subsystem that doesn't exist");
+
+    publish_footprint(residency.footprint());
+    expect(current_footprint()->size() == 4 && (*current_footprint())[0].name == "gui",
+           "the published footprint is wrong");
+    publish_footprint({});
+
+    // the real metadata caches, filled by listing the sample desktop
+    FakeBackend backend;
+    backend.load_sample();
+    std::vector<WindowInfo> listed = ListWindowsByDesktop(backend, false);
+    resolve_window_fields(backend, listed, ALL_WINDOW_FIELDS);
+    printf("  metadata caches: %zu bytes for %zu windows\n", metadata_cache_bytes(), listed.size());
+    expect(metadata_cache_bytes() > 0, "the metadata caches report nothing");
+
+    // the real app index: released, then loaded back from its file
+    const std::filesystem::path base = std::filesystem::temp_directory_path() / "fmw_residency_bench";
+    std::filesystem::remove_all(base);
+    std::filesystem::create_directories(base / "apps");
+    for (size_t file = 0; file < 50; ++file)
+    {
+        write_text(base / "apps" / ("app" + std::to_string(file) + ".desktop"),
+                   desktop_file("App " + std::to_string(file), "app"));
+    }
+    static std::string appsRoot;
+    static std::string appsFile;
+    appsRoot = (base / "apps").string();
+    appsFile = (base / "findmywindows.apps").string();
+    const auto wait_for_apps = [](const size_t count)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (current_apps()->size() != count && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(milliseconds(5));
+        }
+        return current_apps()->size() == count;
+    };
+
+    fakeNow = {};
+    ResidencyPolicy apps(fake_clock);
+    apps.add({"apps", [] { return current_apps()->bytes(); }, app_index_stop,
+              [] { app_index_start({appsRoot}, appsFile, make_directory_watcher); }}, {minutes(30), 0});
+    apps.note_activity();
+    expect(wait_for_apps(50), "warming didn't index the apps");
+    const size_t warmBytes = current_apps()->bytes();
+    fakeNow += minutes(30);
+    apps.tick();
+    const size_t releasedBytes = current_apps()->bytes();
+    expect(current_apps()->size() == 0 && releasedBytes < warmBytes / 10 &&
+           std::filesystem::exists(appsFile), "releasing the app index kept it or didn't save it");
+    const auto rewarmed = std::chrono::steady_clock::now();
+    apps.note_activity();
+    expect(wait_for_apps(50), "warming again didn't load the app index");
+    printf("  app index: %zu bytes warm, %zu released, loaded back in %.1f ms\n", warmBytes, releasedBytes,
+           std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - rewarmed).count());
+    app_index_stop();
+    std::filesystem::remove_all(base);
+
+    if (failures != 0)
+    {
+        printf("residency: %zu failures\n", failures);
+        return 1;
+    }
+    printf("residency: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,290 @@
+#include "rules.h"
+#include "tabs.h"
+#include "tests/test_support.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <regex>
+#include <string_view>
+#include <vector>
+
+static char lower(const char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// Plain backtracking glob, ASCII only, as the reference for the automaton
+static bool glob_matches(const std::string_view pattern, const std::string_view text)
+{
+    if (pattern.empty()) return text.empty();
+    if (pattern[0] == '*')
+    {
+        for (size_t skip = 0; skip <= text.size(); ++skip)
+        {
+            if (glob_matches(pattern.substr(1), text.substr(skip))) return true;
+        }
+        return false;
+    }
+    if (text.empty()) return false;
+    if (pattern[0] == '?' || lower(pattern[0]) == lower(text[0]))
+    {
+        return glob_matches(pattern.substr(1), text.substr(1));
+    }
+    return false;
+}
+
+struct ReferenceCondition
+{
+    int field;
+    bool regex;
+    std::string pattern;
+    std::regex compiled;
+};
+
+struct ReferenceRule
+{
+    std::string action;
+    int slot = 0;
+    std::string rename;
+    std::vector<ReferenceCondition> conditions;
+};
+
+static std::string rule_line(const ReferenceRule& rule)
+{
+    static constexpr const char* fields[] = {"process", "class", "title"};
+    std::string line = rule.action;
+    if (rule.action == "pin") line += " " + std::to_string(rule.slot);
+    if (rule.action == "rename") line += " \"" + rule.rename + "\"";
+    for (const auto& condition : rule.conditions)
+    {
+        line += std::string(" ") + fields[condition.field] + (condition.regex ? "~\"" : "=\"") + condition.pattern +
+            "\"";
+    }
+    return line;
+}
+
+static RuleMatch reference_evaluate(const std::vector<ReferenceRule>& rules, const WindowInfo& window)
+{
+    const std::string* values[] = {&window.processName, &window.className, &window.title};
+    RuleMatch match;
+    for (const auto& rule : rules)
+    {
+        const bool all = std::ranges::all_of(rule.conditions, [&](const ReferenceCondition& condition)
+        {
+            const std::string& value = *values[condition.field];
+            return condition.regex
+                       ? std::regex_search(value, condition.compiled)
+                       : glob_matches(condition.pattern, value);
+        });
+        if (!all) continue;
+
+        if (rule.action == "exclude") match.excluded = true;
+        if (rule.action == "pin" && match.pinnedSlot == 0) match.pinnedSlot = rule.slot;
+        if (rule.action == "rename" && !match.rename) match.rename = &rule.rename;
+    }
+    return match;
+}
+
+static bool same_match(const RuleMatch& a, const RuleMatch& b)
+{
+    return a.excluded == b.excluded && a.pinnedSlot == b.pinnedSlot && (a.rename == nullptr) == (b.rename == nullptr)
+        && (!a.rename || *a.rename == *b.rename);
+}
+
+static size_t check_rule_cases()
+{
+    WindowRules rules;
+    const size_t kept = rules.compile(
+        "# comment\n"
+        "pin 2 process=chrome.exe title=\"*github*\"\n"
+        "pin 5 process=chrome.exe\n"
+        "exclude class~\"^Shell_.*TrayWnd$\"\n"
+        "rename \"Mail: {title}\" process=OUTLOOK.EXE\n"
+        "rename \"ignored\" process=outlook.exe\n"
+        "exclude title~\"build #\\d+ (failed|passed)\"\n"
+        "pin 3 title=\"caf? ??\"\n"
+        "pin 4 class=\"[a-c]x[^0-9]\"\n"
+        "bogus title=x\n"
+        "pin 0 title=x\n"
+        "exclude\n"
+        "exclude colour=red\n"
+        "exclude title~\"a{2}\"\n"
+        "exclude title~\"(unbalanced\"\n");
+
+    struct Case
+    {
+        const char* process;
+        const char* className;
+        const char* title;
+        bool excluded;
+        int slot;
+        const char* rename;
+    };
+    const Case cases[] = {
+        {"chrome.exe", "Chrome_WidgetWin_1", "RA341/findmywindows - GitHub - Google Chrome", false, 2, nullptr},
+        {"CHROME.EXE", "Chrome_WidgetWin_1", "New Tab", false, 5, nullptr},
+        {"explorer.exe", "Shell_TrayWnd", "", true, 0, nullptr},
+        {"explorer.exe", "Shell_SecondaryTrayWnd", "", true, 0, nullptr},
+        {"explorer.exe", "xShell_TrayWnd", "", false, 0, nullptr},
+        {"outlook.exe", "rctrl_renwnd32", "Inbox", false, 0, "Mail: Inbox"},
+        {"ci.exe", "Console", "Build #1042 failed - CI", true, 0, nullptr},
+        {"ci.exe", "Console", "Build # failed", false, 0, nullptr},
+        {"notes.exe", "Notes", "Caf\xC3\xA9 \xE4\xB8\xAD\xE6\x96\x87", false, 3, nullptr},
+        {"notes.exe", "Notes", "Cafe 12", false, 3, nullptr},
+        {"notes.exe", "Notes", "Cafe 123", false, 0, nullptr},
+        {"x.exe", "BX_", "", false, 4, nullptr},
+        {"x.exe", "bx7", "", false, 0, nullptr},
+        {"x.exe", "bx\xC3\xA9", "", false, 4, nullptr},
+    };
+
+    size_t failures = 0;
+    if (kept != 8)
+    {
+        printf("  kept %zu rules, expected 8 with the malformed lines skipped\n", kept);
+        ++failures;
+    }
+    for (const auto& c : cases)
+    {
+        WindowInfo window{.hwnd = nullptr, .title = c.title, .className = c.className, .processName = c.process};
+        const RuleMatch match = rules.evaluate(window);
+        std::vector<WindowInfo> list{window};
+        rules.apply(list);
+        const bool renamed = c.rename ? !list.empty() && list[0].title == c.rename : true;
+        if (match.excluded != c.excluded || match.pinnedSlot != c.slot || !renamed)
+        {
+            printf("  rule case %s / %s / %s evaluated wrong\n", c.process, c.className, c.title);
+            ++failures;
+        }
+    }
+    return failures;
+}
+
+int test_rules()
+{
+    size_t failures = check_rule_cases();
+
+    std::mt19937 rng(11);
+    const auto pick = [&](const int n) { return static_cast<int>(rng() % static_cast<unsigned>(n)); };
+    const auto word = [&] { return "w" + std::to_string(pick(2000)); };
+
+    std::vector<ReferenceRule> reference;
+    std::string text;
+    for (int i = 0; i < 500; ++i)
+    {
+        ReferenceRule rule;
+        const int kind = pick(100);
+        rule.action = kind < 40 ? "pin" : kind < 70 ? "exclude" : "rename";
+        rule.slot = 1 + pick(9);
+        rule.rename = "renamed " + std::to_string(i);
+
+        const int shape = pick(100);
+        if (shape < 25)
+        {
+            rule.conditions.push_back({0, false, "app" + std::to_string(pick(1000)) + (pick(2) ? ".exe" : "*"), {}});
+        }
+        else if (shape < 55)
+        {
+            rule.conditions.push_back({2, false, "*" + word() + " " + word() + "*", {}});
+        }
+        else if (shape < 70)
+        {
+            rule.conditions.push_back({1, false, "Class" + std::to_string(pick(300)) + "_?*", {}});
+        }
+        else if (shape < 85)
+        {
+            rule.conditions.push_back({2, true, word() + " (" + word() + "|" + word() + ") [0-9]+", {}});
+        }
+        else
+        {
+            rule.conditions.push_back({0, false, "app" + std::to_string(pick(100)) + "?.exe", {}});
+            rule.conditions.push_back({2, true, "^" + word() + " .*" + word() + "$", {}});
+        }
+        for (auto& condition : rule.conditions)
+        {
+            if (condition.regex)
+            {
+                condition.compiled = std::regex(condition.pattern, std::regex::ECMAScript | std::regex::icase);
+            }
+        }
+        text += rule_line(rule) + "\n";
+        reference.push_back(std::move(rule));
+    }
+
+    std::vector<WindowInfo> windows(5000);
+    size_t bytes = 0;
+    for (auto& window : windows)
+    {
+        window.processName = "App" + std::to_string(pick(1000)) + ".exe";
+        window.className = "Class" + std::to_string(pick(300)) + "_" + std::to_string(pick(10));
+        const int words = 3 + pick(8);
+        for (int i = 0; i < words; ++i)
+        {
+            window.title += (i ? " " : "") + (pick(10) == 0 ? std::to_string(pick(100000)) : word());
+        }
+        bytes += window.processName.size() + window.className.size() + window.title.size();
+    }
+
+    WindowRules rules;
+    size_t kept = 0;
+    const double compileSeconds = seconds_for([&] { kept = rules.compile(text); });
+    printf("compile       %zu rules, %zu patterns in %.2f ms\n", kept, rules.pattern_count(), compileSeconds * 1e3);
+    if (kept != reference.size())
+    {
+        printf("  %zu of %zu generated rules compiled\n", kept, reference.size());
+        ++failures;
+    }
+
+    std::vector<RuleMatch> matches(windows.size());
+    const double coldSeconds = seconds_for([&]
+    {
+        for (size_t i = 0; i < windows.size(); ++i) matches[i] = rules.evaluate(windows[i]);
+    });
+
+    constexpr int rounds = 20;
+    const double warmSeconds = seconds_for([&]
+    {
+        for (int round = 0; round < rounds; ++round)
+        {
+            for (size_t i = 0; i < windows.size(); ++i) matches[i] = rules.evaluate(windows[i]);
+        }
+    }) / rounds;
+
+    size_t matched = 0;
+    size_t mismatched = 0;
+    constexpr size_t referenceWindows = 500;
+    const double referenceSeconds = seconds_for([&]
+    {
+        for (size_t i = 0; i < referenceWindows; ++i)
+        {
+            const RuleMatch expected = reference_evaluate(reference, windows[i]);
+            mismatched += !same_match(expected, matches[i]);
+        }
+    });
+    for (const auto& match : matches)
+    {
+        matched += match.excluded || match.pinnedSlot || match.rename;
+    }
+
+    printf("evaluate      %zu windows, %zu hit a rule, %zu DFA states in %.1f MB\n", windows.size(), matched,
+           rules.dfa_states(), rules.dfa_memory() / 1e6);
+    printf("  cold        %8.2f ms  %6.0f ns/window\n", coldSeconds * 1e3, coldSeconds * 1e9 / windows.size());
+    printf("  warm        %8.2f ms  %6.0f ns/window  %.0f MB/s\n", warmSeconds * 1e3,
+           warmSeconds * 1e9 / windows.size(), bytes / warmSeconds / 1e6);
+    printf("  per-rule    %8.2f ms  %6.0f ns/window  (glob + std::regex, extrapolated from %zu)\n",
+           referenceSeconds * 1e3 * windows.size() / referenceWindows, referenceSeconds * 1e9 / referenceWindows,
+           referenceWindows);
+    if (mismatched)
+    {
+        printf("  %zu of %zu windows differ from the per-rule reference\n", mismatched, referenceWindows);
+        ++failures;
+    }
+
+    if (failures)
+    {
+        printf("rules: %zu failures\n", failures);
+        return 1;
+    }
+    printf("rules: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,216 @@
+#include "fake_backend.h"
+#include "platform.h"
+#include "tabs.h"
+#include "window_list.h"
+#include "tests/test_support.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+static size_t check_fake_latency(const FakeLatency latency)
+{
+    FakeBackend backend;
+    backend.set_latency(FakeCall::Title, latency);
+    backend.set_clock(advance_simulated);
+    const HWND hwnd = backend.add_window({.title = "t"});
+
+    std::vector<int64_t> draws(20000);
+    for (auto& draw : draws)
+    {
+        const auto before = backend.charged();
+        backend.title(hwnd);
+        draw = (backend.charged() - before).count();
+    }
+    std::ranges::sort(draws);
+
+    const double median = static_cast<double>(draws[draws.size() / 2]);
+    const double p99 = static_cast<double>(draws[draws.size() * 99 / 100]);
+    printf("  latency %lld/%lld us configured, drawn median %.0f p99 %.0f\n",
+           static_cast<long long>(latency.median.count()), static_cast<long long>(latency.p99.count()), median, p99);
+    if (std::abs(median / static_cast<double>(latency.median.count()) - 1) > 0.05 ||
+        std::abs(p99 / static_cast<double>(latency.p99.count()) - 1) > 0.1)
+    {
+        printf("  drawn latencies are off the configured distribution\n");
+        return 1;
+    }
+    return 0;
+}
+
+// Simulated time of refreshes on a fresh backend with the given seed
+static std::vector<std::chrono::microseconds> simulated_refreshes(const uint64_t seed, const size_t refreshes)
+{
+    forget_process_names();
+    FakeBackend backend;
+    populate(backend, 200, 20);
+    set_desktop_latencies(backend);
+    backend.seed(seed);
+
+    std::vector<std::chrono::microseconds> times;
+    for (size_t i = 0; i < refreshes; ++i)
+    {
+        const auto before = backend.charged();
+        build_window_list(backend);
+        times.push_back(backend.charged() - before);
+    }
+    return times;
+}
+
+int test_sim()
+{
+    using std::chrono::microseconds;
+    size_t failures = 0;
+
+    failures += check_fake_latency({microseconds(100), microseconds(1000)});
+    failures += check_fake_latency({microseconds(20), microseconds(25)});
+
+    // the same seed reproduces the same refresh times exactly, another seed doesn't
+    const auto first = simulated_refreshes(7, 10);
+    const auto again = simulated_refreshes(7, 10);
+    const auto reseeded = simulated_refreshes(8, 10);
+    if (first != again)
+    {
+        printf("  two runs with seed 7 were charged different times\n");
+        ++failures;
+    }
+    if (first == reseeded)
+    {
+        printf("  seeds 7 and 8 were charged the same times\n");
+        ++failures;
+    }
+    microseconds warm{0};
+    for (size_t i = 1; i < first.size(); ++i) warm += first[i];
+    printf("  200 windows of 20 processes: cold refresh %.2f ms, warm %.2f ms simulated\n",
+           static_cast<double>(first[0].count()) / 1000.0,
+           static_cast<double>(warm.count()) / 1000.0 / static_cast<double>(first.size() - 1));
+
+    // process names are resolved once per process, not per window or per refresh
+    forget_process_names();
+    FakeBackend backend;
+    populate(backend, 200, 20);
+    set_desktop_latencies(backend);
+    for (int i = 0; i < 10; ++i)
+    {
+        build_window_list(backend);
+    }
+    if (backend.calls(FakeCall::ProcessName) != 20)
+    {
+        printf("  10 refreshes resolved %zu process names for 20 processes\n", backend.calls(FakeCall::ProcessName));
+        ++failures;
+    }
+
+    // a process that can't be opened is listed as Unknown, and not asked again every refresh
+    const HWND elevated = backend.add_window({.title = "Administrator: cmd", .processName = "cmd.exe"});
+    FakeWindow elevatedWindow;
+    backend.get_window(elevated, elevatedWindow);
+    backend.deny_process(elevatedWindow.processId);
+    const size_t namesBefore = backend.calls(FakeCall::ProcessName);
+    std::vector<WindowInfo> listed;
+    for (int i = 0; i < 5; ++i)
+    {
+        listed = ListWindowsByDesktop(backend, true);
+    }
+    const auto elevatedInfo = std::ranges::find(listed, elevated, &WindowInfo::hwnd);
+    if (elevatedInfo == listed.end() || elevatedInfo->processName != "Unknown" ||
+        backend.calls(FakeCall::ProcessName) != namesBefore + 1)
+    {
+        printf("  the access denied process was resolved %zu times\n", backend.calls(FakeCall::ProcessName) - namesBefore);
+        ++failures;
+    }
+
+    // pid reuse: once the old process is gone from an enumeration its name is gone too
+    const HWND oldWindow = backend.add_window({.title = "old", .processName = "old.exe", .processId = 4242});
+    ListWindowsByDesktop(backend, true);
+    backend.end_process(4242);
+    ListWindowsByDesktop(backend, true);
+    const HWND newWindow = backend.add_window({.title = "new", .processName = "new.exe", .processId = 4242});
+    listed = ListWindowsByDesktop(backend, true);
+    const auto reused = std::ranges::find(listed, newWindow, &WindowInfo::hwnd);
+    if (std::ranges::find(listed, oldWindow, &WindowInfo::hwnd) != listed.end() || reused == listed.end() ||
+        reused->processName != "new.exe")
+    {
+        printf("  a reused pid was listed as %s\n", reused == listed.end() ? "missing" : reused->processName.c_str());
+        ++failures;
+    }
+
+    // desktop membership: only windows elsewhere are listed once virtual desktops are available
+    backend.set_virtual_desktops(true);
+    listed = ListWindowsByDesktop(backend, true);
+    const bool anyCurrent = std::ranges::any_of(listed, &WindowInfo::isOnCurrentDesktop);
+    if (anyCurrent || listed.size() != 202 - 67)
+    {
+        printf("  %zu windows listed with virtual desktops, expected 135 from other desktops\n", listed.size());
+        ++failures;
+    }
+
+    // a hung window costs the hang timeout and keeps the focus where it was
+    backend.set_hang_cost(microseconds(5000000));
+    const HWND hung = backend.add_window({.title = "Not Responding", .processName = "hung.exe", .hung = true});
+    backend.activate(newWindow);
+    const auto hungBefore = simulatedNow;
+    if (backend.activate(hung) || backend.foreground() != newWindow ||
+        simulatedNow - hungBefore < microseconds(5000000))
+    {
+        printf("  activating a hung window succeeded or didn't wait for it\n");
+        ++failures;
+    }
+    const size_t placed = backend.set_positions({{hung, {0, 0, 100, 100}}, {newWindow, {100, 0, 100, 100}}});
+    if (placed != 1)
+    {
+        printf("  a batch with a hung window placed %zu of 2\n", placed);
+        ++failures;
+    }
+
+    // a script sets up the same desktop
+    const std::string script = (std::filesystem::temp_directory_path() / "fmw_sim_bench.txt").string();
+    {
+        std::ofstream out(script);
+        out << "# simulated desktop\n"
+               "@seed 3\n"
+               "@hang 2000000\n"
+               "@desktops on\n"
+               "@latency process_name 60 1500\n"
+               "[current] explorer.exe|CabinetWClass|Downloads\n"
+               "[hung minimized pid=77] game.exe|GameWindow|Game | Paused\n"
+               "[denied] taskmgr.exe|TaskManagerWindow|Task Manager\n"
+               "[hidden, tool] tray.exe|TrayWnd|\n";
+    }
+    FakeBackend scripted;
+    scripted.set_clock(advance_simulated);
+    scripted.load(script);
+    std::filesystem::remove(script);
+
+    std::vector<HWND> handles;
+    scripted.enum_windows(handles);
+    std::vector<FakeWindow> loaded(handles.size());
+    for (size_t i = 0; i < handles.size(); ++i) scripted.get_window(handles[i], loaded[i]);
+    if (loaded.size() != 4 || !loaded[0].onCurrentDesktop || !loaded[1].hung || !loaded[1].minimized ||
+        loaded[1].processId != 77 || loaded[1].title != "Game | Paused" ||
+        scripted.process_name(loaded[2].processId) != "Unknown" || loaded[3].visible ||
+        !(loaded[3].exStyle & WS_EX_TOOLWINDOW) || !scripted.has_virtual_desktops() ||
+        scripted.charged() == microseconds::zero())
+    {
+        printf("  the script was not loaded as written\n");
+        ++failures;
+    }
+    const auto scriptedBefore = simulatedNow;
+    scripted.activate(loaded[1].hwnd);
+    if (simulatedNow - scriptedBefore != microseconds(2000000))
+    {
+        printf("  the scripted hang time was not used\n");
+        ++failures;
+    }
+
+    forget_process_names();
+    if (failures != 0)
+    {
+        printf("sim: %zu failures\n", failures);
+        return 1;
+    }
+    printf("sim: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,148 @@
+#include "fake_backend.h"
+#include "state.h"
+#include "tabs.h"
+#include "tests/test_support.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+static std::string read_bytes(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return {std::istreambuf_iterator(file), std::istreambuf_iterator<char>()};
+}
+
+static void put_u32(std::string& bytes, const size_t offset, const uint32_t value)
+{
+    std::memcpy(bytes.data() + offset, &value, sizeof(value));
+}
+
+static bool same_window(const WindowInfo& a, const WindowInfo& b)
+{
+    return a.hwnd == b.hwnd && a.title == b.title && a.className == b.className && a.package == b.package &&
+        a.processName == b.processName && a.processId == b.processId && a.fingerprint == b.fingerprint &&
+        a.isOnCurrentDesktop == b.isOnCurrentDesktop;
+}
+
+// Restored windows are saved ones in slot order, the ones left out skipped
+static bool in_slot_order(const std::vector<WindowInfo>& restored, const std::vector<WindowInfo>& saved)
+{
+    size_t next = 0;
+    for (const auto& window : restored)
+    {
+        while (next < saved.size() && !same_window(window, saved[next])) ++next;
+        if (next == saved.size()) return false;
+        ++next;
+    }
+    return true;
+}
+
+int test_state()
+{
+    size_t failures = 0;
+    const auto expect = [&](const bool ok, const char* what)
+    {
+        if (!ok)
+        {
+            printf("  state: %s\n", what);
+            ++failures;
+        }
+    };
+
+    forget_process_names();
+    FakeBackend backend;
+    const auto add = [&](const FakeWindow& fake, const uint64_t fingerprint, const bool onCurrentDesktop)
+    {
+        const HWND hwnd = backend.add_window(fake);
+        WindowInfo window;
+        window.hwnd = hwnd;
+        window.title = fake.title;
+        window.className = fake.className;
+        window.processName = fake.processName;
+        window.processId = backend.process_id(hwnd);
+        window.package = fake.package;
+        window.fingerprint = fingerprint;
+        window.isOnCurrentDesktop = onCurrentDesktop;
+        return window;
+    };
+    std::vector<WindowInfo> saved;
+    saved.push_back(add({.title = "main.cpp - Code", .className = "Chrome_WidgetWin_1", .processName = "Code.exe"},
+                        0x1111, true));
+    saved.push_back(add({.title = "state.cpp - Code", .className = "Chrome_WidgetWin_1", .processName = "Code.exe"},
+                        0x2222, false));
+    saved.push_back(add({.title = "Calculator", .className = "ApplicationFrameWindow",
+                         .processName = "ApplicationFrameHost.exe", .package = "Microsoft.WindowsCalculator"},
+                        0x3333, true));
+    saved.push_back(add({.title = std::string(300, 't'), .className = "ConsoleWindowClass",
+                         .processName = "powershell.exe"}, 0x4444, true));
+    saved.push_back(add({.title = "", .className = "Notepad", .processName = "notepad.exe"}, 0, false));
+
+    // save and restore give back every window with its fields, in slot order
+    const std::string path = (std::filesystem::temp_directory_path() / "fmw_state_test.state").string();
+    std::vector<WindowInfo> restored;
+    expect(save_state(path, saved) && restore_state(path, backend, restored), "the snapshot didn't round trip");
+    expect(restored.size() == saved.size() && in_slot_order(restored, saved),
+           "restored windows differ from the saved ones");
+    expect(!std::filesystem::exists(path + ".tmp"), "the temp file was left behind");
+
+    // a window closed since, or a pid that moved on, is left out
+    const std::string bytes = read_bytes(path);
+    backend.remove_window(saved[1].hwnd);
+    restored.clear();
+    expect(restore_state(path, backend, restored) && restored.size() == saved.size() - 1 &&
+           in_slot_order(restored, saved), "a closed window was restored");
+
+    // cut off anywhere, the reader never runs past the end and keeps the complete windows before the cut
+    size_t restoredCuts = 0;
+    bool inOrder = true;
+    for (size_t length = 0; length < bytes.size(); ++length)
+    {
+        write_text(path, bytes.substr(0, length));
+        std::vector<WindowInfo> partial;
+        restoredCuts += restore_state(path, backend, partial);
+        inOrder = inOrder && partial.size() < saved.size() && in_slot_order(partial, saved);
+    }
+    printf("  %zu byte snapshot, %zu of its truncations still restore windows\n", bytes.size(), restoredCuts);
+    expect(inOrder && restoredCuts > 0, "a truncated snapshot restored windows it didn't hold whole");
+
+    // a window count past the end of the file reads what is there and stops
+    std::string lying = bytes;
+    put_u32(lying, 12, UINT32_MAX);
+    write_text(path, lying);
+    restored.clear();
+    expect(restore_state(path, backend, restored) && restored.size() == saved.size() - 1,
+           "a window count past the end wasn't bounded by the file");
+    put_u32(lying, 8, UINT32_MAX);
+    write_text(path, lying);
+    restored.clear();
+    expect(!restore_state(path, backend, restored) && restored.empty(),
+           "a process count past the end restored windows");
+
+    // a snapshot of another version or without the magic is ignored whole
+    std::string other = bytes;
+    put_u32(other, 4, 2);
+    write_text(path, other);
+    restored.clear();
+    expect(!restore_state(path, backend, restored) && restored.empty(), "a version 2 snapshot was restored");
+    other = bytes;
+    other[0] = 'X';
+    write_text(path, other);
+    expect(!restore_state(path, backend, restored) && restored.empty(), "a file without the magic was restored");
+    std::filesystem::remove(path);
+    expect(!restore_state(path, backend, restored) && restored.empty(), "a missing snapshot was restored");
+
+    forget_process_names();
+    if (failures)
+    {
+        printf("state: %zu failures\n", failures);
+        return 1;
+    }
+    printf("state: all checks passed\n");
+    return 0;
+}
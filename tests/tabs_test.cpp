@@ -0,0 +1,236 @@
+#include "browser_tabs.h"
+#include "switcher.h"
+#include "tabs.h"
+#include "tests/test_support.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+static std::chrono::steady_clock::time_point crawlNow;
+
+static std::chrono::steady_clock::time_point crawl_clock()
+{
+    return crawlNow;
+}
+
+static void advance_crawl_clock(const std::chrono::microseconds cost)
+{
+    crawlNow += cost;
+}
+
+static std::vector<std::string> tab_titles(const char* site, const size_t count)
+{
+    std::vector<std::string> titles;
+    for (size_t i = 0; i < count; ++i)
+    {
+        titles.push_back(std::string(site) + " page " + std::to_string(i) + " - " + site);
+    }
+    return titles;
+}
+
+struct CrawlRun
+{
+    std::chrono::nanoseconds used{0};
+    std::chrono::nanoseconds wall{0};
+    std::chrono::nanoseconds longestSlice{0};
+};
+
+// Runs the crawler to idle on the fake clock, resting between slices like the thread does.
+// Always one slice at least, that is where due recrawls are queued.
+static CrawlRun crawl_to_idle(TabCrawler& crawler)
+{
+    CrawlRun run;
+    do
+    {
+        const auto used = crawler.run_slice();
+        const auto rest = crawler.rest_after(used);
+        crawlNow += rest;
+        run.used += used;
+        run.wall += used + rest;
+        run.longestSlice = std::max(run.longestSlice, used);
+    }
+    while (!crawler.idle());
+    return run;
+}
+
+static size_t check_tab_titles(const TabSnapshot& snapshot, const HWND window, const std::vector<std::string>& titles)
+{
+    std::vector<std::string> found;
+    for (const auto& tab : snapshot.tabs)
+    {
+        if (tab.window == window) found.push_back(tab.title);
+    }
+    if (found != titles)
+    {
+        printf("  tabs: window %p has %zu tabs, expected %zu\n", static_cast<void*>(window), found.size(),
+               titles.size());
+        return 1;
+    }
+    return 0;
+}
+
+static std::unique_ptr<AccessibilityTree> make_slow_tree()
+{
+    // every call stalls like a busy browser would
+    auto tree = std::make_unique<MockAccessibilityTree>();
+    tree->add_browser(handle_of(101), tab_titles("Slow", 10), 500);
+    tree->set_call_cost(std::chrono::milliseconds(20));
+    return tree;
+}
+
+int test_tabs()
+{
+    using namespace std::chrono_literals;
+    size_t failures = 0;
+    const auto expect = [&](const bool ok, const char* what)
+    {
+        if (!ok)
+        {
+            printf("  tabs: %s\n", what);
+            ++failures;
+        }
+    };
+
+    constexpr auto call_cost = 200us;
+    const HWND a = handle_of(1), b = handle_of(2), c = handle_of(3), d = handle_of(4), e = handle_of(5);
+    MockAccessibilityTree tree;
+    tree.set_call_cost(call_cost, advance_crawl_clock);
+    tree.add_browser(a, tab_titles("GitHub", 80), 3000);
+    tree.add_browser(b, tab_titles("Docs", 70), 3000);
+    tree.add_browser(c, tab_titles("Mail", 50), 3000);
+
+    TabCrawlerOptions options;
+    options.slice = 5ms;
+    options.cpuShare = 0.1;
+    options.recrawlAfter = 30s;
+    options.maxNodesPerWindow = 5000;
+    crawlNow = {};
+    {
+        TabCrawler crawler(tree, options, crawl_clock);
+        crawler.set_windows({{a, "a"}, {b, "b"}, {c, "c"}});
+
+        // first crawl: 200 tabs, page content skipped, within the slice and the share
+        const CrawlRun first = crawl_to_idle(crawler);
+        const double share = static_cast<double>(first.used.count()) / static_cast<double>(first.wall.count());
+        printf("  3 windows, 200 tabs, 9000 content nodes: %llu nodes, %zu calls, %llu slices, "
+               "longest %.2f ms, %.1f%% of %.2f s\n",
+               static_cast<unsigned long long>(crawler.stats().nodes), tree.calls(),
+               static_cast<unsigned long long>(crawler.stats().slices),
+               std::chrono::duration<double, std::milli>(first.longestSlice).count(), share * 100,
+               std::chrono::duration<double>(first.wall).count());
+        expect(first.longestSlice <= options.slice + 2 * call_cost, "a slice overran the budget");
+        expect(share <= options.cpuShare + 1e-9, "the crawler used more than its share");
+        expect(crawler.stats().nodes == 215, "page content was crawled");
+
+        auto snapshot = crawler.snapshot();
+        failures += check_tab_titles(*snapshot, a, tab_titles("GitHub", 80));
+        failures += check_tab_titles(*snapshot, b, tab_titles("Docs", 70));
+        failures += check_tab_titles(*snapshot, c, tab_titles("Mail", 50));
+        expect(tree.live_handles() == 200, "handles leaked by the crawl");
+        expect(snapshot->find("GITHUB PAGE 1").size() == 11, "find() misses tabs");
+
+        // a title change recrawls that window only
+        const AccessibleNode staleTab = snapshot->tabs[snapshot->find("docs page 3 ")[0]].node;
+        tree.set_tabs(b, tab_titles("Docs", 75));
+        const uint64_t nodesBefore = crawler.stats().nodes;
+        crawler.set_windows({{a, "a"}, {b, "b changed"}, {c, "c"}});
+        crawl_to_idle(crawler);
+        expect(crawler.stats().nodes - nodesBefore == 80, "a title change recrawled more than its window");
+        snapshot = crawler.snapshot();
+        failures += check_tab_titles(*snapshot, b, tab_titles("Docs", 75));
+        expect(tree.live_handles() == 205, "replaced tabs weren't released");
+
+        // selecting goes through the current snapshot only
+        const BrowserTab& tab = snapshot->tabs[snapshot->find("docs page 72 ")[0]];
+        expect(crawler.select(b, tab.node) && tree.selected_tab(b) == tab.title, "tab not selected");
+        expect(!crawler.select(b, staleTab), "stale tab selected");
+
+        // everything again once the recrawl interval passed
+        const uint64_t crawledBefore = crawler.stats().windowsCrawled;
+        crawlNow += 31s;
+        crawl_to_idle(crawler);
+        expect(crawler.stats().windowsCrawled - crawledBefore == 3, "periodic recrawl");
+
+        // closed windows drop their tabs, including one closed mid-crawl
+        tree.add_browser(e, tab_titles("Long", 300), 0);
+        crawler.set_windows({{a, "a"}, {b, "b changed"}, {e, "e"}});
+        crawler.run_slice();
+        expect(!crawler.idle(), "300 tabs crawled in one slice");
+        crawler.set_windows({{a, "a"}, {b, "b changed"}});
+        expect(crawler.idle(), "crawl of a closed window continued");
+        expect(crawler.snapshot()->tabs.size() == 155, "closed window's tabs kept");
+        expect(tree.live_handles() == 155, "handles of closed windows leaked");
+
+        // a tree over the node limit is given up on without leaking
+        tree.add_browser(d, tab_titles("Huge", 6000), 0);
+        crawler.set_windows({{a, "a"}, {b, "b changed"}, {d, "d"}});
+        crawl_to_idle(crawler);
+        expect(crawler.stats().windowsAbandoned == 1, "oversized tree not abandoned");
+        expect(crawler.snapshot()->tabs.size() == 155, "tabs of an abandoned crawl published");
+        expect(tree.live_handles() == 155, "abandoned crawl leaked handles");
+    }
+    expect(tree.live_handles() == 0, "crawler kept handles after destruction");
+
+    // switcher rows for tabs: after the windows, no shortcut, no marks
+    std::vector<WindowInfo> entries{
+        {a, "GitHub page 0 - GitHub", "Chrome_WidgetWin_1", "chrome.exe", 10, true},
+        {b, "Notes", "Notepad", "notepad.exe", 11, true},
+    };
+    entries.push_back(entries[0]);
+    entries.back().title = "GitHub page 1 - GitHub";
+    entries.back().tabNode = 42;
+    SwitcherList rows(entries, 2);
+    expect(std::string_view(rows.label(2)) == "[tab] GitHub page 1 - GitHub", "tab row label");
+    rows.toggle_mark();
+    expect(!rows.is_marked(0) && rows.take_targets().empty(), "tab row took part in a window action");
+
+    // the real thread against a tree whose every call takes 20 ms: the caller never waits
+    TabCrawlerOptions threadOptions;
+    threadOptions.cpuShare = 1.0;
+    tab_crawler_start(make_slow_tree, threadOptions);
+    std::vector<WindowInfo> windows{
+        {handle_of(101), "Slow page 0 - Slow", "Chrome_WidgetWin_1", "chrome.exe", 20, true},
+        {handle_of(102), "Editor", "Notepad", "notepad.exe", 21, true},
+    };
+
+    double slowest = 0;
+    const auto timed = [&](const auto& body)
+    {
+        slowest = std::max(slowest, seconds_for(body));
+    };
+    const auto deadline = std::chrono::steady_clock::now() + 10s;
+    size_t polls = 0;
+    while (current_tabs()->tabs.size() < 10 && std::chrono::steady_clock::now() < deadline)
+    {
+        timed([&] { track_browser_windows(windows); });
+        timed([&]
+        {
+            std::vector<WindowInfo> list = windows;
+            append_browser_tabs(list);
+        });
+        timed([&] { activate_tab(handle_of(101), 1); });
+        windows[0].title = "Slow page " + std::to_string(++polls % 10) + " - Slow";
+        std::this_thread::sleep_for(5ms);
+    }
+
+    std::vector<WindowInfo> list = windows;
+    append_browser_tabs(list);
+    tab_crawler_stop();
+
+    printf("  threaded crawl at 20 ms per call: %zu polls, slowest caller-side call %.3f ms\n", polls, slowest * 1e3);
+    expect(list.size() == 12 && list[2].tabNode != 0 && list[2].hwnd == handle_of(101), "tabs not appended");
+    expect(slowest < 0.005, "a caller waited on the accessibility tree");
+
+    if (failures != 0)
+    {
+        printf("tabs: %zu failures\n", failures);
+        return 1;
+    }
+    printf("tabs: all checks passed\n");
+    return 0;
+}
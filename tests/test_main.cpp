@@ -0,0 +1,111 @@
+#include "window_list.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+// Each prints what it measured and returns non-zero when one of its checks fails
+int test_utf();
+int test_actions();
+int test_rules();
+int test_predict();
+int test_frames();
+int test_refresh();
+int test_tabs();
+int test_sim();
+int test_lazy();
+int test_eligibility();
+int test_usage();
+int test_quick();
+int test_mru();
+int test_present();
+int test_hosted();
+int test_query();
+int test_views();
+int test_apps();
+int test_residency();
+int test_fingerprint();
+int test_probe();
+int test_ipc();
+int test_log();
+int test_trace();
+int test_state();
+
+struct Test
+{
+    const char* name;
+    const char* description;
+    int (*run)();
+};
+
+static constexpr Test tests[] = {
+    {"utf", "UTF-16 to UTF-8 throughput per path, round trips and edge cases", test_utf},
+    {"actions", "batched window actions against the fake backend, tile layout checks", test_actions},
+    {"rules", "500 compiled rules against 5k windows, checked against per-rule matching", test_rules},
+    {"predict", "next-window prediction on a simulated user, decay and eviction checks", test_predict},
+    {"frames", "switcher frames and Ctrl+N activations, fails on any heap allocation", test_frames},
+    {"refresh", "refresh coalescing on a fake clock, message storms and hotkey freshness", test_refresh},
+    {"tabs", "browser tab crawling on a mock accessibility tree, budgets and a slow tree", test_tabs},
+    {"sim", "enumeration on a simulated desktop with latencies, hung windows and pid reuse", test_sim},
+    {"lazy", "per-field fetch counts of eager and lazy metadata, cache invalidation", test_lazy},
+    {"eligibility", "alt-tab filter stages on every kind of window, rejects and fetches per stage", test_eligibility},
+    {"usage", "CPU and working set deltas between process samples, /proc parsing and cost", test_usage},
+    {"quick", "quick-tap and hold decisions on a scripted keyboard, tap to activation cost", test_quick},
+    {"mru", "MRU stack against a reference, previous-window hotkey cost at 100 to 4000 windows", test_mru},
+    {"present", "input to present latency of vsync and paced frames on a simulated 60 Hz display", test_present},
+    {"hosted", "UWP frames resolved to their app on a mock window tree, one child walk per frame", test_hosted},
+    {"query", "filter queries compiled and run over 10k windows, checked against plain predicates", test_query},
+    {"views", "switcher sort views updated in place over 10k windows, switch cost and memory", test_views},
+    {"apps", "app index over a synthetic 30k entry tree: scan, save and load, offline and live changes", test_apps},
+    {"residency", "idle release and re-warm of resident subsystems over a simulated day on a fake clock",
+     test_residency},
+    {"fingerprint", "window fingerprints: collisions, matching 10k windows after edits and closes, restarts",
+     test_fingerprint},
+    {"probe", "input to photon pairing of presses and read-back frames on a simulated switcher, readback cost",
+     test_probe},
+    {"ipc", "IPC server over a fake desktop: list, subscribe, focus, find, malformed and lazy requests", test_ipc},
+    {"log", "log ring under concurrent producers: a full ring, wraparound, drop counts and the rate limit", test_log},
+    {"trace", "trace encoding round trips, truncated traces, a session recorded on a fake desktop and replayed",
+     test_trace},
+    {"state", "state snapshot save and restore, closed windows, every truncation and version mismatches",
+     test_state},
+};
+
+static void print_test_names()
+{
+    for (const auto& test : tests)
+    {
+        printf("  %-12s %s\n", test.name, test.description);
+    }
+}
+
+// findmywindows_tests [name], all of them without a name. CTest runs one per test.
+int main(const int argc, char** argv)
+{
+    const std::string_view name = argc > 1 ? argv[1] : "";
+    int result = 0;
+    bool found = false;
+    for (const auto& test : tests)
+    {
+        if (!name.empty() && name != test.name) continue;
+
+        found = true;
+        printf("== %s\n", test.name);
+        // a saved order of its own, never the one in the working directory
+        const std::filesystem::path order =
+            std::filesystem::temp_directory_path() / ("fmw_" + std::string(test.name) + "_order.txt");
+        std::filesystem::remove(order);
+        set_saved_order_path(order.string());
+        if (test.run() != 0) result = 1;
+        std::filesystem::remove(order);
+    }
+
+    if (!found)
+    {
+        printf("unknown test %.*s, available:\n", static_cast<int>(name.size()), name.data());
+        print_test_names();
+        return 2;
+    }
+    return result;
+}
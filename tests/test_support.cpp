@@ -0,0 +1,112 @@
+#include "tests/test_support.h"
+#include "window_list.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+
+HWND handle_of(const size_t index)
+{
+    return reinterpret_cast<HWND>(static_cast<uintptr_t>(0x10010 + 4 * index));
+}
+
+std::chrono::steady_clock::time_point fakeNow;
+
+std::chrono::steady_clock::time_point fake_clock()
+{
+    return fakeNow;
+}
+
+std::chrono::microseconds simulatedNow{0};
+
+void advance_simulated(const std::chrono::microseconds by)
+{
+    simulatedNow += by;
+}
+
+void set_desktop_latencies(FakeBackend& backend)
+{
+    using std::chrono::microseconds;
+    backend.set_latency(FakeCall::EnumWindows, {microseconds(200), microseconds(800)});
+    backend.set_latency(FakeCall::IsVisible, {microseconds(1), microseconds(3)});
+    backend.set_latency(FakeCall::ExStyle, {microseconds(1), microseconds(3)});
+    backend.set_latency(FakeCall::Owner, {microseconds(1), microseconds(3)});
+    backend.set_latency(FakeCall::Title, {microseconds(3), microseconds(40)});
+    backend.set_latency(FakeCall::ClassName, {microseconds(2), microseconds(10)});
+    backend.set_latency(FakeCall::ProcessId, {microseconds(1), microseconds(3)});
+    backend.set_latency(FakeCall::ProcessName, {microseconds(60), microseconds(1500)});
+    backend.set_latency(FakeCall::IsOnCurrentDesktop, {microseconds(30), microseconds(600)});
+    backend.set_clock(advance_simulated);
+}
+
+void populate(FakeBackend& backend, const size_t windows, const size_t processes)
+{
+    for (size_t i = 0; i < windows; ++i)
+    {
+        backend.add_window({
+            .title = "document " + std::to_string(i), .className = "Fake",
+            .processName = "app" + std::to_string(i % processes) + ".exe",
+            .onCurrentDesktop = i % 3 == 0,
+        });
+    }
+}
+
+void forget_process_names()
+{
+    FakeBackend empty;
+    ListWindowsByDesktop(empty, true);
+}
+
+std::vector<WindowInfo> query_windows(const size_t count)
+{
+    static constexpr const char* processes[] = {"Code.exe", "chrome.exe", "devenv.exe", "WindowsTerminal.exe",
+                                                "explorer.exe", "OUTLOOK.EXE", "firefox.exe", "conhost.exe"};
+    static constexpr const char* classes[] = {"Chrome_WidgetWin_1", "Chrome_WidgetWin_1", "HwndWrapper",
+                                              "CASCADIA_HOSTING_WINDOW_CLASS", "CabinetWClass", "rctrl_renwnd32",
+                                              "MozillaWindowClass", "ConsoleWindowClass"};
+    static constexpr const char* extensions[] = {".cpp", ".h", ".txt", ".md", ""};
+    std::mt19937 rng(45);
+    std::vector<WindowInfo> windows;
+    windows.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const size_t kind = rng() % std::size(processes);
+        std::string title = "document" + std::to_string(i) + extensions[rng() % std::size(extensions)] +
+            " - project " + std::to_string(rng() % 50);
+        const auto processId = static_cast<DWORD>(1000 + rng() % 400);
+        WindowInfo window{.hwnd = handle_of(i), .title = std::move(title), .className = classes[kind],
+                          .processName = processes[kind], .processId = processId,
+                          .isOnCurrentDesktop = rng() % 3 == 0};
+        if (i % 40 == 0) window.package = "Vendor.App" + std::to_string(i % 7) + "_8wekyb3d8bbwe";
+        windows.push_back(std::move(window));
+    }
+    return windows;
+}
+
+bool icontains(const std::string_view text, const std::string_view needle)
+{
+    const auto lower = [](const char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); };
+    return !std::ranges::search(text, needle, {}, lower, lower).empty();
+}
+
+std::string lowered(const std::string_view text)
+{
+    std::string out(text);
+    for (char& c : out) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return out;
+}
+
+void write_text(const std::filesystem::path& path, const std::string& text)
+{
+    std::ofstream(path, std::ios::binary) << text;
+}
+
+std::string desktop_file(const std::string& name, const std::string& exec, const bool shown)
+{
+    return "# generated\n[Desktop Entry]\nType=Application\nName=" + name + "\nName[de]=" + name + " (de)\nExec=" +
+        exec + " %U\n" + (shown ? "" : "NoDisplay=true\n") + "\n[Desktop Action new]\nName=New Window\nExec=" + exec +
+        " --new\n";
+}
@@ -0,0 +1,58 @@
+#ifndef FINDMYWINDOWS_TEST_SUPPORT_H
+#define FINDMYWINDOWS_TEST_SUPPORT_H
+
+#include "fake_backend.h"
+#include "platform.h"
+#include "tabs.h"
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Helpers shared by the tests, each test lives in its own <name>_test.cpp
+
+template <typename F>
+double seconds_for(const F& body)
+{
+    const auto start = std::chrono::steady_clock::now();
+    body();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// A made-up window handle, spaced like real ones
+HWND handle_of(size_t index);
+
+// A clock that only moves when a test sets fakeNow
+extern std::chrono::steady_clock::time_point fakeNow;
+std::chrono::steady_clock::time_point fake_clock();
+
+// Time the fake backend charged for its calls since the start, set_desktop_latencies() hooks it up
+extern std::chrono::microseconds simulatedNow;
+void advance_simulated(std::chrono::microseconds by);
+
+// Roughly what the calls take on a loaded desktop: opening a process and asking
+// the virtual desktop manager are cross-process and dominate, the rest is user32
+void set_desktop_latencies(FakeBackend& backend);
+
+// Windows titled "document N", spread over processes app0.exe to app<processes - 1>.exe
+void populate(FakeBackend& backend, size_t windows, size_t processes);
+
+// The process name cache outlives a backend, an enumeration that sees no pids empties it
+void forget_process_names();
+
+// 10k windows of a busy desktop: editors, browsers, consoles and UWP apps
+std::vector<WindowInfo> query_windows(size_t count);
+
+// ASCII case-insensitive substring search
+bool icontains(std::string_view text, std::string_view needle);
+std::string lowered(std::string_view text);
+
+void write_text(const std::filesystem::path& path, const std::string& text);
+
+// A .desktop entry with a "new" action, NoDisplay when not shown
+std::string desktop_file(const std::string& name, const std::string& exec, bool shown = true);
+
+#endif //FINDMYWINDOWS_TEST_SUPPORT_H
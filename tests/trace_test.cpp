@@ -0,0 +1,142 @@
+#include "fake_backend.h"
+#include "replay.h"
+#include "tabs.h"
+#include "trace.h"
+#include "window_list.h"
+#include "tests/alloc_counter.h"
+#include "tests/test_support.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+static std::string read_bytes(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return {std::istreambuf_iterator(file), std::istreambuf_iterator<char>()};
+}
+
+static bool same_event(const TraceEvent& a, const TraceEvent& b)
+{
+    return a.timeUs == b.timeUs && a.type == b.type && a.hwnd == b.hwnd && a.processId == b.processId &&
+        a.shortcut == b.shortcut && a.processName == b.processName && a.className == b.className &&
+        a.title == b.title;
+}
+
+// What the list shows, front first, handles left out as the replay reuses the recorded ones
+static std::vector<std::string> list_rows(const std::vector<WindowInfo>& windows)
+{
+    std::vector<std::string> rows;
+    for (const auto& window : windows)
+    {
+        rows.push_back(window.processName + "|" + window.className + "|" + window.title);
+    }
+    return rows;
+}
+
+int test_trace()
+{
+    size_t failures = 0;
+    const auto expect = [&](const bool ok, const char* what)
+    {
+        if (!ok)
+        {
+            printf("  trace: %s\n", what);
+            ++failures;
+        }
+    };
+
+    const auto directory = std::filesystem::temp_directory_path();
+    const std::string synthetic = (directory / "fmw_trace_synthetic.fmwt").string();
+    const std::string rewritten = (directory / "fmw_trace_rewritten.fmwt").string();
+    const std::string recorded = (directory / "fmw_trace_recorded.fmwt").string();
+
+    // the encoding round trips: reading a trace and writing it again gives the same bytes
+    std::vector<TraceEvent> events;
+    expect(write_synthetic_trace(synthetic, 2000, 42) && read_trace(synthetic, events) && events.size() == 2000,
+           "the synthetic trace didn't read back whole");
+    expect(write_trace(rewritten, events) && read_bytes(rewritten) == read_bytes(synthetic),
+           "a trace written back from its events differs");
+
+    // a cut off trace keeps the events before the cut, something else isn't a trace
+    const std::string bytes = read_bytes(synthetic);
+    write_text(rewritten, bytes.substr(0, bytes.size() / 2));
+    std::vector<TraceEvent> truncated;
+    expect(read_trace(rewritten, truncated) && !truncated.empty() && truncated.size() < events.size() &&
+           same_event(truncated.back(), events[truncated.size() - 1]), "a truncated trace lost its prefix");
+    write_text(rewritten, "FMWT\x7f" + bytes.substr(5));
+    std::vector<TraceEvent> rejected;
+    expect(!read_trace(rewritten, rejected) && rejected.empty(), "a trace of another version was read");
+
+    // a session recorded on the fake desktop, driven the way the message loop drives it
+    forget_process_names();
+    FakeBackend backend;
+    set_window_backend(&backend);
+    availableWindows.clear();
+    expect(trace_start(recorded), "recording didn't start");
+    const HWND editor = backend.add_window({.title = "main.cpp - Code", .className = "Chrome_WidgetWin_1",
+                                            .processName = "Code.exe"});
+    backend.add_window({.title = "Inbox - Outlook", .className = "rctrl_renwnd32", .processName = "OUTLOOK.EXE"});
+    const HWND console = backend.add_window({.title = "PowerShell", .className = "ConsoleWindowClass",
+                                             .processName = "powershell.exe"});
+    load_window_list();
+    backend.set_title(editor, "log.cpp - Code");
+    const HWND build = backend.add_window({.title = "cl.exe", .className = "ConsoleWindowClass",
+                                           .processName = "cl.exe"});
+    load_window_list();
+    trace_hotkey(3);
+    handle_sht(&availableWindows, 3);
+    backend.remove_window(build);
+    load_window_list();
+    trace_focus(console);
+    BringWindowToFront(console);
+    backend.set_title(editor, "trace.cpp - Code");
+    load_window_list();
+    trace_stop();
+    const auto recordedRows = list_rows(availableWindows);
+    set_window_backend(nullptr);
+
+    std::vector<TraceEvent> session;
+    expect(read_trace(recorded, session), "the recorded trace didn't read back");
+    size_t created = 0, destroyed = 0, retitled = 0, hotkeys = 0, focuses = 0;
+    bool ordered = true;
+    for (size_t i = 0; i < session.size(); ++i)
+    {
+        const auto& event = session[i];
+        if (i > 0 && event.timeUs < session[i - 1].timeUs) ordered = false;
+        created += event.type == TraceEventType::WindowCreated;
+        destroyed += event.type == TraceEventType::WindowDestroyed;
+        retitled += event.type == TraceEventType::WindowRetitled;
+        hotkeys += event.type == TraceEventType::Hotkey && event.shortcut == 3;
+        focuses += event.type == TraceEventType::Focus && event.hwnd == reinterpret_cast<uintptr_t>(console);
+    }
+    printf("  recorded %zu events: %zu created, %zu destroyed, %zu retitled\n", session.size(), created, destroyed,
+           retitled);
+    expect(created == 4 && destroyed == 1 && retitled == 2 && hotkeys == 1 && focuses == 1 && ordered,
+           "the recorded events don't match the session");
+    expect(!session.empty() && session.front().type == TraceEventType::WindowCreated &&
+           session.front().title == "main.cpp - Code" && session.front().processName == "Code.exe" &&
+           session.front().className == "Chrome_WidgetWin_1", "the first window wasn't recorded with its fields");
+
+    // replaying it on a fresh fake desktop ends with the list the session ended with
+    forget_process_names();
+    set_replay_allocation_counter(thread_alloc_count);
+    expect(run_replay(recorded, 0) == 0, "the replay failed");
+    set_replay_allocation_counter(nullptr);
+    set_window_backend(nullptr);
+    expect(list_rows(availableWindows) == recordedRows, "the replayed list differs from the recorded one");
+    availableWindows.clear();
+    forget_process_names();
+
+    for (const auto& path : {synthetic, rewritten, recorded}) std::filesystem::remove(path);
+    if (failures)
+    {
+        printf("trace: %zu failures\n", failures);
+        return 1;
+    }
+    printf("trace: all checks passed\n");
+    return 0;
+}
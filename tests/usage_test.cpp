@@ -0,0 +1,190 @@
+#include "usage.h"
+#include "tests/test_support.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+static size_t check_usage(const UsageSnapshot& snapshot, const DWORD processId, const float cpuPercent,
+                          const uint64_t workingSetBytes)
+{
+    const ProcessUsage* usage = snapshot.find(processId);
+    if (!usage)
+    {
+        printf("  pid %lu missing from the snapshot\n", static_cast<unsigned long>(processId));
+        return 1;
+    }
+    if (std::fabs(usage->cpuPercent - cpuPercent) > 0.01f || usage->workingSetBytes != workingSetBytes)
+    {
+        printf("  pid %lu at %.2f%% %llu bytes, expected %.2f%% %llu bytes\n", static_cast<unsigned long>(processId),
+               usage->cpuPercent, static_cast<unsigned long long>(usage->workingSetBytes), cpuPercent,
+               static_cast<unsigned long long>(workingSetBytes));
+        return 1;
+    }
+    return 0;
+}
+
+// Deltas between two samples on a 4 core machine, one second apart
+static size_t check_usage_deltas()
+{
+    size_t failures = 0;
+    constexpr uint64_t second = 1000000000;
+    UsageTracker tracker(4);
+    const auto start = std::chrono::steady_clock::now();
+
+    // unsorted on purpose, the tracker sorts
+    std::vector<ProcessSample> samples = {
+        {5, 9 * second, 500}, {1, 1 * second, 100}, {4, 1 * second, 400}, {2, 3 * second, 200},
+    };
+    const UsageSnapshot first = tracker.update(samples, start);
+    // no deltas before a second sample
+    for (const DWORD pid : {1, 2, 4, 5})
+    {
+        failures += check_usage(first, pid, -1.0f, pid * 100);
+    }
+
+    samples = {
+        {3, 1 * second, 300}, {1, 3 * second, 150}, {2, 3 * second, 200}, {5, 1 * second, 50},
+    };
+    const UsageSnapshot later = tracker.update(samples, start + std::chrono::seconds(1));
+    // two busy seconds out of four cores, an idle process, a new one and a reused pid
+    failures += check_usage(later, 1, 50.0f, 150);
+    failures += check_usage(later, 2, 0.0f, 200);
+    failures += check_usage(later, 3, -1.0f, 300);
+    failures += check_usage(later, 5, -1.0f, 50);
+    if (later.find(4) || later.version != first.version + 1 || later.processes.size() != 4)
+    {
+        printf("  the second snapshot has %zu processes at version %llu\n", later.processes.size(),
+               static_cast<unsigned long long>(later.version));
+        ++failures;
+    }
+    return failures;
+}
+
+#ifdef __linux__
+static std::filesystem::path fakeProcRoot;
+
+static void write_stat(const DWORD processId, const char* command, const uint64_t utime, const uint64_t stime,
+                       const uint64_t rssPages)
+{
+    const auto directory = fakeProcRoot / std::to_string(processId);
+    std::filesystem::create_directories(directory);
+    std::ofstream stat(directory / "stat");
+    // the layout of proc(5), fields after the command up to rss
+    stat << processId << " (" << command << ") S 1 " << processId << ' ' << processId << " 0 -1 4194560 100 0 0 0 "
+        << utime << ' ' << stime << " 0 0 20 0 1 0 12345 1048576 " << rssPages << " 18446744073709551615\n";
+}
+
+static std::unique_ptr<ProcessSampler> make_fake_proc_sampler()
+{
+    return make_proc_sampler(fakeProcRoot.string());
+}
+
+static std::unique_ptr<ProcessSampler> make_real_proc_sampler()
+{
+    return make_proc_sampler();
+}
+
+static size_t check_proc_sampler()
+{
+    size_t failures = 0;
+    const uint64_t tick = 1000000000ull / static_cast<uint64_t>(sysconf(_SC_CLK_TCK));
+    const uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+
+    fakeProcRoot = std::filesystem::temp_directory_path() / "fmw_usage_bench";
+    std::filesystem::remove_all(fakeProcRoot);
+    write_stat(100, "app", 300, 100, 10);
+    // spaces and parentheses in the command don't shift the fields
+    write_stat(200, "web (content) 3", 5, 5, 2000);
+    // a process that exited between listing and reading, and entries that aren't processes
+    std::filesystem::create_directories(fakeProcRoot / "300");
+    std::filesystem::create_directories(fakeProcRoot / "self");
+    std::ofstream(fakeProcRoot / "uptime") << "1.0 1.0\n";
+
+    std::vector<ProcessSample> samples;
+    const auto sampler = make_fake_proc_sampler();
+    if (!sampler->sample(samples) || samples.size() != 2)
+    {
+        printf("  sampled %zu processes from the fake tree, expected 2\n", samples.size());
+        return 1;
+    }
+    std::ranges::sort(samples, {}, &ProcessSample::processId);
+    if (samples[0].processId != 100 || samples[0].cpuNanoseconds != 400 * tick ||
+        samples[0].workingSetBytes != 10 * page || samples[1].processId != 200 ||
+        samples[1].cpuNanoseconds != 10 * tick || samples[1].workingSetBytes != 2000 * page)
+    {
+        printf("  misread stat: pid %lu %llu ns %llu bytes\n", static_cast<unsigned long>(samples[0].processId),
+               static_cast<unsigned long long>(samples[0].cpuNanoseconds),
+               static_cast<unsigned long long>(samples[0].workingSetBytes));
+        ++failures;
+    }
+
+    // the whole system in one pass, our own process among it
+    const auto real = make_proc_sampler();
+    constexpr int passes = 50;
+    bool sampled = true;
+    const double seconds = seconds_for([&]
+    {
+        for (int i = 0; i < passes; ++i)
+        {
+            sampled &= real->sample(samples);
+        }
+    });
+    const bool foundSelf = std::ranges::find(samples, static_cast<DWORD>(getpid()), &ProcessSample::processId) !=
+        samples.end();
+    printf("  /proc: %zu processes in %.3f ms per sample\n", samples.size(), seconds * 1000.0 / passes);
+    if (!sampled || !foundSelf)
+    {
+        printf("  sampling /proc failed or missed pid %d\n", getpid());
+        ++failures;
+    }
+
+    // the timer publishes snapshots while running and drops them once stopped
+    set_usage_sampler(make_fake_proc_sampler);
+    const bool started = usage_sampling_start(std::chrono::milliseconds(5));
+    const bool startedTwice = usage_sampling_start(std::chrono::milliseconds(5));
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (current_usage()->version < 3 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const auto latest = current_usage();
+    usage_sampling_stop();
+    set_usage_sampler(make_real_proc_sampler);
+    if (!started || startedTwice || latest->version < 3 || !latest->find(100) ||
+        latest->find(100)->cpuPercent != 0.0f || current_usage()->version != 0)
+    {
+        printf("  sampling thread reached version %llu\n", static_cast<unsigned long long>(latest->version));
+        ++failures;
+    }
+
+    std::filesystem::remove_all(fakeProcRoot);
+    return failures;
+}
+#endif
+
+int test_usage()
+{
+    size_t failures = check_usage_deltas();
+#ifdef __linux__
+    failures += check_proc_sampler();
+#endif
+
+    if (failures != 0)
+    {
+        printf("usage: %zu failures\n", failures);
+        return 1;
+    }
+    printf("usage: all checks passed\n");
+    return 0;
+}
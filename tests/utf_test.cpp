@@ -0,0 +1,218 @@
+#include "utf.h"
+#include "tests/test_support.h"
+
+#include <cstdio>
+#include <random>
+#include <string_view>
+#include <vector>
+
+static void append_code_point(std::u16string& out, uint32_t cp)
+{
+    if (cp >= 0x10000)
+    {
+        cp -= 0x10000;
+        out.push_back(static_cast<char16_t>(0xD800 + (cp >> 10)));
+        out.push_back(static_cast<char16_t>(0xDC00 + (cp & 0x3FF)));
+        return;
+    }
+    out.push_back(static_cast<char16_t>(cp));
+}
+
+// Titles the way they show up in practice: mostly ASCII, some with a few
+// accented letters or an emoji, and whole CJK titles
+static std::vector<std::u16string> make_titles(const char* kind, const size_t count, std::mt19937& rng)
+{
+    static constexpr std::string_view ascii_words[] = {
+        "main.cpp", "findmywindows", "Visual Studio Code", "Mozilla Firefox", "Pull Request #412",
+        "Inbox", "Terminal", "Build succeeded", "README.md", "Google Chrome", "Slack", "-", "|",
+    };
+    static constexpr uint32_t accented[] = {0xE9, 0xE8, 0xFC, 0xF6, 0xE7, 0xF1, 0x142, 0x17C, 0x3B1, 0x430};
+    static constexpr uint32_t emoji[] = {0x1F600, 0x1F4C1, 0x1F525, 0x2705, 0x1F680};
+
+    std::uniform_int_distribution<size_t> word(0, std::size(ascii_words) - 1);
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::uniform_int_distribution<uint32_t> cjk(0x4E00, 0x9FFF);
+    std::uniform_int_distribution<size_t> words(3, 12);
+
+    const std::string_view mode = kind;
+    std::vector<std::u16string> titles(count);
+    for (auto& title : titles)
+    {
+        const size_t length = words(rng);
+        for (size_t i = 0; i < length; ++i)
+        {
+            if (mode == "cjk")
+            {
+                for (int j = 0; j < 4; ++j) append_code_point(title, cjk(rng));
+                if (percent(rng) < 30) title.push_back(u' ');
+                continue;
+            }
+
+            if (!title.empty()) title.push_back(u' ');
+            for (const char c : ascii_words[word(rng)]) title.push_back(static_cast<char16_t>(c));
+            if (mode == "mixed" && percent(rng) < 20)
+            {
+                append_code_point(title, accented[percent(rng) % std::size(accented)]);
+            }
+            if (mode == "mixed" && percent(rng) < 5)
+            {
+                append_code_point(title, emoji[percent(rng) % std::size(emoji)]);
+            }
+        }
+    }
+    return titles;
+}
+
+static const char* path_name(const Utf16Path path)
+{
+    switch (path)
+    {
+    case Utf16Path::Scalar: return "scalar";
+    case Utf16Path::Sse2: return "sse2";
+    case Utf16Path::Avx2: return "avx2";
+    }
+    return "?";
+}
+
+static constexpr Utf16Path utf_paths[] = {Utf16Path::Scalar, Utf16Path::Sse2, Utf16Path::Avx2};
+
+// Every supported path must agree with the scalar one, and valid input must
+// survive the trip back through utf8_to_utf16()
+static size_t check_utf(const std::u16string& text, const bool valid)
+{
+    std::string expected;
+    utf16_to_utf8(text, expected, Utf16Path::Scalar);
+
+    size_t failures = 0;
+    for (const auto path : utf_paths)
+    {
+        if (!utf16_path_supported(path)) continue;
+
+        std::string actual = "prefix";
+        utf16_to_utf8(text, actual, path);
+        if (actual != "prefix" + expected)
+        {
+            printf("  mismatch on the %s path for a %zu unit string\n", path_name(path), text.size());
+            ++failures;
+        }
+    }
+    if (valid && utf8_to_utf16(expected) != text)
+    {
+        printf("  round trip failed for a %zu unit string\n", text.size());
+        ++failures;
+    }
+    return failures;
+}
+
+static size_t check_utf_edges()
+{
+    size_t failures = 0;
+
+    // a single non-ASCII unit at every position of every length covers the
+    // vector prefix handling and the scalar tails of both SIMD loops
+    for (size_t length = 0; length <= 80; ++length)
+    {
+        const std::u16string base(length, u'a');
+        failures += check_utf(base, true);
+        for (size_t at = 0; at < length; ++at)
+        {
+            for (const char16_t c : {u'\u00E9', u'\u4E2D', u'\uFFFF'})
+            {
+                std::u16string text = base;
+                text[at] = c;
+                failures += check_utf(text, true);
+            }
+
+            // surrogate pair straddling the position, including block boundaries
+            if (at + 1 < length)
+            {
+                std::u16string text = base;
+                text[at] = 0xD83D;
+                text[at + 1] = 0xDE00;
+                failures += check_utf(text, true);
+            }
+
+            std::u16string lone = base;
+            lone[at] = at % 2 ? 0xDC00 : 0xD800;
+            failures += check_utf(lone, false);
+        }
+    }
+
+    // unpaired surrogates, including a high one at the very end
+    std::string out;
+    utf16_to_utf8(u"a\xD800" "b\xDC00\xD83D", out);
+    if (out != "a\xEF\xBF\xBD" "b\xEF\xBF\xBD\xEF\xBF\xBD")
+    {
+        printf("  unpaired surrogates were not replaced with U+FFFD\n");
+        ++failures;
+    }
+    if (utf8_to_utf16("\xC0\x80x\xED\xA0\x80\xF4\x90\x80\x80\xE4\xB8") != u"\uFFFDx\uFFFD\uFFFD\uFFFD")
+    {
+        printf("  overlong, surrogate, out of range or truncated UTF-8 was accepted\n");
+        ++failures;
+    }
+    return failures;
+}
+
+int test_utf()
+{
+    printf("transcoder    %s\n", utf16_transcoder_name());
+
+    size_t failures = check_utf_edges();
+
+    std::mt19937 rng(7);
+    for (const char* kind : {"ascii", "mixed", "cjk"})
+    {
+        const auto titles = make_titles(kind, 20000, rng);
+        size_t units = 0;
+        for (const auto& title : titles)
+        {
+            units += title.size();
+            failures += check_utf(title, true);
+        }
+
+        std::vector<std::u16string_view> views(titles.begin(), titles.end());
+        std::vector<std::string> outs(titles.size());
+        constexpr int rounds = 20;
+
+        printf("%-6s %7zu titles, %.1f MB UTF-16\n", kind, titles.size(), units * 2 / 1e6);
+        double scalarSeconds = 0;
+        for (const auto path : utf_paths)
+        {
+            if (!utf16_path_supported(path)) continue;
+
+            const double seconds = seconds_for([&]
+            {
+                for (int round = 0; round < rounds; ++round)
+                {
+                    for (size_t i = 0; i < views.size(); ++i)
+                    {
+                        outs[i].clear();
+                        utf16_to_utf8(views[i], outs[i], path);
+                    }
+                }
+            });
+            if (path == Utf16Path::Scalar) scalarSeconds = seconds;
+            printf("  %-8s %8.0f MB/s  %5.2fx\n", path_name(path), units * 2.0 * rounds / seconds / 1e6,
+                   scalarSeconds / seconds);
+        }
+
+        const double batchSeconds = seconds_for([&]
+        {
+            for (int round = 0; round < rounds; ++round)
+            {
+                utf16_to_utf8_batch(views.data(), outs.data(), views.size());
+            }
+        });
+        printf("  %-8s %8.0f MB/s  %5.2fx\n", "batch", units * 2.0 * rounds / batchSeconds / 1e6,
+               scalarSeconds / batchSeconds);
+    }
+
+    if (failures)
+    {
+        printf("utf: %zu failures\n", failures);
+        return 1;
+    }
+    printf("utf: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,261 @@
+#include "switcher.h"
+#include "tabs.h"
+#include "views.h"
+#include "tests/alloc_counter.h"
+#include "tests/test_support.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <span>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+// Every view against its definition: saved holds the bench's own list, the others
+// are sorted by their key and then by the saved place
+static size_t check_views(const WindowViews& views, const std::vector<HWND>& saved, const std::vector<HWND>& touched,
+                          const char* when)
+{
+    std::unordered_map<HWND, size_t> savedAt;
+    for (size_t i = 0; i < saved.size(); ++i) savedAt[saved[i]] = i;
+    std::unordered_map<HWND, size_t> touchedAt;
+    for (size_t i = 0; i < touched.size(); ++i) touchedAt.try_emplace(touched[i], i);
+
+    size_t failures = 0;
+    for (size_t index = 0; index < sort_view_count; ++index)
+    {
+        const SortView view = static_cast<SortView>(index);
+        const std::span<const uint32_t> order = views.order(view);
+        std::vector<std::tuple<std::string, size_t>> keys;
+        keys.reserve(order.size());
+        bool known = order.size() == saved.size();
+        for (const uint32_t slot : order)
+        {
+            const WindowInfo& window = views.window(slot);
+            const auto at = savedAt.find(window.hwnd);
+            if (at == savedAt.end())
+            {
+                known = false;
+                break;
+            }
+            std::string key;
+            if (view == SortView::Process) key = lowered(window.processName);
+            if (view == SortView::Title) key = lowered(window.title);
+            if (view == SortView::Desktop) key = window.isOnCurrentDesktop ? "0" : "1";
+            if (view == SortView::Recency)
+            {
+                const auto recent = touchedAt.find(window.hwnd);
+                key = recent != touchedAt.end() ? "0" + std::to_string(1000000 + recent->second) : "1";
+            }
+            keys.emplace_back(std::move(key), at->second);
+        }
+        if (!known)
+        {
+            printf("  views: %s, the %s view holds %zu windows, expected the %zu listed\n", when,
+                   sort_view_name(view), order.size(), saved.size());
+            ++failures;
+            continue;
+        }
+        // strictly increasing, so every window is in once
+        if (std::ranges::adjacent_find(keys, std::greater_equal<>()) != keys.end())
+        {
+            printf("  views: %s, the %s view is out of order\n", when, sort_view_name(view));
+            ++failures;
+        }
+    }
+    return failures;
+}
+
+int test_views()
+{
+    size_t failures = 0;
+    std::mt19937 rng(46);
+    constexpr size_t count = 10000;
+    const std::vector<WindowInfo> windows = query_windows(count);
+
+    std::vector<HWND> recent;
+    for (size_t i = 0; i < 2000; ++i) recent.push_back(handle_of(rng() % count));
+    // MruStack::order() never repeats a window
+    std::vector<HWND> touched;
+    for (const HWND hwnd : recent)
+    {
+        if (std::ranges::find(touched, hwnd) == touched.end()) touched.push_back(hwnd);
+    }
+    std::vector<HWND> saved;
+    for (const WindowInfo& window : windows) saved.push_back(window.hwnd);
+
+    // the one full sort, what every change would cost without the views
+    WindowViews views;
+    const double buildSeconds = seconds_for([&] { views.assign(windows, touched); });
+    printf("  building %zu windows into %zu views: %.0f us\n", count, sort_view_count, buildSeconds * 1e6);
+    failures += check_views(views, saved, touched, "after building");
+
+    const auto timed = [&](const char* what, const size_t operations, const auto& body)
+    {
+        const double seconds = seconds_for(body);
+        const double perOperation = seconds * 1e6 / static_cast<double>(operations);
+        printf("  %zu %s: %.2f us each, %.0fx under a full sort\n", operations, what, perOperation,
+               buildSeconds * 1e6 / perOperation);
+        // generous so a loaded machine doesn't fail it, a re-sort is thousands of times slower
+        if (perOperation * 20 > buildSeconds * 1e6)
+        {
+            printf("  views: %s cost %.2f us each, a full sort takes %.0f us\n", what, perOperation,
+                   buildSeconds * 1e6);
+            ++failures;
+        }
+    };
+
+    constexpr size_t changes = 1000;
+    std::vector<WindowInfo> added = query_windows(changes);
+    for (size_t i = 0; i < changes; ++i)
+    {
+        added[i].hwnd = handle_of(count + i);
+        added[i].title = "new " + added[i].title;
+    }
+    timed("inserts", changes, [&]
+    {
+        for (WindowInfo& window : added) views.insert(std::move(window));
+    });
+    for (size_t i = 0; i < changes; ++i) saved.push_back(handle_of(count + i));
+
+    std::vector<HWND> removed;
+    while (removed.size() < changes)
+    {
+        const HWND hwnd = saved[rng() % saved.size()];
+        if (std::ranges::find(removed, hwnd) == removed.end()) removed.push_back(hwnd);
+    }
+    timed("removes", changes, [&]
+    {
+        for (const HWND hwnd : removed) views.remove(views.find(hwnd));
+    });
+    std::erase_if(saved, [&](const HWND hwnd) { return std::ranges::find(removed, hwnd) != removed.end(); });
+    std::erase_if(touched, [&](const HWND hwnd) { return std::ranges::find(removed, hwnd) != removed.end(); });
+
+    std::vector<std::pair<uint32_t, std::string>> retitles;
+    for (size_t i = 0; i < changes; ++i)
+    {
+        retitles.emplace_back(views.find(saved[rng() % saved.size()]), "Retitled " + std::to_string(rng() % 5000));
+    }
+    timed("retitles", changes, [&]
+    {
+        for (auto& [slot, title] : retitles) views.retitle(slot, std::move(title));
+    });
+
+    std::vector<uint32_t> focused;
+    for (size_t i = 0; i < changes; ++i) focused.push_back(views.find(saved[rng() % saved.size()]));
+    timed("focus changes", changes, [&]
+    {
+        for (const uint32_t slot : focused) views.touch(slot);
+    });
+    for (const uint32_t slot : focused)
+    {
+        std::erase(touched, views.window(slot).hwnd);
+        touched.insert(touched.begin(), views.window(slot).hwnd);
+    }
+
+    timed("desktop moves", changes, [&]
+    {
+        for (size_t i = 0; i < changes; ++i)
+        {
+            const uint32_t slot = views.find(saved[i * 7 % saved.size()]);
+            views.set_desktop(slot, !views.window(slot).isOnCurrentDesktop);
+        }
+    });
+    failures += check_views(views, saved, touched, "after the changes");
+
+    // a slot freed by a remove is reused
+    const size_t slotsBefore = views.size();
+    WindowInfo reused{handle_of(count * 2), "Reused", "Reused", "reused.exe", 7, true};
+    const uint32_t reusedSlot = views.insert(reused);
+    saved.push_back(reused.hwnd);
+    if (reusedSlot >= count + changes || views.size() != slotsBefore + 1)
+    {
+        printf("  views: a new window got slot %u instead of a freed one\n", reusedSlot);
+        ++failures;
+    }
+    failures += check_views(views, saved, touched, "after reusing a slot");
+
+    // a view is 4 bytes a window, the windows themselves several hundred with their strings
+    const double share = static_cast<double>(views.view_bytes()) / static_cast<double>(views.window_bytes());
+    printf("  one view: %zu bytes, the windows: %zu bytes (%.1f%%)\n", views.view_bytes(), views.window_bytes(),
+           share * 100);
+    if (share > 0.05)
+    {
+        printf("  views: a view takes %.1f%% of the window data\n", share * 100);
+        ++failures;
+    }
+
+    // switching the switcher's view: walking another permutation through the filter
+    SwitcherList rows(windows, 0, touched);
+    // compiled once first so the query's buffers are there
+    const char* filter = "proc:code desktop:current";
+    rows.set_query(filter);
+    rows.set_query("");
+    rows.set_view(SortView::Title);
+    constexpr size_t switches = 500;
+    size_t shownRows = 0;
+    const auto cycle = [&]
+    {
+        for (size_t i = 0; i < switches; ++i)
+        {
+            rows.set_view(static_cast<SortView>(i % sort_view_count));
+            shownRows += rows.size();
+        }
+    };
+    const uint64_t switchAllocationsBefore = thread_alloc_count();
+    const double switchSeconds = seconds_for(cycle);
+    rows.set_query(filter);
+    const double filteredSeconds = seconds_for(cycle);
+    const uint64_t switchAllocations = thread_alloc_count() - switchAllocationsBefore;
+    printf("  switching views over %zu rows: %.1f us, %.1f us filtered, %llu allocations (%zu rows shown)\n", count,
+           switchSeconds * 1e6 / switches, filteredSeconds * 1e6 / switches,
+           static_cast<unsigned long long>(switchAllocations), shownRows);
+    if (switchAllocations != 0)
+    {
+        printf("  views: switching views allocated %llu times\n", static_cast<unsigned long long>(switchAllocations));
+        ++failures;
+    }
+
+    // the selection follows the window and reordering only happens in the saved order
+    rows.set_view(SortView::Saved);
+    rows.select(3);
+    const HWND picked = rows.window(3).hwnd;
+    rows.set_view(SortView::Title);
+    if (rows.window(rows.selected()).hwnd != picked)
+    {
+        printf("  views: switching views lost the selected window\n");
+        ++failures;
+    }
+    const int before = rows.selected();
+    rows.move_selected(1);
+    if (rows.selected() != before || rows.window(rows.selected()).hwnd != picked)
+    {
+        printf("  views: Alt+down reordered the title view\n");
+        ++failures;
+    }
+    rows.set_query("");
+    rows.set_view(SortView::Title);
+    for (size_t row = 1; row < rows.size(); ++row)
+    {
+        if (lowered(rows.window(row - 1).title) > lowered(rows.window(row).title))
+        {
+            printf("  views: the title rows are out of order at %zu\n", row);
+            ++failures;
+            break;
+        }
+    }
+    if (rows.release().size() != windows.size())
+    {
+        printf("  views: the switcher lost windows\n");
+        ++failures;
+    }
+
+    if (failures != 0)
+    {
+        printf("views: %zu failures\n", failures);
+        return 1;
+    }
+    printf("views: all checks passed\n");
+    return 0;
+}
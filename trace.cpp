@@ -0,0 +1,293 @@
+#include "trace.h"
+#include "log.h"
+
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <ranges>
+#include <unordered_map>
+
+static constexpr char trace_magic[4] = {'F', 'M', 'W', 'T'};
+static constexpr uint8_t trace_version = 1;
+
+static void put_varint(std::string& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+static void put_string(std::string& out, const std::string& value)
+{
+    put_varint(out, value.size());
+    out += value;
+}
+
+static void encode_event(std::string& out, const TraceEvent& event, const uint64_t previousUs)
+{
+    out.push_back(static_cast<char>(event.type));
+    put_varint(out, event.timeUs - previousUs);
+    put_varint(out, event.hwnd);
+
+    switch (event.type)
+    {
+    case TraceEventType::WindowCreated:
+        put_varint(out, event.processId);
+        put_string(out, event.processName);
+        put_string(out, event.className);
+        put_string(out, event.title);
+        break;
+    case TraceEventType::WindowRetitled:
+        put_string(out, event.title);
+        break;
+    case TraceEventType::Hotkey:
+        put_varint(out, event.shortcut);
+        break;
+    case TraceEventType::WindowDestroyed:
+    case TraceEventType::Focus:
+        break;
+    }
+}
+
+struct TraceReader
+{
+    const std::string& data;
+    size_t pos = 0;
+    bool ok = true;
+
+    uint64_t varint()
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            if (pos >= data.size())
+            {
+                ok = false;
+                return 0;
+            }
+            const auto byte = static_cast<uint8_t>(data[pos++]);
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        ok = false;
+        return 0;
+    }
+
+    std::string string()
+    {
+        const uint64_t length = varint();
+        if (!ok || length > data.size() - pos)
+        {
+            ok = false;
+            return {};
+        }
+        std::string value = data.substr(pos, length);
+        pos += length;
+        return value;
+    }
+};
+
+bool write_trace(const std::string& path, const std::vector<TraceEvent>& events)
+{
+    std::string out(trace_magic, sizeof(trace_magic));
+    out.push_back(static_cast<char>(trace_version));
+
+    uint64_t previousUs = 0;
+    for (const auto& event : events)
+    {
+        encode_event(out, event, previousUs);
+        previousUs = event.timeUs;
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(out.data(), static_cast<std::streamsize>(out.size()));
+    if (!file)
+    {
+        LOG_ERROR("Unable to write trace: {}", path);
+        return false;
+    }
+    return true;
+}
+
+bool read_trace(const std::string& path, std::vector<TraceEvent>& events)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        LOG_ERROR("Unable to open trace: {}", path);
+        return false;
+    }
+    const std::string data{std::istreambuf_iterator(file), std::istreambuf_iterator<char>()};
+
+    if (data.size() < sizeof(trace_magic) + 1 ||
+        data.compare(0, sizeof(trace_magic), trace_magic, sizeof(trace_magic)) != 0 ||
+        static_cast<uint8_t>(data[sizeof(trace_magic)]) != trace_version)
+    {
+        LOG_ERROR("Not a findmywindows trace: {}", path);
+        return false;
+    }
+
+    TraceReader reader{data, sizeof(trace_magic) + 1};
+    uint64_t timeUs = 0;
+    while (reader.ok && reader.pos < data.size())
+    {
+        TraceEvent event;
+        event.type = static_cast<TraceEventType>(data[reader.pos++]);
+        timeUs += reader.varint();
+        event.timeUs = timeUs;
+        event.hwnd = reader.varint();
+
+        switch (event.type)
+        {
+        case TraceEventType::WindowCreated:
+            event.processId = static_cast<DWORD>(reader.varint());
+            event.processName = reader.string();
+            event.className = reader.string();
+            event.title = reader.string();
+            break;
+        case TraceEventType::WindowRetitled:
+            event.title = reader.string();
+            break;
+        case TraceEventType::Hotkey:
+            event.shortcut = static_cast<int>(reader.varint());
+            break;
+        case TraceEventType::WindowDestroyed:
+        case TraceEventType::Focus:
+            break;
+        default:
+            reader.ok = false;
+        }
+
+        if (reader.ok) events.push_back(std::move(event));
+    }
+
+    if (!reader.ok)
+    {
+        LOG_WARN("Trace {} is truncated or corrupt, kept {} events", path, events.size());
+    }
+    return true;
+}
+
+static std::ofstream recording;
+static std::string pending;
+static std::chrono::steady_clock::time_point recordingStart;
+static uint64_t lastUs = 0;
+
+static uint64_t elapsed_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - recordingStart).count();
+}
+
+static void record(TraceEvent& event)
+{
+    event.timeUs = elapsed_us();
+    encode_event(pending, event, lastUs);
+    lastUs = event.timeUs;
+
+    if (pending.size() > 64 * 1024)
+    {
+        recording.write(pending.data(), static_cast<std::streamsize>(pending.size()));
+        pending.clear();
+    }
+}
+
+bool trace_start(const std::string& path)
+{
+    recording.open(path, std::ios::binary | std::ios::trunc);
+    if (!recording.is_open())
+    {
+        LOG_ERROR("Unable to record trace to {}", path);
+        return false;
+    }
+
+    pending.assign(trace_magic, sizeof(trace_magic));
+    pending.push_back(static_cast<char>(trace_version));
+    recordingStart = std::chrono::steady_clock::now();
+    lastUs = 0;
+
+    LOG_INFO("Recording trace to {}", path);
+    return true;
+}
+
+void trace_stop()
+{
+    if (!recording.is_open()) return;
+
+    recording.write(pending.data(), static_cast<std::streamsize>(pending.size()));
+    pending.clear();
+    recording.close();
+}
+
+bool trace_recording()
+{
+    return recording.is_open();
+}
+
+void trace_window_list(const std::vector<WindowInfo>& previous, const std::vector<WindowInfo>& current)
+{
+    std::unordered_map<HWND, const WindowInfo*> before;
+    before.reserve(previous.size());
+    for (const auto& window : previous)
+    {
+        before.emplace(window.hwnd, &window);
+    }
+
+    // back to front, so a replay that raises each new window rebuilds the same z-order
+    for (const auto& window : std::ranges::reverse_view(current))
+    {
+        TraceEvent event;
+        event.hwnd = reinterpret_cast<uintptr_t>(window.hwnd);
+
+        const auto it = before.find(window.hwnd);
+        if (it == before.end())
+        {
+            event.type = TraceEventType::WindowCreated;
+            event.processId = window.processId;
+            event.processName = window.processName;
+            event.className = window.className;
+            event.title = window.title;
+            record(event);
+            continue;
+        }
+
+        if (it->second->title != window.title)
+        {
+            event.type = TraceEventType::WindowRetitled;
+            event.title = window.title;
+            record(event);
+        }
+        before.erase(it);
+    }
+
+    for (const auto& [hwnd, window] : before)
+    {
+        TraceEvent event;
+        event.type = TraceEventType::WindowDestroyed;
+        event.hwnd = reinterpret_cast<uintptr_t>(hwnd);
+        record(event);
+    }
+}
+
+void trace_hotkey(const int shortcut)
+{
+    if (!trace_recording()) return;
+
+    TraceEvent event;
+    event.type = TraceEventType::Hotkey;
+    event.shortcut = shortcut;
+    record(event);
+}
+
+void trace_focus(const HWND hwnd)
+{
+    if (!trace_recording()) return;
+
+    TraceEvent event;
+    event.type = TraceEventType::Focus;
+    event.hwnd = reinterpret_cast<uintptr_t>(hwnd);
+    record(event);
+}
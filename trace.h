@@ -0,0 +1,52 @@
+#ifndef FINDMYWINDOWS_TRACE_H
+#define FINDMYWINDOWS_TRACE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "tabs.h"
+
+// Compact binary trace of a session: "FMWT", a version byte, then one record per event.
+// A record is the type byte, the LEB128 time delta in microseconds and the LEB128
+// window handle, followed by the fields that type carries (strings are length prefixed).
+enum class TraceEventType : uint8_t
+{
+    WindowCreated = 1, // processId, processName, className, title
+    WindowDestroyed = 2,
+    WindowRetitled = 3, // title
+    Hotkey = 4, // shortcut id, 1-7 for Ctrl+N, 70 for the previous window
+    Focus = 5, // activation requested over IPC
+};
+
+struct TraceEvent
+{
+    uint64_t timeUs = 0; // since the start of the recording
+    TraceEventType type = TraceEventType::WindowCreated;
+    uint64_t hwnd = 0;
+    DWORD processId = 0;
+    int shortcut = 0;
+    std::string processName;
+    std::string className;
+    std::string title;
+};
+
+bool write_trace(const std::string& path, const std::vector<TraceEvent>& events);
+
+bool read_trace(const std::string& path, std::vector<TraceEvent>& events);
+
+// Session recorder, fed from load_window_list() and the message loop.
+// Window events come from diffing consecutive lists, so they have refresh granularity.
+bool trace_start(const std::string& path);
+
+void trace_stop();
+
+bool trace_recording();
+
+void trace_window_list(const std::vector<WindowInfo>& previous, const std::vector<WindowInfo>& current);
+
+void trace_hotkey(int shortcut);
+
+void trace_focus(HWND hwnd);
+
+#endif //FINDMYWINDOWS_TRACE_H
@@ -0,0 +1,249 @@
+#include "usage.h"
+#include "log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+class ProcSampler final : public ProcessSampler
+{
+public:
+    explicit ProcSampler(std::string root) :
+        root(std::move(root)),
+        tickNanoseconds(1000000000ull / static_cast<uint64_t>(sysconf(_SC_CLK_TCK))),
+        pageBytes(static_cast<uint64_t>(sysconf(_SC_PAGESIZE)))
+    {
+    }
+
+    bool sample(std::vector<ProcessSample>& out) override
+    {
+        DIR* dir = opendir(root.c_str());
+        if (!dir) return false;
+
+        out.clear();
+        std::string path = root;
+        while (const dirent* entry = readdir(dir))
+        {
+            char* end = nullptr;
+            const unsigned long pid = std::strtoul(entry->d_name, &end, 10);
+            if (end == entry->d_name || *end != '\0') continue;
+
+            path.resize(root.size());
+            path += '/';
+            path += entry->d_name;
+            path += "/stat";
+
+            ProcessSample sample;
+            sample.processId = static_cast<DWORD>(pid);
+            // the process may have exited since readdir, that's not a failed sample
+            if (read_stat(path, sample)) out.push_back(sample);
+        }
+        closedir(dir);
+        return true;
+    }
+
+private:
+    // "pid (comm) state ppid ..." where comm may hold spaces and parentheses,
+    // so the fields are counted from the last ')'
+    bool read_stat(const std::string& path, ProcessSample& sample) const
+    {
+        const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+
+        char buffer[1024];
+        const ssize_t length = read(fd, buffer, sizeof(buffer) - 1);
+        close(fd);
+        if (length <= 0) return false;
+        buffer[length] = '\0';
+
+        const char* field = nullptr;
+        for (ssize_t i = length - 1; i >= 0; --i)
+        {
+            if (buffer[i] == ')')
+            {
+                field = buffer + i + 1;
+                break;
+            }
+        }
+        if (!field) return false;
+
+        // after the ')': state is field 0, utime 11, stime 12, rss (pages) 21
+        uint64_t utime = 0;
+        uint64_t stime = 0;
+        uint64_t rss = 0;
+        for (int index = 0; index <= 21; ++index)
+        {
+            while (*field == ' ') ++field;
+            if (*field == '\0') return false;
+
+            char* end = nullptr;
+            const uint64_t value = std::strtoull(field, &end, 10);
+            if (index == 11) utime = value;
+            else if (index == 12) stime = value;
+            else if (index == 21) rss = value;
+
+            field = end != field ? end : field + 1;
+            while (*field != ' ' && *field != '\0') ++field;
+        }
+
+        sample.cpuNanoseconds = (utime + stime) * tickNanoseconds;
+        sample.workingSetBytes = rss * pageBytes;
+        return true;
+    }
+
+    std::string root;
+    uint64_t tickNanoseconds;
+    uint64_t pageBytes;
+};
+#endif
+
+std::unique_ptr<ProcessSampler> make_proc_sampler(const std::string& root)
+{
+#ifdef __linux__
+    return std::make_unique<ProcSampler>(root);
+#else
+    (void)root;
+    return nullptr;
+#endif
+}
+
+const ProcessUsage* UsageSnapshot::find(const DWORD processId) const
+{
+    const auto it = std::ranges::lower_bound(processes, processId, {}, &ProcessUsage::processId);
+    return it != processes.end() && it->processId == processId ? &*it : nullptr;
+}
+
+UsageTracker::UsageTracker(const unsigned cores) : cores(std::max(cores, 1u))
+{
+}
+
+UsageSnapshot UsageTracker::update(std::vector<ProcessSample>& samples, const std::chrono::steady_clock::time_point now)
+{
+    std::ranges::sort(samples, {}, &ProcessSample::processId);
+
+    UsageSnapshot snapshot;
+    snapshot.version = ++version;
+    snapshot.processes.reserve(samples.size());
+
+    const double wallNanoseconds = previous.empty()
+        ? 0.0
+        : static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - previousAt).count());
+
+    auto before = previous.begin();
+    for (const auto& sample : samples)
+    {
+        while (before != previous.end() && before->processId < sample.processId) ++before;
+
+        ProcessUsage usage;
+        usage.processId = sample.processId;
+        usage.workingSetBytes = sample.workingSetBytes;
+        if (before != previous.end() && before->processId == sample.processId && wallNanoseconds > 0 &&
+            sample.cpuNanoseconds >= before->cpuNanoseconds)
+        {
+            const double busy = static_cast<double>(sample.cpuNanoseconds - before->cpuNanoseconds);
+            usage.cpuPercent = static_cast<float>(std::min(100.0, 100.0 * busy / (wallNanoseconds * cores)));
+        }
+        snapshot.processes.push_back(usage);
+    }
+
+    // the old buffer is reused for the next sample
+    std::swap(previous, samples);
+    previousAt = now;
+    return snapshot;
+}
+
+static std::mutex samplerMutex;
+static std::condition_variable samplerWake;
+static std::thread samplerThread;
+static bool samplerRunning = false;
+static bool samplerStopping = false;
+#ifdef __linux__
+static std::unique_ptr<ProcessSampler> make_default_sampler()
+{
+    return make_proc_sampler();
+}
+
+static SamplerFactory samplerFactory = make_default_sampler;
+#else
+static SamplerFactory samplerFactory = nullptr;
+#endif
+static std::chrono::milliseconds samplerInterval{1000};
+static std::atomic<std::shared_ptr<const UsageSnapshot>> publishedUsage{std::make_shared<const UsageSnapshot>()};
+
+static void sampler_main(const SamplerFactory make_sampler)
+{
+    const std::unique_ptr<ProcessSampler> sampler = make_sampler ? make_sampler() : nullptr;
+    if (!sampler)
+    {
+        LOG_WARN("No process sampler, resource usage won't be shown");
+        return;
+    }
+
+    UsageTracker tracker(std::thread::hardware_concurrency());
+    std::vector<ProcessSample> samples;
+    auto nextAt = std::chrono::steady_clock::now();
+
+    std::unique_lock lock(samplerMutex);
+    while (!samplerStopping)
+    {
+        lock.unlock();
+        if (sampler->sample(samples))
+        {
+            const auto now = std::chrono::steady_clock::now();
+            publishedUsage.store(std::make_shared<const UsageSnapshot>(tracker.update(samples, now)),
+                                 std::memory_order_release);
+        }
+        nextAt += samplerInterval;
+        lock.lock();
+
+        samplerWake.wait_until(lock, nextAt, [] { return samplerStopping; });
+    }
+}
+
+void set_usage_sampler(const SamplerFactory make_sampler)
+{
+    std::lock_guard lock(samplerMutex);
+    samplerFactory = make_sampler;
+}
+
+bool usage_sampling_start(const std::chrono::milliseconds interval)
+{
+    std::lock_guard lock(samplerMutex);
+    if (samplerRunning) return false;
+
+    samplerInterval = interval;
+    samplerStopping = false;
+    samplerRunning = true;
+    samplerThread = std::thread(sampler_main, samplerFactory);
+    return true;
+}
+
+void usage_sampling_stop()
+{
+    {
+        std::lock_guard lock(samplerMutex);
+        if (!samplerRunning) return;
+        samplerStopping = true;
+        samplerRunning = false;
+    }
+    samplerWake.notify_all();
+    samplerThread.join();
+
+    // the next start shows fresh numbers rather than ones from the last time the switcher was open
+    publishedUsage.store(std::make_shared<const UsageSnapshot>(), std::memory_order_release);
+}
+
+std::shared_ptr<const UsageSnapshot> current_usage()
+{
+    return publishedUsage.load(std::memory_order_acquire);
+}
@@ -0,0 +1,82 @@
+#ifndef FINDMYWINDOWS_USAGE_H
+#define FINDMYWINDOWS_USAGE_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "platform.h"
+
+struct ProcessSample
+{
+    DWORD processId = 0;
+    // user and kernel time so far
+    uint64_t cpuNanoseconds = 0;
+    uint64_t workingSetBytes = 0;
+};
+
+// One system-wide pass over the processes, never a handle per process or window.
+// NtQuerySystemInformation on Windows, /proc on Linux.
+class ProcessSampler
+{
+public:
+    virtual ~ProcessSampler() = default;
+
+    // Replaces out with every process visible, false when sampling failed
+    virtual bool sample(std::vector<ProcessSample>& out) = 0;
+};
+
+// Reads <root>/<pid>/stat for every pid, root is /proc unless a test points it elsewhere
+std::unique_ptr<ProcessSampler> make_proc_sampler(const std::string& root = "/proc");
+
+struct ProcessUsage
+{
+    DWORD processId = 0;
+    // share of all cores since the previous sample, negative until there is one
+    float cpuPercent = -1.0f;
+    uint64_t workingSetBytes = 0;
+};
+
+// Usage of every process at one sample, sorted by pid
+struct UsageSnapshot
+{
+    uint64_t version = 0;
+    std::vector<ProcessUsage> processes;
+
+    // null when the process wasn't sampled
+    const ProcessUsage* find(DWORD processId) const;
+};
+
+// Turns consecutive samples into CPU% by walking both sorted by pid. A pid
+// whose CPU time went backwards was reused and starts over without a delta.
+class UsageTracker
+{
+public:
+    explicit UsageTracker(unsigned cores);
+
+    // samples is sorted in place
+    UsageSnapshot update(std::vector<ProcessSample>& samples, std::chrono::steady_clock::time_point now);
+
+private:
+    unsigned cores;
+    std::vector<ProcessSample> previous;
+    std::chrono::steady_clock::time_point previousAt;
+    uint64_t version = 0;
+};
+
+using SamplerFactory = std::unique_ptr<ProcessSampler> (*)();
+
+// The sampler the sampling thread creates, /proc by default on Linux and none elsewhere
+void set_usage_sampler(SamplerFactory make_sampler);
+
+// Samples on a background thread every interval until stopped, meant to run only
+// while the switcher is visible. Returns false when it is already running.
+bool usage_sampling_start(std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+void usage_sampling_stop();
+
+// The latest sample, empty before the first one. Never waits for the sampler.
+std::shared_ptr<const UsageSnapshot> current_usage();
+
+#endif //FINDMYWINDOWS_USAGE_H
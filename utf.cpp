@@ -0,0 +1,361 @@
+#include "utf.h"
+
+#include <bit>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define FMW_UTF_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define FMW_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define FMW_TARGET_AVX2
+#endif
+
+static bool is_high_surrogate(const char16_t c)
+{
+    return c >= 0xD800 && c <= 0xDBFF;
+}
+
+static bool is_low_surrogate(const char16_t c)
+{
+    return c >= 0xDC00 && c <= 0xDFFF;
+}
+
+static char* put_code_point(const uint32_t cp, char* dst)
+{
+    if (cp < 0x80)
+    {
+        *dst++ = static_cast<char>(cp);
+    }
+    else if (cp < 0x800)
+    {
+        *dst++ = static_cast<char>(0xC0 | cp >> 6);
+        *dst++ = static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000)
+    {
+        *dst++ = static_cast<char>(0xE0 | cp >> 12);
+        *dst++ = static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+        *dst++ = static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else
+    {
+        *dst++ = static_cast<char>(0xF0 | cp >> 18);
+        *dst++ = static_cast<char>(0x80 | (cp >> 12 & 0x3F));
+        *dst++ = static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+        *dst++ = static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    return dst;
+}
+
+// Encodes the code point starting at src[i], returns the number of units consumed (1 or 2)
+static size_t encode_one(const char16_t* src, const size_t i, const size_t n, char*& dst)
+{
+    const char16_t c = src[i];
+    if (is_high_surrogate(c) && i + 1 < n && is_low_surrogate(src[i + 1]))
+    {
+        const uint32_t cp = 0x10000 + ((c - 0xD800) << 10) + (src[i + 1] - 0xDC00);
+        dst = put_code_point(cp, dst);
+        return 2;
+    }
+
+    dst = put_code_point(is_high_surrogate(c) || is_low_surrogate(c) ? 0xFFFD : c, dst);
+    return 1;
+}
+
+// Encodes the run of non-ASCII units starting at src[i], returns the index after it.
+// Going back to the vector loop after every code point would reload the same
+// block over and over for CJK titles, so lone ASCII units (the spaces between
+// words) stay in the run too.
+static size_t encode_non_ascii_run(const char16_t* src, size_t i, const size_t n, char*& dst)
+{
+    while (i < n)
+    {
+        if (src[i] >= 0x80)
+        {
+            i += encode_one(src, i, n, dst);
+        }
+        else if (i + 1 < n && src[i + 1] >= 0x80)
+        {
+            *dst++ = static_cast<char>(src[i++]);
+        }
+        else
+        {
+            break;
+        }
+    }
+    return i;
+}
+
+static char* encode_scalar(const char16_t* src, const size_t n, size_t i, char* dst)
+{
+    while (i < n)
+    {
+        if (src[i] < 0x80)
+        {
+            *dst++ = static_cast<char>(src[i++]);
+            continue;
+        }
+        i += encode_one(src, i, n, dst);
+    }
+    return dst;
+}
+
+#ifdef FMW_UTF_X86
+// 16 units per step. Both halves are narrowed with a saturating pack and stored
+// unconditionally, then only the ASCII prefix is kept and the first non-ASCII
+// run goes through the scalar encoder. The output has room for 3 bytes per unit,
+// so the 16 byte store never runs past it while 16 units remain.
+static char* encode_sse2(const char16_t* src, const size_t n, size_t i, char* dst)
+{
+    const __m128i high_bits = _mm_set1_epi16(static_cast<short>(0xFF80));
+    const __m128i zero = _mm_setzero_si128();
+
+    while (i + 16 <= n)
+    {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+        const auto ascii_a = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(a, high_bits), zero)));
+        const auto ascii_b = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(b, high_bits), zero)));
+        const uint32_t other = ~(ascii_a | ascii_b << 16);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(a, b));
+        if (other == 0)
+        {
+            i += 16;
+            dst += 16;
+            continue;
+        }
+
+        // movemask has two bits per 16-bit lane
+        const size_t prefix = std::countr_zero(other) / 2;
+        i += prefix;
+        dst += prefix;
+        i = encode_non_ascii_run(src, i, n, dst);
+    }
+    return encode_scalar(src, n, i, dst);
+}
+
+// Same scheme with 32 units per step, the last 16..31 units go through the SSE2
+// loop. packus works per 128-bit lane, the permute puts the four 64-bit quarters
+// back in order.
+FMW_TARGET_AVX2 static char* encode_avx2(const char16_t* src, const size_t n, char* dst)
+{
+    const __m256i high_bits = _mm256_set1_epi16(static_cast<short>(0xFF80));
+    const __m256i zero = _mm256_setzero_si256();
+
+    size_t i = 0;
+    while (i + 32 <= n)
+    {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 16));
+        const auto ascii_a = static_cast<uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_and_si256(a, high_bits), zero)));
+        const auto ascii_b = static_cast<uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_and_si256(b, high_bits), zero)));
+        const uint64_t other = ~(static_cast<uint64_t>(ascii_a) | static_cast<uint64_t>(ascii_b) << 32);
+
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), packed);
+        if (other == 0)
+        {
+            i += 32;
+            dst += 32;
+            continue;
+        }
+
+        const size_t prefix = std::countr_zero(other) / 2;
+        i += prefix;
+        dst += prefix;
+        i = encode_non_ascii_run(src, i, n, dst);
+    }
+    // GCC drops the implicit vzeroupper when the call below becomes a tail call,
+    // and legacy SSE code running with dirty upper halves is several times slower
+    _mm256_zeroupper();
+    return encode_sse2(src, n, i, dst);
+}
+
+static bool cpu_has_avx2()
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+
+    // AVX needs OS support for the YMM state as well as the CPU bit
+    __cpuid(info, 1);
+    const bool osxsave = info[2] & 1 << 27;
+    const bool avx = info[2] & 1 << 28;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;
+
+    __cpuidex(info, 7, 0);
+    return info[1] & 1 << 5;
+#else
+    return false;
+#endif
+}
+#endif
+
+static char* encode_with(const Utf16Path path, const char16_t* src, const size_t n, char* dst)
+{
+#ifdef FMW_UTF_X86
+    switch (path)
+    {
+    case Utf16Path::Avx2:
+        return encode_avx2(src, n, dst);
+    case Utf16Path::Sse2:
+        return encode_sse2(src, n, 0, dst);
+    case Utf16Path::Scalar:
+        break;
+    }
+#else
+    (void)path;
+#endif
+    return encode_scalar(src, n, 0, dst);
+}
+
+bool utf16_path_supported(const Utf16Path path)
+{
+#ifdef FMW_UTF_X86
+    static const bool avx2 = cpu_has_avx2();
+    return path != Utf16Path::Avx2 || avx2;
+#else
+    return path == Utf16Path::Scalar;
+#endif
+}
+
+static Utf16Path best_path()
+{
+    static const Utf16Path path = utf16_path_supported(Utf16Path::Avx2)
+                                      ? Utf16Path::Avx2
+                                      : utf16_path_supported(Utf16Path::Sse2)
+                                      ? Utf16Path::Sse2
+                                      : Utf16Path::Scalar;
+    return path;
+}
+
+const char* utf16_transcoder_name()
+{
+    switch (best_path())
+    {
+    case Utf16Path::Avx2: return "avx2";
+    case Utf16Path::Sse2: return "sse2";
+    case Utf16Path::Scalar: break;
+    }
+    return "scalar";
+}
+
+void utf16_to_utf8(const std::u16string_view text, std::string& out, Utf16Path path)
+{
+    if (!utf16_path_supported(path)) path = Utf16Path::Scalar;
+
+    const size_t start = out.size();
+    out.resize_and_overwrite(start + text.size() * 3, [&](char* buffer, size_t)
+    {
+        return encode_with(path, text.data(), text.size(), buffer + start) - buffer;
+    });
+}
+
+void utf16_to_utf8(const std::u16string_view text, std::string& out)
+{
+    utf16_to_utf8(text, out, best_path());
+}
+
+std::string utf16_to_utf8(const std::u16string_view text)
+{
+    std::string out;
+    utf16_to_utf8(text, out, best_path());
+    return out;
+}
+
+void utf16_to_utf8_batch(const std::u16string_view* texts, std::string* outs, const size_t count)
+{
+    const Utf16Path path = best_path();
+    for (size_t i = 0; i < count; ++i)
+    {
+        outs[i].clear();
+        utf16_to_utf8(texts[i], outs[i], path);
+    }
+}
+
+std::u16string utf8_to_utf16(const std::string_view text)
+{
+    std::u16string out;
+    out.reserve(text.size());
+
+    const auto* s = reinterpret_cast<const unsigned char*>(text.data());
+    const size_t n = text.size();
+    size_t i = 0;
+    while (i < n)
+    {
+        const unsigned char lead = s[i];
+        uint32_t cp;
+        size_t length;
+        uint32_t minimum;
+        if (lead < 0x80)
+        {
+            out.push_back(lead);
+            ++i;
+            continue;
+        }
+        if ((lead & 0xE0) == 0xC0)
+        {
+            cp = lead & 0x1F;
+            length = 2;
+            minimum = 0x80;
+        }
+        else if ((lead & 0xF0) == 0xE0)
+        {
+            cp = lead & 0x0F;
+            length = 3;
+            minimum = 0x800;
+        }
+        else if ((lead & 0xF8) == 0xF0)
+        {
+            cp = lead & 0x07;
+            length = 4;
+            minimum = 0x10000;
+        }
+        else
+        {
+            out.push_back(0xFFFD);
+            ++i;
+            continue;
+        }
+
+        size_t consumed = 1;
+        while (consumed < length && i + consumed < n && (s[i + consumed] & 0xC0) == 0x80)
+        {
+            cp = cp << 6 | (s[i + consumed] & 0x3F);
+            ++consumed;
+        }
+
+        if (consumed < length || cp < minimum || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+        {
+            out.push_back(0xFFFD);
+            i += consumed;
+            continue;
+        }
+
+        if (cp >= 0x10000)
+        {
+            cp -= 0x10000;
+            out.push_back(static_cast<char16_t>(0xD800 + (cp >> 10)));
+            out.push_back(static_cast<char16_t>(0xDC00 + (cp & 0x3FF)));
+        }
+        else
+        {
+            out.push_back(static_cast<char16_t>(cp));
+        }
+        i += length;
+    }
+    return out;
+}
@@ -0,0 +1,38 @@
+#ifndef FINDMYWINDOWS_UTF_H
+#define FINDMYWINDOWS_UTF_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// UTF-16 -> UTF-8 for window metadata coming out of the wide Win32 APIs.
+// Runs of ASCII go through an AVX2 or SSE2 path (picked once at runtime on x86),
+// everything else through the scalar encoder. Unpaired surrogates become U+FFFD.
+
+enum class Utf16Path
+{
+    Scalar,
+    Sse2,
+    Avx2,
+};
+
+// Appends the UTF-8 form of text to out using the fastest supported path
+void utf16_to_utf8(std::u16string_view text, std::string& out);
+
+std::string utf16_to_utf8(std::u16string_view text);
+
+// Same, forcing a path. Falls back to scalar when the CPU lacks it.
+void utf16_to_utf8(std::u16string_view text, std::string& out, Utf16Path path);
+
+// Converts count strings in one go, overwriting each output but reusing its capacity
+void utf16_to_utf8_batch(const std::u16string_view* texts, std::string* outs, size_t count);
+
+bool utf16_path_supported(Utf16Path path);
+
+// Path used by utf16_to_utf8(), "avx2", "sse2" or "scalar"
+const char* utf16_transcoder_name();
+
+// The reverse direction, scalar only. Invalid sequences become U+FFFD.
+std::u16string utf8_to_utf16(std::string_view text);
+
+#endif //FINDMYWINDOWS_UTF_H
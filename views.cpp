@@ -0,0 +1,260 @@
+#include "views.h"
+
+#include <algorithm>
+#include <utility>
+
+static char fold(const char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// <0, 0 or >0 ignoring case for ASCII, without folding copies
+static int compare_folded(const std::string_view a, const std::string_view b)
+{
+    const size_t common = std::min(a.size(), b.size());
+    for (size_t i = 0; i < common; ++i)
+    {
+        const char x = fold(a[i]);
+        const char y = fold(b[i]);
+        if (x != y) return static_cast<unsigned char>(x) < static_cast<unsigned char>(y) ? -1 : 1;
+    }
+    return a.size() < b.size() ? -1 : a.size() > b.size() ? 1 : 0;
+}
+
+const char* sort_view_name(const SortView view)
+{
+    static constexpr const char* names[] = {"saved", "process", "title", "recent", "desktop"};
+    return names[static_cast<size_t>(view)];
+}
+
+bool WindowViews::before(const SortView view, const uint32_t a, const uint32_t b) const
+{
+    const WindowInfo& x = slots[a];
+    const WindowInfo& y = slots[b];
+    switch (view)
+    {
+    case SortView::Saved:
+        break;
+    case SortView::Process:
+        if (const int order = compare_folded(x.processName, y.processName); order != 0) return order < 0;
+        break;
+    case SortView::Title:
+        if (const int order = compare_folded(x.title, y.title); order != 0) return order < 0;
+        break;
+    case SortView::Recency:
+        if (keys[a].stamp != keys[b].stamp) return keys[a].stamp > keys[b].stamp;
+        break;
+    case SortView::Desktop:
+        if (x.isOnCurrentDesktop != y.isOnCurrentDesktop) return x.isOnCurrentDesktop;
+        break;
+    }
+    return keys[a].rank < keys[b].rank;
+}
+
+void WindowViews::place(const SortView view, const uint32_t slot)
+{
+    std::vector<uint32_t>& order = orders[static_cast<size_t>(view)];
+    const auto it = std::ranges::lower_bound(order, slot, [&](const uint32_t a, const uint32_t b)
+    {
+        return before(view, a, b);
+    });
+    order.insert(it, slot);
+}
+
+void WindowViews::unplace(const SortView view, const uint32_t slot)
+{
+    std::vector<uint32_t>& order = orders[static_cast<size_t>(view)];
+    order.erase(order.begin() + static_cast<ptrdiff_t>(position(view, slot)));
+}
+
+void WindowViews::assign(std::vector<WindowInfo> windows, const std::span<const HWND> recent)
+{
+    slots = std::move(windows);
+    keys.assign(slots.size(), {});
+    freeSlots.clear();
+    slotOf.clear();
+    slotOf.reserve(slots.size());
+    nextRank = slots.size();
+    nextStamp = recent.size();
+    for (uint32_t slot = 0; slot < slots.size(); ++slot)
+    {
+        keys[slot].rank = slot;
+        if (slots[slot].tabNode == 0) slotOf[slots[slot].hwnd] = slot;
+    }
+    for (size_t index = 0; index < recent.size(); ++index)
+    {
+        if (const auto it = slotOf.find(recent[index]); it != slotOf.end())
+        {
+            keys[it->second].stamp = recent.size() - index;
+        }
+    }
+
+    for (size_t view = 0; view < sort_view_count; ++view)
+    {
+        std::vector<uint32_t>& order = orders[view];
+        order.resize(slots.size());
+        for (uint32_t slot = 0; slot < slots.size(); ++slot)
+        {
+            order[slot] = slot;
+        }
+        if (static_cast<SortView>(view) == SortView::Saved) continue;
+
+        std::ranges::sort(order, [&](const uint32_t a, const uint32_t b)
+        {
+            return before(static_cast<SortView>(view), a, b);
+        });
+    }
+}
+
+uint32_t WindowViews::insert(WindowInfo window)
+{
+    uint32_t slot;
+    if (freeSlots.empty())
+    {
+        slot = static_cast<uint32_t>(slots.size());
+        slots.push_back(std::move(window));
+        keys.emplace_back();
+    }
+    else
+    {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+        slots[slot] = std::move(window);
+    }
+    keys[slot] = {nextRank++, 0};
+    if (slots[slot].tabNode == 0) slotOf[slots[slot].hwnd] = slot;
+
+    for (size_t view = 0; view < sort_view_count; ++view)
+    {
+        place(static_cast<SortView>(view), slot);
+    }
+    return slot;
+}
+
+void WindowViews::remove(const uint32_t slot)
+{
+    for (size_t view = 0; view < sort_view_count; ++view)
+    {
+        unplace(static_cast<SortView>(view), slot);
+    }
+    if (const auto it = slotOf.find(slots[slot].hwnd); it != slotOf.end() && it->second == slot)
+    {
+        slotOf.erase(it);
+    }
+    // the strings go now, the slot itself waits for the next insert
+    slots[slot] = {};
+    freeSlots.push_back(slot);
+}
+
+void WindowViews::retitle(const uint32_t slot, std::string title)
+{
+    unplace(SortView::Title, slot);
+    slots[slot].title = std::move(title);
+    place(SortView::Title, slot);
+}
+
+void WindowViews::set_desktop(const uint32_t slot, const bool current)
+{
+    if (slots[slot].isOnCurrentDesktop == current) return;
+
+    unplace(SortView::Desktop, slot);
+    slots[slot].isOnCurrentDesktop = current;
+    place(SortView::Desktop, slot);
+}
+
+void WindowViews::touch(const uint32_t slot)
+{
+    // the newest stamp always goes first, no search needed
+    std::vector<uint32_t>& order = orders[static_cast<size_t>(SortView::Recency)];
+    const auto it = order.begin() + static_cast<ptrdiff_t>(position(SortView::Recency, slot));
+    std::rotate(order.begin(), it, it + 1);
+    keys[slot].stamp = ++nextStamp;
+}
+
+void WindowViews::swap_saved(const uint32_t a, const uint32_t b)
+{
+    if (a == b) return;
+
+    // every view breaks ties by rank, so any of them can hold the two in a new order
+    for (size_t view = 0; view < sort_view_count; ++view)
+    {
+        unplace(static_cast<SortView>(view), a);
+        unplace(static_cast<SortView>(view), b);
+    }
+    std::swap(keys[a].rank, keys[b].rank);
+    for (size_t view = 0; view < sort_view_count; ++view)
+    {
+        place(static_cast<SortView>(view), a);
+        place(static_cast<SortView>(view), b);
+    }
+}
+
+std::span<const uint32_t> WindowViews::order(const SortView view) const
+{
+    return orders[static_cast<size_t>(view)];
+}
+
+const WindowInfo& WindowViews::window(const uint32_t slot) const
+{
+    return slots[slot];
+}
+
+uint32_t WindowViews::find(const HWND hwnd) const
+{
+    const auto it = slotOf.find(hwnd);
+    return it != slotOf.end() ? it->second : UINT32_MAX;
+}
+
+size_t WindowViews::position(const SortView view, const uint32_t slot) const
+{
+    const std::vector<uint32_t>& order = orders[static_cast<size_t>(view)];
+    const auto it = std::ranges::lower_bound(order, slot, [&](const uint32_t a, const uint32_t b)
+    {
+        return before(view, a, b);
+    });
+    return static_cast<size_t>(it - order.begin());
+}
+
+size_t WindowViews::size() const
+{
+    return orders[0].size();
+}
+
+std::vector<WindowInfo> WindowViews::release()
+{
+    std::vector<WindowInfo> windows;
+    windows.reserve(size());
+    for (const uint32_t slot : orders[static_cast<size_t>(SortView::Saved)])
+    {
+        windows.push_back(std::move(slots[slot]));
+    }
+
+    slots.clear();
+    keys.clear();
+    freeSlots.clear();
+    slotOf.clear();
+    for (std::vector<uint32_t>& order : orders)
+    {
+        order.clear();
+    }
+    return windows;
+}
+
+size_t WindowViews::view_bytes() const
+{
+    return orders[0].capacity() * sizeof(uint32_t);
+}
+
+size_t WindowViews::window_bytes() const
+{
+    size_t bytes = slots.capacity() * sizeof(WindowInfo);
+    for (const WindowInfo& window : slots)
+    {
+        // strings short enough for the inline buffer cost nothing more
+        for (const std::string* text : {&window.title, &window.className, &window.processName, &window.package})
+        {
+            if (text->capacity() > std::string().capacity()) bytes += text->capacity() + 1;
+        }
+    }
+    return bytes;
+}
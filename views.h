@@ -0,0 +1,91 @@
+#ifndef FINDMYWINDOWS_VIEWS_H
+#define FINDMYWINDOWS_VIEWS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "tabs.h"
+
+// Orders the switcher can show its rows in
+enum class SortView : uint8_t
+{
+    // the saved order, then the rest as the enumeration listed them
+    Saved,
+    Process,
+    Title,
+    // most recently focused first
+    Recency,
+    // current desktop first, each desktop in saved order
+    Desktop,
+};
+constexpr size_t sort_view_count = 5;
+
+const char* sort_view_name(SortView view);
+
+// Windows in every SortView at once. Each view is a permutation of slot indices,
+// 4 bytes per window, kept sorted as windows come, go, get retitled or focused:
+// a change costs a binary search and a move within the views it affects, never a
+// sort. Switching views is reading another permutation.
+//
+// Slots are stable for a row's life and reused after it, ties in every view go by
+// the saved order so each view is a strict total order. Browser tab rows share
+// their window's handle, so rows are changed by slot and find() only knows windows.
+class WindowViews
+{
+public:
+    // The one full sort: windows in saved order, recent the most recently focused
+    // first (MruStack::order()), windows not in it count as never focused
+    void assign(std::vector<WindowInfo> windows, std::span<const HWND> recent = {});
+
+    // Adds at the end of the saved order as never focused, returns the slot
+    uint32_t insert(WindowInfo window);
+    void remove(uint32_t slot);
+    void retitle(uint32_t slot, std::string title);
+    void set_desktop(uint32_t slot, bool current);
+    // The slot's window got the focus
+    void touch(uint32_t slot);
+    // Trades the saved places of two rows, the switcher's Alt+up/down
+    void swap_saved(uint32_t a, uint32_t b);
+
+    std::span<const uint32_t> order(SortView view) const;
+    const WindowInfo& window(uint32_t slot) const;
+    // Slot of the window row of hwnd, UINT32_MAX when it isn't listed
+    uint32_t find(HWND hwnd) const;
+    // Where slot is in view, by binary search
+    size_t position(SortView view, uint32_t slot) const;
+    size_t size() const;
+
+    // The windows in saved order, the views are empty afterwards
+    std::vector<WindowInfo> release();
+
+    // Bytes held by one view, and by the windows themselves including their strings
+    size_t view_bytes() const;
+    size_t window_bytes() const;
+
+private:
+    struct SlotKeys
+    {
+        uint64_t rank = 0;
+        // higher is more recent, 0 for never focused
+        uint64_t stamp = 0;
+    };
+
+    bool before(SortView view, uint32_t a, uint32_t b) const;
+    // Places slot in view by its current keys, unplace before the keys change
+    void place(SortView view, uint32_t slot);
+    void unplace(SortView view, uint32_t slot);
+
+    std::vector<WindowInfo> slots;
+    std::vector<SlotKeys> keys;
+    std::vector<uint32_t> freeSlots;
+    std::unordered_map<HWND, uint32_t> slotOf;
+    std::array<std::vector<uint32_t>, sort_view_count> orders;
+    uint64_t nextRank = 0;
+    uint64_t nextStamp = 0;
+};
+
+#endif //FINDMYWINDOWS_VIEWS_H
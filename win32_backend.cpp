@@ -0,0 +1,551 @@
+#include "win32_backend.h"
+#include "log.h"
+#include "utf.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <windows.h>
+#include <appmodel.h>
+#include <shellapi.h>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <uiautomation.h>
+#include <winternl.h>
+#include <wrl/client.h>
+
+using Microsoft::WRL::ComPtr;
+
+// Virtual Desktop Manager interface (Windows 10/11)
+// These are undocumented COM interfaces that Windows uses internally
+DEFINE_GUID(CLSID_VirtualDesktopManager, 0xaa509086, 0x4258, 0x4bd1, 0x94, 0xcf, 0x3f, 0xde, 0x1c, 0x5d, 0x4b, 0xce);
+DEFINE_GUID(IID_IVirtualDesktopManager, 0xa5cd92ff, 0x29be, 0x454c, 0x8d, 0x04, 0xd8, 0x28, 0x79, 0xfb, 0x3f, 0x1b);
+
+// Interface declaration
+MIDL_INTERFACE("a5cd92ff-29be-454c-8d04-d82879fb3f1b")
+    IVirtualDesktopManager : public IUnknown
+{
+public:
+    virtual ~IVirtualDesktopManager() = default;
+    virtual HRESULT STDMETHODCALLTYPE IsWindowOnCurrentVirtualDesktop(
+        HWND topLevelWindow,
+        BOOL* onCurrentDesktop) = 0;
+
+    virtual HRESULT STDMETHODCALLTYPE GetWindowDesktopId(
+        HWND topLevelWindow,
+        GUID* desktopId) = 0;
+
+    virtual HRESULT STDMETHODCALLTYPE MoveWindowToDesktop(
+        HWND topLevelWindow,
+        REFGUID desktopId) = 0;
+};
+
+static std::string to_utf8(const wchar_t* text, const size_t length)
+{
+    return utf16_to_utf8(std::u16string_view(reinterpret_cast<const char16_t*>(text), length));
+}
+
+// Get process name from process ID. PROCESS_QUERY_LIMITED_INFORMATION is enough
+// for QueryFullProcessImageNameW and, unlike PROCESS_VM_READ, is also granted
+// for elevated processes.
+std::string GetProcessName(const DWORD processId)
+{
+    const HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
+    if (!hProcess) return "Unknown";
+
+    // image paths can exceed MAX_PATH with long path support enabled
+    std::wstring path(MAX_PATH, L'\0');
+    while (true)
+    {
+        DWORD length = static_cast<DWORD>(path.size());
+        if (QueryFullProcessImageNameW(hProcess, 0, path.data(), &length))
+        {
+            CloseHandle(hProcess);
+            const size_t slash = std::wstring_view(path.data(), length).find_last_of(L"\\/");
+            const size_t start = slash == std::wstring_view::npos ? 0 : slash + 1;
+            return to_utf8(path.data() + start, length - start);
+        }
+        if (GetLastError() != ERROR_INSUFFICIENT_BUFFER || path.size() >= 32768) break;
+        path.resize(path.size() * 2);
+    }
+    CloseHandle(hProcess);
+    return "Unknown";
+}
+
+// Package family name of a packaged process, empty when it has no package identity
+static std::string GetPackageName(const DWORD processId)
+{
+    const HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
+    if (!hProcess) return {};
+
+    wchar_t name[PACKAGE_FAMILY_NAME_MAX_LENGTH + 1];
+    UINT32 length = static_cast<UINT32>(std::size(name));
+    // APPMODEL_ERROR_NO_PACKAGE for ordinary desktop apps
+    const LONG result = GetPackageFamilyName(hProcess, &length, name);
+    CloseHandle(hProcess);
+    if (result != ERROR_SUCCESS || length == 0) return {};
+
+    // length counts the terminator
+    return to_utf8(name, length - 1);
+}
+
+// Function to get desktop GUID for a window
+void ShowWindowDesktopInfo(IVirtualDesktopManager* vdm, const HWND hwnd)
+{
+    if (!vdm) return;
+
+    GUID desktopId;
+    if (SUCCEEDED(vdm->GetWindowDesktopId(hwnd, &desktopId)))
+    {
+        char id[40];
+        snprintf(id, sizeof(id), "%08lx-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+                 desktopId.Data1, desktopId.Data2, desktopId.Data3,
+                 desktopId.Data4[0], desktopId.Data4[1], desktopId.Data4[2], desktopId.Data4[3],
+                 desktopId.Data4[4], desktopId.Data4[5], desktopId.Data4[6], desktopId.Data4[7]);
+        LOG_DEBUG("Desktop ID: {}", id);
+    }
+}
+
+class Win32Backend final : public WindowBackend
+{
+public:
+    Win32Backend()
+    {
+        // Initialize COM
+        const HRESULT hr = CoInitialize(nullptr);
+        comInitialized = SUCCEEDED(hr);
+        if (!comInitialized)
+        {
+            char code[16];
+            snprintf(code, sizeof(code), "0x%08lx", static_cast<unsigned long>(hr));
+            LOG_ERROR("Failed to initialize COM: {}", code);
+            return;
+        }
+
+        // Create Virtual Desktop Manager
+        if (FAILED(CoCreateInstance(CLSID_VirtualDesktopManager, nullptr, CLSCTX_ALL,
+            IID_IVirtualDesktopManager, &vdm)))
+        {
+            LOG_WARN("Virtual Desktop Manager not available (Windows 10/11 required), listing all windows instead");
+        }
+    }
+
+    ~Win32Backend() override
+    {
+        // let ComPtr handle the release, then uninitialize COM
+        vdm.Reset();
+        if (comInitialized)
+        {
+            CoUninitialize();
+        }
+    }
+
+    void enum_windows(std::vector<HWND>& out) override
+    {
+        EnumWindows([](const HWND hwnd, const LPARAM lParam) -> BOOL
+        {
+            reinterpret_cast<std::vector<HWND>*>(lParam)->push_back(hwnd);
+            return TRUE;
+        }, reinterpret_cast<LPARAM>(&out));
+    }
+
+    bool is_visible(const HWND hwnd) override
+    {
+        return IsWindowVisible(hwnd);
+    }
+
+    DWORD ex_style(const HWND hwnd) override
+    {
+        return GetWindowLong(hwnd, GWL_EXSTYLE);
+    }
+
+    HWND owner(const HWND hwnd) override
+    {
+        return GetWindow(hwnd, GW_OWNER);
+    }
+
+    DWORD cloaked(const HWND hwnd) override
+    {
+        DWORD cloaked = 0;
+        if (FAILED(DwmGetWindowAttribute(hwnd, DWMWA_CLOAKED, &cloaked, sizeof(cloaked))))
+        {
+            return 0;
+        }
+        return cloaked;
+    }
+
+    std::string title(const HWND hwnd) override
+    {
+        // the length is only a hint and the title can grow between the two calls.
+        // One spare character so a title that fits exactly doesn't look truncated.
+        std::wstring title(GetWindowTextLengthW(hwnd) + 2, L'\0');
+        int length = GetWindowTextW(hwnd, title.data(), static_cast<int>(title.size()));
+        while (length >= static_cast<int>(title.size()) - 1 && title.size() < 65536)
+        {
+            title.resize(title.size() * 2);
+            length = GetWindowTextW(hwnd, title.data(), static_cast<int>(title.size()));
+        }
+        return to_utf8(title.data(), length);
+    }
+
+    std::string class_name(const HWND hwnd) override
+    {
+        // class names are capped at 256 characters by RegisterClass
+        wchar_t className[257];
+        const int length = GetClassNameW(hwnd, className, static_cast<int>(std::size(className)));
+        return to_utf8(className, length);
+    }
+
+    DWORD process_id(const HWND hwnd) override
+    {
+        DWORD processId = 0;
+        GetWindowThreadProcessId(hwnd, &processId);
+        return processId;
+    }
+
+    std::string process_name(const DWORD processId) override
+    {
+        return GetProcessName(processId);
+    }
+
+    void child_windows(const HWND parent, std::vector<HWND>& out) override
+    {
+        EnumChildWindows(parent, [](const HWND hwnd, const LPARAM lParam) -> BOOL
+        {
+            reinterpret_cast<std::vector<HWND>*>(lParam)->push_back(hwnd);
+            return TRUE;
+        }, reinterpret_cast<LPARAM>(&out));
+    }
+
+    std::string package_name(const DWORD processId) override
+    {
+        return GetPackageName(processId);
+    }
+
+    bool has_virtual_desktops() override
+    {
+        return vdm != nullptr;
+    }
+
+    bool is_on_current_desktop(const HWND hwnd) override
+    {
+        if (!vdm) return false;
+
+        BOOL onCurrentDesktop = FALSE;
+        const HRESULT hr = vdm->IsWindowOnCurrentVirtualDesktop(hwnd, &onCurrentDesktop);
+        return SUCCEEDED(hr) && onCurrentDesktop == TRUE;
+    }
+
+    bool activate(const HWND hwnd) override
+    {
+        // Restore if minimized
+        if (IsIconic(hwnd))
+        {
+            ShowWindow(hwnd, SW_RESTORE);
+        }
+
+        // Bring to foreground
+        const bool focused = SetForegroundWindow(hwnd);
+        BringWindowToTop(hwnd);
+        return focused;
+    }
+
+    HWND foreground() override
+    {
+        return GetForegroundWindow();
+    }
+
+    bool close_window(const HWND hwnd) override
+    {
+        // posted rather than sent, an app that is hung or shows a save prompt can't stall the batch
+        return PostMessage(hwnd, WM_CLOSE, 0, 0);
+    }
+
+    bool minimize(const HWND hwnd) override
+    {
+        return ShowWindowAsync(hwnd, SW_MINIMIZE);
+    }
+
+    bool launch(const std::string& command) override
+    {
+        // a shortcut opens like a double click in Explorer, with its own working directory and arguments
+        const std::u16string path = utf8_to_utf16(command);
+        const HINSTANCE result = ShellExecuteW(nullptr, L"open", reinterpret_cast<LPCWSTR>(path.c_str()), nullptr,
+                                               nullptr, SW_SHOWNORMAL);
+        return reinterpret_cast<INT_PTR>(result) > 32;
+    }
+
+    bool move_to_desktop_of(const HWND hwnd, const HWND anchor) override
+    {
+        if (!vdm) return false;
+
+        // the documented interface only moves windows of this process, others fail with E_ACCESSDENIED
+        GUID desktopId;
+        if (FAILED(vdm->GetWindowDesktopId(anchor ? anchor : GetForegroundWindow(), &desktopId)))
+        {
+            return false;
+        }
+        return SUCCEEDED(vdm->MoveWindowToDesktop(hwnd, desktopId));
+    }
+
+    WindowRect work_area() override
+    {
+        RECT area{};
+        SystemParametersInfo(SPI_GETWORKAREA, 0, &area, 0);
+        return {area.left, area.top, area.right - area.left, area.bottom - area.top};
+    }
+
+    size_t set_positions(const std::vector<WindowPlacement>& placements) override
+    {
+        // DeferWindowPos keeps the show state, a minimized or maximized window would ignore the new rect
+        for (const auto& placement : placements)
+        {
+            if (IsIconic(placement.hwnd) || IsZoomed(placement.hwnd))
+            {
+                ShowWindow(placement.hwnd, SW_RESTORE);
+            }
+        }
+
+        constexpr UINT flags = SWP_NOZORDER | SWP_NOACTIVATE;
+        HDWP batch = BeginDeferWindowPos(static_cast<int>(placements.size()));
+        for (const auto& [hwnd, rect] : placements)
+        {
+            if (!batch) break;
+            batch = DeferWindowPos(batch, hwnd, nullptr, rect.x, rect.y, rect.width, rect.height, flags);
+        }
+        if (batch && EndDeferWindowPos(batch))
+        {
+            return placements.size();
+        }
+
+        // one window refused (e.g. an elevated process) and took the batch with it,
+        // place them one at a time instead
+        LOG_WARN("Deferred positioning failed ({}), moving {} windows one by one", GetLastError(),
+                 placements.size());
+        size_t placed = 0;
+        for (const auto& [hwnd, rect] : placements)
+        {
+            placed += SetWindowPos(hwnd, nullptr, rect.x, rect.y, rect.width, rect.height,
+                                   flags | SWP_ASYNCWINDOWPOS) != FALSE;
+        }
+        return placed;
+    }
+
+private:
+    bool comInitialized = false;
+    ComPtr<IVirtualDesktopManager> vdm;
+};
+
+WindowBackend& win32_backend()
+{
+    static Win32Backend backend;
+    return backend;
+}
+
+std::unique_ptr<WindowBackend> make_win32_backend()
+{
+    return std::make_unique<Win32Backend>();
+}
+
+// UI Automation client for the tab crawler. A handle is an IUIAutomationElement
+// pointer holding one reference.
+class UiaTree final : public AccessibilityTree
+{
+public:
+    UiaTree()
+    {
+        // UI Automation clients belong in the multithreaded apartment
+        comInitialized = SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+
+        HRESULT hr = CoCreateInstance(__uuidof(CUIAutomation8), nullptr, CLSCTX_INPROC_SERVER,
+                                      IID_PPV_ARGS(&automation));
+        if (FAILED(hr))
+        {
+            // before Windows 8
+            hr = CoCreateInstance(__uuidof(CUIAutomation), nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&automation));
+        }
+        if (FAILED(hr))
+        {
+            char code[16];
+            snprintf(code, sizeof(code), "0x%08lx", static_cast<unsigned long>(hr));
+            LOG_ERROR("UI Automation not available: {}", code);
+            return;
+        }
+
+        // bounds how long a hung browser can hold up a single call
+        ComPtr<IUIAutomation2> automation2;
+        if (SUCCEEDED(automation.As(&automation2)))
+        {
+            automation2->put_ConnectionTimeout(2000);
+            automation2->put_TransactionTimeout(1000);
+        }
+        automation->get_ControlViewWalker(&walker);
+    }
+
+    ~UiaTree() override
+    {
+        walker.Reset();
+        automation.Reset();
+        if (comInitialized)
+        {
+            CoUninitialize();
+        }
+    }
+
+    bool available() const
+    {
+        return automation && walker;
+    }
+
+    AccessibleNode root(const HWND window) override
+    {
+        IUIAutomationElement* windowElement = nullptr;
+        if (FAILED(automation->ElementFromHandle(window, &windowElement))) return 0;
+        return to_node(windowElement);
+    }
+
+    void children(const AccessibleNode node, std::vector<AccessibleNode>& out) override
+    {
+        IUIAutomationElement* child = nullptr;
+        if (FAILED(walker->GetFirstChildElement(element(node), &child))) return;
+
+        while (child)
+        {
+            out.push_back(to_node(child));
+            IUIAutomationElement* next = nullptr;
+            if (FAILED(walker->GetNextSiblingElement(child, &next))) break;
+            child = next;
+        }
+    }
+
+    AccessibleRole role(const AccessibleNode node) override
+    {
+        CONTROLTYPEID type = 0;
+        if (FAILED(element(node)->get_CurrentControlType(&type))) return AccessibleRole::Other;
+
+        switch (type)
+        {
+        case UIA_TabControlTypeId: return AccessibleRole::TabList;
+        case UIA_TabItemControlTypeId: return AccessibleRole::Tab;
+        case UIA_DocumentControlTypeId: return AccessibleRole::Document;
+        default: return AccessibleRole::Other;
+        }
+    }
+
+    std::string name(const AccessibleNode node) override
+    {
+        BSTR name = nullptr;
+        if (FAILED(element(node)->get_CurrentName(&name)) || !name) return {};
+
+        std::string text = to_utf8(name, SysStringLen(name));
+        SysFreeString(name);
+        return text;
+    }
+
+    bool select(const AccessibleNode node) override
+    {
+        ComPtr<IUIAutomationSelectionItemPattern> selection;
+        if (SUCCEEDED(element(node)->GetCurrentPatternAs(UIA_SelectionItemPatternId, IID_PPV_ARGS(&selection))) &&
+            selection)
+        {
+            return SUCCEEDED(selection->Select());
+        }
+
+        // tabs without the selection pattern usually still have a default action
+        ComPtr<IUIAutomationLegacyIAccessiblePattern> legacy;
+        if (SUCCEEDED(element(node)->GetCurrentPatternAs(UIA_LegacyIAccessiblePatternId, IID_PPV_ARGS(&legacy))) &&
+            legacy)
+        {
+            return SUCCEEDED(legacy->DoDefaultAction());
+        }
+        return false;
+    }
+
+    void release(const AccessibleNode node) override
+    {
+        element(node)->Release();
+    }
+
+private:
+    static IUIAutomationElement* element(const AccessibleNode node)
+    {
+        return reinterpret_cast<IUIAutomationElement*>(static_cast<uintptr_t>(node));
+    }
+
+    static AccessibleNode to_node(IUIAutomationElement* pointer)
+    {
+        return reinterpret_cast<uintptr_t>(pointer);
+    }
+
+    ComPtr<IUIAutomation> automation;
+    ComPtr<IUIAutomationTreeWalker> walker;
+    bool comInitialized = false;
+};
+
+std::unique_ptr<AccessibilityTree> make_uia_tree()
+{
+    auto tree = std::make_unique<UiaTree>();
+    if (!tree->available()) return nullptr;
+    return tree;
+}
+
+// All processes in one NtQuerySystemInformation call, the buffer is kept and
+// grown between samples. The CPU times sit in the reserved part of the
+// documented SYSTEM_PROCESS_INFORMATION, user time at byte 32, kernel at 40.
+class NtSampler final : public ProcessSampler
+{
+public:
+    bool sample(std::vector<ProcessSample>& out) override
+    {
+        constexpr NTSTATUS infoLengthMismatch = static_cast<NTSTATUS>(0xC0000004L);
+        if (buffer.empty()) buffer.resize(512 * 1024);
+
+        ULONG needed = 0;
+        NTSTATUS status;
+        while ((status = NtQuerySystemInformation(SystemProcessInformation, buffer.data(),
+                                                  static_cast<ULONG>(buffer.size()), &needed)) == infoLengthMismatch)
+        {
+            // processes start between the two calls, leave some room
+            buffer.resize(std::max<size_t>(needed + needed / 4, buffer.size() * 2));
+        }
+        if (status < 0)
+        {
+            // the logger only substitutes plain {}
+            char code[16];
+            snprintf(code, sizeof(code), "0x%08lx", static_cast<unsigned long>(status));
+            LOG_WARN("NtQuerySystemInformation failed: {}", code);
+            return false;
+        }
+
+        out.clear();
+        const auto* entry = buffer.data();
+        while (true)
+        {
+            const auto* process = reinterpret_cast<const SYSTEM_PROCESS_INFORMATION*>(entry);
+            LARGE_INTEGER userTime;
+            LARGE_INTEGER kernelTime;
+            memcpy(&userTime, reinterpret_cast<const BYTE*>(process->Reserved1) + 32, sizeof(userTime));
+            memcpy(&kernelTime, reinterpret_cast<const BYTE*>(process->Reserved1) + 40, sizeof(kernelTime));
+
+            ProcessSample sample;
+            sample.processId = static_cast<DWORD>(reinterpret_cast<ULONG_PTR>(process->UniqueProcessId));
+            // 100 ns units
+            sample.cpuNanoseconds = static_cast<uint64_t>(userTime.QuadPart + kernelTime.QuadPart) * 100;
+            sample.workingSetBytes = process->WorkingSetSize;
+            out.push_back(sample);
+
+            if (process->NextEntryOffset == 0) break;
+            entry += process->NextEntryOffset;
+        }
+        return true;
+    }
+
+private:
+    std::vector<BYTE> buffer;
+};
+
+std::unique_ptr<ProcessSampler> make_nt_sampler()
+{
+    return std::make_unique<NtSampler>();
+}
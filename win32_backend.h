@@ -0,0 +1,23 @@
+#ifndef FINDMYWINDOWS_WIN32_BACKEND_H
+#define FINDMYWINDOWS_WIN32_BACKEND_H
+
+#include <memory>
+
+#include "backend.h"
+#include "browser_tabs.h"
+#include "usage.h"
+
+// Backend over the real Win32 desktop. COM and the virtual desktop manager are
+// set up once on first use, so call it from the thread that runs the message loop.
+WindowBackend& win32_backend();
+
+// A separate instance with its own COM apartment for work on another thread
+std::unique_ptr<WindowBackend> make_win32_backend();
+
+// Browser tabs through UI Automation, for the tab crawler thread
+std::unique_ptr<AccessibilityTree> make_uia_tree();
+
+// CPU and working set of every process from one system-wide query
+std::unique_ptr<ProcessSampler> make_nt_sampler();
+
+#endif //FINDMYWINDOWS_WIN32_BACKEND_H
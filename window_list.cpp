@@ -0,0 +1,248 @@
+#include "window_list.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <filesystem>
+#include <iterator>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <unordered_set>
+
+#include "backend.h"
+#include "file.h"
+#include "fingerprint.h"
+#include "log.h"
+#include "mru.h"
+#include "snapshot.h"
+#include "trace.h"
+
+const std::string FIND_MY_WIN_CONFIG = "findmywindows.txt";
+
+std::vector<WindowInfo> availableWindows;
+
+struct SavedSlot
+{
+    // 0 on lines written before fingerprints
+    WindowFingerprint fingerprint = 0;
+    std::string key;
+};
+
+// "<16 hex digits> <ordering key>", or the ordering key alone
+static SavedSlot parse_saved_slot(const std::string& line)
+{
+    SavedSlot slot;
+    if (line.size() > 17 && line[16] == ' ')
+    {
+        const auto [end, ec] = std::from_chars(line.data(), line.data() + 16, slot.fingerprint, 16);
+        if (ec == std::errc() && end == line.data() + 16)
+        {
+            slot.key = line.substr(17);
+            return slot;
+        }
+        slot.fingerprint = 0;
+    }
+    slot.key = line;
+    return slot;
+}
+
+// The saved order and where it is read from. build_window_list() runs on the
+// reconcile thread too, hence the lock.
+static std::mutex savedOrderMutex;
+static std::string savedOrderPath = FIND_MY_WIN_CONFIG;
+static std::vector<SavedSlot> savedOrder;
+static bool savedOrderLoaded = false;
+static std::filesystem::file_time_type savedOrderTime;
+
+void set_saved_order_path(std::string path)
+{
+    std::lock_guard lock(savedOrderMutex);
+    savedOrderPath = std::move(path);
+    savedOrderLoaded = false;
+}
+
+std::string saved_order_path()
+{
+    std::lock_guard lock(savedOrderMutex);
+    return savedOrderPath;
+}
+
+// Read again only when the file changed
+static std::vector<SavedSlot> saved_order()
+{
+    std::lock_guard lock(savedOrderMutex);
+
+    std::error_code error;
+    const auto modified = std::filesystem::last_write_time(savedOrderPath, error);
+    const auto current = error ? std::filesystem::file_time_type::min() : modified;
+    if (!savedOrderLoaded || current != savedOrderTime)
+    {
+        // also creates the file when it is missing
+        savedOrder.clear();
+        for (const std::string& line : read_strings_from_file(savedOrderPath))
+        {
+            savedOrder.push_back(parse_saved_slot(line));
+        }
+        savedOrderLoaded = true;
+        savedOrderTime = current;
+    }
+    return savedOrder;
+}
+
+// Fingerprints the windows of the apps a saved fingerprint names, only they need
+// their class and title before the list is ordered
+static void fingerprint_saved_apps(WindowBackend& backend, const std::span<WindowInfo> windows,
+                                   const std::span<const SavedSlot> saved)
+{
+    std::unordered_set<std::string_view> keys;
+    for (const SavedSlot& slot : saved)
+    {
+        if (slot.fingerprint != 0) keys.insert(slot.key);
+    }
+    if (keys.empty()) return;
+
+    for (WindowInfo& window : windows)
+    {
+        if (keys.contains(ordering_key(window)))
+        {
+            resolve_window_fields(backend, std::span(&window, 1), ALL_WINDOW_FIELDS);
+        }
+    }
+    // the others stay without a fingerprint
+    fingerprint_windows(backend, windows);
+}
+
+template <typename T>
+T* safeGet(std::vector<T>& vec, size_t idx)
+{
+    return idx < vec.size() ? &vec[idx] : nullptr;
+}
+
+void handle_sht(std::vector<WindowInfo>* windows, int trigger_key)
+{
+    if (windows->empty())
+    {
+        LOG_WARN("No windows found");
+        return;
+    }
+
+    if (const auto win = safeGet(*windows, trigger_key - 1))
+    {
+        BringWindowToFront(win->hwnd);
+    }
+}
+
+void handle_previous(std::vector<WindowInfo>*, int)
+{
+    const HWND current = window_backend().foreground();
+    while (const HWND previous = mru_stack().previous(current))
+    {
+        if (BringWindowToFront(previous, current)) return;
+        // closed without a destroy notification reaching us, try the one before
+        mru_stack().remove(previous);
+    }
+    LOG_DEBUG("No previous window to switch to");
+}
+
+const std::string& ordering_key(const WindowInfo& window)
+{
+    return window.package.empty() ? window.processName : window.package;
+}
+
+std::string saved_order_line(const WindowInfo& window)
+{
+    if (window.fingerprint == 0) return ordering_key(window);
+
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(window.fingerprint));
+    return std::string(hex) + ' ' + ordering_key(window);
+}
+
+std::vector<WindowInfo> build_window_list(WindowBackend& backend)
+{
+    // in lazy mode only what the ordering looks at is fetched, the ordering key of every
+    // window and the rest for the apps with a saved fingerprint. The rules fetch their own.
+    const std::vector<SavedSlot> saved = saved_order();
+    WindowFields fields = saved.empty() ? 0 : FIELD_PROCESS;
+    if (trace_recording()) fields = ALL_WINDOW_FIELDS;
+
+    std::vector<WindowInfo> initialWindows = ListWindowsByDesktop(backend, true, fields);
+    fingerprint_saved_apps(backend, initialWindows, saved);
+
+    std::vector<WindowInfo> finalWindowList;
+    finalWindowList.reserve(initialWindows.size());
+
+    // the window each fingerprint points at, even after its title changed, then for
+    // old lines and for apps that came back with fewer windows the first one of the
+    // same process
+    FingerprintMatcher matcher(initialWindows);
+    std::vector<WindowFingerprint> fingerprints;
+    fingerprints.reserve(saved.size());
+    for (const SavedSlot& slot : saved) fingerprints.push_back(slot.fingerprint);
+    const std::vector<size_t> matched = matcher.match(fingerprints);
+    for (size_t s = 0; s < saved.size(); ++s)
+    {
+        size_t index = matched[s];
+        for (size_t i = 0; index == SIZE_MAX && i < initialWindows.size(); ++i)
+        {
+            if (!matcher.taken(i) && ordering_key(initialWindows[i]) == saved[s].key)
+            {
+                index = i;
+                matcher.take(i);
+            }
+        }
+        if (index != SIZE_MAX) finalWindowList.push_back(std::move(initialWindows[index]));
+    }
+
+    // the rest keep their enumeration order
+    for (size_t i = 0; i < initialWindows.size(); ++i)
+    {
+        if (!matcher.taken(i)) finalWindowList.push_back(std::move(initialWindows[i]));
+    }
+
+    // pinned windows take their slot, everything else shifts down around them
+    const auto pinned = std::ranges::stable_partition(finalWindowList, [](const WindowInfo& window)
+    {
+        return window.pinnedSlot == 0;
+    });
+    std::vector<WindowInfo> pinnedWindows(std::make_move_iterator(pinned.begin()),
+                                          std::make_move_iterator(pinned.end()));
+    finalWindowList.erase(pinned.begin(), pinned.end());
+
+    std::ranges::stable_sort(pinnedWindows, {}, &WindowInfo::pinnedSlot);
+    for (auto& window : pinnedWindows)
+    {
+        const size_t slot = std::min(static_cast<size_t>(window.pinnedSlot - 1), finalWindowList.size());
+        finalWindowList.insert(finalWindowList.begin() + static_cast<ptrdiff_t>(slot), std::move(window));
+    }
+
+    return finalWindowList;
+}
+
+// what IPC clients asked the published list for, owner thread only
+static WindowFields publishedFields = 0;
+
+void apply_window_list(std::vector<WindowInfo> windows)
+{
+    if (trace_recording())
+    {
+        trace_window_list(availableWindows, windows);
+    }
+
+    availableWindows = std::move(windows);
+    resolve_window_fields(window_backend(), availableWindows, publishedFields);
+    publish_snapshot(availableWindows);
+}
+
+void publish_window_fields(const WindowFields fields)
+{
+    publishedFields = fields;
+    resolve_window_fields(window_backend(), availableWindows, publishedFields);
+    publish_snapshot(availableWindows);
+}
+
+void load_window_list()
+{
+    apply_window_list(build_window_list(window_backend()));
+}
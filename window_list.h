@@ -0,0 +1,56 @@
+#ifndef FINDMYWINDOWS_WINDOW_LIST_H
+#define FINDMYWINDOWS_WINDOW_LIST_H
+
+#include <string>
+#include <vector>
+
+#include "tabs.h"
+
+class WindowBackend;
+
+// Saved slot order, one window per line, see saved_order_line()
+extern const std::string FIND_MY_WIN_CONFIG;
+
+// Where the saved order is read and written, FIND_MY_WIN_CONFIG in the working
+// directory unless set, any thread
+void set_saved_order_path(std::string path);
+std::string saved_order_path();
+
+// The ordered list the hotkeys and the switcher work on
+extern std::vector<WindowInfo> availableWindows;
+
+// What the saved order stores for a window, its process name or for a UWP app its
+// package, several of them can share an executable (WWAHost.exe)
+const std::string& ordering_key(const WindowInfo& window);
+
+// "<fingerprint as 16 hex digits> <ordering key>", the key alone for a window without
+// a fingerprint. The list puts the window the fingerprint matches in that slot and
+// falls back to the key for lines without one.
+std::string saved_order_line(const WindowInfo& window);
+
+// Enumerates and applies the saved order without touching availableWindows,
+// safe to run on another thread with its own backend
+std::vector<WindowInfo> build_window_list(WindowBackend& backend);
+
+// Makes windows the current list and publishes the snapshot. Owner thread only.
+void apply_window_list(std::vector<WindowInfo> windows);
+
+// Fields every list published from now on carries, resolved on the current list
+// right away, 0 for what the list needs alone. For IPC clients, which read the
+// snapshot on their own thread. Owner thread only.
+void publish_window_fields(WindowFields fields);
+
+// build_window_list() on the current backend followed by apply_window_list()
+void load_window_list();
+
+// Ctrl+N: activates the window in slot trigger_key
+void handle_sht(std::vector<WindowInfo>* windows, int trigger_key);
+
+// Shortcut id of the previous window hotkey, in traces too
+constexpr int PREVIOUS_WINDOW_SHORTCUT = 70;
+
+// Ctrl+0: toggles to the window focused before the current one. Served from
+// mru_stack() alone, it never looks at the window list or enumerates.
+void handle_previous(std::vector<WindowInfo>* windows, int trigger_key);
+
+#endif //FINDMYWINDOWS_WINDOW_LIST_H